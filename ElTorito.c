@@ -5,44 +5,44 @@ static int ElTorito_ValiationEntry (uint8_t buffer[0x20], uint8_t *arch)
 
 	int i;
 
-	printf ("  [ElTorito Valiation Header]\n");
+	TRACE ("  [ElTorito Valiation Header]\n");
 
 	if (buffer[0] != 0x01)
 	{
-		printf ("  Warning - Header ID invalid (expected 0x01, got 0x%02" PRIx8 "\n", buffer[0]);
+		TRACE ("  Warning - Header ID invalid (expected 0x01, got 0x%02" PRIx8 "\n", buffer[0]);
 		retval = 1;
 	}
 
 	*arch = buffer[1];
 	switch (buffer[1])
 	{
-		case 0x00: printf ("   PlatformID=80x86\n"); break;
-		case 0x01: printf ("   PlatformID=PowerPC\n"); break;
-		case 0x02: printf ("   PlatformID=Mac\n"); break;
-		case 0xef: printf ("   PlatformID=EFI?\n"); break; /* guess based on data found */
-		default:   printf ("   PlatformID=Unknown 0x%02" PRIx8 "\n", buffer[1]);
+		case 0x00: TRACE ("   PlatformID=80x86\n"); break;
+		case 0x01: TRACE ("   PlatformID=PowerPC\n"); break;
+		case 0x02: TRACE ("   PlatformID=Mac\n"); break;
+		case 0xef: TRACE ("   PlatformID=EFI?\n"); break; /* guess based on data found */
+		default:   TRACE ("   PlatformID=Unknown 0x%02" PRIx8 "\n", buffer[1]);
 	}
 
 	if (buffer[2] != 0x00)
 	{
-		printf ("   Warning - Reserved header at offset 2 if not 0x00, but 0x%02" PRIx8 "\n", buffer[2]);
+		TRACE ("   Warning - Reserved header at offset 2 if not 0x00, but 0x%02" PRIx8 "\n", buffer[2]);
 	}
 
 	if (buffer[3] != 0x00)
 	{
-		printf ("   Warning - Reserved header at offset 3 if not 0x00, but 0x%02" PRIx8 "\n", buffer[3]);
+		TRACE ("   Warning - Reserved header at offset 3 if not 0x00, but 0x%02" PRIx8 "\n", buffer[3]);
 	}
 
-	printf ("   IDstring=\"");
+	TRACE ("   IDstring=\"");
 	for (i=0x04; i <= 0x1b; i++)
 	{
 		if (!buffer[i])
 		{
 			break;
 		}
-		putchar (buffer[i]);
+		TRACE_PUTCHAR (buffer[i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
 	/* not much tested... */
 	for (i=0; i < 0x10; i++)
@@ -53,20 +53,20 @@ static int ElTorito_ValiationEntry (uint8_t buffer[0x20], uint8_t *arch)
 	}
 	if (checksumA)
 	{
-		printf ("   Warning, Checksum failed (got 0x%04" PRIx16", but expected 0x0000 )!\n", checksumA);
+		TRACE ("   Warning, Checksum failed (got 0x%04" PRIx16", but expected 0x0000 )!\n", checksumA);
 		retval = 1;
 	} else {
-		printf ("   Checksum correct\n");
+		TRACE ("   Checksum correct\n");
 	}
 
 	if (buffer[0x1e] != 0x55)
 	{
-		printf ("   KeySignature #1 is not 0x55, but 0x%02" PRIx8 "\n", buffer[0x1e]);
+		TRACE ("   KeySignature #1 is not 0x55, but 0x%02" PRIx8 "\n", buffer[0x1e]);
 	}
 
 	if (buffer[0x1f] != 0xaa)
 	{
-		printf ("   KeySignature #2 is not 0xaa, but 0x%02" PRIx8 "\n", buffer[0x1f]);
+		TRACE ("   KeySignature #2 is not 0xaa, but 0x%02" PRIx8 "\n", buffer[0x1f]);
 	}
 
 	return retval;
@@ -77,38 +77,38 @@ static int ElTorito_SectionHeaderEntry (uint8_t buffer[0x20], int index1, int *l
 	int retval = 0;
 	int i;
 
-	printf ("  [Section Header Entry %d]\n", index1);
+	TRACE ("  [Section Header Entry %d]\n", index1);
 
 	switch (buffer[0])
 	{
-		case 0x90: printf ("   More section headers will follow\n"); *last = 0; break;
-		case 0x91: printf ("   This is the last header\n"); *last = 1; break;
-		default: printf ("   Invalid header ID: 0x%02" PRIx8 "\n", buffer[0]); retval = 1; break;
+		case 0x90: TRACE ("   More section headers will follow\n"); *last = 0; break;
+		case 0x91: TRACE ("   This is the last header\n"); *last = 1; break;
+		default: TRACE ("   Invalid header ID: 0x%02" PRIx8 "\n", buffer[0]); retval = 1; break;
 	}
 
 	*arch = buffer[1];
 	switch (buffer[1])
 	{
-		case 0x00: printf ("   PlatformID=80x86\n"); break;
-		case 0x01: printf ("   PlatformID=PowerPC\n"); break;
-		case 0x02: printf ("   PlatformID=Mac\n"); break;
-		case 0xef: printf ("   PlatformID=EFI?\n"); break; /* guess based on data found */
-		default:   printf ("   PlatformID=Unknown 0x%02" PRIx8 "\n", buffer[1]);
+		case 0x00: TRACE ("   PlatformID=80x86\n"); break;
+		case 0x01: TRACE ("   PlatformID=PowerPC\n"); break;
+		case 0x02: TRACE ("   PlatformID=Mac\n"); break;
+		case 0xef: TRACE ("   PlatformID=EFI?\n"); break; /* guess based on data found */
+		default:   TRACE ("   PlatformID=Unknown 0x%02" PRIx8 "\n", buffer[1]);
 	}
 
 	*sections = (buffer[3] << 8) | buffer[2];
-	printf ("   Sections: %" PRId16 "\n", *sections);
+	TRACE ("   Sections: %" PRId16 "\n", *sections);
 
-	printf ("   IDstring=\"");
+	TRACE ("   IDstring=\"");
 	for (i=0x04; i <= 0x1f; i++)
 	{
 		if (!buffer[i])
 		{
 			break;
 		}
-		putchar(buffer[i]);
+		TRACE_PUTCHAR(buffer[i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
 	return retval;
 }
@@ -120,26 +120,26 @@ static int ElTorito_SectionEntry (const uint8_t arch, uint8_t buffer[0x20], int
 
 	if (index1 == 0)
 	{
-		printf ("   [Initial/Default Entry]\n");
+		TRACE ("   [Initial/Default Entry]\n");
 	} else {
-		printf ("   [Section Entry %d.%d\n", index1, index2+1);
+		TRACE ("   [Section Entry %d.%d\n", index1, index2+1);
 	}
 
 	switch (buffer[0])
 	{
-		case 0x88: printf ("    Bootable\n"); break;
-		case 0x00: printf ("    Not bootable\n"); break;
-		default:   printf ("    Invalid indicator: 0x%02" PRIx8 "\n", buffer[0]); retval = 1; break;
+		case 0x88: TRACE ("    Bootable\n"); break;
+		case 0x00: TRACE ("    Not bootable\n"); break;
+		default:   TRACE ("    Invalid indicator: 0x%02" PRIx8 "\n", buffer[0]); retval = 1; break;
 	}
 
 	switch (buffer[1] & 0x0f)
 	{
-		case 0x00: printf ("    No Emulation (?)\n"); break;
-		case 0x01: printf ("    1.2 meg diskette\n"); break;
-		case 0x02: printf ("    1.44 meg diskette\n"); break;
-		case 0x03: printf ("    2.88 meg diskette\n"); break;
-		case 0x04: printf ("    Hard Disk (drive 80)\n"); break;
-		default: printf ("    Invalid media type: 0x%02" PRIx8 "\n", buffer[1]); retval = 1; break;
+		case 0x00: TRACE ("    No Emulation (?)\n"); break;
+		case 0x01: TRACE ("    1.2 meg diskette\n"); break;
+		case 0x02: TRACE ("    1.44 meg diskette\n"); break;
+		case 0x03: TRACE ("    2.88 meg diskette\n"); break;
+		case 0x04: TRACE ("    Hard Disk (drive 80)\n"); break;
+		default: TRACE ("    Invalid media type: 0x%02" PRIx8 "\n", buffer[1]); retval = 1; break;
 	}
 
 	if (arch == 0x00) /* 80x86 */
@@ -147,30 +147,30 @@ static int ElTorito_SectionEntry (const uint8_t arch, uint8_t buffer[0x20], int
 		uint16_t segment = (buffer[3] << 8) | buffer[2];
 		if (segment == 0x0000)
 		{
-			printf ("    Load into default memory =>  [07c0:0000]\n");
+			TRACE ("    Load into default memory =>  [07c0:0000]\n");
 		} else {
-			printf ("    Load into memory [%04" PRIx16 ":0000]\n", segment);
+			TRACE ("    Load into memory [%04" PRIx16 ":0000]\n", segment);
 		}
 	} else {
 		uint32_t addr = (buffer[2] << 12) | (buffer[3] << 4);
-		printf ("    Load into memory [%08" PRIx32"]\n", addr);
+		TRACE ("    Load into memory [%08" PRIx32"]\n", addr);
 	}
 
-	printf ("    System Type (should match the active partion from disk image if hard drive): %s\n", PartitionType(buffer[4]));
+	TRACE ("    System Type (should match the active partion from disk image if hard drive): %s\n", PartitionType(buffer[4]));
 
 	if (buffer[5] != 0x00)
 	{
-		printf ("    Warning - Reserved header at offset 5 if not 0x00, but 0x%02" PRIx8 "\n", buffer[5]);
+		TRACE ("    Warning - Reserved header at offset 5 if not 0x00, but 0x%02" PRIx8 "\n", buffer[5]);
 	}
 
 	{
 		uint16_t sectorcount = (buffer[7] << 8) | buffer[6];
-		printf ("    Sectors to load: %" PRId16 "\n", sectorcount);
+		TRACE ("    Sectors to load: %" PRId16 "\n", sectorcount);
 	}
 
 	{
 		int32_t rba = (buffer[11] << 24) | (buffer[10] << 16) | (buffer[9] << 8) | buffer[8];
-		printf ("    Relative offset to start of image: %" PRId32"\n", rba);
+		TRACE ("    Relative offset to start of image: %" PRId32"\n", rba);
 	}
 
 	if (index1 == 0)
@@ -179,24 +179,24 @@ static int ElTorito_SectionEntry (const uint8_t arch, uint8_t buffer[0x20], int
 		{
 			if (buffer[i])
 			{
-				printf ("    Warning - Reserved header at offset %d if not 0x00, but 0x%02" PRIx8 "\n", i, buffer[i]);
+				TRACE ("    Warning - Reserved header at offset %d if not 0x00, but 0x%02" PRIx8 "\n", i, buffer[i]);
 			}
 		}
 	} else {
 		if (buffer[0x0c] == 0x00)
 		{
-			printf ("   No selection criteria\n");
+			TRACE ("   No selection criteria\n");
 		} else if (buffer[0x0c] == 0x01)
 		{
-			printf ("    Language and Version Information (IBM)\n");
-			printf ("   ");
+			TRACE ("    Language and Version Information (IBM)\n");
+			TRACE ("   ");
 			for (i=0x0d; i <= 0x1f; i++)
 			{
-				printf (" 0x%02" PRIx8 "\n", buffer[i]);
+				TRACE (" 0x%02" PRIx8 "\n", buffer[i]);
 			}
-			printf ("\n");
+			TRACE ("\n");
 		} else {
-			printf ("   Invalid selection criteria type: 0x%02" PRIx8 "\n", buffer[0x0c]);
+			TRACE ("   Invalid selection criteria type: 0x%02" PRIx8 "\n", buffer[0x0c]);
 			retval = 1;
 		}
 	}
@@ -209,11 +209,11 @@ static int ElTorito_SectionEntryExtension (uint8_t buffer[0x20], int index1, int
 	int retval = 0;
 	int i;
 
-	printf ("    [Section Entry Extension %d.%d.%d\n", index1, index2+1, index3);
+	TRACE ("    [Section Entry Extension %d.%d.%d\n", index1, index2+1, index3);
 
 	if (buffer[0] != 0x44)
 	{
-		printf ("     Invalid ID indicator: 0x%02" PRIx8 "\n", buffer[0]);
+		TRACE ("     Invalid ID indicator: 0x%02" PRIx8 "\n", buffer[0]);
 		retval = 1;
 	}
 
@@ -221,78 +221,184 @@ static int ElTorito_SectionEntryExtension (uint8_t buffer[0x20], int index1, int
 
 	for (i=0x02; i <= 0x1f; i++)
 	{
-		printf (" 0x%02" PRIx8 "\n", buffer[i]);
+		TRACE (" 0x%02" PRIx8 "\n", buffer[i]);
 	}
-	putchar ('\n');
+	TRACE_PUTCHAR ('\n');
 
 	return retval;
 }
 
-static int ElTorito_check_offset (struct cdfs_disc_t *disc, uint32_t *sector, uint8_t *buffer, int *offset)
+#define ELTORITO_CATALOG_BATCH 4 /* most catalogs fit in the first sector, but the sections can continue into the next ones */
+
+struct ElTorito_reader_t
 {
-	if (*offset >= SECTORSIZE)
-	{
-		*sector = (*sector) + 1;
-		*offset = 0;
+	struct cdfs_disc_t *disc;
+	uint32_t            sector; /* first sector in buffer */
+	uint32_t            count;  /* sectors available in buffer */
+	uint8_t             buffer[ELTORITO_CATALOG_BATCH * SECTORSIZE];
+};
+
+static int ElTorito_reader_fetch (struct ElTorito_reader_t *r, uint32_t sector)
+{
+	uint32_t end = cdfs_disc_sectorcount (r->disc);
+	uint32_t count = ELTORITO_CATALOG_BATCH;
 
-		if (get_absolute_sector_2048 (disc, *sector, buffer))
+	if (sector >= end)
+	{
+		return -1;
+	}
+	if (count > (end - sector))
+	{
+		count = end - sector;
+	}
+	if (get_absolute_sectors_2048 (r->disc, sector, count, r->buffer))
+	{ /* a bad sector later in the batch should not hide the catalog */
+		count = 1;
+		if (get_absolute_sector_2048 (r->disc, sector, r->buffer))
 		{
-			printf ("\n Failed to fetch next El Torito boot description at absolute sector%"PRId32"\n", *sector);
 			return -1;
 		}
+	}
+	r->sector = sector;
+	r->count = count;
+	return 0;
+}
+
+static struct ElTorito_entry_t *ElTorito_catalog_append (struct ElTorito_catalog_t *catalog, const uint8_t arch, const uint8_t buffer[0x20], int index1)
+{
+	struct ElTorito_entry_t *entry;
+
+	if (catalog->entries_count == catalog->entries_size)
+	{
+		struct ElTorito_entry_t *temp = realloc (catalog->entries_data, sizeof (catalog->entries_data[0]) * (catalog->entries_size + 16));
+		if (!temp)
+		{
+			fprintf (stderr, "ElTorito_catalog_append() realloc() failed\n");
+			return 0;
+		}
+		catalog->entries_data = temp;
+		catalog->entries_size += 16;
+	}
+	entry = &catalog->entries_data[catalog->entries_count++];
+	memset (entry, 0, sizeof (*entry));
+
+	entry->Platform    = arch;
+	entry->Bootable    = buffer[0] == 0x88;
+	entry->Media       = buffer[1] & 0x0f;
+	entry->LoadSegment = (buffer[3] << 8) | buffer[2];
+	entry->SystemType  = buffer[4];
+	entry->SectorCount = (buffer[7] << 8) | buffer[6];
+	entry->LoadRBA     = (buffer[11] << 24) | (buffer[10] << 16) | (buffer[9] << 8) | buffer[8];
+	if (index1)
+	{
+		entry->SelectionCriteriaType = buffer[0x0c];
+		memcpy (entry->SelectionCriteria, buffer + 0x0d, sizeof (entry->SelectionCriteria));
+	}
+
+	return entry;
+}
+
+static void ElTorito_Catalog_Free (struct ElTorito_catalog_t *catalog)
+{
+	if (!catalog) return;
+	free (catalog->entries_data);
+	free (catalog);
+}
+
+static int ElTorito_check_offset (struct ElTorito_reader_t *r, int *offset)
+{
+	if ((*offset) && !((*offset) % SECTORSIZE))
+	{
+		uint32_t sector = r->sector + (*offset) / SECTORSIZE;
+
+		if ((*offset) >= (r->count * SECTORSIZE))
+		{
+			*offset = 0;
+
+			if (ElTorito_reader_fetch (r, sector))
+			{
+				TRACE ("\n Failed to fetch next El Torito boot description at absolute sector%"PRId32"\n", sector);
+				return -1;
+			}
+		}
 
-		printf ("\n ElTorito data at absolute sector %"PRId32"\n", *sector);
+		TRACE ("\n ElTorito data at absolute sector %"PRId32"\n", sector);
 	}
 	return 0;
 }
 
-static void ElTorito_abs_sector (struct cdfs_disc_t *disc, uint32_t sector)
+static struct ElTorito_catalog_t *ElTorito_abs_sector (struct cdfs_disc_t *disc, uint32_t sector)
 {
-	uint8_t buffer[SECTORSIZE];
+	struct ElTorito_reader_t *r;
+	struct ElTorito_catalog_t *catalog;
+	struct ElTorito_entry_t *entry;
+	uint8_t *buffer;
 	uint8_t arch;
 	int i, j;
 	int offset = 0;
 	int lastheader = 0;
 
-	if (get_absolute_sector_2048 (disc, sector, buffer))
+	r = malloc (sizeof (*r));
+	catalog = calloc (sizeof (*catalog), 1);
+	if (!r || !catalog)
 	{
-		printf ("Failed to fetch El Torito boot description at absolute sector%"PRId32"\n", sector);
-		return;
+		fprintf (stderr, "ElTorito_abs_sector() malloc() failed\n");
+		free (r);
+		free (catalog);
+		return 0;
 	}
+	r->disc = disc;
+	buffer = r->buffer;
+	catalog->Location = sector;
 
-	printf ("\n ElTorito data at absolute sector %"PRId32"\n", sector);
-	printf ("\n (offset=0x%04x)\n", offset);
+	if (ElTorito_reader_fetch (r, sector))
+	{
+		TRACE ("Failed to fetch El Torito boot description at absolute sector%"PRId32"\n", sector);
+		free (r);
+		ElTorito_Catalog_Free (catalog);
+		return 0;
+	}
+
+	TRACE ("\n ElTorito data at absolute sector %"PRId32"\n", sector);
+	TRACE ("\n (offset=0x%04x)\n", offset);
 	if (ElTorito_ValiationEntry (buffer + offset, &arch))
 	{
-		return;
+		free (r);
+		ElTorito_Catalog_Free (catalog);
+		return 0;
 	}
+	catalog->Platform = arch;
+	memcpy (catalog->IDString, buffer + offset + 0x04, 0x1b - 0x04 + 1);
 	offset += 0x020;
 
-	printf ("\n (offset=0x%04x)\n", offset);
+	TRACE ("\n (offset=0x%04x)\n", offset);
 	if (ElTorito_SectionEntry (arch, buffer + offset, 0, 0))
 	{
-		return;
+		free (r);
+		ElTorito_Catalog_Free (catalog);
+		return 0;
 	}
+	ElTorito_catalog_append (catalog, arch, buffer + offset, 0);
 	offset += 0x020;
 
 
 	if (buffer[offset] == 0x00)
 	{
-		printf ("\n no sections available for further parsing\n");
+		TRACE ("\n no sections available for further parsing\n");
 	} else {
 		for (i=1;; i++)
 		{
 			uint16_t entries = 0;
 
-			if (ElTorito_check_offset (disc, &sector, buffer, &offset))
+			if (ElTorito_check_offset (r, &offset))
 			{
-				return;
+				break;
 			}
 
-			printf ("\n (offset=0x%04x)\n", offset);
+			TRACE ("\n (offset=0x%04x)\n", offset);
 			if (ElTorito_SectionHeaderEntry (buffer + offset, i, &lastheader, &arch, &entries))
 			{
-				return;
+				break;
 			}
 			offset += 0x020;
 
@@ -301,38 +407,43 @@ static void ElTorito_abs_sector (struct cdfs_disc_t *disc, uint32_t sector)
 				int last = 0;
 				int k = 0;
 
-				if (ElTorito_check_offset (disc, &sector, buffer, &offset))
+				if (ElTorito_check_offset (r, &offset))
 				{
-					return;
+					goto out;
 				}
 
-				printf ("\n (offset=0x%04x)\n", offset);
+				TRACE ("\n (offset=0x%04x)\n", offset);
 				if (ElTorito_SectionEntry (arch, buffer + offset, i, j))
 				{
-					return;
+					goto out;
 				}
+				entry = ElTorito_catalog_append (catalog, arch, buffer + offset, i);
 				offset += 0x020;
 
 				while (!last)
 				{
 					k++;
 
-					if (ElTorito_check_offset (disc, &sector, buffer, &offset))
+					if (ElTorito_check_offset (r, &offset))
 					{
-						return;
+						goto out;
 					}
 
 					if (buffer[offset] == 0x00)
 					{
-						printf ("\n no sections entry extension available for further parsing (not according to standard)\n");
+						TRACE ("\n no sections entry extension available for further parsing (not according to standard)\n");
 						last = 1;
 						break;
 					}
 
-					printf ("\n (offset=0x%04x)\n", offset);
+					TRACE ("\n (offset=0x%04x)\n", offset);
 					if (ElTorito_SectionEntryExtension (buffer + offset, i, j, k, &last))
 					{
-						return;
+						goto out;
+					}
+					if (entry)
+					{
+						entry->Extensions++;
 					}
 					offset += 0x020;
 				}
@@ -345,5 +456,189 @@ static void ElTorito_abs_sector (struct cdfs_disc_t *disc, uint32_t sector)
 		}
 	}
 
-	return;
+out: /* entries parsed before an error are kept */
+	free (r);
+	return catalog;
+}
+
+static const char *ElTorito_PlatformName (uint8_t platform)
+{
+	switch (platform)
+	{
+		case 0x00: return "x86";
+		case 0x01: return "ppc";
+		case 0x02: return "mac";
+		case 0xef: return "efi";
+		default:   return "unknown";
+	}
+}
+
+/* Number of bytes the boot image covers. SectorCount is only what the BIOS loads, so the emulated media and the image headers are used when possible.
+ * Returns 0 if LoadRBA is past the end of the disc */
+static uint64_t ElTorito_ImageLength (struct cdfs_disc_t *disc, const struct ElTorito_entry_t *entry)
+{
+	uint8_t buffer[SECTORSIZE];
+	uint32_t discend = cdfs_disc_sectorcount (disc);
+	uint64_t retval = (uint64_t)entry->SectorCount * 512;
+	uint64_t end;
+	int i;
+
+	if (entry->LoadRBA >= discend)
+	{
+		return 0;
+	}
+	end = (uint64_t)(discend - entry->LoadRBA) * SECTORSIZE;
+
+	switch (entry->Media)
+	{
+		case 0x01: retval = 1200 * 1024; break;
+		case 0x02: retval = 1440 * 1024; break;
+		case 0x03: retval = 2880 * 1024; break;
+		case 0x04:
+		case 0x00:
+			if (get_absolute_sector_2048 (disc, entry->LoadRBA, buffer) ||
+			    (buffer[510] != 0x55) ||
+			    (buffer[511] != 0xaa))
+			{
+				break;
+			}
+			if (entry->Media == 0x04)
+			{ /* the image is a hard disk, use the end of the last partition */
+				uint64_t last = 0;
+				for (i=0; i < 4; i++)
+				{
+					uint8_t *p = buffer + 0x1be + (i << 4);
+					uint64_t first  = p[8]  | (p[9]  << 8) | (p[10] << 16) | ((uint32_t)p[11] << 24);
+					uint64_t length = p[12] | (p[13] << 8) | (p[14] << 16) | ((uint32_t)p[15] << 24);
+					if (p[4] && ((first + length) > last))
+					{
+						last = first + length;
+					}
+				}
+				if (last)
+				{
+					retval = last * 512;
+				}
+			} else if ((entry->SectorCount <= 1) && ((buffer[0] == 0xeb) || (buffer[0] == 0xe9)))
+			{ /* No Emulation images (EFI) often only state one sector, try the FAT boot sector */
+				uint16_t bytespersector = buffer[11] | (buffer[12] << 8);
+				uint32_t sectors = buffer[19] | (buffer[20] << 8);
+				if (!sectors)
+				{
+					sectors = buffer[32] | (buffer[33] << 8) | (buffer[34] << 16) | ((uint32_t)buffer[35] << 24);
+				}
+				if ((bytespersector >= 512) && (bytespersector <= 4096) && !(bytespersector & (bytespersector - 1)) && sectors)
+				{
+					retval = (uint64_t)sectors * bytespersector;
+				}
+			}
+			break;
+	}
+
+	if (retval > end)
+	{
+		retval = end;
+	}
+	return retval;
+}
+
+#define ELTORITO_EXTRACT_BATCH 32
+
+int ElTorito_Extract (struct cdfs_disc_t *disc, const char *directory)
+{
+	struct ElTorito_catalog_t *catalog;
+	uint8_t *buffer;
+	int retval = 0;
+	int i;
+
+	if ((!disc->iso9660_session) || (!disc->iso9660_session->ElTorito))
+	{
+		fprintf (stderr, "No El Torito boot catalog found\n");
+		return -1;
+	}
+	catalog = disc->iso9660_session->ElTorito;
+
+	buffer = malloc (ELTORITO_EXTRACT_BATCH * SECTORSIZE);
+	if (!buffer)
+	{
+		fprintf (stderr, "ElTorito_Extract() malloc() failed\n");
+		return -1;
+	}
+
+	for (i=0; i < catalog->entries_count; i++)
+	{
+		struct ElTorito_entry_t *entry = &catalog->entries_data[i];
+		uint64_t length = ElTorito_ImageLength (disc, entry);
+		uint32_t sector = entry->LoadRBA;
+		char *filename;
+		int fd;
+
+		if (entry->LoadRBA >= cdfs_disc_sectorcount (disc))
+		{
+			fprintf (stderr, "Skipping El Torito entry %d, sector %" PRIu32 " is past the end of the disc\n", i, entry->LoadRBA);
+			retval = -1;
+			continue;
+		}
+
+		filename = malloc (strlen (directory) + 32);
+		if (!filename)
+		{
+			fprintf (stderr, "ElTorito_Extract() malloc() failed\n");
+			retval = -1;
+			break;
+		}
+		sprintf (filename, "%s/boot%02d-%s.img", directory, i, ElTorito_PlatformName (entry->Platform));
+
+		fd = open (filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+		{
+			fprintf (stderr, "open(\"%s\") failed: %s\n", filename, strerror (errno));
+			free (filename);
+			retval = -1;
+			continue;
+		}
+
+		TRACE ("Extracting El Torito entry %d to %s, %" PRIu64 " bytes from sector %" PRIu32 "\n", i, filename, length, entry->LoadRBA);
+
+		while (length)
+		{
+			uint32_t count = ELTORITO_EXTRACT_BATCH;
+			uint64_t bytes;
+
+			if (((uint64_t)count * SECTORSIZE) > length)
+			{
+				count = (length + SECTORSIZE - 1) / SECTORSIZE;
+			}
+			bytes = (uint64_t)count * SECTORSIZE;
+			if (bytes > length)
+			{
+				bytes = length;
+			}
+
+			if (get_absolute_sectors_2048 (disc, sector, count, buffer))
+			{
+				fprintf (stderr, "Failed to read boot image %s at sector %" PRIu32 "\n", filename, sector);
+				retval = -1;
+				break;
+			}
+			if (DumpFS_extract_write (fd, buffer, bytes))
+			{
+				fprintf (stderr, "write(\"%s\") failed: %s\n", filename, strerror (errno));
+				retval = -1;
+				break;
+			}
+			sector += count;
+			length -= bytes;
+		}
+
+		if (close (fd))
+		{
+			fprintf (stderr, "close(\"%s\") failed: %s\n", filename, strerror (errno));
+			retval = -1;
+		}
+		free (filename);
+	}
+
+	free (buffer);
+	return retval;
 }
@@ -4,22 +4,22 @@ static void decode_amiga_AS (struct Volume_Description_t *self, uint8_t *buffer)
 	uint8_t *b = buffer + 4;
 	uint8_t flags;
 
-	printf ("       Amiga\n");
+	TRACE ("       Amiga\n");
 
 	if (buffer[2] < 5)
 	{
-		printf ("WARNING - Length is way too short\n");
+		TRACE ("WARNING - Length is way too short\n");
 		return;
 	}
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
-	printf ("        Flags: 0x%02" PRIx8 "\n", buffer[4]);
-	if (buffer[4] & 0x01) printf ("         Protection present\n");
-	if (buffer[4] & 0x02) printf ("         Comment present\n");
-	if (buffer[4] & 0x04) printf ("         Comment continues in next AS record\n");
+	TRACE ("        Flags: 0x%02" PRIx8 "\n", buffer[4]);
+	if (buffer[4] & 0x01) TRACE ("         Protection present\n");
+	if (buffer[4] & 0x02) TRACE ("         Comment present\n");
+	if (buffer[4] & 0x04) TRACE ("         Comment continues in next AS record\n");
 
 	flags = buffer[4];
 
@@ -27,28 +27,28 @@ static void decode_amiga_AS (struct Volume_Description_t *self, uint8_t *buffer)
 	{
 		if (l < 4)
 		{
-			printf ("WARNING - Length is way too short #2\n");
+			TRACE ("WARNING - Length is way too short #2\n");
 			return;
 		}
-		printf ("        Protection User:       0x%02" PRIx8 "\n", b[0]);
-		printf ("        Protection Reserved:   0x%02" PRIx8 "\n", b[1]);
-		printf ("        Protection Multiuser:  0x%02" PRIx8 "\n", b[2]);
-		if (b[2] & 0x01) printf ("         Deletable for group members\n");
-		if (b[2] & 0x02) printf ("         Executable for group members\n");
-		if (b[2] & 0x04) printf ("         Writable for group members\n");
-		if (b[2] & 0x08) printf ("         Readable for group members\n");
-		if (b[2] & 0x10) printf ("         Deletable for other users\n");
-		if (b[2] & 0x20) printf ("         Executable for other users\n");
-		if (b[2] & 0x40) printf ("         Writable for other users\n");
-		if (b[2] & 0x80) printf ("         Readable for other users\n");
-		printf ("        Protection Protection: 0x%02" PRIx8 "\n", b[3]);
-		if (b[3] & 0x01) printf ("         Not deletable for owner\n");
-		if (b[3] & 0x02) printf ("         Not executable for owner\n");
-		if (b[3] & 0x04) printf ("         Not writable for owner\n");
-		if (b[3] & 0x08) printf ("         Not readable for owner\n");
-		if (b[3] & 0x10) printf ("         Archived\n");
-		if (b[2] & 0x20) printf ("         Reentrant executable\n");
-		if (b[3] & 0x40) printf ("         Executable script\n");
+		TRACE ("        Protection User:       0x%02" PRIx8 "\n", b[0]);
+		TRACE ("        Protection Reserved:   0x%02" PRIx8 "\n", b[1]);
+		TRACE ("        Protection Multiuser:  0x%02" PRIx8 "\n", b[2]);
+		if (b[2] & 0x01) TRACE ("         Deletable for group members\n");
+		if (b[2] & 0x02) TRACE ("         Executable for group members\n");
+		if (b[2] & 0x04) TRACE ("         Writable for group members\n");
+		if (b[2] & 0x08) TRACE ("         Readable for group members\n");
+		if (b[2] & 0x10) TRACE ("         Deletable for other users\n");
+		if (b[2] & 0x20) TRACE ("         Executable for other users\n");
+		if (b[2] & 0x40) TRACE ("         Writable for other users\n");
+		if (b[2] & 0x80) TRACE ("         Readable for other users\n");
+		TRACE ("        Protection Protection: 0x%02" PRIx8 "\n", b[3]);
+		if (b[3] & 0x01) TRACE ("         Not deletable for owner\n");
+		if (b[3] & 0x02) TRACE ("         Not executable for owner\n");
+		if (b[3] & 0x04) TRACE ("         Not writable for owner\n");
+		if (b[3] & 0x08) TRACE ("         Not readable for owner\n");
+		if (b[3] & 0x10) TRACE ("         Archived\n");
+		if (b[2] & 0x20) TRACE ("         Reentrant executable\n");
+		if (b[3] & 0x40) TRACE ("         Executable script\n");
 
 		b+=4;
 		l-=4;
@@ -59,15 +59,15 @@ static void decode_amiga_AS (struct Volume_Description_t *self, uint8_t *buffer)
 		int i;
 		if ((l < 1) || (l < b[0]))
 		{
-			printf ("WARNING - Length is way too short #3\n");
+			TRACE ("WARNING - Length is way too short #3\n");
 			return;
 		}
-		printf ("        Comment: \"");
+		TRACE ("        Comment: \"");
 		for (i=1; i < l; i++)
 		{
-			putchar (b[i]);
+			TRACE_PUTCHAR (b[i]);
 		}
-		printf ("\"\n");
+		TRACE ("\"\n");
 		b += i;
 		l -= i;
 	}
@@ -1,5 +1,7 @@
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,6 +12,7 @@
 
 #include "cdfs.h"
 #include "iso9660.h"
+#include "main.h"
 
 int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_size, enum cdfs_format_t *isofile_format, uint32_t *isofile_sectorcount)
 {
@@ -37,7 +40,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 	     (buffer[4] == '0') &&
 	     (buffer[5] == '1')))
 	{
-		printf ("%s: detected as ISO file format, containing only data as is\n", filename);
+		TRACE ("%s: detected as ISO file format, containing only data as is\n", filename);
 		*isofile_format = FORMAT_MODE_1__XA_MODE2_FORM1___NONE;
 		*isofile_sectorcount = st_size / 2048;
 		return 0;
@@ -67,7 +70,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 	      (buffer[8+4] == '0') &&
 	      (buffer[8+5] == '1'))))
 	{
-		printf ("%s: detected as ISO file format, each sector prefixed with XA1 header (8 bytes)\n", filename);
+		TRACE ("%s: detected as ISO file format, each sector prefixed with XA1 header (8 bytes)\n", filename);
 		*isofile_format = FORMAT_XA1_MODE2_FORM1___NONE;
 		*isofile_sectorcount = st_size / (2048 + 8);
 		return 0;
@@ -110,7 +113,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 			     (buffer[12+4+4] =='0') &&
 			     (buffer[12+4+5] =='1')))
 			{
-				printf ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 1 header\n", filename);
+				TRACE ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 1 header\n", filename);
 				*isofile_format = FORMAT_MODE1_RAW___NONE;
 				*isofile_sectorcount = st_size / (SECTORSIZE_XA2);
 				return 0;
@@ -129,7 +132,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 			      (buffer[12+4+4] == '0') &&
 			      (buffer[12+4+5] == '1')))
 			{
-				printf ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2\n", filename);
+				TRACE ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2\n", filename);
 				*isofile_format = FORMAT_MODE2_RAW___NONE;
 				*isofile_sectorcount = st_size / (SECTORSIZE_XA2);
 				return 0;
@@ -148,7 +151,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 			      (buffer[12+4+8+4] == '0') &&
 			      (buffer[12+4+8+5] == '1'))))
 			{
-				printf ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2 FORM 1 header\n", filename);
+				TRACE ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2 FORM 1 header\n", filename);
 				*isofile_format = FORMAT_XA_MODE2_RAW;
 				*isofile_sectorcount = st_size / (SECTORSIZE_XA2);
 				return 0;
@@ -193,7 +196,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 			     (buffer[12+4+4] == '0') &&
 			     (buffer[12+4+5] == '1')))
 			{
-				printf ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 1 header, and suffixed with SUBCHANNEL R-W\n", filename);
+				TRACE ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 1 header, and suffixed with SUBCHANNEL R-W\n", filename);
 				*isofile_format = FORMAT_MODE1_RAW___RAW_RW;
 				*isofile_sectorcount = st_size / (SECTORSIZE_XA2 + 96);
 				return 0;
@@ -212,7 +215,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 			      (buffer[12+4+4] == '0') &&
 			      (buffer[12+4+5] == '1')))
 			{
-				printf ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2, and suffixed with SUBCHANNEL R-W\n", filename);
+				TRACE ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2, and suffixed with SUBCHANNEL R-W\n", filename);
 				*isofile_format = FORMAT_MODE2_RAW___RAW_RW;
 				*isofile_sectorcount = st_size / (SECTORSIZE_XA2);
 				return 0;
@@ -231,7 +234,7 @@ int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_
 			      (buffer[12+4+8+4] == '0') &&
 			      (buffer[12+4+8+5] == '1'))))
 			{
-				printf ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2 FORM 1 header, and suffixed with SUBCHANNEL R-W\n", filename);
+				TRACE ("%s: detected as ISO file format, each sector prefixed with SYNC and MODE 2 FORM 1 header, and suffixed with SUBCHANNEL R-W\n", filename);
 				*isofile_format = FORMAT_XA_MODE2_RAW___RAW_RW;
 				*isofile_sectorcount = st_size / (SECTORSIZE_XA2 + 96);
 				return 0;
@@ -425,6 +428,714 @@ int get_absolute_sector_2048 (struct cdfs_disc_t *disc, uint32_t sector, uint8_t
 	return 1;
 }
 
+static uint32_t       cdfs_edc_table[8][256];
+static pthread_once_t cdfs_edc_table_once = PTHREAD_ONCE_INIT;
+
+static void cdfs_edc_init (void)
+{
+	int i, j;
+
+	for (i=0; i < 256; i++)
+	{
+		uint32_t c = i;
+		for (j=0; j < 8; j++)
+		{
+			c = (c & 1) ? ((c >> 1) ^ 0xd8018001) : (c >> 1);
+		}
+		cdfs_edc_table[0][i] = c;
+	}
+	for (i=0; i < 256; i++)
+	{
+		for (j=1; j < 8; j++)
+		{
+			cdfs_edc_table[j][i] = (cdfs_edc_table[j-1][i] >> 8) ^ cdfs_edc_table[0][cdfs_edc_table[j-1][i] & 0xff];
+		}
+	}
+}
+
+uint32_t cdfs_edc (const uint8_t *data, size_t length)
+{
+	uint32_t edc = 0;
+
+	pthread_once (&cdfs_edc_table_once, cdfs_edc_init);
+
+	while (length >= 8)
+	{
+		uint32_t one = edc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+		uint32_t two =        data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+		edc = cdfs_edc_table[7][ one        & 0xff] ^
+		      cdfs_edc_table[6][(one >>  8) & 0xff] ^
+		      cdfs_edc_table[5][(one >> 16) & 0xff] ^
+		      cdfs_edc_table[4][ one >> 24        ] ^
+		      cdfs_edc_table[3][ two        & 0xff] ^
+		      cdfs_edc_table[2][(two >>  8) & 0xff] ^
+		      cdfs_edc_table[1][(two >> 16) & 0xff] ^
+		      cdfs_edc_table[0][ two >> 24        ];
+		data += 8;
+		length -= 8;
+	}
+	while (length--)
+	{
+		edc = (edc >> 8) ^ cdfs_edc_table[0][(edc ^ *(data++)) & 0xff];
+	}
+
+	return edc;
+}
+
+/* Checks the EDC of a raw 2352 byte sector, returns non-zero on mismatch */
+static int cdfs_edc_verify (const uint8_t *src)
+{
+	const uint8_t *stored;
+	uint32_t edc;
+
+	if (src[15] == 0x01)
+	{ /* MODE 1: sync, header and data */
+		edc = cdfs_edc (src, 2064);
+		stored = src + 2064;
+	} else if (src[18] & 0x20)
+	{ /* MODE 2 FORM 2: sub-header and data, the EDC is optional */
+		edc = cdfs_edc (src + 16, 8 + 2324);
+		stored = src + 2348;
+		if (!(stored[0] | stored[1] | stored[2] | stored[3]))
+		{
+			return 0;
+		}
+	} else { /* MODE 2 FORM 1: sub-header and data */
+		edc = cdfs_edc (src + 16, 8 + 2048);
+		stored = src + 2072;
+	}
+	return edc != (stored[0] | (stored[1] << 8) | (stored[2] << 16) | ((uint32_t)stored[3] << 24));
+}
+
+#define CDFS_FRAMEBUFFER_SECTORS 64 /* 64 * (2352 + 96) = 153KB */
+
+/* Reads straight from the image file when the sectors are stored as plain 2048 byte sectors, or as framed sectors where the data can
+ * be picked out at a fixed position (raw 2352 byte sectors, subchannel data, XA1 sub-headers). Returns number of sectors fetched (0 if
+ * not possible, the slow path will then report the actual error) */
+static uint32_t get_absolute_sectors_2048_direct (struct cdfs_disc_t *disc, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+	int i;
+
+	for (i=0; i < disc->datasources_count; i++)
+	{
+		if (  (disc->datasources_data[i].sectoroffset <= sector) &&
+		     ((disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount) > sector))
+		{
+			uint32_t relsector = sector - disc->datasources_data[i].sectoroffset;
+			uint64_t done = 0;
+			uint64_t length;
+			int stride;
+			int dataoffset; /* -1 means that the sector header must be checked */
+			uint32_t j;
+
+			if (count > (disc->datasources_data[i].sectorcount - relsector))
+			{
+				count = disc->datasources_data[i].sectorcount - relsector;
+			}
+			length = (uint64_t)count * SECTORSIZE;
+
+			if (!disc->datasources_data[i].filename)
+			{
+				bzero (buffer, length);
+				return count;
+			}
+
+			switch (disc->datasources_data[i].format)
+			{
+				case FORMAT_MODE1___NONE:
+				case FORMAT_XA_MODE2_FORM1___NONE:
+				case FORMAT_MODE_1__XA_MODE2_FORM1___NONE:
+					while (done < length)
+					{
+						ssize_t res = pread (disc->datasources_data[i].fd, buffer + done, length - done, (off_t)relsector * SECTORSIZE + done);
+						if (res <= 0)
+						{
+							return 0; /* let the slow path report the error */
+						}
+						done += res;
+					}
+					return count;
+
+				case FORMAT_MODE1___RAW_RW:
+				case FORMAT_MODE1___RW:
+				case FORMAT_XA_MODE2_FORM1___RAW_RW:
+				case FORMAT_XA_MODE2_FORM1___RW:
+				case FORMAT_MODE_1__XA_MODE2_FORM1___RAW_RW:
+				case FORMAT_MODE_1__XA_MODE2_FORM1___RW:
+					stride = SECTORSIZE + 96;
+					dataoffset = 0;
+					break;
+
+				case FORMAT_XA1_MODE2_FORM1___NONE:
+					stride = SECTORSIZE_XA1;
+					dataoffset = 8;
+					break;
+
+				case FORMAT_XA1_MODE2_FORM1___RW:
+				case FORMAT_XA1_MODE2_FORM1___RW_RAW:
+					stride = SECTORSIZE_XA1 + 96;
+					dataoffset = 8;
+					break;
+
+				case FORMAT_RAW___NONE:
+				case FORMAT_AUDIO___NONE:
+				case FORMAT_AUDIO_SWAP___NONE:
+				case FORMAT_MODE1_RAW___NONE:
+				case FORMAT_MODE2_RAW___NONE:
+				case FORMAT_XA_MODE2_RAW:
+					stride = SECTORSIZE_XA2;
+					dataoffset = -1;
+					break;
+
+				case FORMAT_AUDIO_SWAP___RAW_RW:
+				case FORMAT_AUDIO_SWAP___RW:
+				case FORMAT_AUDIO___RAW_RW:
+				case FORMAT_AUDIO___RW:
+				case FORMAT_MODE1_RAW___RAW_RW:
+				case FORMAT_MODE1_RAW___RW:
+				case FORMAT_MODE2_RAW___RAW_RW:
+				case FORMAT_MODE2_RAW___RW:
+				case FORMAT_XA_MODE2_RAW___RAW_RW:
+				case FORMAT_XA_MODE2_RAW___RW:
+				case FORMAT_RAW___RAW_RW:
+				case FORMAT_RAW___RW:
+					stride = SECTORSIZE_XA2 + 96;
+					dataoffset = -1;
+					break;
+
+				default:
+					return 0;
+			}
+
+			if (!disc->framebuffer)
+			{
+				disc->framebuffer = malloc (CDFS_FRAMEBUFFER_SECTORS * (SECTORSIZE_XA2 + 96));
+				if (!disc->framebuffer)
+				{
+					return 0;
+				}
+			}
+			if (count > CDFS_FRAMEBUFFER_SECTORS)
+			{
+				count = CDFS_FRAMEBUFFER_SECTORS;
+			}
+			length = (uint64_t)count * stride;
+			while (done < length)
+			{
+				ssize_t res = pread (disc->datasources_data[i].fd, disc->framebuffer + done, length - done, (off_t)relsector * stride + done);
+				if (res <= 0)
+				{
+					break;
+				}
+				done += res;
+			}
+			count = done / stride; /* a short read still gives us the complete sectors in front of it */
+
+			for (j=0; j < count; j++)
+			{
+				uint8_t *src = disc->framebuffer + (uint64_t)j * stride;
+				if (dataoffset >= 0)
+				{
+					memcpy (buffer + (uint64_t)j * SECTORSIZE, src + dataoffset, SECTORSIZE);
+					continue;
+				}
+				if (memcmp (src, "\x00\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x00", 12))
+				{
+					break;
+				}
+				switch (src[15])
+				{
+					case 0x01: /* MODE 1: DATA */
+						memcpy (buffer + (uint64_t)j * SECTORSIZE, src + 16, SECTORSIZE);
+						break;
+					case 0xe2:
+					case 0x02: /* MODE 2, assuming XA-FORM-1 like get_absolute_sector_2048() */
+						memcpy (buffer + (uint64_t)j * SECTORSIZE, src + 24, SECTORSIZE);
+						break;
+					default:
+						return j; /* CLEAR and unknown sectors are reported by the slow path */
+				}
+				if (disc->verify_edc && cdfs_edc_verify (src))
+				{
+					fprintf (stderr, "EDC mismatch in sector %" PRIu32 "\n", sector + j);
+					disc->edc_errors++;
+				}
+			}
+			return j;
+		}
+	}
+	return 0;
+}
+
+int get_absolute_sectors_2048_fd (struct cdfs_disc_t *disc, uint32_t sector, uint32_t count, int *fd, off_t *offset)
+{
+	int i;
+
+	for (i=0; i < disc->datasources_count; i++)
+	{
+		if (  (disc->datasources_data[i].sectoroffset <= sector) &&
+		     ((disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount) > sector))
+		{
+			if ((!disc->datasources_data[i].filename) ||
+			    ((disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount - sector) < count))
+			{
+				return -1;
+			}
+			switch (disc->datasources_data[i].format)
+			{
+				case FORMAT_MODE1___NONE:
+				case FORMAT_XA_MODE2_FORM1___NONE:
+				case FORMAT_MODE_1__XA_MODE2_FORM1___NONE:
+					*fd = disc->datasources_data[i].fd;
+					*offset = (off_t)(sector - disc->datasources_data[i].sectoroffset) * SECTORSIZE;
+					return 0;
+				default:
+					return -1;
+			}
+		}
+	}
+	return -1;
+}
+
+int get_absolute_sectors_2048 (struct cdfs_disc_t *disc, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+	while (count)
+	{
+		uint32_t fetched = get_absolute_sectors_2048_direct (disc, sector, count, buffer);
+		if (!fetched)
+		{
+			if (get_absolute_sector_2048 (disc, sector, buffer))
+			{
+				return -1;
+			}
+			fetched = 1;
+		}
+		sector += fetched;
+		count -= fetched;
+		buffer += (uint64_t)fetched * SECTORSIZE;
+	}
+	return 0;
+}
+
+size_t cdfs_utf16be_to_utf8 (char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft)
+{
+	while (*inbytesleft)
+	{
+		const uint8_t *in = (const uint8_t *)*inbuf;
+		uint8_t *out = (uint8_t *)*outbuf;
+		uint32_t codepoint;
+		size_t inlength = 2;
+		size_t outlength;
+
+		if (*inbytesleft < 2)
+		{
+			return (size_t)-1; /* incomplete input */
+		}
+		codepoint = (in[0] << 8) | in[1];
+		if ((codepoint >= 0xd800) && (codepoint <= 0xdbff))
+		{
+			uint32_t low;
+			if (*inbytesleft < 4)
+			{
+				return (size_t)-1;
+			}
+			low = (in[2] << 8) | in[3];
+			if ((low < 0xdc00) || (low > 0xdfff))
+			{
+				return (size_t)-1; /* invalid surrogate pair */
+			}
+			codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+			inlength = 4;
+		} else if ((codepoint >= 0xdc00) && (codepoint <= 0xdfff))
+		{
+			return (size_t)-1;
+		}
+
+		outlength = (codepoint < 0x80) ? 1 : (codepoint < 0x800) ? 2 : (codepoint < 0x10000) ? 3 : 4;
+		if (outlength > *outbytesleft)
+		{
+			return (size_t)-1; /* output buffer full */
+		}
+		switch (outlength)
+		{
+			case 1:
+				out[0] = codepoint;
+				break;
+			case 2:
+				out[0] = 0xc0 | (codepoint >> 6);
+				out[1] = 0x80 | (codepoint & 0x3f);
+				break;
+			case 3:
+				out[0] = 0xe0 | (codepoint >> 12);
+				out[1] = 0x80 | ((codepoint >> 6) & 0x3f);
+				out[2] = 0x80 | (codepoint & 0x3f);
+				break;
+			default:
+				out[0] = 0xf0 | (codepoint >> 18);
+				out[1] = 0x80 | ((codepoint >> 12) & 0x3f);
+				out[2] = 0x80 | ((codepoint >> 6) & 0x3f);
+				out[3] = 0x80 | (codepoint & 0x3f);
+				break;
+		}
+		*inbuf += inlength;
+		*inbytesleft -= inlength;
+		*outbuf += outlength;
+		*outbytesleft -= outlength;
+	}
+	return 0;
+}
+
+static uint8_t        cdfs_ecc_f_table[256]; /* multiply by x (alpha) in GF(2^8) with polynomial x^8 + x^4 + x^3 + x^2 + 1 */
+static uint8_t        cdfs_ecc_b_table[256]; /* divide by (x + 1) */
+static pthread_once_t cdfs_ecc_table_once = PTHREAD_ONCE_INIT;
+
+static void cdfs_ecc_init (void)
+{
+	int i;
+
+	for (i=0; i < 256; i++)
+	{
+		uint8_t j = (i << 1) ^ ((i & 0x80) ? 0x1d : 0);
+		cdfs_ecc_f_table[i] = j;
+		cdfs_ecc_b_table[i ^ j] = i;
+	}
+}
+
+/* One set of Reed-Solomon Product Code parity bytes (ECMA-130 Annex A), the P parity are columns of 24 bytes and the Q parity are
+ * diagonals of 43 bytes, both over the sector with the sync pattern removed */
+static void cdfs_ecc_block (const uint8_t *src, uint32_t major_count, uint32_t minor_count, uint32_t major_mult, uint32_t minor_inc, uint8_t *dst)
+{
+	uint32_t size = major_count * minor_count;
+	uint32_t major, minor;
+
+	for (major = 0; major < major_count; major++)
+	{
+		uint32_t index = (major >> 1) * major_mult + (major & 1);
+		uint8_t ecc_a = 0;
+		uint8_t ecc_b = 0;
+
+		for (minor = 0; minor < minor_count; minor++)
+		{
+			uint8_t temp = src[index];
+			index += minor_inc;
+			if (index >= size)
+			{
+				index -= size;
+			}
+			ecc_a ^= temp;
+			ecc_b ^= temp;
+			ecc_a = cdfs_ecc_f_table[ecc_a];
+		}
+		ecc_a = cdfs_ecc_b_table[cdfs_ecc_f_table[ecc_a] ^ ecc_b];
+		dst[major] = ecc_a;
+		dst[major + major_count] = ecc_a ^ ecc_b;
+	}
+}
+
+static void cdfs_edc_store (uint8_t *dst, uint32_t edc)
+{
+	dst[0] = edc;
+	dst[1] = edc >> 8;
+	dst[2] = edc >> 16;
+	dst[3] = edc >> 24;
+}
+
+void cdfs_sector_encode (uint8_t *raw, uint32_t sector, int mode, int form, const uint8_t *data)
+{
+	uint32_t msf = sector + 150; /* the first 2 seconds of the disc are the lead-in pregap */
+	uint8_t header[4];
+
+	pthread_once (&cdfs_ecc_table_once, cdfs_ecc_init);
+
+	memcpy (raw, "\x00\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x00", 12);
+	raw[12] = ((msf / 75 / 60) / 10) << 4 | ((msf / 75 / 60) % 10);
+	raw[13] = (((msf / 75) % 60) / 10) << 4 | (((msf / 75) % 60) % 10);
+	raw[14] = ((msf % 75) / 10) << 4 | ((msf % 75) % 10);
+	raw[15] = mode;
+
+	if (mode == 1)
+	{
+		memcpy (raw + 16, data, SECTORSIZE);
+		cdfs_edc_store (raw + 2064, cdfs_edc (raw, 2064));
+		memset (raw + 2068, 0, 8);
+		cdfs_ecc_block (raw + 12, 86, 24,  2, 86, raw + 2076);
+		cdfs_ecc_block (raw + 12, 52, 43, 86, 88, raw + 2248);
+		return;
+	}
+
+	/* XA sub-header, file 0, channel 0, submode and coding, stored twice */
+	raw[16] = raw[20] = 0;
+	raw[17] = raw[21] = 0;
+	raw[18] = raw[22] = (form == 2) ? 0x20 : 0x08; /* FORM2 or DATA */
+	raw[19] = raw[23] = 0;
+
+	if (form == 2)
+	{
+		memcpy (raw + 24, data, 2324);
+		cdfs_edc_store (raw + 2348, cdfs_edc (raw + 16, 8 + 2324));
+		return;
+	}
+
+	memcpy (raw + 24, data, SECTORSIZE);
+	cdfs_edc_store (raw + 2072, cdfs_edc (raw + 16, 8 + 2048));
+	/* Mode 2 ECC is calculated with the header set to zero */
+	memcpy (header, raw + 12, 4);
+	memset (raw + 12, 0, 4);
+	cdfs_ecc_block (raw + 12, 86, 24,  2, 86, raw + 2076);
+	cdfs_ecc_block (raw + 12, 52, 43, 86, 88, raw + 2248);
+	memcpy (raw + 12, header, 4);
+}
+
+#define CDFS_CONVERT_BATCH 256 /* sectors per write, 512KB */
+
+static int cdfs_write (int fd, const uint8_t *buffer, size_t length)
+{
+	while (length)
+	{
+		ssize_t res = write (fd, buffer, length);
+		if (res < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		buffer += res;
+		length -= res;
+	}
+	return 0;
+}
+
+/* Returns 0 for formats where the sectors does not carry 2048 bytes of user data */
+static int cdfs_format_is_cookable (enum cdfs_format_t format)
+{
+	switch (format)
+	{
+		case FORMAT_AUDIO___NONE:
+		case FORMAT_AUDIO___RW:
+		case FORMAT_AUDIO___RAW_RW:
+		case FORMAT_AUDIO_SWAP___NONE:
+		case FORMAT_AUDIO_SWAP___RW:
+		case FORMAT_AUDIO_SWAP___RAW_RW:
+		case FORMAT_MODE2___NONE:
+		case FORMAT_MODE2___RW:
+		case FORMAT_MODE2___RAW_RW:
+		case FORMAT_XA_MODE2_FORM2___NONE:
+		case FORMAT_XA_MODE2_FORM2___RW:
+		case FORMAT_XA_MODE2_FORM2___RAW_RW:
+			return 0;
+		default:
+			return 1;
+	}
+}
+
+/* mode 0 writes 2048 byte sectors, mode 1 and 2 writes 2352 byte Mode 1 or Mode 2 Form 1 sectors */
+static int cdfs_disc_cook (struct cdfs_disc_t *disc, int fd, int verify_edc, int mode)
+{
+	uint8_t *buffer;
+	uint8_t *rawbuffer = 0;
+	uint32_t end = 0;
+	uint32_t sector = 0;
+	uint32_t zerofilled = 0;
+	int retval = 0;
+	int i;
+
+	/* stop after the last data track, trailing audio tracks would only become zeros */
+	for (i=0; i < disc->datasources_count; i++)
+	{
+		if (disc->datasources_data[i].filename &&
+		    cdfs_format_is_cookable (disc->datasources_data[i].format) &&
+		    (end < (disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount)))
+		{
+			end = disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount;
+		}
+	}
+	if (!end)
+	{
+		fprintf (stderr, "No data tracks to convert\n");
+		return -1;
+	}
+
+	buffer = malloc (CDFS_CONVERT_BATCH * SECTORSIZE);
+	if (mode)
+	{
+		rawbuffer = malloc (CDFS_CONVERT_BATCH * SECTORSIZE_XA2);
+	}
+	if ((!buffer) || (mode && !rawbuffer))
+	{
+		fprintf (stderr, "cdfs_disc_cook() malloc() failed\n");
+		free (buffer);
+		free (rawbuffer);
+		return -1;
+	}
+
+	disc->verify_edc = verify_edc;
+	disc->edc_errors = 0;
+
+	while (sector < end)
+	{
+		uint32_t count = end - sector;
+		int zerofill = 1;
+
+		for (i=0; i < disc->datasources_count; i++)
+		{
+			struct cdfs_datasource_t *ds = &disc->datasources_data[i];
+
+			if ((ds->sectoroffset <= sector) && ((ds->sectoroffset + ds->sectorcount) > sector))
+			{
+				if (count > (ds->sectoroffset + ds->sectorcount - sector))
+				{
+					count = ds->sectoroffset + ds->sectorcount - sector;
+				}
+				zerofill = !cdfs_format_is_cookable (ds->format);
+				break;
+			} else if ((ds->sectoroffset > sector) && (count > (ds->sectoroffset - sector)))
+			{ /* gap up to the next datasource */
+				count = ds->sectoroffset - sector;
+			}
+		}
+		if (count > CDFS_CONVERT_BATCH)
+		{
+			count = CDFS_CONVERT_BATCH;
+		}
+
+		if (zerofill)
+		{
+			bzero (buffer, count * SECTORSIZE);
+			zerofilled += count;
+		} else if (get_absolute_sectors_2048 (disc, sector, count, buffer))
+		{
+			retval = -1;
+			break;
+		}
+
+		if (mode)
+		{
+			uint32_t j;
+			for (j=0; j < count; j++)
+			{
+				cdfs_sector_encode (rawbuffer + j * SECTORSIZE_XA2, sector + j, mode, 1, buffer + j * SECTORSIZE);
+			}
+		}
+
+		if (cdfs_write (fd, mode ? rawbuffer : buffer, count * (mode ? SECTORSIZE_XA2 : SECTORSIZE)))
+		{
+			fprintf (stderr, "write() failed: %s\n", strerror (errno));
+			retval = -1;
+			break;
+		}
+		sector += count;
+	}
+
+	disc->verify_edc = 0;
+	free (buffer);
+	free (rawbuffer);
+
+	TRACE ("Converted %" PRIu32 " sectors, %" PRIu32 " zero-filled (audio, Mode 2 Form 2 and gaps)", sector, zerofilled);
+	if (verify_edc)
+	{
+		TRACE (", %" PRIu32 " EDC errors", disc->edc_errors);
+	}
+	TRACE ("\n");
+
+	if (disc->edc_errors)
+	{
+		retval = -1;
+	}
+	return retval;
+}
+
+int cdfs_disc_convert (struct cdfs_disc_t *disc, int fd, int verify_edc)
+{
+	return cdfs_disc_cook (disc, fd, verify_edc, 0);
+}
+
+/* Replaces the extension of filename (if any) with extension */
+static char *cdfs_filename_extension (const char *filename, const char *extension)
+{
+	const char *slash = strrchr (filename, '/');
+	const char *dot = strrchr (filename, '.');
+	size_t length = (dot && (!slash || (dot > slash))) ? (size_t)(dot - filename) : strlen (filename);
+	char *retval = malloc (length + strlen (extension) + 1);
+
+	if (retval)
+	{
+		memcpy (retval, filename, length);
+		strcpy (retval + length, extension);
+	}
+	return retval;
+}
+
+int cdfs_disc_write_raw (struct cdfs_disc_t *disc, const char *filename, int mode)
+{
+	const char *basename = strrchr (filename, '/') ? strrchr (filename, '/') + 1 : filename;
+	char *cuename = cdfs_filename_extension (filename, ".cue");
+	char *tocname = cdfs_filename_extension (filename, ".toc");
+	FILE *cue = 0;
+	FILE *toc = 0;
+	int retval = -1;
+	int fd;
+
+	if ((!cuename) || (!tocname))
+	{
+		fprintf (stderr, "cdfs_disc_write_raw() malloc() failed\n");
+		goto out;
+	}
+	if ((!strcmp (cuename, filename)) || (!strcmp (tocname, filename)))
+	{
+		fprintf (stderr, "%s: the raw image can not use the .cue or .toc extension\n", filename);
+		goto out;
+	}
+	if (cdfs_disc_is_source (disc, filename) || cdfs_disc_is_source (disc, cuename) || cdfs_disc_is_source (disc, tocname))
+	{
+		fprintf (stderr, "%s: refusing to overwrite an input file of the disc\n", cdfs_disc_is_source (disc, filename) ? filename : cdfs_disc_is_source (disc, cuename) ? cuename : tocname);
+		goto out;
+	}
+
+	fd = open (filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		fprintf (stderr, "open(\"%s\") failed: %s\n", filename, strerror (errno));
+		goto out;
+	}
+	retval = cdfs_disc_cook (disc, fd, 0, mode);
+	if (close (fd))
+	{
+		fprintf (stderr, "close(\"%s\") failed: %s\n", filename, strerror (errno));
+		retval = -1;
+	}
+	if (retval)
+	{
+		goto out;
+	}
+
+	cue = fopen (cuename, "w");
+	toc = fopen (tocname, "w");
+	if ((!cue) || (!toc))
+	{
+		fprintf (stderr, "fopen(\"%s\") failed: %s\n", cue ? tocname : cuename, strerror (errno));
+		retval = -1;
+		goto out;
+	}
+	fprintf (cue, "FILE \"%s\" BINARY\n  TRACK 01 %s\n    INDEX 01 00:00:00\n", basename, (mode == 1) ? "MODE1/2352" : "MODE2/2352");
+	fprintf (toc, "%s\n\nTRACK %s\nDATAFILE \"%s\"\n", (mode == 1) ? "CD_ROM" : "CD_ROM_XA", (mode == 1) ? "MODE1_RAW" : "MODE2_RAW", basename);
+
+out:
+	if (cue && fclose (cue))
+	{
+		retval = -1;
+	}
+	if (toc && fclose (toc))
+	{
+		retval = -1;
+	}
+	free (cuename);
+	free (tocname);
+	return retval;
+}
+
 void cdfs_disc_datasource_append (struct cdfs_disc_t *disc,
                                   uint32_t            sectoroffset,
                                   uint32_t            sectorcount,
@@ -501,6 +1212,45 @@ void cdfs_disc_track_append (struct cdfs_disc_t *disc,
 	disc->tracks_count++;
 }
 
+uint32_t cdfs_disc_sectorcount (struct cdfs_disc_t *disc)
+{
+	uint32_t retval = 0;
+	int i;
+
+	for (i=0; i < disc->datasources_count; i++)
+	{
+		if ((disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount) > retval)
+		{
+			retval = disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount;
+		}
+	}
+
+	return retval;
+}
+
+int cdfs_disc_is_source (struct cdfs_disc_t *disc, const char *filename)
+{
+	struct stat st, st2;
+	int i;
+
+	if (stat (filename, &st))
+	{ /* does not exist yet */
+		return 0;
+	}
+	if (disc->has_source && (st.st_dev == disc->source_dev) && (st.st_ino == disc->source_ino))
+	{
+		return 1;
+	}
+	for (i=0; i < disc->datasources_count; i++)
+	{
+		if ((disc->datasources_data[i].fd >= 0) && (!fstat (disc->datasources_data[i].fd, &st2)) && (st.st_dev == st2.st_dev) && (st.st_ino == st2.st_ino))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
 void cdfs_disc_free (struct cdfs_disc_t *disc)
 {
 	int i;
@@ -514,6 +1264,7 @@ void cdfs_disc_free (struct cdfs_disc_t *disc)
 		free (disc->datasources_data[i].filename);
 	}
 	free (disc->datasources_data);
+	free (disc->framebuffer);
 
 	for (i=0; i < 100; i++)
 	{
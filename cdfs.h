@@ -187,6 +187,18 @@ struct cdfs_disc_t
 
 	/* One UDF session can in theory cross sessions on disc */
 	struct UDF_Session       *udf_session;
+	int                       trace;         /* cdfs_disc_scan() dumps the descriptors on stdout, only with CDFS_TRACE, see main.h */
+	int                       udf_has_timestamp; /* if set, strategy 4096 ICBs resolve to the newest version recorded at or before udf_timestamp */
+	int64_t                   udf_timestamp;
+	int                       udf_spacecheck; /* if set, the UDF space bitmaps are checked against the file tree after it has been read */
+
+	uint8_t                  *framebuffer; /* scratch space used by get_absolute_sectors_2048() to strip the framing of raw sectors */
+	int                       verify_edc;  /* if set, get_absolute_sectors_2048() checks the EDC of raw sectors and counts the failures in edc_errors */
+	uint32_t                  edc_errors;
+
+	int                       has_source;  /* the file given to cdfs_disc_open(), the .cue or .toc file itself for those */
+	dev_t                     source_dev;
+	ino_t                     source_ino;
 };
 
 void cdfs_disc_datasource_append (struct cdfs_disc_t *disc,
@@ -209,10 +221,42 @@ void cdfs_disc_track_append (struct cdfs_disc_t *disc,
                              const char         *arranger,
                              const char         *message);
 
+/* Returns non-zero if filename is the file the disc was opened from, or one of the files it reads sectors from. Used to refuse
+ * writing an output file on top of its own input */
+int cdfs_disc_is_source (struct cdfs_disc_t *disc, const char *filename);
+
+/* Number of sectors on the disc, the end of the last datasource */
+uint32_t cdfs_disc_sectorcount (struct cdfs_disc_t *disc);
+
 void cdfs_disc_free (struct cdfs_disc_t *disc);
 
 int get_absolute_sector_2048 (struct cdfs_disc_t *disc, uint32_t sector, uint8_t *buffer) /* 2048 byte modes */;
 
+/* same as above, but for a range of sectors. Plain 2048 byte images are read in one go, raw and subchannel images are read in large batches and stripped in memory */
+int get_absolute_sectors_2048 (struct cdfs_disc_t *disc, uint32_t sector, uint32_t count, uint8_t *buffer);
+
+/* if the range is stored as plain 2048 byte sectors in one file, gives the file and byte offset so data can be copied directly. Returns non-zero if not */
+int get_absolute_sectors_2048_fd (struct cdfs_disc_t *disc, uint32_t sector, uint32_t count, int *fd, off_t *offset);
+
+/* CD-ROM Error Detection Code (CRC-32 with polynomial 0xD8018001, no inversion) */
+uint32_t cdfs_edc (const uint8_t *data, size_t length);
+
+/* Writes all sectors up to the end of the last data track to fd as plain 2048 byte sectors. Audio, Mode 2 Form 2 and sectors not
+ * covered by any datasource are zero-filled, so sector numbers stay valid. Returns non-zero on errors, or EDC mismatches if verify_edc */
+int cdfs_disc_convert (struct cdfs_disc_t *disc, int fd, int verify_edc);
+
+/* Builds a raw 2352 byte sector for absolute sector number with sync, header, sub-header (mode 2), EDC and ECC (mode 1 and mode 2
+ * form 1). data holds 2048 bytes, or 2324 bytes for mode 2 form 2 */
+void cdfs_sector_encode (uint8_t *raw, uint32_t sector, int mode, int form, const uint8_t *data);
+
+/* Same as cdfs_disc_convert(), but writes raw 2352 byte Mode 1 or Mode 2 Form 1 sectors to filename, together with a matching
+ * .cue and .toc file */
+int cdfs_disc_write_raw (struct cdfs_disc_t *disc, const char *filename, int mode);
+
+/* Converts UTF-16BE (Joliet and UDF names) to UTF-8, with the same calling convention as iconv(). Stops at invalid input or when
+ * the output is full, and then returns (size_t)-1. Keeps no state, so it is safe to use from several discs at once */
+size_t cdfs_utf16be_to_utf8 (char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft);
+
 int detect_isofile_sectorformat (int isofile_fd, const char *filename, off_t st_size, enum cdfs_format_t *isofile_format, uint32_t *isofile_sectorcount);
 
 #endif
@@ -1037,7 +1037,7 @@ struct cdfs_disc_t *cue_parser_to_cdfs_disc (const char *argv1_path, struct cue_
 		 */
 
 		/* first iteration, figure out mode */ 
-		for (j = 0; j <= cue_parser->track; j++)
+		for (j = 1; j <= cue_parser->track; j++) /* track 0 only holds the global information */
 		{
 			if ( cue_parser->track_data[j].datasource > i) goto superbreak;
 			mode = cue_parser->track_data[j].track_mode;
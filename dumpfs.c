@@ -0,0 +1,853 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dumpfs.h"
+
+static int DumpFS_path_reserve (struct DumpFS_path_t *self, size_t length)
+{
+	char *temp;
+	size_t size;
+
+	if (length < self->size)
+	{
+		return 0;
+	}
+	size = self->size ? self->size : 256;
+	while (size <= length)
+	{
+		size *= 2;
+	}
+	temp = realloc (self->data, size);
+	if (!temp)
+	{
+		fprintf (stderr, "DumpFS_path_reserve() realloc() failed\n");
+		return -1;
+	}
+	self->data = temp;
+	self->size = size;
+	return 0;
+}
+
+int DumpFS_path_init (struct DumpFS_path_t *self, const char *base)
+{
+	size_t baselength = strlen (base);
+
+	self->data = 0;
+	self->length = 0;
+	self->size = 0;
+
+	if (DumpFS_path_reserve (self, baselength))
+	{
+		return -1;
+	}
+	memcpy (self->data, base, baselength + 1);
+	self->length = baselength;
+	return 0;
+}
+
+int DumpFS_path_append (struct DumpFS_path_t *self, const char *name, size_t namelength)
+{
+	if (DumpFS_path_reserve (self, self->length + 1 + namelength))
+	{
+		return -1;
+	}
+	self->data[self->length] = '/';
+	memcpy (self->data + self->length + 1, name, namelength);
+	self->length += 1 + namelength;
+	self->data[self->length] = 0;
+	return 0;
+}
+
+int DumpFS_path_put (struct DumpFS_path_t *self, const char *data, size_t datalength)
+{
+	if (DumpFS_path_reserve (self, self->length + datalength))
+	{
+		return -1;
+	}
+	memcpy (self->data + self->length, data, datalength);
+	self->length += datalength;
+	self->data[self->length] = 0;
+	return 0;
+}
+
+void DumpFS_path_truncate (struct DumpFS_path_t *self, size_t length)
+{
+	if (length < self->length)
+	{
+		self->length = length;
+		self->data[length] = 0;
+	}
+}
+
+void DumpFS_path_free (struct DumpFS_path_t *self)
+{
+	free (self->data);
+	self->data = 0;
+	self->length = 0;
+	self->size = 0;
+}
+
+#define DUMPFS_SINK_BUFFERSIZE (256*1024)
+
+struct DumpFS_sink_t
+{
+	int                     fd;
+	enum DumpFS_format_t    format;
+	int                     error;
+
+	int                     extents_size;
+	struct DumpFS_extent_t *extents_data;
+
+	size_t                  fill;
+	char                    buffer[DUMPFS_SINK_BUFFERSIZE];
+};
+
+struct DumpFS_sink_t *DumpFS_sink_open (int fd, enum DumpFS_format_t format)
+{
+	struct DumpFS_sink_t *self = malloc (sizeof (*self));
+	if (!self)
+	{
+		fprintf (stderr, "DumpFS_sink_open() malloc() failed\n");
+		return 0;
+	}
+	self->fd = fd;
+	self->format = format;
+	self->error = 0;
+	self->extents_size = 0;
+	self->extents_data = 0;
+	self->fill = 0;
+	return self;
+}
+
+static void DumpFS_sink_flush (struct DumpFS_sink_t *self)
+{
+	size_t done = 0;
+
+	while ((done < self->fill) && (!self->error))
+	{
+		ssize_t res = write (self->fd, self->buffer + done, self->fill - done);
+		if (res < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror ("DumpFS_sink_flush() write()");
+			self->error = 1;
+			break;
+		}
+		done += res;
+	}
+	self->fill = 0;
+}
+
+int DumpFS_sink_close (struct DumpFS_sink_t *self)
+{
+	int retval;
+
+	DumpFS_sink_flush (self);
+	retval = self->error ? -1 : 0;
+	free (self->extents_data);
+	free (self);
+	return retval;
+}
+
+struct DumpFS_extent_t *DumpFS_sink_extents (struct DumpFS_sink_t *self, int count)
+{
+	if (count > self->extents_size)
+	{
+		struct DumpFS_extent_t *temp = realloc (self->extents_data, sizeof (self->extents_data[0]) * (count + 32));
+		if (!temp)
+		{
+			fprintf (stderr, "DumpFS_sink_extents() realloc() failed\n");
+			return 0;
+		}
+		self->extents_data = temp;
+		self->extents_size = count + 32;
+	}
+	return self->extents_data;
+}
+
+static void DumpFS_sink_put (struct DumpFS_sink_t *self, const char *data, size_t length)
+{
+	while (length)
+	{
+		size_t chunk = sizeof (self->buffer) - self->fill;
+		if (chunk > length)
+		{
+			chunk = length;
+		}
+		memcpy (self->buffer + self->fill, data, chunk);
+		self->fill += chunk;
+		data += chunk;
+		length -= chunk;
+		if (self->fill == sizeof (self->buffer))
+		{
+			DumpFS_sink_flush (self);
+		}
+	}
+}
+
+static void DumpFS_sink_putc (struct DumpFS_sink_t *self, char c)
+{
+	if (self->fill == sizeof (self->buffer))
+	{
+		DumpFS_sink_flush (self);
+	}
+	self->buffer[self->fill++] = c;
+}
+
+static void DumpFS_sink_puts (struct DumpFS_sink_t *self, const char *s)
+{
+	DumpFS_sink_put (self, s, strlen (s));
+}
+
+static void DumpFS_sink_put_uint (struct DumpFS_sink_t *self, uint64_t value, int base)
+{
+	char temp[24];
+	int i = sizeof (temp);
+
+	do
+	{
+		temp[--i] = '0' + (value % base);
+		value /= base;
+	} while (value);
+	DumpFS_sink_put (self, temp + i, sizeof (temp) - i);
+}
+
+static void DumpFS_sink_put_int (struct DumpFS_sink_t *self, int64_t value)
+{
+	if (value < 0)
+	{
+		DumpFS_sink_putc (self, '-');
+		DumpFS_sink_put_uint (self, -(uint64_t)value, 10);
+	} else {
+		DumpFS_sink_put_uint (self, value, 10);
+	}
+}
+
+/* length of the valid UTF-8 sequence starting at s, or 0 if it is invalid (overlong, surrogate, above U+10FFFF or truncated) */
+static size_t DumpFS_utf8_length (const unsigned char *s, size_t length)
+{
+	uint32_t codepoint;
+	size_t need, i;
+
+	if (s[0] < 0x80)
+	{
+		return 1;
+	} else if ((s[0] & 0xe0) == 0xc0)
+	{
+		need = 2;
+		codepoint = s[0] & 0x1f;
+	} else if ((s[0] & 0xf0) == 0xe0)
+	{
+		need = 3;
+		codepoint = s[0] & 0x0f;
+	} else if ((s[0] & 0xf8) == 0xf0)
+	{
+		need = 4;
+		codepoint = s[0] & 0x07;
+	} else {
+		return 0;
+	}
+	if (need > length)
+	{
+		return 0;
+	}
+	for (i=1; i < need; i++)
+	{
+		if ((s[i] & 0xc0) != 0x80)
+		{
+			return 0;
+		}
+		codepoint = (codepoint << 6) | (s[i] & 0x3f);
+	}
+	if (((need == 2) && (codepoint < 0x80)) ||
+	    ((need == 3) && (codepoint < 0x800)) ||
+	    ((need == 4) && (codepoint < 0x10000)) ||
+	    ((codepoint >= 0xd800) && (codepoint <= 0xdfff)) ||
+	    (codepoint > 0x10ffff))
+	{
+		return 0;
+	}
+	return need;
+}
+
+static void DumpFS_sink_put_json_string (struct DumpFS_sink_t *self, const char *s, size_t length)
+{
+	const char *hex = "0123456789abcdef";
+	size_t i, start = 0;
+
+	for (i=0; i < length; i++)
+	{
+		unsigned char c = s[i];
+		if (c >= 0x80)
+		{
+			size_t valid = DumpFS_utf8_length ((const unsigned char *)s + i, length - i);
+			if (valid)
+			{
+				i += valid - 1;
+				continue;
+			}
+			/* not UTF-8, escape the byte as if it was Latin-1 */
+		} else if ((c >= 0x20) && (c != '"') && (c != '\\'))
+		{
+			continue;
+		}
+		DumpFS_sink_put (self, s + start, i - start);
+		start = i + 1;
+		DumpFS_sink_putc (self, '\\');
+		switch (c)
+		{
+			case '"':  DumpFS_sink_putc (self, '"'); break;
+			case '\\': DumpFS_sink_putc (self, '\\'); break;
+			case '\n': DumpFS_sink_putc (self, 'n'); break;
+			case '\t': DumpFS_sink_putc (self, 't'); break;
+			default:
+				DumpFS_sink_put (self, "u00", 3);
+				DumpFS_sink_putc (self, hex[c >> 4]);
+				DumpFS_sink_putc (self, hex[c & 0x0f]);
+				break;
+		}
+	}
+	DumpFS_sink_put (self, s + start, length - start);
+}
+
+static void DumpFS_sink_record_jsonl (struct DumpFS_sink_t *self, const struct DumpFS_record_t *record, size_t pathlength)
+{
+	int i;
+
+	DumpFS_sink_puts (self, "{\"fs\":\"");
+	DumpFS_sink_puts (self, record->fs);
+	DumpFS_sink_puts (self, "\",\"path\":\"");
+	DumpFS_sink_put_json_string (self, record->path, pathlength);
+	DumpFS_sink_putc (self, '/');
+	DumpFS_sink_put_json_string (self, record->name, record->name_length);
+	DumpFS_sink_puts (self, "\",\"type\":\"");
+	DumpFS_sink_putc (self, record->type);
+	DumpFS_sink_putc (self, '"');
+	if (record->has_size)
+	{
+		DumpFS_sink_puts (self, ",\"size\":");
+		DumpFS_sink_put_uint (self, record->size, 10);
+	}
+	if (record->has_mode)
+	{
+		DumpFS_sink_puts (self, ",\"mode\":");
+		DumpFS_sink_put_uint (self, record->mode, 10);
+	}
+	if (record->has_owner)
+	{
+		DumpFS_sink_puts (self, ",\"uid\":");
+		DumpFS_sink_put_uint (self, record->uid, 10);
+		DumpFS_sink_puts (self, ",\"gid\":");
+		DumpFS_sink_put_uint (self, record->gid, 10);
+	}
+	if (record->has_mtime)
+	{
+		DumpFS_sink_puts (self, ",\"mtime\":");
+		DumpFS_sink_put_int (self, record->mtime);
+	}
+	if (record->has_ctime)
+	{
+		DumpFS_sink_puts (self, ",\"ctime\":");
+		DumpFS_sink_put_int (self, record->ctime);
+	}
+	if (record->target)
+	{
+		DumpFS_sink_puts (self, ",\"target\":\"");
+		DumpFS_sink_put_json_string (self, record->target, record->target_length);
+		DumpFS_sink_putc (self, '"');
+	}
+	if (record->has_device)
+	{
+		DumpFS_sink_puts (self, ",\"major\":");
+		DumpFS_sink_put_uint (self, record->major, 10);
+		DumpFS_sink_puts (self, ",\"minor\":");
+		DumpFS_sink_put_uint (self, record->minor, 10);
+	}
+	DumpFS_sink_puts (self, ",\"extents\":[");
+	for (i=0; i < record->extents_count; i++)
+	{
+		if (i)
+		{
+			DumpFS_sink_putc (self, ',');
+		}
+		DumpFS_sink_putc (self, '[');
+		if (record->extents[i].Hole)
+		{
+			DumpFS_sink_puts (self, "null");
+		} else {
+			DumpFS_sink_put_uint (self, record->extents[i].Location, 10);
+		}
+		DumpFS_sink_putc (self, ',');
+		DumpFS_sink_put_uint (self, record->extents[i].Length, 10);
+		DumpFS_sink_putc (self, ']');
+	}
+	DumpFS_sink_puts (self, "]}\n");
+}
+
+static void DumpFS_sink_record_nul (struct DumpFS_sink_t *self, const struct DumpFS_record_t *record, size_t pathlength)
+{
+	int i;
+
+	DumpFS_sink_put (self, record->fs, strlen (record->fs) + 1);
+	DumpFS_sink_put (self, record->path, pathlength);
+	DumpFS_sink_putc (self, '/');
+	DumpFS_sink_put (self, record->name, record->name_length);
+	DumpFS_sink_putc (self, 0);
+	DumpFS_sink_putc (self, record->type);
+	DumpFS_sink_putc (self, 0);
+	if (record->has_size)
+	{
+		DumpFS_sink_put_uint (self, record->size, 10);
+	}
+	DumpFS_sink_putc (self, 0);
+	if (record->has_mode)
+	{
+		DumpFS_sink_put_uint (self, record->mode, 8);
+	}
+	DumpFS_sink_putc (self, 0);
+	if (record->has_owner)
+	{
+		DumpFS_sink_put_uint (self, record->uid, 10);
+		DumpFS_sink_putc (self, 0);
+		DumpFS_sink_put_uint (self, record->gid, 10);
+		DumpFS_sink_putc (self, 0);
+	} else {
+		DumpFS_sink_put (self, "\0\0", 2);
+	}
+	if (record->has_mtime)
+	{
+		DumpFS_sink_put_int (self, record->mtime);
+	}
+	DumpFS_sink_putc (self, 0);
+	if (record->has_ctime)
+	{
+		DumpFS_sink_put_int (self, record->ctime);
+	}
+	DumpFS_sink_putc (self, 0);
+	if (record->target)
+	{
+		DumpFS_sink_put (self, record->target, record->target_length);
+	}
+	DumpFS_sink_putc (self, 0);
+	for (i=0; i < record->extents_count; i++)
+	{
+		if (i)
+		{
+			DumpFS_sink_putc (self, ',');
+		}
+		if (record->extents[i].Hole)
+		{
+			DumpFS_sink_putc (self, '-');
+		} else {
+			DumpFS_sink_put_uint (self, record->extents[i].Location, 10);
+		}
+		DumpFS_sink_putc (self, ':');
+		DumpFS_sink_put_uint (self, record->extents[i].Length, 10);
+	}
+	DumpFS_sink_putc (self, 0);
+}
+
+void DumpFS_sink_record (struct DumpFS_sink_t *self, const struct DumpFS_record_t *record)
+{
+	size_t pathlength = strlen (record->path);
+
+	if (pathlength && (record->path[pathlength - 1] == '/')) /* the UDF root is listed as "./" */
+	{
+		pathlength--;
+	}
+
+	switch (self->format)
+	{
+		case DUMPFS_FORMAT_JSONL: DumpFS_sink_record_jsonl (self, record, pathlength); break;
+		case DUMPFS_FORMAT_NUL:   DumpFS_sink_record_nul (self, record, pathlength); break;
+	}
+}
+
+int64_t DumpFS_time (int year, int month, int day, int hour, int minute, int second, int tz)
+{ /* days from civil, proleptic Gregorian calendar */
+	int64_t y = year - (month <= 2);
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int64_t yoe = y - era * 400;
+	int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	int64_t days = era * 146097 + doe - 719468;
+
+	return days * 86400 + hour * 3600 + minute * 60 + second - tz * 60;
+}
+
+struct DumpFS_index_node_t *DumpFS_index_append (struct DumpFS_index_t *self, const char *name, void *entry, uint32_t parent, char type)
+{
+	struct DumpFS_index_node_t *node;
+
+	if (self->nodes_count >= self->nodes_size)
+	{
+		struct DumpFS_index_node_t *temp = realloc (self->nodes_data, sizeof (self->nodes_data[0]) * (self->nodes_size + 256));
+		if (!temp)
+		{
+			fprintf (stderr, "DumpFS_index_append() realloc() failed\n");
+			return 0;
+		}
+		self->nodes_data = temp;
+		self->nodes_size += 256;
+	}
+	node = &self->nodes_data[self->nodes_count];
+	memset (node, 0, sizeof (*node));
+	node->name = strdup (name);
+	if (!node->name)
+	{
+		fprintf (stderr, "DumpFS_index_append() strdup() failed\n");
+		return 0;
+	}
+	node->entry = entry;
+	node->parent = parent;
+	node->type = type;
+	if (self->nodes_count)
+	{
+		struct DumpFS_index_node_t *p = &self->nodes_data[parent];
+		if (!p->children)
+		{
+			p->first_child = self->nodes_count;
+		}
+		p->children++;
+		if (type == 'd')
+		{
+			p->subdirectories++;
+		}
+	}
+	self->nodes_count++;
+	return node;
+}
+
+static int DumpFS_index_rank (char type)
+{
+	switch (type)
+	{
+		case 'd': return 0;
+		case '-': return 1;
+		default:  return 2;
+	}
+}
+
+static int DumpFS_index_cmp (const void *a, const void *b)
+{
+	const struct DumpFS_index_node_t *A = a;
+	const struct DumpFS_index_node_t *B = b;
+	int cmp = strcmp (A->name, B->name);
+
+	if (cmp)
+	{
+		return cmp;
+	}
+	/* the same name twice, directories first, then files, then symlinks */
+	return DumpFS_index_rank (A->type) - DumpFS_index_rank (B->type);
+}
+
+void DumpFS_index_sort (struct DumpFS_index_t *self, uint32_t n)
+{
+	struct DumpFS_index_node_t *parent = &self->nodes_data[n];
+	struct DumpFS_index_node_t *children = self->nodes_data + parent->first_child;
+	uint32_t i, kept;
+
+	if (!parent->children)
+	{
+		return;
+	}
+	qsort (children, parent->children, sizeof (children[0]), DumpFS_index_cmp);
+
+	/* a path can only lead to one node, so only the first entry of a name is kept, directories sort first */
+	for (i=1, kept=1; i < parent->children; i++)
+	{
+		if (!strcmp (children[i].name, children[kept - 1].name))
+		{
+			if (children[i].type == 'd')
+			{
+				parent->subdirectories--;
+			}
+			free (children[i].name);
+			continue;
+		}
+		children[kept++] = children[i];
+	}
+	self->nodes_count -= parent->children - kept;
+	parent->children = kept;
+}
+
+int DumpFS_index_lookup (struct DumpFS_index_t *self, const char *path)
+{
+	uint32_t n = 0;
+
+	if (!self->nodes_count)
+	{
+		return -1;
+	}
+
+	while (1)
+	{
+		const char *end;
+		size_t length;
+		uint32_t low, high;
+
+		while (*path == '/')
+		{
+			path++;
+		}
+		if (!*path)
+		{
+			return n;
+		}
+		end = strchr (path, '/');
+		if (!end)
+		{
+			end = path + strlen (path);
+		}
+		length = end - path;
+
+		if ((length == 1) && (path[0] == '.'))
+		{
+			path = end;
+			continue;
+		}
+		if ((length == 2) && (path[0] == '.') && (path[1] == '.'))
+		{
+			n = self->nodes_data[n].parent;
+			path = end;
+			continue;
+		}
+		if (self->nodes_data[n].type != 'd')
+		{
+			return -1;
+		}
+
+		low = self->nodes_data[n].first_child;
+		high = low + self->nodes_data[n].children;
+		while (low < high)
+		{
+			uint32_t mid = low + (high - low) / 2;
+			const char *name = self->nodes_data[mid].name;
+			int cmp = strncmp (name, path, length);
+
+			if ((!cmp) && name[length])
+			{
+				cmp = 1;
+			}
+			if (!cmp)
+			{
+				low = mid;
+				break;
+			}
+			if (cmp < 0)
+			{
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		if (low >= high)
+		{
+			return -1;
+		}
+		n = low;
+		path = end;
+	}
+}
+
+int DumpFS_index_child (struct DumpFS_index_t *self, uint32_t n, uint32_t child, const char **name)
+{
+	if ((n >= self->nodes_count) || (self->nodes_data[n].type != 'd') || (child >= self->nodes_data[n].children))
+	{
+		return -1;
+	}
+	child += self->nodes_data[n].first_child;
+	*name = self->nodes_data[child].name;
+	return child;
+}
+
+void DumpFS_index_free (struct DumpFS_index_t *self)
+{
+	uint32_t n;
+
+	for (n = 0; n < self->nodes_count; n++)
+	{
+		free (self->nodes_data[n].name);
+	}
+	free (self->nodes_data);
+	self->nodes_data = 0;
+	self->nodes_count = 0;
+	self->nodes_size = 0;
+}
+
+int DumpFS_extract_job_append (int *count, int *size, struct DumpFS_extract_job_t **data, char *path, void *entry)
+{
+	if (*count >= *size)
+	{
+		struct DumpFS_extract_job_t *temp = realloc (*data, sizeof ((*data)[0]) * (*size + 64));
+		if (!temp)
+		{
+			fprintf (stderr, "DumpFS_extract_job_append() realloc() failed\n");
+			return -1;
+		}
+		*data = temp;
+		*size += 64;
+	}
+	(*data)[*count].path = path;
+	(*data)[*count].entry = entry;
+	(*data)[*count].target = 0;
+	(*data)[*count].extents_left = 0;
+	(*data)[*count].created = 0;
+	(*count)++;
+	return 0;
+}
+
+void DumpFS_extract_jobs_free (int count, struct DumpFS_extract_job_t *data)
+{
+	int i;
+
+	for (i=0; i < count; i++)
+	{
+		free (data[i].path);
+	}
+	free (data);
+}
+
+int DumpFS_extract_name_safe (const char *name, size_t length)
+{
+	if ((!name) || (!length) || (memchr (name, 0, length)) || (memchr (name, '/', length)))
+	{
+		return 0;
+	}
+	if (((length == 1) && (name[0] == '.')) || ((length == 2) && (name[0] == '.') && (name[1] == '.')))
+	{
+		return 0;
+	}
+	return 1;
+}
+
+int DumpFS_extract_mkdir (const char *path, int root)
+{
+	struct stat st;
+
+	if (!mkdir (path, 0700))
+	{
+		return 0;
+	}
+	if (errno != EEXIST)
+	{
+		fprintf (stderr, "mkdir(\"%s\") failed: %s\n", path, strerror (errno));
+		return -1;
+	}
+	if ((root ? stat (path, &st) : lstat (path, &st)) || !S_ISDIR (st.st_mode))
+	{
+		fprintf (stderr, "mkdir(\"%s\") failed: a file with the same name already exists\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+int DumpFS_extract_open (const char *path, int truncate)
+{
+	int fd = open (path, O_WRONLY | O_CREAT | O_NOFOLLOW | (truncate ? O_TRUNC : 0), 0644);
+
+	if (fd < 0)
+	{
+		fprintf (stderr, "open(\"%s\") failed: %s\n", path, strerror (errno));
+	}
+	return fd;
+}
+
+int DumpFS_extract_symlink (const char *target, const char *path)
+{
+	unlink (path);
+	if (symlink (target, path))
+	{
+		fprintf (stderr, "symlink(\"%s\", \"%s\") failed: %s\n", target, path, strerror (errno));
+		return -1;
+	}
+	return 0;
+}
+
+int DumpFS_extract_write (int fd, const uint8_t *buffer, uint64_t length)
+{
+	while (length)
+	{
+		ssize_t res = write (fd, buffer, (length > 0x40000000) ? 0x40000000 : length);
+		if (res < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		buffer += res;
+		length -= res;
+	}
+	return 0;
+}
+
+int DumpFS_extract_pwrite (int fd, const uint8_t *buffer, uint64_t length, uint64_t offset)
+{
+	while (length)
+	{
+		ssize_t res = pwrite (fd, buffer, (length > 0x40000000) ? 0x40000000 : length, offset);
+		if (res < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		buffer += res;
+		offset += res;
+		length -= res;
+	}
+	return 0;
+}
+
+void DumpFS_extract_attributes (int fd, const char *path, const struct DumpFS_record_t *record)
+{
+	int symlink = (record->type == 'l');
+	mode_t mode = record->mode;
+
+	if (record->type == 'd')
+	{ /* we need to be able to enter the directories we extract */
+		mode |= 0700;
+	}
+
+	if (record->has_owner && !geteuid ())
+	{ /* ownership is only restored when running as root, before the mode since chown() clears set-user-ID */
+		if ((fd >= 0) ? fchown (fd, record->uid, record->gid) : lchown (path, record->uid, record->gid))
+		{
+			fprintf (stderr, "chown(\"%s\") failed: %s\n", path, strerror (errno));
+		}
+	}
+	if (record->has_mode && !symlink)
+	{
+		if ((fd >= 0) ? fchmod (fd, mode) : chmod (path, mode))
+		{
+			fprintf (stderr, "chmod(\"%s\") failed: %s\n", path, strerror (errno));
+		}
+	}
+	if (record->has_mtime)
+	{
+		struct timespec times[2];
+
+		times[0].tv_sec = record->mtime;
+		times[0].tv_nsec = 0;
+		times[1] = times[0];
+		if ((fd >= 0) ? futimens (fd, times) : utimensat (AT_FDCWD, path, times, symlink ? AT_SYMLINK_NOFOLLOW : 0))
+		{
+			fprintf (stderr, "utimensat(\"%s\") failed: %s\n", path, strerror (errno));
+		}
+	}
+}
@@ -0,0 +1,189 @@
+#ifndef _DUMPFS_H
+#define _DUMPFS_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A single growable path buffer, shared by the tree dumpers. Entering a
+ * directory appends "/name", leaving it truncates back to the saved length.
+ */
+struct DumpFS_path_t
+{
+	char   *data;   /* always zero-terminated */
+	size_t  length;
+	size_t  size;
+};
+
+int DumpFS_path_init (struct DumpFS_path_t *self, const char *base);
+
+/* appends "/" + name, returns non-zero on allocation failure (the path is then left untouched) */
+int DumpFS_path_append (struct DumpFS_path_t *self, const char *name, size_t namelength);
+
+/* appends data as is, without a separator */
+int DumpFS_path_put (struct DumpFS_path_t *self, const char *data, size_t datalength);
+
+void DumpFS_path_truncate (struct DumpFS_path_t *self, size_t length);
+
+void DumpFS_path_free (struct DumpFS_path_t *self);
+
+
+/* Machine-readable output of the tree dumpers, one record per directory entry.
+ *
+ * DUMPFS_FORMAT_JSONL - one JSON object per line, unknown fields are left out:
+ *   {"fs":"udf","path":"./a/b","type":"-","size":12,"mode":420,"uid":0,"gid":0,"mtime":0,"ctime":0,"target":"x","major":1,"minor":2,"extents":[[location,length],[null,length]]}
+ *   Extent locations are sectors for ISO9660, and logical blocks inside the partition of the file for UDF. null is a hole.
+ *   Names are written as UTF-8. Bytes that are not part of a valid UTF-8 sequence (plain ISO9660 and RockRidge names carry no
+ *   charset) are escaped as \u0080-\u00ff, so the output stays valid JSON and the original byte can be recovered as Latin-1.
+ *
+ * DUMPFS_FORMAT_NUL - every record has exactly 11 fields, each field is terminated by a NUL byte, unknown fields are empty:
+ *   fs path type size mode(octal) uid gid mtime ctime target extents(location:length,... with - for holes)
+ */
+enum DumpFS_format_t
+{
+	DUMPFS_FORMAT_JSONL = 1,
+	DUMPFS_FORMAT_NUL = 2,
+};
+
+struct DumpFS_extent_t
+{
+	uint64_t Location;
+	uint64_t Length;   /* in bytes */
+	uint8_t  Hole;     /* not recorded, reads as zero */
+};
+
+struct DumpFS_record_t
+{
+	const char *fs;
+	const char *path;        /* parent directory */
+	const char *name;
+	size_t      name_length;
+	char        type;        /* same letters as ls uses */
+
+	uint8_t     has_mode;
+	uint32_t    mode;        /* permission bits, 07777 */
+
+	uint8_t     has_owner;
+	uint32_t    uid;
+	uint32_t    gid;
+
+	uint8_t     has_size;
+	uint64_t    size;
+
+	uint8_t     has_device;
+	uint32_t    major;
+	uint32_t    minor;
+
+	uint8_t     has_mtime;
+	int64_t     mtime;       /* seconds since 1970-01-01 00:00:00 UTC */
+
+	uint8_t     has_ctime;
+	int64_t     ctime;
+
+	const char *target;      /* symlink */
+	size_t      target_length;
+
+	int                           extents_count;
+	const struct DumpFS_extent_t *extents;
+};
+
+struct DumpFS_sink_t;
+
+struct DumpFS_sink_t *DumpFS_sink_open (int fd, enum DumpFS_format_t format);
+
+/* flushes and frees the sink, the file descriptor is not closed */
+int DumpFS_sink_close (struct DumpFS_sink_t *self);
+
+/* scratch space for record->extents, valid until the next call */
+struct DumpFS_extent_t *DumpFS_sink_extents (struct DumpFS_sink_t *self, int count);
+
+void DumpFS_sink_record (struct DumpFS_sink_t *self, const struct DumpFS_record_t *record);
+
+/* tz is given in minutes east of UTC */
+int64_t DumpFS_time (int year, int month, int day, int hour, int minute, int second, int tz);
+
+
+/* In-memory directory tree, filled by ISO9660_Index() and UDF_Index() for the libcdfs.h API.
+ *
+ * Nodes are added breadth first, so the children of a directory are stored next to each other, and sorted by name with
+ * DumpFS_index_sort() once the directory is complete. A path lookup is then one binary search per path component, and the node
+ * number is used as inode. Node 0 is the root.
+ */
+struct DumpFS_index_node_t
+{
+	char     *name;
+	void     *entry;          /* filesystem specific */
+	uint32_t  Location;       /* filesystem specific, directories only */
+	uint32_t  parent;
+	uint32_t  first_child;    /* directories only */
+	uint32_t  children;
+	uint32_t  subdirectories;
+	uint64_t  size;
+	char      type;           /* 'd', '-' or 'l' */
+};
+
+struct DumpFS_index_t
+{
+	uint32_t                    nodes_count;
+	uint32_t                    nodes_size;
+	struct DumpFS_index_node_t *nodes_data;
+};
+
+/* Appends a node and counts it as a child of parent (the first node is the root). Returns 0 on allocation failure */
+struct DumpFS_index_node_t *DumpFS_index_append (struct DumpFS_index_t *self, const char *name, void *entry, uint32_t parent, char type);
+
+/* Sorts the children of node n by name, right after all of them have been appended. Of entries with the same name only one is kept,
+ * directories are preferred over files, and files over symlinks */
+void DumpFS_index_sort (struct DumpFS_index_t *self, uint32_t n);
+
+/* path is relative to the root, leading and repeated slashes, . and .. are handled. Returns the node, or -1 if not found */
+int DumpFS_index_lookup (struct DumpFS_index_t *self, const char *path);
+
+/* Returns the node of the child'th entry in directory n and its name, or -1 past the last one */
+int DumpFS_index_child (struct DumpFS_index_t *self, uint32_t n, uint32_t child, const char **name);
+
+/* Frees the nodes, not self */
+void DumpFS_index_free (struct DumpFS_index_t *self);
+
+
+/* Helpers shared by the extractors, ISO9660_Extract() and UDF_Extract().
+ *
+ * Both walk the tree once to create the directories and to collect the files and symlinks, then write the files in disc order.
+ * Files are opened with O_NOFOLLOW and symlinks are created after all the files, so a crafted image can not place a symlink in the
+ * path of anything that is written later. Directory attributes are applied last, children before parents, since creating files
+ * updates the timestamps and the mode might remove write access.
+ */
+struct DumpFS_extract_job_t
+{
+	char       *path;
+	void       *entry;        /* struct iso_dirent_t or struct UDF_FileEntry_t, depending on the extractor */
+	const char *target;       /* symlinks only, if known when the job is queued */
+	int         extents_left; /* files written in several pieces, the file is completed when this reaches zero */
+	int         created;      /* set when the file has been opened the first time */
+};
+
+/* path is owned by the list on success, returns non-zero on allocation failure */
+int DumpFS_extract_job_append (int *count, int *size, struct DumpFS_extract_job_t **data, char *path, void *entry);
+
+void DumpFS_extract_jobs_free (int count, struct DumpFS_extract_job_t *data);
+
+/* Names are used as path components, so they can not be empty, . or .., or contain a slash or a NUL byte */
+int DumpFS_extract_name_safe (const char *name, size_t length);
+
+/* Creates the directory, or accepts an existing one. Only the target directory given by the user (root) may be a symlink to a directory */
+int DumpFS_extract_mkdir (const char *path, int root);
+
+/* Opens a file for writing without following a symlink at path, truncate is only given the first time a file is opened */
+int DumpFS_extract_open (const char *path, int truncate);
+
+/* Replaces whatever is at path with a symlink */
+int DumpFS_extract_symlink (const char *target, const char *path);
+
+/* write() and pwrite() that retry on short writes and EINTR */
+int DumpFS_extract_write (int fd, const uint8_t *buffer, uint64_t length);
+int DumpFS_extract_pwrite (int fd, const uint8_t *buffer, uint64_t length, uint64_t offset);
+
+/* Applies the mode, ownership (only when running as root) and mtime of record to fd, or to path if fd is negative. record->type 'l'
+ * is a symlink, 'd' directories always get owner rwx so they can be entered */
+void DumpFS_extract_attributes (int fd, const char *path, const struct DumpFS_record_t *record);
+
+#endif
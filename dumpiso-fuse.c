@@ -0,0 +1,196 @@
+/* Read-only FUSE mount of the files on an image, including raw BIN and CUE/TOC with WAVE files.
+ *
+ *     dumpiso-fuse <file.iso|file.bin|file.cue|file.toc> <mountpoint> [FUSE options]
+ *
+ * The UDF filesystem is mounted if the image has one, else the last ISO9660 session, see libcdfs.h. Images with neither (audio
+ * only, or only El Torito boot images) can not be mounted. "make dumpiso-fuse-stub" builds these operations against fuse-stub/
+ * instead of libfuse3, to test them without mounting.
+ *
+ * The directory tree is indexed by libcdfs when the image is opened, so lookups, getattr and readdir never touch the image. The image
+ * can not change while mounted, so the kernel is allowed to keep attributes and file data in its caches for as long as it wants.
+ */
+
+#define FUSE_USE_VERSION 31
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fuse.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "libcdfs.h"
+
+#define DUMPISO_FUSE_TIMEOUT   86400.0           /* seconds, the image is read-only */
+#define DUMPISO_FUSE_READAHEAD (1024 * 1024)     /* bytes, file data is read in large sequential runs */
+
+struct dumpiso_fuse_t
+{
+	struct cdfs_t   *cdfs;
+	pthread_mutex_t  lock; /* the disc reader is not thread safe, the index is read-only and needs no locking */
+};
+
+static struct dumpiso_fuse_t *dumpiso_fuse (void)
+{
+	return fuse_get_context ()->private_data;
+}
+
+static void dumpiso_fuse_stat (const struct cdfs_stat_t *src, struct stat *dst)
+{
+	memset (dst, 0, sizeof (*dst));
+	dst->st_ino = src->ino + 1; /* FUSE reserves inode 1 for the root, libcdfs uses 0 */
+	dst->st_mode = src->mode & ~0222; /* nothing is writable */
+	dst->st_nlink = src->nlink;
+	dst->st_uid = src->uid;
+	dst->st_gid = src->gid;
+	dst->st_size = src->size;
+	dst->st_blksize = 2048;
+	dst->st_blocks = (src->size + 511) / 512;
+	dst->st_atime = src->mtime;
+	dst->st_mtime = src->mtime;
+	dst->st_ctime = src->mtime;
+}
+
+static void *dumpiso_fuse_init (struct fuse_conn_info *conn, struct fuse_config *cfg)
+{
+	cfg->use_ino = 1;
+	cfg->kernel_cache = 1;
+	cfg->entry_timeout = DUMPISO_FUSE_TIMEOUT;
+	cfg->attr_timeout = DUMPISO_FUSE_TIMEOUT;
+	cfg->negative_timeout = DUMPISO_FUSE_TIMEOUT;
+	if (conn->max_readahead < DUMPISO_FUSE_READAHEAD)
+	{
+		conn->max_readahead = DUMPISO_FUSE_READAHEAD;
+	}
+	return dumpiso_fuse ();
+}
+
+static int dumpiso_fuse_getattr (const char *path, struct stat *st, struct fuse_file_info *fi)
+{
+	struct cdfs_stat_t cst;
+
+	if (cdfs_stat (dumpiso_fuse ()->cdfs, path, &cst))
+	{
+		return -ENOENT;
+	}
+	dumpiso_fuse_stat (&cst, st);
+	return 0;
+}
+
+static int dumpiso_fuse_readlink (const char *path, char *buffer, size_t size)
+{
+	struct cdfs_stat_t cst;
+
+	if (cdfs_stat (dumpiso_fuse ()->cdfs, path, &cst))
+	{
+		return -ENOENT;
+	}
+	if (cdfs_readlink (dumpiso_fuse ()->cdfs, cst.ino, buffer, size) < 0)
+	{
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int dumpiso_fuse_open (const char *path, struct fuse_file_info *fi)
+{
+	struct cdfs_stat_t cst;
+
+	if (cdfs_stat (dumpiso_fuse ()->cdfs, path, &cst))
+	{
+		return -ENOENT;
+	}
+	if ((fi->flags & O_ACCMODE) != O_RDONLY)
+	{
+		return -EROFS;
+	}
+	if (!S_ISREG (cst.mode))
+	{
+		return -EISDIR;
+	}
+	fi->fh = cst.ino;
+	fi->keep_cache = 1;
+	return 0;
+}
+
+static int dumpiso_fuse_read (const char *path, char *buffer, size_t size, off_t offset, struct fuse_file_info *fi)
+{
+	struct dumpiso_fuse_t *self = dumpiso_fuse ();
+	ssize_t res;
+
+	pthread_mutex_lock (&self->lock);
+	res = cdfs_pread (self->cdfs, fi->fh, buffer, size, offset);
+	pthread_mutex_unlock (&self->lock);
+
+	return (res < 0) ? -EIO : res;
+}
+
+static int dumpiso_fuse_readdir (const char *path, void *buffer, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi, enum fuse_readdir_flags flags)
+{
+	struct cdfs_dir_t *dir;
+	struct cdfs_stat_t cst;
+	struct stat st;
+	const char *name;
+
+	dir = cdfs_opendir (dumpiso_fuse ()->cdfs, path);
+	if (!dir)
+	{
+		return -ENOTDIR;
+	}
+
+	filler (buffer, ".", 0, 0, 0);
+	filler (buffer, "..", 0, 0, 0);
+	while ((name = cdfs_readdir (dir, &cst)))
+	{
+		dumpiso_fuse_stat (&cst, &st);
+		if (filler (buffer, name, &st, 0, FUSE_FILL_DIR_PLUS))
+		{
+			break;
+		}
+	}
+
+	cdfs_closedir (dir);
+	return 0;
+}
+
+static const struct fuse_operations dumpiso_fuse_operations =
+{
+	.init     = dumpiso_fuse_init,
+	.getattr  = dumpiso_fuse_getattr,
+	.readlink = dumpiso_fuse_readlink,
+	.open     = dumpiso_fuse_open,
+	.read     = dumpiso_fuse_read,
+	.readdir  = dumpiso_fuse_readdir,
+};
+
+int main (int argc, char *argv[])
+{
+	struct dumpiso_fuse_t self;
+	int retval;
+
+	if ((argc < 3) || (argv[1][0] == '-'))
+	{
+		fprintf (stderr, "Usage:\n%s <file.iso file.bin file.cue file.toc> <mountpoint> [FUSE options]\n", argv[0]);
+		return 1;
+	}
+
+	self.cdfs = cdfs_open (argv[1]);
+	if (!self.cdfs)
+	{
+		return 1;
+	}
+	pthread_mutex_init (&self.lock, 0);
+
+	/* the image is not an argument for FUSE */
+	argv[1] = argv[0];
+	retval = fuse_main (argc - 1, argv + 1, &dumpiso_fuse_operations, &self);
+
+	pthread_mutex_destroy (&self.lock);
+	cdfs_close (self.cdfs);
+
+	return retval;
+}
@@ -0,0 +1,283 @@
+/* Drives the dumpiso-fuse.c operations directly, for testing them without libfuse3 and without mounting:
+ *
+ *     dumpiso-fuse-stub <file.iso|file.bin|file.cue|file.toc> <directory>
+ *
+ * The tree is walked through getattr and readdir, every entry is listed on stdout, and the files and symlinks are copied into
+ * directory through open, read and readlink, so the result can be compared with the output of dumpiso -u or -x. The attributes
+ * given by readdir are checked against getattr, and a few error paths are tried. Returns non-zero if anything did not match.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fuse.h"
+
+#define FUSE_STUB_READSIZE 3001 /* odd on purpose, so reads straddle the sector boundaries */
+
+struct fuse_stub_entry_t
+{
+	char        *name;
+	struct stat  st;
+};
+
+struct fuse_stub_dir_t
+{
+	int                       entries_count;
+	int                       entries_size;
+	struct fuse_stub_entry_t *entries_data;
+};
+
+static struct fuse_context fuse_stub_context;
+
+struct fuse_context *fuse_get_context (void)
+{
+	return &fuse_stub_context;
+}
+
+static int fuse_stub_filler (void *buffer, const char *name, const struct stat *st, off_t offset, enum fuse_fill_dir_flags flags)
+{
+	struct fuse_stub_dir_t *dir = buffer;
+
+	if ((!strcmp (name, ".")) || (!strcmp (name, "..")))
+	{
+		return 0;
+	}
+	if (!st)
+	{
+		fprintf (stderr, "readdir: %s has no attributes\n", name);
+		return 1;
+	}
+	if (dir->entries_count == dir->entries_size)
+	{
+		struct fuse_stub_entry_t *temp = realloc (dir->entries_data, sizeof (dir->entries_data[0]) * (dir->entries_size + 64));
+		if (!temp)
+		{
+			fprintf (stderr, "fuse_stub_filler() realloc() failed\n");
+			return 1;
+		}
+		dir->entries_data = temp;
+		dir->entries_size += 64;
+	}
+	dir->entries_data[dir->entries_count].name = strdup (name);
+	if (!dir->entries_data[dir->entries_count].name)
+	{
+		fprintf (stderr, "fuse_stub_filler() strdup() failed\n");
+		return 1;
+	}
+	dir->entries_data[dir->entries_count].st = *st;
+	dir->entries_count++;
+	return 0;
+}
+
+static int fuse_stub_file (const struct fuse_operations *op, const char *path, const struct stat *st, const char *target)
+{
+	struct fuse_file_info fi;
+	char buffer[FUSE_STUB_READSIZE];
+	off_t offset = 0;
+	int retval = 0;
+	int fd;
+	int res;
+
+	memset (&fi, 0, sizeof (fi));
+	fi.flags = O_WRONLY;
+	if ((res = op->open (path, &fi)) != -EROFS)
+	{
+		fprintf (stderr, "open(\"%s\", O_WRONLY) returned %d, expected %d\n", path, res, -EROFS);
+		retval = 1;
+	}
+
+	memset (&fi, 0, sizeof (fi));
+	fi.flags = O_RDONLY;
+	if ((res = op->open (path, &fi)))
+	{
+		fprintf (stderr, "open(\"%s\") failed: %s\n", path, strerror (-res));
+		return 1;
+	}
+
+	fd = open (target, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		fprintf (stderr, "open(\"%s\") failed: %s\n", target, strerror (errno));
+		return 1;
+	}
+	while ((res = op->read (path, buffer, sizeof (buffer), offset, &fi)) > 0)
+	{
+		if (write (fd, buffer, res) != res)
+		{
+			fprintf (stderr, "write(\"%s\") failed: %s\n", target, strerror (errno));
+			retval = 1;
+			break;
+		}
+		offset += res;
+	}
+	close (fd);
+
+	if (res < 0)
+	{
+		fprintf (stderr, "read(\"%s\", %lld) failed: %s\n", path, (long long)offset, strerror (-res));
+		return 1;
+	}
+	if (offset != st->st_size)
+	{
+		fprintf (stderr, "read(\"%s\") gave %lld bytes, getattr() said %lld\n", path, (long long)offset, (long long)st->st_size);
+		return 1;
+	}
+	return retval;
+}
+
+static int fuse_stub_symlink (const struct fuse_operations *op, const char *path, const char *target)
+{
+	char buffer[4096];
+	int res;
+
+	if ((res = op->readlink (path, buffer, sizeof (buffer))))
+	{
+		fprintf (stderr, "readlink(\"%s\") failed: %s\n", path, strerror (-res));
+		return 1;
+	}
+	if (symlink (buffer, target))
+	{
+		fprintf (stderr, "symlink(\"%s\", \"%s\") failed: %s\n", buffer, target, strerror (errno));
+		return 1;
+	}
+	return 0;
+}
+
+static char *fuse_stub_join (const char *path, const char *name)
+{
+	char *retval = malloc (strlen (path) + 1 + strlen (name) + 1);
+
+	if (retval)
+	{
+		sprintf (retval, "%s/%s", path, name);
+	}
+	return retval;
+}
+
+static int fuse_stub_walk (const struct fuse_operations *op, const char *path, const struct stat *st, const char *target)
+{
+	struct fuse_stub_dir_t dir;
+	int retval = 0;
+	int res;
+	int i;
+
+	printf ("%06o %10lld %s\n", (unsigned int)st->st_mode, (long long)st->st_size, path);
+
+	if (S_ISREG (st->st_mode))
+	{
+		return fuse_stub_file (op, path, st, target);
+	}
+	if (S_ISLNK (st->st_mode))
+	{
+		return fuse_stub_symlink (op, path, target);
+	}
+	if (!S_ISDIR (st->st_mode))
+	{
+		fprintf (stderr, "%s: unexpected mode %06o\n", path, (unsigned int)st->st_mode);
+		return 1;
+	}
+
+	if (mkdir (target, 0755) && (errno != EEXIST))
+	{
+		fprintf (stderr, "mkdir(\"%s\") failed: %s\n", target, strerror (errno));
+		return 1;
+	}
+
+	memset (&dir, 0, sizeof (dir));
+	if ((res = op->readdir (path, &dir, fuse_stub_filler, 0, 0, FUSE_READDIR_PLUS)))
+	{
+		fprintf (stderr, "readdir(\"%s\") failed: %s\n", path, strerror (-res));
+		retval = 1;
+	}
+
+	for (i=0; i < dir.entries_count; i++)
+	{
+		struct fuse_stub_entry_t *e = &dir.entries_data[i];
+		struct stat st2;
+		char *childpath;
+		char *childtarget;
+
+		childpath = fuse_stub_join (strcmp (path, "/") ? path : "", e->name);
+		childtarget = fuse_stub_join (target, e->name);
+		if ((!childpath) || (!childtarget))
+		{
+			fprintf (stderr, "fuse_stub_walk() malloc() failed\n");
+			free (childpath);
+			free (childtarget);
+			retval = 1;
+			break;
+		}
+
+		if ((res = op->getattr (childpath, &st2, 0)))
+		{
+			fprintf (stderr, "getattr(\"%s\") failed: %s\n", childpath, strerror (-res));
+			retval = 1;
+		} else {
+			if ((st2.st_ino != e->st.st_ino) || (st2.st_mode != e->st.st_mode) || (st2.st_size != e->st.st_size))
+			{
+				fprintf (stderr, "%s: readdir() and getattr() do not agree\n", childpath);
+				retval = 1;
+			}
+			retval |= fuse_stub_walk (op, childpath, &st2, childtarget);
+		}
+
+		free (childpath);
+		free (childtarget);
+	}
+
+	for (i=0; i < dir.entries_count; i++)
+	{
+		free (dir.entries_data[i].name);
+	}
+	free (dir.entries_data);
+
+	return retval;
+}
+
+int fuse_main (int argc, char *argv[], const struct fuse_operations *op, void *private_data)
+{
+	struct fuse_conn_info conn;
+	struct fuse_config cfg;
+	struct stat st;
+	char buffer[16];
+	int retval = 0;
+	int res;
+
+	if (argc < 2)
+	{
+		fprintf (stderr, "fuse_main(): no directory given\n");
+		return 1;
+	}
+
+	memset (&conn, 0, sizeof (conn));
+	memset (&cfg, 0, sizeof (cfg));
+	fuse_stub_context.private_data = private_data;
+	fuse_stub_context.private_data = op->init (&conn, &cfg);
+
+	if ((res = op->getattr ("/", &st, 0)))
+	{
+		fprintf (stderr, "getattr(\"/\") failed: %s\n", strerror (-res));
+		return 1;
+	}
+	if ((res = op->getattr ("/.fuse-stub-missing", &st, 0)) != -ENOENT)
+	{
+		fprintf (stderr, "getattr() of a missing file returned %d, expected %d\n", res, -ENOENT);
+		retval = 1;
+	}
+	if ((res = op->readlink ("/", buffer, sizeof (buffer))) != -EINVAL)
+	{
+		fprintf (stderr, "readlink(\"/\") returned %d, expected %d\n", res, -EINVAL);
+		retval = 1;
+	}
+
+	op->getattr ("/", &st, 0);
+	retval |= fuse_stub_walk (op, "/", &st, argv[1]);
+
+	return retval;
+}
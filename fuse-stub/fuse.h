@@ -0,0 +1,67 @@
+#ifndef FUSE_STUB_H
+#define FUSE_STUB_H
+
+/* Stand-in for the parts of the libfuse3 API that dumpiso-fuse.c uses, so that the file system operations can be built and
+ * exercised without libfuse3 and without mounting anything, see fuse-stub.c and "make dumpiso-fuse-stub".
+ *
+ * The layouts are not binary compatible with libfuse3, only the names and the prototypes of the callbacks match.
+ */
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+struct fuse_conn_info
+{
+	unsigned int max_readahead;
+};
+
+struct fuse_config
+{
+	int    use_ino;
+	int    kernel_cache;
+	double entry_timeout;
+	double attr_timeout;
+	double negative_timeout;
+};
+
+struct fuse_file_info
+{
+	int          flags;
+	unsigned int keep_cache : 1;
+	uint64_t     fh;
+};
+
+enum fuse_readdir_flags
+{
+	FUSE_READDIR_PLUS = (1 << 0),
+};
+
+enum fuse_fill_dir_flags
+{
+	FUSE_FILL_DIR_PLUS = (1 << 1),
+};
+
+typedef int (*fuse_fill_dir_t) (void *buffer, const char *name, const struct stat *st, off_t offset, enum fuse_fill_dir_flags flags);
+
+struct fuse_operations
+{
+	int   (*getattr)  (const char *path, struct stat *st, struct fuse_file_info *fi);
+	int   (*readlink) (const char *path, char *buffer, size_t size);
+	int   (*open)     (const char *path, struct fuse_file_info *fi);
+	int   (*read)     (const char *path, char *buffer, size_t size, off_t offset, struct fuse_file_info *fi);
+	int   (*readdir)  (const char *path, void *buffer, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi, enum fuse_readdir_flags flags);
+	void *(*init)     (struct fuse_conn_info *conn, struct fuse_config *cfg);
+};
+
+struct fuse_context
+{
+	void *private_data;
+};
+
+struct fuse_context *fuse_get_context (void);
+
+/* Instead of mounting, argv[1] (the mountpoint) is created as a directory and every file is copied into it through the operations */
+int fuse_main (int argc, char *argv[], const struct fuse_operations *op, void *private_data);
+
+#endif
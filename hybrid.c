@@ -0,0 +1,523 @@
+/* System Area (sector 0-15) of hybrid images, that can both be used as a CD-ROM and as a hard-drive / USB stick.
+ *
+ * isohybrid / xorriso images can contain any combination of a MBR, a GPT and an Apple Partition Map. The partitions usually point at
+ * the ISO9660 filesystem itself, or at a FAT image (EFI System Partition) that is also a file inside the ISO9660 filesystem and/or
+ * an El Torito boot image.
+ */
+
+#define HYBRID_SYSTEMAREA_SECTORS 16
+#define HYBRID_GPT_ENTRIES_MAX (1024*1024) /* the specification requires 16KB, some sanity for the allocation */
+
+static uint32_t       Hybrid_crc32_table[8][256];
+static pthread_once_t Hybrid_crc32_table_once = PTHREAD_ONCE_INIT;
+
+static void Hybrid_crc32_init (void)
+{
+	int i, j;
+
+	for (i=0; i < 256; i++)
+	{
+		uint32_t c = i;
+		for (j=0; j < 8; j++)
+		{
+			c = (c & 1) ? ((c >> 1) ^ 0xedb88320) : (c >> 1);
+		}
+		Hybrid_crc32_table[0][i] = c;
+	}
+	for (i=0; i < 256; i++)
+	{
+		for (j=1; j < 8; j++)
+		{
+			Hybrid_crc32_table[j][i] = (Hybrid_crc32_table[j-1][i] >> 8) ^ Hybrid_crc32_table[0][Hybrid_crc32_table[j-1][i] & 0xff];
+		}
+	}
+}
+
+/* CRC-32 as used by GPT, slice-by-8: eight bytes per iteration with one table lookup each */
+static uint32_t Hybrid_crc32 (const uint8_t *data, size_t length)
+{
+	uint32_t crc = 0xffffffff;
+
+	pthread_once (&Hybrid_crc32_table_once, Hybrid_crc32_init);
+
+	while (length >= 8)
+	{
+		uint32_t one = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+		uint32_t two =        data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+		crc = Hybrid_crc32_table[7][ one        & 0xff] ^
+		      Hybrid_crc32_table[6][(one >>  8) & 0xff] ^
+		      Hybrid_crc32_table[5][(one >> 16) & 0xff] ^
+		      Hybrid_crc32_table[4][ one >> 24        ] ^
+		      Hybrid_crc32_table[3][ two        & 0xff] ^
+		      Hybrid_crc32_table[2][(two >>  8) & 0xff] ^
+		      Hybrid_crc32_table[1][(two >> 16) & 0xff] ^
+		      Hybrid_crc32_table[0][ two >> 24        ];
+		data += 8;
+		length -= 8;
+	}
+	while (length--)
+	{
+		crc = (crc >> 8) ^ Hybrid_crc32_table[0][(crc ^ *(data++)) & 0xff];
+	}
+
+	return ~crc;
+}
+
+static uint32_t Hybrid_le32 (const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t Hybrid_le64 (const uint8_t *p)
+{
+	return Hybrid_le32 (p) | ((uint64_t)Hybrid_le32 (p + 4) << 32);
+}
+
+static uint32_t Hybrid_be32 (const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void Hybrid_print_guid (const uint8_t *g)
+{
+	TRACE ("%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+		g[3], g[2], g[1], g[0], g[5], g[4], g[7], g[6],
+		g[8], g[9], g[10], g[11], g[12], g[13], g[14], g[15]);
+}
+
+static const char *Hybrid_GPT_Type (const uint8_t *g)
+{
+	static const struct
+	{
+		uint8_t guid[16];
+		const char *name;
+	} types[] =
+	{
+		{{0x28,0x73,0x2a,0xc1,0x1f,0xf8,0xd2,0x11,0xba,0x4b,0x00,0xa0,0xc9,0x3e,0xc9,0x3b}, "EFI System Partition"},
+		{{0xa2,0xa0,0xd0,0xeb,0xe5,0xb9,0x33,0x44,0x87,0xc0,0x68,0xb6,0xb7,0x26,0x99,0xc7}, "Basic Data"},
+		{{0x00,0x53,0x46,0x48,0x00,0x00,0xaa,0x11,0xaa,0x11,0x00,0x30,0x65,0x43,0xec,0xac}, "Apple HFS+"},
+		{{0xaf,0x3d,0xc6,0x0f,0x83,0x84,0x72,0x47,0x8e,0x79,0x3d,0x69,0xd8,0x47,0x7d,0xe4}, "Linux filesystem data"},
+		{{0x48,0x61,0x68,0x21,0x49,0x64,0x6f,0x6e,0x74,0x4e,0x65,0x65,0x64,0x45,0x46,0x49}, "BIOS boot partition"},
+	};
+	int i;
+
+	for (i=0; i < (int)(sizeof (types) / sizeof (types[0])); i++)
+	{
+		if (!memcmp (types[i].guid, g, 16))
+		{
+			return types[i].name;
+		}
+	}
+	return "Unknown";
+}
+
+/* GPT partition names are UTF-16LE, print them as UTF-8 */
+static void Hybrid_print_utf16le (const uint8_t *p, int length)
+{
+	int i;
+
+	for (i=0; i + 1 < length; i+=2)
+	{
+		uint16_t c = p[i] | (p[i+1] << 8);
+		if (!c)
+		{
+			break;
+		}
+		if (c < 0x80)
+		{
+			TRACE_PUTCHAR (c);
+		} else if (c < 0x800)
+		{
+			TRACE_PUTCHAR (0xc0 | (c >> 6));
+			TRACE_PUTCHAR (0x80 | (c & 0x3f));
+		} else {
+			TRACE_PUTCHAR (0xe0 | (c >> 12));
+			TRACE_PUTCHAR (0x80 | ((c >> 6) & 0x3f));
+			TRACE_PUTCHAR (0x80 | (c & 0x3f));
+		}
+	}
+}
+
+/* Rebuild the path of directory by following the .. entries up to the root directory */
+static void Hybrid_path (struct Volume_Description_t *vd, struct iso_dir_t *directory, struct DumpFS_path_t *path)
+{
+	struct iso_dir_t **chain;
+	int n = 0;
+
+	/* a chain of distinct directories can not be longer than the number of directories, if it is the .. entries form a loop */
+	chain = malloc (sizeof (chain[0]) * (vd->directories_count + 1));
+	if (!chain)
+	{
+		fprintf (stderr, "Hybrid_path() malloc() failed\n");
+		DumpFS_path_put (path, "/?", 2);
+		return;
+	}
+	while (directory && (directory->Location != vd->root_dirent.Absolute_Location) && (directory->dirents_count > 1) && (n <= vd->directories_count))
+	{
+		chain[n++] = directory;
+		directory = DumpFS_dir_find (vd, directory->dirents_data[1]->Absolute_Location);
+	}
+	if ((!directory) || (n > vd->directories_count))
+	{
+		DumpFS_path_put (path, "/?", 2);
+		free (chain);
+		return;
+	}
+
+	while (n--)
+	{
+		int i;
+		for (i=2; i < directory->dirents_count; i++)
+		{
+			struct iso_dirent_t *de = directory->dirents_data[i];
+			if ((de->Flags & ISO9660_DIRENT_FLAGS_DIR) && (de->Absolute_Location == chain[n]->Location))
+			{
+				if (de->Name_RockRidge_Length)
+				{
+					DumpFS_path_append (path, (char *)de->Name_RockRidge, de->Name_RockRidge_Length);
+				} else {
+					DumpFS_path_append (path, (char *)de->Name_ISO9660, de->Name_ISO9660_Length);
+				}
+				break;
+			}
+		}
+		directory = chain[n];
+	}
+	free (chain);
+}
+
+/* List the files and El Torito boot images that are stored inside the given byte range of the disc */
+static void Hybrid_map (struct cdfs_disc_t *disc, uint64_t start, uint64_t length)
+{
+	struct Volume_Description_t *vd;
+	uint64_t end = start + length;
+	int found = 0;
+	int i, j;
+
+	if (!length)
+	{
+		return;
+	}
+
+	if ((start < (17 * SECTORSIZE)) && (end > (16 * SECTORSIZE)))
+	{
+		TRACE ("    contains the ISO9660 volume descriptors\n");
+		return;
+	}
+
+	if (disc->iso9660_session && disc->iso9660_session->ElTorito)
+	{
+		struct ElTorito_catalog_t *catalog = disc->iso9660_session->ElTorito;
+		for (i=0; i < catalog->entries_count; i++)
+		{
+			uint64_t first = (uint64_t)catalog->entries_data[i].LoadRBA * SECTORSIZE;
+			uint64_t last = first + ElTorito_ImageLength (disc, &catalog->entries_data[i]);
+			if ((first < end) && (last > start))
+			{
+				TRACE ("    overlaps El Torito entry %d (%s boot image at sector %" PRIu32 ")%s\n",
+					i,
+					ElTorito_PlatformName (catalog->entries_data[i].Platform),
+					catalog->entries_data[i].LoadRBA,
+					((first == start) && (last == end)) ? ", exact match" : "");
+				found = 1;
+			}
+		}
+	}
+
+	vd = disc->iso9660_session ? disc->iso9660_session->Primary_Volume_Description : 0;
+	for (i=0; vd && (i < vd->directories_count); i++)
+	{
+		struct iso_dir_t *directory = &vd->directories_data[i];
+		for (j=2; j < directory->dirents_count; j++)
+		{
+			struct iso_dirent_t *de = directory->dirents_data[j];
+			struct iso_dirent_t *iter;
+
+			if (de->Flags & ISO9660_DIRENT_FLAGS_DIR)
+			{
+				continue;
+			}
+
+			for (iter = de; iter; iter = iter->next_extent)
+			{
+				uint64_t first = (uint64_t)iter->Absolute_Location * SECTORSIZE;
+				uint64_t last = first + iter->Length;
+				if ((first < end) && (last > start))
+				{
+					struct DumpFS_path_t path;
+					if (DumpFS_path_init (&path, ""))
+					{
+						return;
+					}
+					Hybrid_path (vd, directory, &path);
+					if (de->Name_RockRidge_Length)
+					{
+						DumpFS_path_append (&path, (char *)de->Name_RockRidge, de->Name_RockRidge_Length);
+					} else {
+						DumpFS_path_append (&path, (char *)de->Name_ISO9660, de->Name_ISO9660_Length);
+					}
+					TRACE ("    overlaps file %s (sector %" PRIu32 ", %" PRIu32 " bytes)%s\n",
+						path.data,
+						iter->Absolute_Location,
+						iter->Length,
+						((first == start) && (last == end)) ? ", exact match" : "");
+					DumpFS_path_free (&path);
+					found = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!found)
+	{
+		TRACE ("    not covered by any ISO9660 file or El Torito boot image\n");
+	}
+}
+
+static int Hybrid_MBR (struct cdfs_disc_t *disc, const uint8_t *buffer)
+{
+	int protective = 0;
+	int i;
+
+	if ((buffer[510] != 0x55) || (buffer[511] != 0xaa))
+	{
+		return 0;
+	}
+
+	TRACE (" [Master Boot Record]\n");
+	for (i=0; i < 4; i++)
+	{
+		const uint8_t *p = buffer + 0x1be + (i << 4);
+		uint32_t first = Hybrid_le32 (p + 8);
+		uint32_t length = Hybrid_le32 (p + 12);
+
+		if (!p[4])
+		{
+			continue;
+		}
+		TRACE ("  Partition %d%s type 0x%02" PRIx8 " (%s) LBA %" PRIu32 ", %" PRIu32 " blocks of 512 bytes\n",
+			i + 1,
+			(p[0] & 0x80) ? " (active)" : "",
+			p[4],
+			PartitionType (p[4]),
+			first,
+			length);
+		if (p[4] == 0xee)
+		{
+			protective = 1;
+			continue;
+		}
+		Hybrid_map (disc, (uint64_t)first * 512, (uint64_t)length * 512);
+	}
+
+	return protective;
+}
+
+static int Hybrid_GPT (struct cdfs_disc_t *disc, const uint8_t *buffer, uint32_t blocksize)
+{
+	const uint8_t *header = buffer + blocksize;
+	uint8_t temp[512];
+	uint32_t headersize, headercrc, entriescount, entrysize, entriescrc, crc;
+	uint64_t entrieslba;
+	uint64_t entriesbytes;
+	const uint8_t *entries;
+	uint8_t *data = 0;
+	uint32_t i;
+
+	if (memcmp (header, "EFI PART", 8))
+	{
+		return -1;
+	}
+
+	TRACE (" [GUID Partition Table, %" PRIu32 " bytes per block]\n", blocksize);
+
+	headersize = Hybrid_le32 (header + 12);
+	headercrc = Hybrid_le32 (header + 16);
+	if ((headersize < 92) || (headersize > sizeof (temp)))
+	{
+		TRACE ("  Warning - invalid header size %" PRIu32 "\n", headersize);
+		return 0;
+	}
+	memcpy (temp, header, headersize);
+	temp[16] = temp[17] = temp[18] = temp[19] = 0;
+	crc = Hybrid_crc32 (temp, headersize);
+	if (crc != headercrc)
+	{
+		TRACE ("  Warning - header CRC32 failed (got 0x%08" PRIx32 ", but expected 0x%08" PRIx32 ")\n", crc, headercrc);
+	} else {
+		TRACE ("  Header CRC32 correct\n");
+	}
+
+	TRACE ("  Current LBA: %" PRIu64 "\n", Hybrid_le64 (header + 24));
+	TRACE ("  Backup LBA: %" PRIu64 "\n", Hybrid_le64 (header + 32));
+	TRACE ("  Usable LBA: %" PRIu64 " - %" PRIu64 "\n", Hybrid_le64 (header + 40), Hybrid_le64 (header + 48));
+	TRACE ("  Disk GUID: ");
+	Hybrid_print_guid (header + 56);
+	TRACE ("\n");
+
+	entrieslba = Hybrid_le64 (header + 72);
+	entriescount = Hybrid_le32 (header + 80);
+	entrysize = Hybrid_le32 (header + 84);
+	entriescrc = Hybrid_le32 (header + 88);
+	entriesbytes = (uint64_t)entriescount * entrysize;
+
+	if ((entrysize < 128) || (entriesbytes > HYBRID_GPT_ENTRIES_MAX))
+	{
+		TRACE ("  Warning - invalid partition entry array (%" PRIu32 " entries of %" PRIu32 " bytes)\n", entriescount, entrysize);
+		return 0;
+	}
+
+	/* entrieslba comes from the image, keep the arithmetic below from wrapping and the reads inside the disc */
+	if ((entrieslba > UINT32_MAX) || ((((entrieslba * blocksize) + entriesbytes + SECTORSIZE - 1) / SECTORSIZE) > cdfs_disc_sectorcount (disc)))
+	{
+		TRACE ("  Warning - partition entry array at LBA %" PRIu64 " is outside the disc\n", entrieslba);
+		return 0;
+	}
+
+	if (((entrieslba * blocksize) + entriesbytes) <= (HYBRID_SYSTEMAREA_SECTORS * SECTORSIZE))
+	{
+		entries = buffer + entrieslba * blocksize;
+	} else {
+		uint64_t first = (entrieslba * blocksize) / SECTORSIZE;
+		uint64_t skip = (entrieslba * blocksize) % SECTORSIZE;
+		uint32_t count = (skip + entriesbytes + SECTORSIZE - 1) / SECTORSIZE;
+		data = malloc ((size_t)count * SECTORSIZE);
+		if (!data)
+		{
+			fprintf (stderr, "Hybrid_GPT() malloc() failed\n");
+			return 0;
+		}
+		if (get_absolute_sectors_2048 (disc, first, count, data))
+		{
+			TRACE ("  Failed to fetch the partition entry array at LBA %" PRIu64 "\n", entrieslba);
+			free (data);
+			return 0;
+		}
+		memmove (data, data + skip, entriesbytes);
+		entries = data;
+	}
+
+	crc = Hybrid_crc32 (entries, entriesbytes);
+	if (crc != entriescrc)
+	{
+		TRACE ("  Warning - partition entry array CRC32 failed (got 0x%08" PRIx32 ", but expected 0x%08" PRIx32 ")\n", crc, entriescrc);
+	} else {
+		TRACE ("  Partition entry array CRC32 correct\n");
+	}
+
+	for (i=0; i < entriescount; i++)
+	{
+		const uint8_t *p = entries + i * entrysize;
+		static const uint8_t unused[16];
+		uint64_t first, last;
+
+		if (!memcmp (p, unused, 16))
+		{
+			continue;
+		}
+		first = Hybrid_le64 (p + 32);
+		last = Hybrid_le64 (p + 40);
+
+		TRACE ("  Partition %" PRIu32 " \"", i + 1);
+		Hybrid_print_utf16le (p + 56, 72);
+		TRACE ("\" type ");
+		Hybrid_print_guid (p);
+		TRACE (" (%s) LBA %" PRIu64 " - %" PRIu64 "\n", Hybrid_GPT_Type (p), first, last);
+		if (last >= first)
+		{
+			Hybrid_map (disc, first * blocksize, (last - first + 1) * blocksize);
+		}
+	}
+
+	free (data);
+
+	return 0;
+}
+
+static void Hybrid_APM (struct cdfs_disc_t *disc, const uint8_t *buffer)
+{
+	uint32_t blocksize;
+	uint32_t count;
+	uint32_t i;
+
+	if ((buffer[0] != 'E') || (buffer[1] != 'R'))
+	{
+		return;
+	}
+
+	/* The Driver Descriptor Map states the block size, but images exist with 512 byte entries and 2048 byte blocks */
+	blocksize = (buffer[2] << 8) | buffer[3];
+	if ((blocksize < 512) || ((blocksize * 2) > (HYBRID_SYSTEMAREA_SECTORS * SECTORSIZE)) || (buffer[blocksize] != 'P') || (buffer[blocksize + 1] != 'M'))
+	{
+		blocksize = 512;
+		if ((buffer[blocksize] != 'P') || (buffer[blocksize + 1] != 'M'))
+		{
+			return;
+		}
+	}
+
+	TRACE (" [Apple Partition Map, %" PRIu32 " bytes per block]\n", blocksize);
+
+	count = Hybrid_be32 (buffer + blocksize + 4);
+	for (i=1; i <= count; i++)
+	{
+		const uint8_t *p = buffer + i * blocksize;
+		uint32_t first, length;
+
+		if ((((uint64_t)i + 1) * blocksize) > (HYBRID_SYSTEMAREA_SECTORS * SECTORSIZE))
+		{
+			TRACE ("  Warning - partition map continues beyond the system area\n");
+			break;
+		}
+		if ((p[0] != 'P') || (p[1] != 'M'))
+		{
+			TRACE ("  Warning - partition %" PRIu32 " has invalid signature\n", i);
+			break;
+		}
+		first = Hybrid_be32 (p + 8);
+		length = Hybrid_be32 (p + 12);
+		TRACE ("  Partition %" PRIu32 " \"%.32s\" type \"%.32s\" block %" PRIu32 ", %" PRIu32 " blocks\n", i, p + 16, p + 48, first, length);
+		if (strncmp ((const char *)p + 48, "Apple_partition_map", 32))
+		{
+			Hybrid_map (disc, (uint64_t)first * blocksize, (uint64_t)length * blocksize);
+		}
+	}
+}
+
+void ISO9660_SystemArea (struct cdfs_disc_t *disc)
+{
+	uint8_t *buffer;
+	int protective;
+	static const uint8_t empty[HYBRID_SYSTEMAREA_SECTORS * SECTORSIZE];
+
+	buffer = malloc (HYBRID_SYSTEMAREA_SECTORS * SECTORSIZE);
+	if (!buffer)
+	{
+		fprintf (stderr, "ISO9660_SystemArea() malloc() failed\n");
+		return;
+	}
+
+	if (get_absolute_sectors_2048 (disc, 0, HYBRID_SYSTEMAREA_SECTORS, buffer))
+	{
+		free (buffer);
+		return;
+	}
+
+	if (!memcmp (buffer, empty, sizeof (empty)))
+	{ /* plain ISO9660 images */
+		free (buffer);
+		return;
+	}
+
+	TRACE ("System Area (sector 0-15)\n");
+	protective = Hybrid_MBR (disc, buffer);
+	if (Hybrid_GPT (disc, buffer, 512) && Hybrid_GPT (disc, buffer, 2048) && protective)
+	{
+		TRACE (" Warning - protective MBR found, but no GPT\n");
+	}
+	Hybrid_APM (disc, buffer);
+
+	free (buffer);
+}
@@ -1,15 +1,22 @@
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "cdfs.h"
+#include "dumpfs.h"
 #include "iso9660.h"
+#include "libcdfs.h"
 #include "main.h"
 
 const char *get_month (uint8_t i)
@@ -36,13 +43,13 @@ static void DumpFS_dir_permissions_ISO9660 (struct iso_dirent_t *de) /* includes
 {
 	if (de->Flags & ISO9660_DIRENT_FLAGS_DIR)
 	{
-		putchar ('d');
+		TRACE_PUTCHAR ('d');
 	} else {
-		putchar ('-');
+		TRACE_PUTCHAR ('-');
 	}
 	if (de->XA)
 	{
-		printf ("%c-%c%c-%c%c-%c",
+		TRACE ("%c-%c%c-%c%c-%c",
 			de->XA_attr & XA_ATTR__OWNER_READ ? 'r':'-',
 			de->XA_attr & XA_ATTR__OWNER_EXEC ? 'x':'-',
 			de->XA_attr & XA_ATTR__GROUP_READ ? 'r':'-',
@@ -50,9 +57,9 @@ static void DumpFS_dir_permissions_ISO9660 (struct iso_dirent_t *de) /* includes
 			de->XA_attr & XA_ATTR__OTHER_READ ? 'r':'-',
 			de->XA_attr & XA_ATTR__OTHER_EXEC ? 'x':'-');
 	} else {
-		printf ("?-\?\?-\?\?-?");
+		TRACE ("?-\?\?-\?\?-?");
 	}
-	putchar ('-');
+	TRACE_PUTCHAR ('-');
 }
 
 static void DumpFS_dir_permissions_RockRidge (struct iso_dirent_t *de) /* Uses ISO9660/XA information if data is missing */
@@ -61,53 +68,53 @@ static void DumpFS_dir_permissions_RockRidge (struct iso_dirent_t *de) /* Uses I
 	{
 		switch (de->RockRidge_PX_st_mode & 0170000)
 		{
-			case 0140000: putchar ('s'); break; /* socket */
-			case 0120000: putchar ('l'); break; /* symlink */
-			case 0100000: putchar ('-'); break; /* file */
-			case 0060000: putchar ('b'); break; /* block special */
-			case 0020000: putchar ('c'); break; /* character special */
-			case 0040000: putchar ('d'); break; /* directory */
-			case 0010000: putchar ('p'); break; /* pipe or FIFO */
-			default:      putchar ('?'); break;
+			case 0140000: TRACE_PUTCHAR ('s'); break; /* socket */
+			case 0120000: TRACE_PUTCHAR ('l'); break; /* symlink */
+			case 0100000: TRACE_PUTCHAR ('-'); break; /* file */
+			case 0060000: TRACE_PUTCHAR ('b'); break; /* block special */
+			case 0020000: TRACE_PUTCHAR ('c'); break; /* character special */
+			case 0040000: TRACE_PUTCHAR ('d'); break; /* directory */
+			case 0010000: TRACE_PUTCHAR ('p'); break; /* pipe or FIFO */
+			default:      TRACE_PUTCHAR ('?'); break;
 		}
 	} else if (de->RockRidge_Symlink_Components_Length)
 	{
-		putchar ('s');
+		TRACE_PUTCHAR ('s');
 	} else if (de->Flags & ISO9660_DIRENT_FLAGS_DIR)
 	{
-		putchar ('d');
+		TRACE_PUTCHAR ('d');
 	} else if (de->RockRidge_IsAugmentedDirectory) /* file is a placeholder for a directory redirect */
 	{
-		putchar ('d');
+		TRACE_PUTCHAR ('d');
 	} else {
-		putchar ('-');
+		TRACE_PUTCHAR ('-');
 	}
 
 	if (de->RockRidge_PX_Present)
 	{
-		putchar ((de->RockRidge_PX_st_mode & 0000400) ? 'r' : '-'); /* S_IRUSR */
-		putchar ((de->RockRidge_PX_st_mode & 0000200) ? 'w' : '-'); /* S_IWUSR */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000400) ? 'r' : '-'); /* S_IRUSR */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000200) ? 'w' : '-'); /* S_IWUSR */
 		if (de->RockRidge_PX_st_mode & 0004000)
 		{
-			putchar ((de->RockRidge_PX_st_mode & 0000100) ? 's' : 'S'); /* S_IXUSR + SUID */
+			TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000100) ? 's' : 'S'); /* S_IXUSR + SUID */
 		} else {
-			putchar ((de->RockRidge_PX_st_mode & 0000100) ? 'x' : '-'); /* S_IXUSR */
+			TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000100) ? 'x' : '-'); /* S_IXUSR */
 		}
-		putchar ((de->RockRidge_PX_st_mode & 0000040) ? 'r' : '-'); /* S_IRGRP */
-		putchar ((de->RockRidge_PX_st_mode & 0000020) ? 'w' : '-'); /* S_IWGRP */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000040) ? 'r' : '-'); /* S_IRGRP */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000020) ? 'w' : '-'); /* S_IWGRP */
 		if (de->RockRidge_PX_st_mode & 0002000)
 		{
-			putchar ((de->RockRidge_PX_st_mode & 0000010) ? 's' : 'S'); /* S_IXGRP + GUID*/
+			TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000010) ? 's' : 'S'); /* S_IXGRP + GUID*/
 		} else {
-			putchar ((de->RockRidge_PX_st_mode & 0000010) ? 'x' : '-'); /* S_IXGRP */
+			TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000010) ? 'x' : '-'); /* S_IXGRP */
 		}
-		putchar ((de->RockRidge_PX_st_mode & 0000004) ? 'r' : '-'); /* S_IROTH */
-		putchar ((de->RockRidge_PX_st_mode & 0000002) ? 'w' : '-'); /* S_IWOTH */
-		putchar ((de->RockRidge_PX_st_mode & 0000001) ? 'x' : '-'); /* S_IXOTH */
-		putchar ((de->RockRidge_PX_st_mode & 0001000) ? 't' : '-'); /* S_ISVTX (sticky) */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000004) ? 'r' : '-'); /* S_IROTH */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000002) ? 'w' : '-'); /* S_IWOTH */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0000001) ? 'x' : '-'); /* S_IXOTH */
+		TRACE_PUTCHAR ((de->RockRidge_PX_st_mode & 0001000) ? 't' : '-'); /* S_ISVTX (sticky) */
 	} else if (de->XA)
 	{
-		printf ("%c-%c%c-%c%c-%c-",
+		TRACE ("%c-%c%c-%c%c-%c-",
 			de->XA_attr & XA_ATTR__OWNER_READ ? 'r':'-',
 			de->XA_attr & XA_ATTR__OWNER_EXEC ? 'x':'-',
 			de->XA_attr & XA_ATTR__GROUP_READ ? 'r':'-',
@@ -115,7 +122,7 @@ static void DumpFS_dir_permissions_RockRidge (struct iso_dirent_t *de) /* Uses I
 			de->XA_attr & XA_ATTR__OTHER_READ ? 'r':'-',
 			de->XA_attr & XA_ATTR__OTHER_EXEC ? 'x':'-');
 	} else {
-		printf ("\?\?\?\?\?\?\?\?\?\?");
+		TRACE ("\?\?\?\?\?\?\?\?\?\?");
 	}
 }
 
@@ -123,9 +130,9 @@ static void DumpFS_dir_owner_ISO9660 (struct iso_dirent_t *de) /* XA parsing */
 {
 	if (de->XA)
 	{
-		printf (" %5d %5d", de->XA_UID, de->XA_GID);
+		TRACE (" %5d %5d", de->XA_UID, de->XA_GID);
 	} else {
-		printf ("     ?     ?");
+		TRACE ("     ?     ?");
 	}
 }
 
@@ -133,7 +140,7 @@ static void DumpFS_dir_owner_RockRidge (struct iso_dirent_t *de) /* Uses ISO9660
 {
 	if (de->RockRidge_PX_Present)
 	{
-		printf (" %5d %5d", de->RockRidge_PX_st_uid, de->RockRidge_PX_st_gid);
+		TRACE (" %5d %5d", de->RockRidge_PX_st_uid, de->RockRidge_PX_st_gid);
 	} else {
 		DumpFS_dir_owner_ISO9660 (de);
 	}
@@ -148,7 +155,7 @@ static void DumpFS_dir_filesize_ISO9660 (struct iso_dirent_t *de)
 	{
 		len += iter->Length;
 	}
-	printf (" %10" PRIu64, len);
+	TRACE (" %10" PRIu64, len);
 }
 
 static void DumpFS_dir_filesize_RockRidge (struct iso_dirent_t *de) /* Falls back to ISO9660 */
@@ -159,7 +166,7 @@ static void DumpFS_dir_filesize_RockRidge (struct iso_dirent_t *de) /* Falls bac
 	    (((de->RockRidge_PX_st_mode & 0170000) == 0060000) || /* block device */
 	     ((de->RockRidge_PX_st_mode & 0170000) == 0020000)))  /* character special */
 	{
-		printf ("  %4" PRIu32 ",%4" PRIu32, de->RockRidge_PN_major, de->RockRidge_PN_minor);
+		TRACE ("  %4" PRIu32 ",%4" PRIu32, de->RockRidge_PN_major, de->RockRidge_PN_minor);
 	} else {
 		DumpFS_dir_filesize_ISO9660 (de);
 	}
@@ -167,7 +174,7 @@ static void DumpFS_dir_filesize_RockRidge (struct iso_dirent_t *de) /* Falls bac
 
 static void DumpFS_dir_cdate_ISO9660 (struct iso_dirent_t *de)
 {
-	printf (" %02d %3s %4d %02u:%02u:%02u%+05d ",
+	TRACE (" %02d %3s %4d %02u:%02u:%02u%+05d ",
 		de->Created.day,              /* day */
 		get_month(de->Created.month), /* month */
 		de->Created.year,             /* year */
@@ -181,7 +188,7 @@ static void DumpFS_dir_cdate_RockRidge (struct iso_dirent_t *de) /* Falls back t
 {
 	if (de->RockRidge_TF_Created_Present)
 	{
-		printf (" %02d %3s %4d %02u:%02u:%02u%+05d ",
+		TRACE (" %02d %3s %4d %02u:%02u:%02u%+05d ",
 			          de->RockRidge_TF_Created.day,       /* day */
 			get_month(de->RockRidge_TF_Created.month),    /* month */
 			          de->RockRidge_TF_Created.year,      /* year */
@@ -194,15 +201,350 @@ static void DumpFS_dir_cdate_RockRidge (struct iso_dirent_t *de) /* Falls back t
 	}
 }
 
-/* assumes ASCII */
-void DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *name, uint32_t Location);
+static void DumpFS_record_extents_ISO9660 (struct DumpFS_sink_t *sink, struct DumpFS_record_t *record, struct iso_dirent_t *de)
+{
+	struct DumpFS_extent_t *extents;
+	struct iso_dirent_t *iter;
+	int count = 0;
+
+	record->size = 0;
+	record->has_size = 1;
+	for (iter = de; iter; iter = iter->next_extent) /* files can be split into extents */
+	{
+		record->size += iter->Length;
+		count++;
+	}
+
+	extents = DumpFS_sink_extents (sink, count);
+	if (!extents)
+	{
+		return;
+	}
+	for (iter = de; iter; iter = iter->next_extent)
+	{
+		if (!iter->Length)
+		{
+			continue;
+		}
+		extents[record->extents_count].Location = iter->Absolute_Location;
+		extents[record->extents_count].Length = iter->Length;
+		extents[record->extents_count].Hole = 0;
+		record->extents_count++;
+	}
+	record->extents = extents;
+}
+
+static int64_t DumpFS_record_time_ISO9660 (struct iso9660_datetime_t *t)
+{
+	return DumpFS_time (t->year, t->month, t->day, t->hour, t->minute, t->second, (t->tz / 100) * 60 + (t->tz % 100));
+}
+
+static void DumpFS_record_fill_ISO9660 (struct DumpFS_sink_t *sink, struct DumpFS_record_t *record, struct iso_dirent_t *de)
+{
+	record->type = (de->Flags & ISO9660_DIRENT_FLAGS_DIR) ? 'd' : '-';
+	if (de->XA)
+	{
+		record->has_mode = 1;
+		record->mode = ((de->XA_attr & XA_ATTR__OWNER_READ) ? 0400 : 0) |
+		               ((de->XA_attr & XA_ATTR__OWNER_EXEC) ? 0100 : 0) |
+		               ((de->XA_attr & XA_ATTR__GROUP_READ) ? 0040 : 0) |
+		               ((de->XA_attr & XA_ATTR__GROUP_EXEC) ? 0010 : 0) |
+		               ((de->XA_attr & XA_ATTR__OTHER_READ) ? 0004 : 0) |
+		               ((de->XA_attr & XA_ATTR__OTHER_EXEC) ? 0001 : 0);
+		record->has_owner = 1;
+		record->uid = de->XA_UID;
+		record->gid = de->XA_GID;
+	}
+	record->has_mtime = 1;
+	record->mtime = DumpFS_record_time_ISO9660 (&de->Created); /* the recording date of the directory record */
+	record->has_ctime = 1;
+	record->ctime = record->mtime;
+	DumpFS_record_extents_ISO9660 (sink, record, de);
+}
+
+static void DumpFS_record_ISO9660 (struct DumpFS_sink_t *sink, const char *fs, const char *path, struct iso_dirent_t *de, const char *name, size_t name_length)
+{
+	struct DumpFS_record_t record;
+
+	memset (&record, 0, sizeof (record));
+	record.fs = fs;
+	record.path = path;
+	record.name = name;
+	record.name_length = strnlen (name, name_length);
+	DumpFS_record_fill_ISO9660 (sink, &record, de);
+
+	DumpFS_sink_record (sink, &record);
+}
+
+/* Same rendering as the text listing in _DumpFS_dir_RockRidge() */
+static void DumpFS_symlink_RockRidge (struct iso_dirent_t *de, struct DumpFS_path_t *target)
+{
+	uint32_t left = de->RockRidge_Symlink_Components_Length;
+	uint8_t *next = de->RockRidge_Symlink_Components;
+	uint8_t incontinue = 0;
+	uint8_t first = 1;
+
+	while (left)
+	{
+		uint8_t nextcontinue = next[0] & 0x01;
+		uint8_t length;
+
+		if ((!first) && (!incontinue))
+		{
+			DumpFS_path_put (target, "/", 1);
+		}
+
+		if (next[0] & 0x02)
+		{
+			DumpFS_path_put (target, ".", 1);
+		} else if (next[0] & 0x04)
+		{
+			DumpFS_path_put (target, "..", 2);
+		} else if (next[0] & 0x08)
+		{
+			DumpFS_path_put (target, "/", 1);
+		} else if (next[0] & 0x10)
+		{
+			DumpFS_path_put (target, "currentdrive:", 13);
+		} else if (next[0] & 0x20)
+		{
+			DumpFS_path_put (target, "localhost:/", 11);
+		}
+		left--;
+		next++;
+
+		if (!left) /* protect buffer */
+		{
+			break;
+		}
+
+		length = next[0];
+		left--;
+		next++;
+
+		if (left < length) /* protect buffer */
+		{
+			break;
+		}
+		if (left)
+		{
+			DumpFS_path_put (target, (char *)next, length);
+		}
+
+		next += length;
+		left -= length;
+
+		incontinue = nextcontinue;
+		first = 0;
+	}
+}
+
+static void DumpFS_record_RockRidge (struct DumpFS_sink_t *sink, const char *path, struct iso_dirent_t *de) /* Uses ISO9660/XA information if data is missing */
+{
+	struct DumpFS_record_t record;
+	struct DumpFS_path_t target;
+
+	memset (&record, 0, sizeof (record));
+	record.fs = "rockridge";
+	record.path = path;
+	if (de->Name_RockRidge_Length)
+	{
+		record.name = (char *)de->Name_RockRidge;
+		record.name_length = de->Name_RockRidge_Length;
+	} else {
+		record.name = (char *)de->Name_ISO9660;
+		record.name_length = strnlen ((char *)de->Name_ISO9660, de->Name_ISO9660_Length);
+	}
+	DumpFS_record_fill_ISO9660 (sink, &record, de);
+
+	if (de->RockRidge_PX_Present)
+	{
+		switch (de->RockRidge_PX_st_mode & 0170000)
+		{
+			case 0140000: record.type = 's'; break; /* socket */
+			case 0120000: record.type = 'l'; break; /* symlink */
+			case 0100000: record.type = '-'; break; /* file */
+			case 0060000: record.type = 'b'; break; /* block special */
+			case 0020000: record.type = 'c'; break; /* character special */
+			case 0040000: record.type = 'd'; break; /* directory */
+			case 0010000: record.type = 'p'; break; /* pipe or FIFO */
+			default:      record.type = '?'; break;
+		}
+		record.has_mode = 1;
+		record.mode = de->RockRidge_PX_st_mode & 07777;
+		record.has_owner = 1;
+		record.uid = de->RockRidge_PX_st_uid;
+		record.gid = de->RockRidge_PX_st_gid;
+	} else if (de->RockRidge_Symlink_Components_Length)
+	{
+		record.type = 'l';
+	} else if (de->RockRidge_IsAugmentedDirectory) /* file is a placeholder for a directory redirect */
+	{
+		record.type = 'd';
+	}
+
+	if (de->RockRidge_PN_Present && ((record.type == 'b') || (record.type == 'c')))
+	{
+		record.has_device = 1;
+		record.major = de->RockRidge_PN_major;
+		record.minor = de->RockRidge_PN_minor;
+	}
+	if (de->RockRidge_TF_Modified_Present)
+	{
+		record.mtime = DumpFS_record_time_ISO9660 (&de->RockRidge_TF_Modified);
+	} else if (de->RockRidge_TF_Created_Present)
+	{
+		record.mtime = DumpFS_record_time_ISO9660 (&de->RockRidge_TF_Created);
+	}
+	if (de->RockRidge_TF_Created_Present)
+	{
+		record.ctime = DumpFS_record_time_ISO9660 (&de->RockRidge_TF_Created);
+	}
+
+	target.data = 0;
+	if (de->RockRidge_Symlink_Components_Length && !DumpFS_path_init (&target, ""))
+	{
+		DumpFS_symlink_RockRidge (de, &target);
+		record.target = target.data;
+		record.target_length = target.length;
+	}
+
+	DumpFS_sink_record (sink, &record);
+
+	if (target.data)
+	{
+		DumpFS_path_free (&target);
+	}
+}
+
+/* Directory lookup, directories_data is kept sorted on Location by Volume_Description_DeQueue() */
+static struct iso_dir_t *DumpFS_dir_find (struct Volume_Description_t *vd, uint32_t Location)
+{
+	int low = 0;
+	int high = vd->directories_count;
+
+	while (low < high)
+	{
+		int mid = low + (high - low) / 2;
+		if (vd->directories_data[mid].Location == Location)
+		{
+			return &vd->directories_data[mid];
+		}
+		if (vd->directories_data[mid].Location < Location)
+		{
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return 0;
+}
+
+struct DumpFS_dir_frame_t
+{
+	struct iso_dir_t *directory;
+	int               next; /* next dirent to consider */
+	size_t            path_length;
+};
+
+/* Walks the directory tree using an explicit stack and a single path buffer, so deep trees does not exhaust the C stack.
+ *
+ * list()  handles the content of one directory, ctx is passed along (the sink for the listings)
+ * child() decides if a dirent should be entered; if so, it stores the Location, appends the name to the path and returns 0
+ */
+static void DumpFS_dir_walk (struct Volume_Description_t *vd, const char *name, uint32_t Location, void *ctx,
+                             void (*list)(void *ctx, const char *name, struct iso_dir_t *directory),
+                             int (*child)(struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path))
+{
+	struct DumpFS_path_t path;
+	struct DumpFS_dir_frame_t *stack = 0;
+	int stack_count = 0;
+	int stack_size = 0;
+	struct iso_dir_t *directory;
+
+	directory = DumpFS_dir_find (vd, Location);
+	if (!directory)
+	{
+		return;
+	}
+	if (DumpFS_path_init (&path, name))
+	{
+		return;
+	}
+
+	while (directory)
+	{
+		int i;
+
+		list (ctx, path.data, directory);
+
+		for (i=0; i < stack_count; i++)
+		{
+			if (stack[i].directory == directory)
+			{
+				break;
+			}
+		}
+		if (i != stack_count)
+		{ /* loop in the directory structure, do not enter it again */
+			directory = 0;
+		} else {
+			if (stack_count >= stack_size)
+			{
+				struct DumpFS_dir_frame_t *temp = realloc (stack, sizeof (stack[0]) * (stack_size + 32));
+				if (!temp)
+				{
+					fprintf (stderr, "DumpFS_dir_walk() realloc() failed\n");
+					break;
+				}
+				stack = temp;
+				stack_size += 32;
+			}
+			stack[stack_count].directory = directory;
+			stack[stack_count].next = 2; /* skip . and .. */
+			stack[stack_count].path_length = path.length;
+			stack_count++;
+			directory = 0;
+		}
 
-static void _DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *name, struct iso_dir_t *directory)
+		while (stack_count && !directory)
+		{
+			struct DumpFS_dir_frame_t *top = &stack[stack_count - 1];
+
+			if (top->next >= top->directory->dirents_count)
+			{
+				stack_count--;
+				continue;
+			}
+			DumpFS_path_truncate (&path, top->path_length);
+			if (child (top->directory->dirents_data[top->next++], &Location, &path))
+			{
+				continue;
+			}
+			directory = DumpFS_dir_find (vd, Location);
+		}
+	}
+
+	free (stack);
+	DumpFS_path_free (&path);
+}
+
+/* assumes ASCII */
+static void _DumpFS_dir_ISO9660 (void *ctx, const char *name, struct iso_dir_t *directory)
 {
+	struct DumpFS_sink_t *sink = ctx;
 	int i, j;
-	char *temp;
 
-	printf ("%s :\n", name);
+	if (sink)
+	{
+		for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+		{
+			DumpFS_record_ISO9660 (sink, "iso9660", name, directory->dirents_data[i], (char *)directory->dirents_data[i]->Name_ISO9660, directory->dirents_data[i]->Name_ISO9660_Length);
+		}
+		return;
+	}
+
+	TRACE ("%s :\n", name);
 
 	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
 	{
@@ -218,53 +560,55 @@ static void _DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *na
 		{
 			if (directory->dirents_data[i]->Name_ISO9660[j]<32)
 			{
-				printf ("\\x%08" PRIx8, directory->dirents_data[i]->Name_ISO9660[j]);
+				TRACE ("\\x%08" PRIx8, directory->dirents_data[i]->Name_ISO9660[j]);
 			} else {
-				putchar (directory->dirents_data[i]->Name_ISO9660[j]);
+				TRACE_PUTCHAR (directory->dirents_data[i]->Name_ISO9660[j]);
 			}
 		}
 
-		putchar ('\n');
+		TRACE_PUTCHAR ('\n');
 	}
+}
 
-	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+static int _DumpFS_child_ISO9660 (struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
+{
+	if (!(dirent->Flags & ISO9660_DIRENT_FLAGS_DIR))
 	{
-		int l;
-		if (!(directory->dirents_data[i]->Flags & ISO9660_DIRENT_FLAGS_DIR))
-		{
-			continue;
-		}
-		l = strlen (name) + 1 + directory->dirents_data[i]->Name_ISO9660_Length + 1;
-		temp = malloc (l);
-		if (temp)
-		{
-			snprintf (temp, l, "%s/%s", name, directory->dirents_data[i]->Name_ISO9660);
-			DumpFS_dir_ISO9660 (vd, temp, directory->dirents_data[i]->Absolute_Location);
-			free (temp);
-		}
+		return -1;
 	}
+	*Location = dirent->Absolute_Location;
+	return DumpFS_path_append (path, (char *)dirent->Name_ISO9660, strnlen ((char *)dirent->Name_ISO9660, dirent->Name_ISO9660_Length));
 }
 
-void DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *name, uint32_t Location)
+void DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *name, uint32_t Location, struct DumpFS_sink_t *sink)
 {
-	int j;
-	for (j=0; j < vd->directories_count; j++)
-	{
-		if (vd->directories_data[j].Location == Location)
-		{
-			_DumpFS_dir_ISO9660 (vd, name, &vd->directories_data[j]);
-			break;
-		}
-	}
+	DumpFS_dir_walk (vd, name, Location, sink, _DumpFS_dir_ISO9660, _DumpFS_child_ISO9660);
 }
 
 /* assumes UCS-2 / UTF16BE */
-void DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *name, uint32_t Location);
-static void _DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *name, struct iso_dir_t *directory)
+static void _DumpFS_dir_Joliet (void *ctx, const char *name, struct iso_dir_t *directory)
 {
+	struct DumpFS_sink_t *sink = ctx;
 	int i;
 
-	printf ("%s :\n", name);
+	if (sink)
+	{
+		for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+		{
+			char namebuffer[128*4]; /* maximum 128 UTF16BE codepoints, 4 is the maxlength of a codepoint in UTF-8 */
+			char *inbuf = (char *)directory->dirents_data[i]->Name_ISO9660;
+			size_t inbytesleft = directory->dirents_data[i]->Name_ISO9660_Length;
+			char *outbuf = namebuffer;
+			size_t outbytesleft = sizeof (namebuffer);
+
+			cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
+
+			DumpFS_record_ISO9660 (sink, "joliet", name, directory->dirents_data[i], namebuffer, outbuf - namebuffer);
+		}
+		return;
+	}
+
+	TRACE ("%s :\n", name);
 
 	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
 	{
@@ -284,61 +628,58 @@ static void _DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *nam
 			size_t outbytesleft = sizeof (namebuffer);
 			//size_t res;
 
-			/* res = */ iconv (UTF16BE_cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
+			/* res = */ cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
 
-			fwrite (namebuffer, 1, (uint8_t *)outbuf - namebuffer, stdout);
+			TRACE_FWRITE (namebuffer, 1, (uint8_t *)outbuf - namebuffer, stdout);
 		}
 
-		putchar ('\n');
-	}
-
-	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
-	{
-		char namebuffer[128*4+1]; /* maximum 128 UTF16BE codepoints, 4 is the maxlength of a codepoint in UTF-8 */
-		char *inbuf = (char *)directory->dirents_data[i]->Name_ISO9660;
-		size_t inbytesleft = directory->dirents_data[i]->Name_ISO9660_Length;
-		char *outbuf = namebuffer;
-		size_t outbytesleft = sizeof (namebuffer);
-		char *temp;
-		//size_t res;
-
-		if (!(directory->dirents_data[i]->Flags & ISO9660_DIRENT_FLAGS_DIR))
-		{
-			continue;
-		}
-		/* res = */ iconv (UTF16BE_cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
-		*outbuf = 0;
-		temp = malloc (strlen (name) + 1 + strlen (namebuffer) + 1);
-		if (temp)
-		{
-			sprintf (temp, "%s/%s", name, namebuffer);
-			DumpFS_dir_Joliet (vd, temp, directory->dirents_data[i]->Absolute_Location);
-			free (temp);
-		}
+		TRACE_PUTCHAR ('\n');
 	}
 }
 
-void DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *name, uint32_t Location)
+static int _DumpFS_child_Joliet (struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
 {
-	int j;
-	for (j=0; j < vd->directories_count; j++)
+	char namebuffer[128*4+1]; /* maximum 128 UTF16BE codepoints, 4 is the maxlength of a codepoint in UTF-8 */
+	char *inbuf = (char *)dirent->Name_ISO9660;
+	size_t inbytesleft = dirent->Name_ISO9660_Length;
+	char *outbuf = namebuffer;
+	size_t outbytesleft = sizeof (namebuffer);
+	//size_t res;
+
+	if (!(dirent->Flags & ISO9660_DIRENT_FLAGS_DIR))
 	{
-		if (vd->directories_data[j].Location == Location)
-		{
-			_DumpFS_dir_Joliet (vd, name, &vd->directories_data[j]);
-			break;
-		}
+		return -1;
 	}
+	/* res = */ cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
+	*outbuf = 0;
+	*Location = dirent->Absolute_Location;
+	return DumpFS_path_append (path, namebuffer, strlen (namebuffer));
+}
 
+void DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *name, uint32_t Location, struct DumpFS_sink_t *sink)
+{
+	DumpFS_dir_walk (vd, name, Location, sink, _DumpFS_dir_Joliet, _DumpFS_child_Joliet);
 }
 
 /* assumes UTF-8 */
-void DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *name, uint32_t Location);
-static void _DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *name, struct iso_dir_t *directory)
+static void _DumpFS_dir_RockRidge (void *ctx, const char *name, struct iso_dir_t *directory)
 {
+	struct DumpFS_sink_t *sink = ctx;
 	int i;
 
-	printf ("%s :\n", name);
+	if (sink)
+	{
+		for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+		{
+			if (!directory->dirents_data[i]->RockRidge_DirectoryIsRedirected)
+			{
+				DumpFS_record_RockRidge (sink, name, directory->dirents_data[i]);
+			}
+		}
+		return;
+	}
+
+	TRACE ("%s :\n", name);
 
 	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
 	{
@@ -357,9 +698,9 @@ static void _DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *
 
 		if (directory->dirents_data[i]->Name_RockRidge_Length)
 		{
-			fwrite (directory->dirents_data[i]->Name_RockRidge, 1, directory->dirents_data[i]->Name_RockRidge_Length, stdout);
+			TRACE_FWRITE (directory->dirents_data[i]->Name_RockRidge, 1, directory->dirents_data[i]->Name_RockRidge_Length, stdout);
 		} else {
-			fwrite (directory->dirents_data[i]->Name_ISO9660, 1, directory->dirents_data[i]->Name_ISO9660_Length, stdout);
+			TRACE_FWRITE (directory->dirents_data[i]->Name_ISO9660, 1, directory->dirents_data[i]->Name_ISO9660_Length, stdout);
 		}
 
 		if (directory->dirents_data[i]->RockRidge_Symlink_Components_Length)
@@ -368,7 +709,7 @@ static void _DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *
 			uint8_t *next = directory->dirents_data[i]->RockRidge_Symlink_Components;
 			uint8_t incontinue = 0;
 			uint8_t first = 1;
-			printf (" -> ");
+			TRACE (" -> ");
 			while (left)
 			{
 				uint8_t nextcontinue = next[0] & 0x01;
@@ -376,24 +717,24 @@ static void _DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *
 
 				if ((!first) && (!incontinue))
 				{
-					putchar ('/');
+					TRACE_PUTCHAR ('/');
 				}
 
 				if (next[0] & 0x02)
 				{
-					printf (".");
+					TRACE (".");
 				} else if (next[0] & 0x04)
 				{
-					printf ("..");
+					TRACE ("..");
 				} else if (next[0] & 0x08)
 				{
-					printf ("/");
+					TRACE ("/");
 				} else if (next[0] & 0x10)
 				{
-					printf ("currentdrive:");
+					TRACE ("currentdrive:");
 				} else if (next[0] & 0x20)
 				{
-					printf ("localhost:/");
+					TRACE ("localhost:/");
 				}
 				left--;
 				next++;
@@ -413,7 +754,7 @@ static void _DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *
 				}
 				if (left)
 				{
-					fwrite (next, 1, length, stdout);
+					TRACE_FWRITE (next, 1, length, stdout);
 				}
 
 				next += length;
@@ -424,64 +765,40 @@ static void _DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *
 			}
 		}
 
-		putchar ('\n');
+		TRACE_PUTCHAR ('\n');
 	}
+}
 
-	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+static int _DumpFS_child_RockRidge (struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
+{
+	if (dirent->RockRidge_DirectoryIsRedirected)
 	{
-		int l;
-		char *temp;
-		uint32_t Location;
-
-		if (directory->dirents_data[i]->RockRidge_DirectoryIsRedirected)
-		{
-			continue;
-		} else if (directory->dirents_data[i]->RockRidge_PX_Present)
-		{
-			if ((directory->dirents_data[i]->RockRidge_PX_st_mode & 0170000) != 0040000) /* directory */ continue;
-		} if (directory->dirents_data[i]->RockRidge_IsAugmentedDirectory)
-		{
-			Location = directory->dirents_data[i]->RockRidge_AugmentedDirectoryFrom;
-			/* always with*/
-		} else if (!(directory->dirents_data[i]->Flags & ISO9660_DIRENT_FLAGS_DIR))
-		{
-			continue;
-		} else {
-			Location = directory->dirents_data[i]->Absolute_Location; /* the normal way */
-		}
+		return -1;
+	} else if (dirent->RockRidge_PX_Present)
+	{
+		if ((dirent->RockRidge_PX_st_mode & 0170000) != 0040000) /* directory */ return -1;
+	} if (dirent->RockRidge_IsAugmentedDirectory)
+	{
+		*Location = dirent->RockRidge_AugmentedDirectoryFrom;
+		/* always with*/
+	} else if (!(dirent->Flags & ISO9660_DIRENT_FLAGS_DIR))
+	{
+		return -1;
+	} else {
+		*Location = dirent->Absolute_Location; /* the normal way */
+	}
 
-		if (directory->dirents_data[i]->Name_RockRidge_Length)
-		{
-			l = strlen (name) + 1 + directory->dirents_data[i]->Name_RockRidge_Length + 1;
-		} else {
-			l = strlen (name) + 1 + directory->dirents_data[i]->Name_ISO9660_Length + 1;
-		}
-		temp = malloc (l);
-		if (temp)
-		{
-			if (directory->dirents_data[i]->Name_RockRidge_Length)
-			{
-				snprintf (temp, l, "%s/%s", name, directory->dirents_data[i]->Name_RockRidge);
-			} else {
-				snprintf (temp, l, "%s/%s", name, directory->dirents_data[i]->Name_ISO9660);
-			}
-			DumpFS_dir_RockRidge (vd, temp, Location);
-			free (temp);
-		}
+	if (dirent->Name_RockRidge_Length)
+	{
+		return DumpFS_path_append (path, (char *)dirent->Name_RockRidge, strnlen ((char *)dirent->Name_RockRidge, dirent->Name_RockRidge_Length));
+	} else {
+		return DumpFS_path_append (path, (char *)dirent->Name_ISO9660, strnlen ((char *)dirent->Name_ISO9660, dirent->Name_ISO9660_Length));
 	}
 }
 
-void DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *name, uint32_t Location)
+void DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *name, uint32_t Location, struct DumpFS_sink_t *sink)
 {
-	int j;
-	for (j=0; j < vd->directories_count; j++)
-	{
-		if (vd->directories_data[j].Location == Location)
-		{
-			_DumpFS_dir_RockRidge (vd, name, &vd->directories_data[j]);
-			break;
-		}
-	}
+	DumpFS_dir_walk (vd, name, Location, sink, _DumpFS_dir_RockRidge, _DumpFS_child_RockRidge);
 }
 
 static void iso_dirent_free (struct iso_dirent_t *iso_dirent);
@@ -523,6 +840,15 @@ static void iso_dir_clear (struct iso_dir_t *iso_dir)
 		return;
 	}
 
+	if (iso_dir->Shared)
+	{
+		iso_dir->dirents_count = 0;
+		iso_dir->dirents_size = 0;
+		iso_dir->dirents_data = 0;
+		iso_dir->Shared = 0;
+		return;
+	}
+
 	for (i = 0; i < iso_dir->dirents_count; i++)
 	{
 		iso_dirent_free (iso_dir->dirents_data[i]);
@@ -815,12 +1141,18 @@ static const char *PartitionType (uint8_t type)
 
 #include "ElTorito.c"
 
+#include "hybrid.c"
+
+#include "iso9660_extract.c"
+
+#include "iso9660_index.c"
+
 static uint32_t decode_uint32_both (uint8_t *buffer, const char *name)
 {
 	uint32_t l = buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (buffer[3] << 24);
 	uint32_t b = buffer[7] | (buffer[6] << 8) | (buffer[5] << 16) | (buffer[4] << 24);
 
-	printf ("%s: %"PRId32"%s\n", name, b, (l != b) ? " WARNING LSB and MSB version does not match":"");
+	TRACE ("%s: %"PRId32"%s\n", name, b, (l != b) ? " WARNING LSB and MSB version does not match":"");
 
 	return b;
 }
@@ -829,7 +1161,7 @@ static uint32_t decode_uint32_lsb (uint8_t *buffer, const char *name)
 {
 	uint32_t l = buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (buffer[3] << 24);
 
-	printf ("%s: %"PRId32"\n", name, l);
+	TRACE ("%s: %"PRId32"\n", name, l);
 
 	return l;
 }
@@ -838,7 +1170,7 @@ static uint32_t decode_uint32_msb (uint8_t *buffer, const char *name)
 {
 	uint32_t b = buffer[3] | (buffer[2] << 8) | (buffer[1] << 16) | (buffer[0] << 24);
 
-	printf ("%s: %"PRId32"\n", name, b);
+	TRACE ("%s: %"PRId32"\n", name, b);
 
 	return b;
 }
@@ -848,7 +1180,7 @@ static uint16_t decode_uint16_both (uint8_t *buffer, const char *name)
 	uint16_t l = buffer[0] | (buffer[1] << 8);
 	uint16_t b = buffer[3] | (buffer[2] << 8);
 
-	printf ("%s: %"PRId16"%s\n", name, b, (l != b) ? " WARNING LSB and MSB version does not match":"");
+	TRACE ("%s: %"PRId16"%s\n", name, b, (l != b) ? " WARNING LSB and MSB version does not match":"");
 
 	return b;
 }
@@ -857,7 +1189,7 @@ static uint16_t decode_uint16_lsb (uint8_t *buffer, const char *name)
 {
 	uint16_t l = buffer[0] | (buffer[1] << 8);
 
-	printf ("%s: %"PRId16"\n", name, l);
+	TRACE ("%s: %"PRId16"\n", name, l);
 
 	return l;
 }
@@ -866,7 +1198,7 @@ static uint16_t decode_uint16_msb (uint8_t *buffer, const char *name)
 {
 	uint16_t b = buffer[1] | (buffer[0] << 8);
 
-	printf ("%s: %"PRId16"\n", name, b);
+	TRACE ("%s: %"PRId16"\n", name, b);
 
 	return b;
 }
@@ -876,7 +1208,7 @@ static void decode_datetime_17 (uint8_t *buffer, const char *name, struct iso966
 	int i = ((int)(int8_t)buffer[6])-40;
 	int tz = ((i/4)*100) + ((i % 4)*15);
 
-	printf ("%s: ", name);
+	TRACE ("%s: ", name);
 
 	if (target)
 	{
@@ -912,23 +1244,23 @@ static void decode_datetime_17 (uint8_t *buffer, const char *name, struct iso966
 		    (i==6) ||
 		    (i==8))
 		{
-			putchar('-');
+			TRACE_PUTCHAR('-');
 		}
 		if ((i==10) ||
 		    (i==12))
 		{
-			putchar(':');
+			TRACE_PUTCHAR(':');
 		}
 		if (i==14) /* the hundreths of a second is usually 00 */
 		{
-			putchar('.');
+			TRACE_PUTCHAR('.');
 		}
 
 
-		putchar (buffer[i]);
+		TRACE_PUTCHAR (buffer[i]);
 	}
 
-	printf ("%+05d\n", tz);
+	TRACE ("%+05d\n", tz);
 }
 
 static void decode_datetime_7 (uint8_t *buffer, const char *name, struct iso9660_datetime_t *target)
@@ -936,7 +1268,7 @@ static void decode_datetime_7 (uint8_t *buffer, const char *name, struct iso9660
 	int i = (int8_t)buffer[6];
 	int tz = ((i/4)*100) + ((i % 4)*15);
 
-	printf ("%s: ", name);
+	TRACE ("%s: ", name);
 
 	if (target)
 	{
@@ -950,7 +1282,7 @@ static void decode_datetime_7 (uint8_t *buffer, const char *name, struct iso9660
 	}
 
 
-	printf ("%04d-%02d-%02d-%02d:%02d:%02d%+05d\n",
+	TRACE ("%04d-%02d-%02d-%02d:%02d:%02d%+05d\n",
 		1900 + buffer[0],
 		buffer[1],
 		buffer[2],
@@ -971,13 +1303,13 @@ static int decode_record (struct cdfs_disc_t *disc, struct Volume_Description_t
 
 	if (len < 1+8+8+7+1+1+1+4+1)
 	{
-		printf ("     WARNING - not enough data to hold a full record\n");
+		TRACE ("     WARNING - not enough data to hold a full record\n");
 		return -1;
 	}
 
 	//ExtendedAttributeLength = buffer[0];
 	/* These would in theory be placed infront of the file-data */
-	printf ("     Extended Attribute Length: %d\n", buffer[0]);
+	TRACE ("     Extended Attribute Length: %d\n", buffer[0]);
 
 	de->Absolute_Location = decode_uint32_both (buffer + 1, "     Location");
 
@@ -987,61 +1319,63 @@ static int decode_record (struct cdfs_disc_t *disc, struct Volume_Description_t
 	decode_datetime_7 (buffer + 17, "     DateTime", &de->Created);
 
 	de->Flags = buffer[24];
-	printf ("     Flags: 0x%02" PRIx8 "\n", buffer[24]);
+	TRACE ("     Flags: 0x%02" PRIx8 "\n", buffer[24]);
 	if (de->Flags & ISO9660_DIRENT_FLAGS_HIDDEN)
 	{
-		printf ("       Hidden\n");
+		TRACE ("       Hidden\n");
 	}
-	printf ("       Type: %s\n", de->Flags & ISO9660_DIRENT_FLAGS_DIR ? "directory" : "file");
+	TRACE ("       Type: %s\n", de->Flags & ISO9660_DIRENT_FLAGS_DIR ? "directory" : "file");
 	if (de->Flags & ISO9660_DIRENT_FLAGS_ASSOCIATED_FILE)
 	{
-		printf ("       Associated file?\n");
+		TRACE ("       Associated file?\n");
 	}
 	if (de->Flags & ISO9660_DIRENT_FLAGS_EXTENDED_ATTRIBUTES_PRESENT)
 	{
-		printf ("       Extended attributes present\n");
+		TRACE ("       Extended attributes present\n");
 	}
 	if (de->Flags & ISO9660_DIRENT_FLAGS_PERMISSIONS_PRESENT)
 	{
-		printf ("       Owner/Group permissions present\n");
+		TRACE ("       Owner/Group permissions present\n");
 	}
 	if (de->Flags & ISO9660_DIRENT_FLAGS_FILE_NOT_LAST_EXTENT)
 	{
-		printf ("       Expect more file-extents for this file\n");
+		TRACE ("       Expect more file-extents for this file\n");
 	}
 
-	printf ("     Interleave Unit Size: %d\n", buffer[25]);
-	printf ("     Interleave Gap Size: %d\n", buffer[26]);
+	de->Interleave_Unit_Size = buffer[25];
+	de->Interleave_Gap_Size = buffer[26];
+	TRACE ("     Interleave Unit Size: %d\n", buffer[25]);
+	TRACE ("     Interleave Gap Size: %d\n", buffer[26]);
 
 	decode_uint16_both (buffer + 27, "     Volume Sequence");
 
 	de->Name_ISO9660_Length = buffer[31];
 	memcpy (de->Name_ISO9660, buffer + 32, de->Name_ISO9660_Length);
 	de->Name_ISO9660[de->Name_ISO9660_Length] = 0;
-	printf ("     Name Length: %d\n", buffer[31]);
+	TRACE ("     Name Length: %d\n", buffer[31]);
 	if (31+buffer[31] > len)
 	{
-		printf ("     WARNING - not enough data to hold the full name\n");
+		TRACE ("     WARNING - not enough data to hold the full name\n");
 		return -1;
 	}
 
 	if ((de->Name_ISO9660_Length == 1) && (buffer[32] == 0))
 	{
-		printf ("     Name: (root)\n");
+		TRACE ("     Name: (root)\n");
 	} else {
-		printf ("     Name: \"");
+		TRACE ("     Name: \"");
 		for (i=0; i < de->Name_ISO9660_Length; i++)
 		{
 //			if (buffer[32+i] == ';') break;
-			putchar (buffer[32+i]);
+			TRACE_PUTCHAR (buffer[32+i]);
 		}
-		printf ("\"\n");
+		TRACE ("\"\n");
 	}
 	if (len - 32 - de->Name_ISO9660_Length + ((de->Name_ISO9660_Length + 1) & 1))
 	{
 		int loopcount = 0;
 		int o = 32 + de->Name_ISO9660_Length + /* padding */ ((de->Name_ISO9660_Length + 1) & 1);
-		printf ("     System Use: (%d - %d => ) %d (padding = %d)\n", len, o, len - o, (de->Name_ISO9660_Length + 1) & 1);
+		TRACE ("     System Use: (%d - %d => ) %d (padding = %d)\n", len, o, len - o, (de->Name_ISO9660_Length + 1) & 1);
 		decode_susp (disc, volumedesc, de, buffer + o, len - o, isrootnode, 0, &loopcount);
 	}
 
@@ -1076,7 +1410,7 @@ static void path_table_decode (uint8_t *buffer, int_fast32_t len, uint16_t (*dec
 
 	if (len & 1)
 	{
-		printf ("    WARNING, len is a odd number\n");
+		TRACE ("    WARNING, len is a odd number\n");
 		len++;
 	}
 	while (len >= 8)
@@ -1088,36 +1422,36 @@ static void path_table_decode (uint8_t *buffer, int_fast32_t len, uint16_t (*dec
 
 		if ((LengthOfDirectoryIdentifier + 8 > len))
 		{
-			printf ("     WARNING, no space for Directory Identifier\n");
+			TRACE ("     WARNING, no space for Directory Identifier\n");
 		} else {
 			if ((LengthOfDirectoryIdentifier == 1) && (buffer[8] == 0x00))
 			{
-				printf ("     Directory Identifier: (1) (root)\n");
+				TRACE ("     Directory Identifier: (1) (root)\n");
 			} else {
-				printf ("     Directory Identifier: (%d) \"", (int)LengthOfDirectoryIdentifier);
+				TRACE ("     Directory Identifier: (%d) \"", (int)LengthOfDirectoryIdentifier);
 				for (i = 0; i < LengthOfDirectoryIdentifier; i++)
 				{
-					putchar (buffer[8 + i]);
+					TRACE_PUTCHAR (buffer[8 + i]);
 				}
-				printf ("\"\n");
+				TRACE ("\"\n");
 
 				if (ExtendedAttributeRecordLength)
 				{
 					if (LengthOfDirectoryIdentifier + ExtendedAttributeRecordLength + 8 > len)
 					{
-						printf ("     WARNING, no space for Extended Attribute Record\n");
+						TRACE ("     WARNING, no space for Extended Attribute Record\n");
 					} else {
-						printf ("     Extended Attribute Record: (%d)", (int)ExtendedAttributeRecordLength);
+						TRACE ("     Extended Attribute Record: (%d)", (int)ExtendedAttributeRecordLength);
 						for (i = 0; i < ExtendedAttributeRecordLength; i++)
 						{
-							printf (" 0x%02" PRIx8, buffer[8 + LengthOfDirectoryIdentifier + i]);
+							TRACE (" 0x%02" PRIx8, buffer[8 + LengthOfDirectoryIdentifier + i]);
 						}
-						putchar ('\n');
+						TRACE_PUTCHAR ('\n');
 					}
 				}
 			}
 		}
-		putchar ('\n');
+		TRACE_PUTCHAR ('\n');
 		buffer += (8 + LengthOfDirectoryIdentifier + ExtendedAttributeRecordLength + 1) & ~ 1;
 		len    -= (8 + LengthOfDirectoryIdentifier + ExtendedAttributeRecordLength + 1) & ~ 1;
 	}
@@ -1131,7 +1465,7 @@ static int Volume_Description_Queue_Directory (struct Volume_Description_t *self
 	{
 		if (self->directories_data[i].Location == Location)
 		{
-			printf ("WARNING - Volume_Description_Queue_Directory() tried to add an entry already present\n");
+			TRACE ("WARNING - Volume_Description_Queue_Directory() tried to add an entry already present\n");
 			return 0;
 		}
 	}
@@ -1141,7 +1475,7 @@ static int Volume_Description_Queue_Directory (struct Volume_Description_t *self
 		struct iso_dir_queue *temp = realloc (self->directory_scan_queue_data, sizeof (self->directory_scan_queue_data[0]) * (self->directory_scan_queue_size + 64));
 		if (!temp)
 		{
-			printf ("WARNING - Volume_Description_Queue_Directory() realloc() failed\n");
+			TRACE ("WARNING - Volume_Description_Queue_Directory() realloc() failed\n");
 			return -1;
 		}
 		self->directory_scan_queue_data = temp;
@@ -1152,7 +1486,7 @@ static int Volume_Description_Queue_Directory (struct Volume_Description_t *self
 	{
 		if (self->directory_scan_queue_data[0].Location == Location)
 		{
-			printf ("WARNING - Volume_Description_Queue_Directory() tried to add an entry already present\n");
+			TRACE ("WARNING - Volume_Description_Queue_Directory() tried to add an entry already present\n");
 			return 0;
 		}
 		if (self->directory_scan_queue_data[0].Location > Location)
@@ -1193,7 +1527,7 @@ static int Volume_Description_DeQueue (struct cdfs_disc_t *disc, struct Volume_D
 		struct iso_dir_t *temp = realloc (self->directories_data, sizeof (self->directories_data[0]) * (self->directories_size + 32));
 		if (!temp)
 		{
-			printf ("WARNING - Volume_Description_DeQueue() realloc() failed\n");
+			TRACE ("WARNING - Volume_Description_DeQueue() realloc() failed\n");
 			return -1;
 		}
 		self->directories_data = temp;
@@ -1204,7 +1538,7 @@ static int Volume_Description_DeQueue (struct cdfs_disc_t *disc, struct Volume_D
 	{
 		if (self->directories_data[i].Location == self->directory_scan_queue_data[0].Location)
 		{
-			printf ("WARNING - Volume_Description_DeQueue() tried to add an entry already present\n");
+			TRACE ("WARNING - Volume_Description_DeQueue() tried to add an entry already present\n");
 			return 0;
 		}
 		if (self->directories_data[i].Location > self->directory_scan_queue_data[0].Location)
@@ -1224,12 +1558,42 @@ static int Volume_Description_DeQueue (struct cdfs_disc_t *disc, struct Volume_D
 	targetdir->dirents_count = 0;
 	targetdir->dirents_size = 0;
 	targetdir->dirents_data = 0;
+	targetdir->Shared = 0;
 	self->directories_count += 1;
 
 	memmove (self->directory_scan_queue_data, self->directory_scan_queue_data + 1, sizeof (self->directory_scan_queue_data[0]) * (self->directory_scan_queue_count - 1));
 	self->directory_scan_queue_count--;
 
-	printf ("\n[dir Location:0x%08" PRIx32 "]\n", targetdir->Location);
+	if (self->Previous)
+	{
+		struct iso_dir_t *previous = DumpFS_dir_find (self->Previous, targetdir->Location);
+		if (previous)
+		{ /* sessions are write-once, so a directory at the same Location is the same directory */
+			TRACE ("\n[dir Location:0x%08" PRIx32 "] unchanged since previous session\n", targetdir->Location);
+			targetdir->dirents_count = previous->dirents_count;
+			targetdir->dirents_size  = previous->dirents_size;
+			targetdir->dirents_data  = previous->dirents_data;
+			targetdir->Shared = 1;
+			self->RockRidge |= self->Previous->RockRidge;
+			if (isrootnode)
+			{
+				self->SystemUse_Skip = self->Previous->SystemUse_Skip;
+			}
+			for (j=2; j < targetdir->dirents_count; j++)
+			{
+				if (targetdir->dirents_data[j]->Flags & ISO9660_DIRENT_FLAGS_DIR)
+				{
+					if (Volume_Description_Queue_Directory(self, targetdir->dirents_data[j]->Absolute_Location, targetdir->dirents_data[j]->Length, 0))
+					{
+						return -1;
+					}
+				}
+			}
+			return 0;
+		}
+	}
+
+	TRACE ("\n[dir Location:0x%08" PRIx32 "]\n", targetdir->Location);
 
 	j = 0; /* record counter */
 	o = 0; /* sector counter */
@@ -1269,7 +1633,7 @@ static int Volume_Description_DeQueue (struct cdfs_disc_t *disc, struct Volume_D
 			{
 				return -1;
 			}
-			putchar ('\n');
+			TRACE_PUTCHAR ('\n');
 
 			dirent = calloc (sizeof (*dirent), 1);
 			if (decode_record (disc, self, b + 1, used - 1, dirent, isrootnode))
@@ -1356,30 +1720,30 @@ static struct Volume_Description_t *Primary_Volume_Descriptor (struct cdfs_disc_
 	}
 
 	/* buffer[0x07] */
-	printf ("  system_identifier: \"");
+	TRACE ("  system_identifier: \"");
 	for (i=0; i < 32; i++)
 	{
 		if (buffer[0x08 + i] == 0x00) break;
-		putchar (buffer[0x08 + i]);
+		TRACE_PUTCHAR (buffer[0x08 + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  volume_identifier: \"");
+	TRACE ("  volume_identifier: \"");
 	for (i=0; i < 32; i++)
 	{
 		if (buffer[0x28 + i] == 0x00) break;
-		putchar (buffer[0x08 + i]);
+		TRACE_PUTCHAR (buffer[0x08 + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
 	/* buffer[0x48-0x4f] */
 
 	decode_uint32_both (buffer + 0x50, "  volume_space_size (sectors)"); /* i */
 
-	printf ("  escape_sequences:");
+	TRACE ("  escape_sequences:");
 	for (i=0; i < 32; i++)
 	{
-		printf (" 0x%02" PRIx8, buffer[0x58 + i]);
+		TRACE (" 0x%02" PRIx8, buffer[0x58 + i]);
 	}
 
 	/* ISO-10646 UCS-2 == UNICODE UTF-16
@@ -1388,25 +1752,25 @@ static struct Volume_Description_t *Primary_Volume_Descriptor (struct cdfs_disc_
 
 	// TODO, parse all G0 etc commands that overrides the 8-bit encoding in order to support japanese etc.
 	// \x25\x40  is to escape back to ASCII ?
-	       if (!memcmp (buffer + 0x58, "\x25\x2f\x40", 4)) { volumedesc->UTF16=1; printf (" UCS-2_LEVEL_1"); } /* Unicode 1.1? - Level 1 requires no composite character support */
-	//else if (!memcmp (buffer + 0x58, "\x25\x2f\x41", 4)) { volumedesc->UTF32=1; printf (" UCS-4-LEVEL_1"); }
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x43", 4)) { volumedesc->UTF16=1; printf (" UCS-2_LEVEL_2"); } /* Unicode 1.1? - Level 2 requires support for specific scripts (including most of the Unicode scripts such as Arabic and Thai) */
-	//else if (!memcmp (buffer + 0x58, "\x25\x2f\x44", 4)) { volumedesc->UTFxx=1; printf (" UCS-4-LEVEL_2");
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x45", 4)) { volumedesc->UTF16=1; printf (" UCS-2_LEVEL_3"); } /* Unicode 1.1? - Level 3 requires unrestricted support for composite characters in all languages. */
-	//else if (!memcmp (buffer + 0x58, "\x25\x2f\x46", 4)) { volumedesc->UTF32=1; printf (" UCS-4-LEVEL_3/UTF-32BE"); }
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x47", 4)) { volumedesc->UTF8=1;  printf (" UTF-8_LEVEL_1"); }
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x48", 4)) { volumedesc->UTF8=1;  printf (" UTF-8_LEVEL_2"); }
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x49", 4)) { volumedesc->UTF8=1;  printf (" UTF-8_LEVEL_3"); } /* Level 3 part of name is phased out */
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x4a", 4)) { volumedesc->UTF16=1; printf (" UCS-2_LEVEL_1"); }
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x4b", 4)) { volumedesc->UTF16=1; printf (" UCS-2_LEVEL_2"); }
-	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x4c", 4)) { volumedesc->UTF16=1; printf (" USC-2_LEVEL_3/UTF-16BE"); } /* Level 3 part of name is phased out */
-
-	  else if (!memcmp (buffer + 0x58, "\x25\x47", 3))     { volumedesc->UTF8=1;  printf (" UTF-8");         }
-	putchar ('\n');
+	       if (!memcmp (buffer + 0x58, "\x25\x2f\x40", 4)) { volumedesc->UTF16=1; TRACE (" UCS-2_LEVEL_1"); } /* Unicode 1.1? - Level 1 requires no composite character support */
+	//else if (!memcmp (buffer + 0x58, "\x25\x2f\x41", 4)) { volumedesc->UTF32=1; TRACE (" UCS-4-LEVEL_1"); }
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x43", 4)) { volumedesc->UTF16=1; TRACE (" UCS-2_LEVEL_2"); } /* Unicode 1.1? - Level 2 requires support for specific scripts (including most of the Unicode scripts such as Arabic and Thai) */
+	//else if (!memcmp (buffer + 0x58, "\x25\x2f\x44", 4)) { volumedesc->UTFxx=1; TRACE (" UCS-4-LEVEL_2");
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x45", 4)) { volumedesc->UTF16=1; TRACE (" UCS-2_LEVEL_3"); } /* Unicode 1.1? - Level 3 requires unrestricted support for composite characters in all languages. */
+	//else if (!memcmp (buffer + 0x58, "\x25\x2f\x46", 4)) { volumedesc->UTF32=1; TRACE (" UCS-4-LEVEL_3/UTF-32BE"); }
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x47", 4)) { volumedesc->UTF8=1;  TRACE (" UTF-8_LEVEL_1"); }
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x48", 4)) { volumedesc->UTF8=1;  TRACE (" UTF-8_LEVEL_2"); }
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x49", 4)) { volumedesc->UTF8=1;  TRACE (" UTF-8_LEVEL_3"); } /* Level 3 part of name is phased out */
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x4a", 4)) { volumedesc->UTF16=1; TRACE (" UCS-2_LEVEL_1"); }
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x4b", 4)) { volumedesc->UTF16=1; TRACE (" UCS-2_LEVEL_2"); }
+	  else if (!memcmp (buffer + 0x58, "\x25\x2f\x4c", 4)) { volumedesc->UTF16=1; TRACE (" USC-2_LEVEL_3/UTF-16BE"); } /* Level 3 part of name is phased out */
+
+	  else if (!memcmp (buffer + 0x58, "\x25\x47", 3))     { volumedesc->UTF8=1;  TRACE (" UTF-8");         }
+	TRACE_PUTCHAR ('\n');
 
 	if (IsPrimary && volumedesc->UTF16)
 	{
-		printf ("   WARNING: Primary Volume Descriptor does not allow UCS-2 / UTF16 - This disc has malformed header, ignoring\n");
+		TRACE ("   WARNING: Primary Volume Descriptor does not allow UCS-2 / UTF16 - This disc has malformed header, ignoring\n");
 		volumedesc->UTF16 = 0;
 	}
 
@@ -1438,13 +1802,13 @@ static struct Volume_Description_t *Primary_Volume_Descriptor (struct cdfs_disc_
 		{
 			if (get_absolute_sector_2048 (disc, path_table_l_loc + ui, path_table_buffer + ui * SECTORSIZE))
 			{
-				printf ("  WARNING - Unable to fetch path_table_l\n");
+				TRACE ("  WARNING - Unable to fetch path_table_l\n");
 				break;
 			}
 		}
 		if (ui == sectors)
 		{
-			printf ("   [PATH_TABLE_L]\n");
+			TRACE ("   [PATH_TABLE_L]\n");
 			path_table_decode (path_table_buffer, path_table_size, decode_uint16_lsb, decode_uint32_lsb);
 		}
 
@@ -1452,13 +1816,13 @@ static struct Volume_Description_t *Primary_Volume_Descriptor (struct cdfs_disc_
 		{
 			if (get_absolute_sector_2048 (disc, path_table_m_loc + ui, path_table_buffer + ui * SECTORSIZE))
 			{
-				printf ("  WARNING - Unable to fetch path_table_m\n");
+				TRACE ("  WARNING - Unable to fetch path_table_m\n");
 				break;
 			}
 		}
 		if (ui == sectors)
 		{
-			printf ("   [PATH_TABLE_M]\n");
+			TRACE ("   [PATH_TABLE_M]\n");
 			path_table_decode (path_table_buffer, path_table_size, decode_uint16_msb, decode_uint32_msb);
 		}
 
@@ -1471,75 +1835,75 @@ static struct Volume_Description_t *Primary_Volume_Descriptor (struct cdfs_disc_
 		if (record_len)
 		{
 			offset = (int)record_len;
-			printf ("   [root record]\n");
+			TRACE ("   [root record]\n");
 			retval |= decode_record (disc, volumedesc, buffer + 0x9d, record_len - 1, &volumedesc->root_dirent, 0);
 		} else {
 			offset = 0;
 		}
 	}
 
-	printf ("  volume_set_identifier: \"");
+	TRACE ("  volume_set_identifier: \"");
 	for (i=0; i < 128; i++)
 	{
 		if (buffer[0x9c + offset + i] == 0x00) break;
-		putchar (buffer[0x9c + offset + i]);
+		TRACE_PUTCHAR (buffer[0x9c + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  publisher_identifier: \"");
+	TRACE ("  publisher_identifier: \"");
 	for (i=0; i < 128; i++)
 	{
 		if (buffer[0x11c + offset + i] == 0x00) break;
-		putchar (buffer[0x11c + offset + i]);
+		TRACE_PUTCHAR (buffer[0x11c + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  data_preparer_identifier: \"");
+	TRACE ("  data_preparer_identifier: \"");
 	for (i=0; i < 128; i++)
 	{
 		if (buffer[0x19c + offset + i] == 0x00) break;
-		putchar (buffer[0x19c + offset + i]);
+		TRACE_PUTCHAR (buffer[0x19c + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  application_identifier: \"");
+	TRACE ("  application_identifier: \"");
 	for (i=0; i < 128; i++)
 	{
 		if (buffer[0x21c + offset + i] == 0x00) break;
-		putchar (buffer[0x21c + offset + i]);
+		TRACE_PUTCHAR (buffer[0x21c + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  copyright_file_identifier: \"");
+	TRACE ("  copyright_file_identifier: \"");
 	for (i=0; i < 38; i++)
 	{
 		if (buffer[0x29c + offset + i] == 0x00) break;
-		putchar (buffer[0x29c + offset + i]);
+		TRACE_PUTCHAR (buffer[0x29c + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  abstract_file_identifier: \"");
+	TRACE ("  abstract_file_identifier: \"");
 	for (i=0; i < 36; i++)
 	{
 		if (buffer[0x2c2 + offset + i] == 0x00) break;
-		putchar (buffer[0x2c2 + offset + i]);
+		TRACE_PUTCHAR (buffer[0x2c2 + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("  bibliographic_file_identifier: \"");
+	TRACE ("  bibliographic_file_identifier: \"");
 	for (i=0; i < 37; i++)
 	{
 		if (buffer[0x2e6 + offset + i] == 0x00) break;
-		putchar (buffer[0x2e6 + offset + i]);
+		TRACE_PUTCHAR (buffer[0x2e6 + offset + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
 	decode_datetime_17 (buffer + offset + 0x30b, "  volume_datetime_created", 0);
 	decode_datetime_17 (buffer + offset + 0x31c, "  volume_datetime_modified", 0);
 	decode_datetime_17 (buffer + offset + 0x32d, "  volume_datetime_expires", 0);
 	decode_datetime_17 (buffer + offset + 0x33e, "  volume_datetime_effective", 0);
 
-	printf ("  file_structure_version: %d\n", (int)buffer[offset + 0x34f]);
+	TRACE ("  file_structure_version: %d\n", (int)buffer[offset + 0x34f]);
 
 	if ((buffer[1024 + 0] == 'C') &&
 	    (buffer[1024 + 1] == 'D') &&
@@ -1552,7 +1916,12 @@ static struct Volume_Description_t *Primary_Volume_Descriptor (struct cdfs_disc_
 	{
 		volumedesc->XA1 = 1;
 		volumedesc->SystemUse_Skip = 14;
-		printf ("  XA1 header found\n"); /* Disc should be a CDROM-XA */
+		TRACE ("  XA1 header found\n"); /* Disc should be a CDROM-XA */
+	}
+
+	if (disc->iso9660_session && disc->iso9660_session->Previous)
+	{
+		volumedesc->Previous = IsPrimary ? disc->iso9660_session->Previous->Primary_Volume_Description : disc->iso9660_session->Previous->Supplementary_Volume_Description;
 	}
 
 	if (!retval)
@@ -1580,46 +1949,67 @@ void ISO9660_Descriptor (struct cdfs_disc_t *disc, uint8_t buffer[SECTORSIZE], c
 	{
 		if ((buffer[6] != 1))
 		{
-			printf ("descriptor[%d] has invalid version (expected 1 got %u)\n", descriptor, buffer[6]);
+			TRACE ("descriptor[%d] has invalid version (expected 1 got %u)\n", descriptor, buffer[6]);
 		}
 	} else {
 		if ((buffer[6] != 1) && (buffer[6] != 2))
 		{
-			printf ("descriptor[%d] has invalid version (expected 1 got %u)\n", descriptor, buffer[6]);
+			TRACE ("descriptor[%d] has invalid version (expected 1 got %u)\n", descriptor, buffer[6]);
 		}
 	}
 
 	switch (buffer[0])
 	{
 		case 0: /* Boot record volume descriptor */
-			printf ("descriptor[%d]: Boot record volume descriptor\n", descriptor);
+			TRACE ("descriptor[%d]: Boot record volume descriptor\n", descriptor);
 			if (descriptor != 2)
 			{
-				printf ("WARNING - boot record volume must always be descriptor 2, located at sector 17 (in the last session)\n");
+				TRACE ("WARNING - boot record volume must always be descriptor 2, located at sector 17 (in the last session)\n");
 			}
 			if (!memcmp (buffer + 0x07, "EL TORITO SPECIFICATION\0\0\0\0\0\0\0\0\0", 0x26 - 0x07 + 1))
 			{
 				uint32_t elsector;
-				printf (" El Torito    format identifier found\n");
+				TRACE (" El Torito    format identifier found\n");
 				if (memcmp (buffer + 0x27, "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 0x46 - 0x27 + 1))
 				{
-					printf (" WARNING - reserved area is not padded with \\0\n");
+					TRACE (" WARNING - reserved area is not padded with \\0\n");
 				}
 				elsector =  buffer[0x47]        |
 					   (buffer[0x48] << 8)  |
 					   (buffer[0x49] << 16) |
 					   (buffer[0x4a] << 24);
-				printf (" Absolute sector of Boot Catalog %"PRId32"\n", elsector);
-				ElTorito_abs_sector (disc, elsector);
+				TRACE (" Absolute sector of Boot Catalog %"PRId32"\n", elsector);
+				{
+					struct ElTorito_catalog_t *temp = ElTorito_abs_sector (disc, elsector);
+					if (temp)
+					{
+						if (!disc->iso9660_session)
+						{
+							disc->iso9660_session = calloc (sizeof (*disc->iso9660_session), 1);
+							if (!disc->iso9660_session)
+							{
+								fprintf (stderr, "ISO9660_Descriptor() calloc() failed\n");
+								ElTorito_Catalog_Free (temp);
+								return;
+							}
+						}
+						if (disc->iso9660_session->ElTorito)
+						{
+							ElTorito_Catalog_Free (temp); /* we do not store the redundant descriptions */
+						} else {
+							disc->iso9660_session->ElTorito = temp;
+						}
+					}
+				}
 				/* byte 0x4b-0x7ff should be zero.... */
 			} else {
-				printf (" WARNING - Unknown boot record identifier: %s\n", buffer + 0x07);
+				TRACE (" WARNING - Unknown boot record identifier: %s\n", buffer + 0x07);
 			}
 			break;
 		case 1: /* Primary volume descriptor */
 			{
 				struct Volume_Description_t *temp;
-				printf ("descriptor[%d]: Primary volume descriptor\n", descriptor);
+				TRACE ("descriptor[%d]: Primary volume descriptor\n", descriptor);
 				temp = Primary_Volume_Descriptor (disc, buffer, sector, 1);
 				if (temp)
 				{
@@ -1645,7 +2035,7 @@ void ISO9660_Descriptor (struct cdfs_disc_t *disc, uint8_t buffer[SECTORSIZE], c
 		case 2: /* Supplementary volume descriptor, or enhanced volume descriptor */
 			{
 				struct Volume_Description_t *temp;
-				printf ("descriptor[%d]: Supplementary volume descriptor, or enhanced volume descriptor\n", descriptor);
+				TRACE ("descriptor[%d]: Supplementary volume descriptor, or enhanced volume descriptor\n", descriptor);
 				temp = Primary_Volume_Descriptor (disc, buffer, sector, 0);
 				if (temp)
 				{
@@ -1672,26 +2062,305 @@ void ISO9660_Descriptor (struct cdfs_disc_t *disc, uint8_t buffer[SECTORSIZE], c
 			}
 			break;
 		case 3: /* Volume partition descriptor */
-			printf ("descriptor[%d]: Volume partition descriptor\n", descriptor);
+			TRACE ("descriptor[%d]: Volume partition descriptor\n", descriptor);
 
 			break;
 		default:
-			printf ("descriptor[%d]: Descriptor type %u is unknown\n", descriptor, buffer[0]);
+			TRACE ("descriptor[%d]: Descriptor type %u is unknown\n", descriptor, buffer[0]);
 			break;
 		case 255: /* Volume descriptor set terminator */
-			printf ("descriptor[%d]: Volume partition set descriptor\n", descriptor);
+			TRACE ("descriptor[%d]: Volume partition set descriptor\n", descriptor);
 
 			*descriptorend = 1;
 			break;
 	}
 }
 
+void ISO9660_Sessions (struct cdfs_disc_t *disc)
+{
+	struct ISO9660_session_t *first = disc->iso9660_session;
+	struct ISO9660_session_t *last = first;
+	uint8_t buffer[SECTORSIZE];
+	int sessions = 1;
+	int i;
+
+	if (!first)
+	{
+		return;
+	}
+
+	for (i=0; i < disc->tracks_count; i++)
+	{
+		struct ISO9660_session_t *session;
+		uint32_t sector = disc->tracks_data[i].start;
+		int descriptor = 0;
+		int descriptorend = 0;
+
+		if (sector <= last->Sector)
+		{
+			continue;
+		}
+
+		if (get_absolute_sector_2048 (disc, sector + 16, buffer) ||
+		    (buffer[0] != 0x01) ||
+		    memcmp (buffer + 1, "CD001", 5))
+		{ /* audio track, or the track belongs to the current session */
+			continue;
+		}
+
+		session = calloc (sizeof (*session), 1);
+		if (!session)
+		{
+			fprintf (stderr, "ISO9660_Sessions() calloc() failed\n");
+			return;
+		}
+		session->Sector = sector;
+		session->Previous = last;
+
+		TRACE ("\nISO9660 session %d at absolute sector %" PRId32 "\n", sessions + 1, sector);
+
+		disc->iso9660_session = session; /* ISO9660_Descriptor() stores into the current session */
+		while (!descriptorend)
+		{
+			if (get_absolute_sector_2048 (disc, sector + 16 + descriptor, buffer))
+			{
+				break;
+			}
+			descriptor++;
+			if (memcmp (buffer + 1, "CD001", 5))
+			{
+				TRACE ("descriptor[%d] has invalid Identifier, ending session\n", descriptor);
+				break;
+			}
+			TRACE ("descriptor[%d] ISO 9660 / ECMA 119 Descriptor\n", descriptor);
+			ISO9660_Descriptor (disc, buffer, sector + 16 + descriptor - 1, descriptor, &descriptorend);
+		}
+		disc->iso9660_session = first;
+
+		if (!session->Primary_Volume_Description)
+		{
+			ISO9660_Session_Free (&session);
+			continue;
+		}
+		last->Next = session;
+		last = session;
+		sessions++;
+	}
+}
+
+struct ISO9660_delta_frame_t
+{
+	struct iso_dir_t *old; /* 0 if the directory was added */
+	struct iso_dir_t *new; /* 0 if the directory was removed */
+	int               next; /* next dirent to consider, first the ones in new, then the ones in old */
+	size_t            path_length;
+};
+
+/* the directories are sorted by name, so the match is usually found at, or close after, the same index */
+static struct iso_dirent_t *ISO9660_Delta_find (struct iso_dir_t *directory, struct iso_dirent_t *de, int hint)
+{
+	int i;
+
+	if (!directory)
+	{
+		return 0;
+	}
+	if (directory->dirents_count <= 2)
+	{
+		return 0;
+	}
+	/* hint is an index into the directory of the other session, which can be much larger than this one */
+	if ((hint < 2) || (hint >= directory->dirents_count))
+	{
+		hint = 2;
+	}
+	for (i=0; i < directory->dirents_count - 2; i++)
+	{
+		int j = 2 + (hint - 2 + i) % (directory->dirents_count - 2);
+		if ((directory->dirents_data[j]->Name_ISO9660_Length == de->Name_ISO9660_Length) &&
+		    !memcmp (directory->dirents_data[j]->Name_ISO9660, de->Name_ISO9660, de->Name_ISO9660_Length))
+		{
+			return directory->dirents_data[j];
+		}
+	}
+	return 0;
+}
+
+static int ISO9660_Delta_modified (struct iso_dirent_t *a, struct iso_dirent_t *b)
+{
+	if (memcmp (&a->Created, &b->Created, sizeof (a->Created)))
+	{
+		return 1;
+	}
+	while (a && b)
+	{
+		if ((a->Absolute_Location != b->Absolute_Location) || (a->Length != b->Length))
+		{
+			return 1;
+		}
+		a = a->next_extent;
+		b = b->next_extent;
+	}
+	return a != b;
+}
+
+static void ISO9660_Delta_print (char mark, struct DumpFS_path_t *path, struct iso_dirent_t *de)
+{
+	size_t length = path->length;
+
+	if (de->Name_RockRidge_Length)
+	{
+		DumpFS_path_append (path, (char *)de->Name_RockRidge, de->Name_RockRidge_Length);
+	} else {
+		DumpFS_path_append (path, (char *)de->Name_ISO9660, de->Name_ISO9660_Length);
+	}
+	TRACE ("%c %s%s\n", mark, path->data, (de->Flags & ISO9660_DIRENT_FLAGS_DIR) ? "/" : "");
+	DumpFS_path_truncate (path, length);
+}
+
+static int ISO9660_Delta_push (struct ISO9660_delta_frame_t **stack, int *stack_count, int *stack_size, struct iso_dir_t *old, struct iso_dir_t *new, struct DumpFS_path_t *path, struct iso_dirent_t *de)
+{
+	int i;
+
+	if ((!old) && (!new))
+	{
+		return 0;
+	}
+	for (i=0; i < *stack_count; i++)
+	{
+		if ((old && ((*stack)[i].old == old)) || (new && ((*stack)[i].new == new)))
+		{ /* loop in the directory structure, do not enter it again */
+			return 0;
+		}
+	}
+	if (*stack_count >= *stack_size)
+	{
+		struct ISO9660_delta_frame_t *temp = realloc (*stack, sizeof ((*stack)[0]) * (*stack_size + 32));
+		if (!temp)
+		{
+			fprintf (stderr, "ISO9660_Session_Delta() realloc() failed\n");
+			return -1;
+		}
+		*stack = temp;
+		*stack_size += 32;
+	}
+	(*stack)[*stack_count].old = old;
+	(*stack)[*stack_count].new = new;
+	(*stack)[*stack_count].next = 2; /* skip . and .. */
+	if (de->Name_RockRidge_Length)
+	{
+		DumpFS_path_append (path, (char *)de->Name_RockRidge, de->Name_RockRidge_Length);
+	} else {
+		DumpFS_path_append (path, (char *)de->Name_ISO9660, de->Name_ISO9660_Length);
+	}
+	(*stack)[*stack_count].path_length = path->length;
+	(*stack_count)++;
+	return 0;
+}
+
+/* Compares the trees with an explicit stack like DumpFS_dir_walk(). Directories shared with the previous session are skipped without being entered */
+void ISO9660_Session_Delta (struct ISO9660_session_t *session)
+{
+	struct Volume_Description_t *oldvd, *newvd;
+	struct ISO9660_delta_frame_t *stack = 0;
+	int stack_count = 0;
+	int stack_size = 0;
+	struct DumpFS_path_t path;
+
+	if ((!session) || (!session->Previous) || (!session->Primary_Volume_Description) || (!session->Previous->Primary_Volume_Description))
+	{
+		return;
+	}
+	oldvd = session->Previous->Primary_Volume_Description;
+	newvd = session->Primary_Volume_Description;
+
+	if (DumpFS_path_init (&path, "."))
+	{
+		return;
+	}
+
+	stack = malloc (sizeof (stack[0]) * 32);
+	if (!stack)
+	{
+		fprintf (stderr, "ISO9660_Session_Delta() malloc() failed\n");
+		DumpFS_path_free (&path);
+		return;
+	}
+	stack_size = 32;
+	stack[0].old = DumpFS_dir_find (oldvd, oldvd->root_dirent.Absolute_Location);
+	stack[0].new = DumpFS_dir_find (newvd, newvd->root_dirent.Absolute_Location);
+	stack[0].next = 2;
+	stack[0].path_length = path.length;
+	stack_count = (stack[0].old != stack[0].new) ? 1 : 0;
+
+	while (stack_count)
+	{
+		struct ISO9660_delta_frame_t *top = &stack[stack_count - 1];
+		int newcount = top->new ? top->new->dirents_count : 2;
+		int oldcount = top->old ? top->old->dirents_count : 2;
+		struct iso_dirent_t *a, *b;
+		int index;
+		int res = 0;
+
+		if (top->next >= (newcount + oldcount - 2))
+		{
+			stack_count--;
+			continue;
+		}
+		DumpFS_path_truncate (&path, top->path_length);
+		index = top->next++;
+
+		if (index < newcount)
+		{ /* entries in the new session, a changed type is reported as added here and as removed below */
+			b = top->new->dirents_data[index];
+			a = ISO9660_Delta_find (top->old, b, index);
+			if ((!a) || ((a->Flags ^ b->Flags) & ISO9660_DIRENT_FLAGS_DIR))
+			{
+				ISO9660_Delta_print ('+', &path, b);
+				if (b->Flags & ISO9660_DIRENT_FLAGS_DIR)
+				{
+					res = ISO9660_Delta_push (&stack, &stack_count, &stack_size, 0, DumpFS_dir_find (newvd, b->Absolute_Location), &path, b);
+				}
+			} else if (b->Flags & ISO9660_DIRENT_FLAGS_DIR)
+			{
+				if (a->Absolute_Location != b->Absolute_Location)
+				{
+					res = ISO9660_Delta_push (&stack, &stack_count, &stack_size, DumpFS_dir_find (oldvd, a->Absolute_Location), DumpFS_dir_find (newvd, b->Absolute_Location), &path, b);
+				}
+			} else if (ISO9660_Delta_modified (a, b))
+			{
+				ISO9660_Delta_print ('M', &path, b);
+			}
+		} else { /* entries in the old session */
+			a = top->old->dirents_data[index - newcount + 2];
+			b = ISO9660_Delta_find (top->new, a, index - newcount + 2);
+			if ((!b) || ((a->Flags ^ b->Flags) & ISO9660_DIRENT_FLAGS_DIR))
+			{
+				ISO9660_Delta_print ('-', &path, a);
+				if (a->Flags & ISO9660_DIRENT_FLAGS_DIR)
+				{
+					res = ISO9660_Delta_push (&stack, &stack_count, &stack_size, DumpFS_dir_find (oldvd, a->Absolute_Location), 0, &path, a);
+				}
+			}
+		}
+		if (res)
+		{
+			break;
+		}
+	}
+
+	free (stack);
+	DumpFS_path_free (&path);
+}
+
 void ISO9660_Session_Free (struct ISO9660_session_t **s)
 {
 	if (!s) return;
 	if (!(*s)) return;
+	ISO9660_Session_Free (&(*s)->Next);
 	if ((*s)->Primary_Volume_Description)       Volume_Description_Free ((*s)->Primary_Volume_Description);
 	if ((*s)->Supplementary_Volume_Description) Volume_Description_Free ((*s)->Supplementary_Volume_Description);
+	if ((*s)->ElTorito)                         ElTorito_Catalog_Free ((*s)->ElTorito);
 	free (*s);
 	(*s) = 0;
 }
@@ -55,8 +55,8 @@ struct iso_dirent_t
 	uint16_t XA_UID;
 	uint16_t XA_attr;
 
-	//uint8_t InterLeave_Unit_Size; ??
-	//uint8_t InterLeave_Gap_Size; ??
+	uint8_t Interleave_Unit_Size; /* in sectors, 0 if not interleaved */
+	uint8_t Interleave_Gap_Size;  /* in sectors */
 	uint16_t Volume_Sequence;
 	uint8_t  Name_ISO9660_Length;
 	uint8_t  Name_ISO9660[256];
@@ -66,6 +66,8 @@ struct iso_dirent_t
 
 	uint8_t               RockRidge_TF_Created_Present;
 	struct iso9660_datetime_t RockRidge_TF_Created;
+	uint8_t               RockRidge_TF_Modified_Present;
+	struct iso9660_datetime_t RockRidge_TF_Modified;
 
 	uint8_t  RockRidge_PX_Present;
 	uint32_t RockRidge_PX_st_mode;
@@ -94,6 +96,7 @@ struct iso_dir_t
 	int dirents_count;
 	int dirents_size;
 	struct iso_dirent_t **dirents_data;
+	uint8_t Shared; /* dirents_data belongs to the same directory in a previous session */
 };
 
 /* Temporary container for unscanned directories */
@@ -127,22 +130,91 @@ struct Volume_Description_t
 	int                   directory_scan_queue_count;
 	int                   directory_scan_queue_size;
 	struct iso_dir_queue *directory_scan_queue_data;
+
+	struct Volume_Description_t *Previous; /* same descriptor in the previous session, directories at the same Location are reused from it */
 };
 
 void Volume_Description_Free (struct Volume_Description_t *volume_desc);
 
+struct ElTorito_entry_t
+{
+	uint8_t  Platform;              /* inherited from the Valiation Header or Section Header */
+	uint8_t  Bootable;
+	uint8_t  Media;                 /* 0=No Emulation, 1=1.2M, 2=1.44M, 3=2.88M diskette, 4=Hard Disk */
+	uint16_t LoadSegment;
+	uint8_t  SystemType;
+	uint16_t SectorCount;           /* in virtual 512 byte sectors */
+	uint32_t LoadRBA;               /* in 2048 byte sectors */
+	uint8_t  SelectionCriteriaType; /* not present in the Initial/Default Entry */
+	uint8_t  SelectionCriteria[19];
+	int      Extensions;            /* number of Section Entry Extensions that followed */
+};
+
+struct ElTorito_catalog_t
+{
+	uint32_t Location;
+	uint8_t  Platform;
+	char     IDString[25];
+
+	int                      entries_count; /* entry 0 is the Initial/Default Entry */
+	int                      entries_size;
+	struct ElTorito_entry_t *entries_data;
+};
+
 struct ISO9660_session_t
-{ /* in theory there might be multiple sessions on the disc, but only the last one easy to detect */
+{ /* the first session is found at sector 16, the following ones are found using the track layout */
 	struct Volume_Description_t *Primary_Volume_Description;
 	struct Volume_Description_t *Supplementary_Volume_Description;	
+	struct ElTorito_catalog_t   *ElTorito;
+
+	uint32_t                     Sector; /* first sector of the session */
+	struct ISO9660_session_t    *Previous;
+	struct ISO9660_session_t    *Next;
 };
 
+/* Extracts the files of session into directory, using RockRidge, Joliet or plain ISO9660 names (in that order of preference). Returns non-zero on errors */
+int ISO9660_Extract (struct cdfs_disc_t *disc, struct ISO9660_session_t *session, const char *directory);
+
+struct ISO9660_index_t;
+struct cdfs_stat_t;
+struct DumpFS_index_t;
+
+/* Builds an in-memory index of the files in session, for the libcdfs.h API. Inode numbers are node numbers in the tree, 0 is the root */
+struct ISO9660_index_t *ISO9660_Index (struct cdfs_disc_t *disc, struct ISO9660_session_t *session);
+
+void ISO9660_Index_Free (struct ISO9660_index_t *index);
+
+/* The tree used for path lookups and directory listings, owned by index */
+struct DumpFS_index_t *ISO9660_Index_Tree (struct ISO9660_index_t *index);
+
+/* Fills in the permissions, ownership and mtime of ino, the rest of st is filled in by libcdfs.c from the tree */
+int ISO9660_Index_Stat (struct ISO9660_index_t *index, uint32_t ino, struct cdfs_stat_t *st);
+
+ssize_t ISO9660_Index_Read (struct ISO9660_index_t *index, uint32_t ino, void *buffer, size_t count, uint64_t offset);
+
+ssize_t ISO9660_Index_Readlink (struct ISO9660_index_t *index, uint32_t ino, char *buffer, size_t size);
+
+/* frees all the sessions in the chain */
 void ISO9660_Session_Free (struct ISO9660_session_t **s);
 
-void DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *name, uint32_t Location);
+/* Probes the start of every track after the first session for more ISO9660 sessions, and appends them to disc->iso9660_session */
+void ISO9660_Sessions (struct cdfs_disc_t *disc);
+
+/* Lists the files that were added (+), removed (-) or modified (M) in session compared to the previous session */
+void ISO9660_Session_Delta (struct ISO9660_session_t *session);
+
+/* Writes each boot image in the El Torito catalog to directory/bootNN-platform.img, returns non-zero on errors */
+int ElTorito_Extract (struct cdfs_disc_t *disc, const char *directory);
+
+/* Decodes MBR, GPT and Apple Partition Map found in the system area of hybrid images, and which files they point to */
+void ISO9660_SystemArea (struct cdfs_disc_t *disc);
+
+struct DumpFS_sink_t;
+
+void DumpFS_dir_ISO9660 (struct Volume_Description_t *vd, const char *name, uint32_t Location, struct DumpFS_sink_t *sink);
 
-void DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *name, uint32_t Location);
+void DumpFS_dir_RockRidge (struct Volume_Description_t *vd, const char *name, uint32_t Location, struct DumpFS_sink_t *sink);
 
-void DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *name, uint32_t Location);
+void DumpFS_dir_Joliet (struct Volume_Description_t *vd, const char *name, uint32_t Location, struct DumpFS_sink_t *sink);
 
 #endif
@@ -0,0 +1,521 @@
+/* Extraction of a ISO9660 / Joliet / RockRidge tree into a directory, see DumpFS_extract_job_t for the common steps.
+ *
+ * The tree is walked with DumpFS_dir_walk(), and the files are written sorted on their Location, so the image is read in one
+ * sequential pass. Plain 2048 byte images are copied with sendfile(), everything else goes via get_absolute_sectors_2048() in
+ * large batches.
+ */
+
+#define ISO9660_EXTRACT_BATCH 256 /* sectors per read, 512KB */
+
+enum ISO9660_extract_names_t
+{
+	ISO9660_EXTRACT_NAMES_ISO9660   = 0,
+	ISO9660_EXTRACT_NAMES_JOLIET    = 1,
+	ISO9660_EXTRACT_NAMES_ROCKRIDGE = 2,
+};
+
+struct ISO9660_extract_t
+{
+	struct cdfs_disc_t          *disc;
+	struct Volume_Description_t *vd;
+	enum ISO9660_extract_names_t names;
+	int                          retval;
+	int                          symlinks;
+
+	/* entry is the struct iso_dirent_t, for directories the . entry */
+	int                          files_count;
+	int                          files_size;
+	struct DumpFS_extract_job_t *files_data;
+
+	int                          directories_count; /* in the order they were created, parents first */
+	int                          directories_size;
+	struct DumpFS_extract_job_t *directories_data;
+
+	int                          symlinks_count;
+	int                          symlinks_size;
+	struct DumpFS_extract_job_t *symlinks_data;
+
+	const char *root;
+	char       *failed; /* directory that could not be created, the walk visits its children right after it */
+
+	uint8_t *buffer;
+};
+
+/* Returns the name length, or -1 if the name can not be used safely as a filename */
+static int ISO9660_extract_name (enum ISO9660_extract_names_t names, struct iso_dirent_t *de, char *name, size_t size)
+{
+	size_t length;
+
+	if ((names == ISO9660_EXTRACT_NAMES_ROCKRIDGE) && de->Name_RockRidge_Length)
+	{
+		length = de->Name_RockRidge_Length;
+		if (length >= size)
+		{
+			return -1;
+		}
+		memcpy (name, de->Name_RockRidge, length);
+	} else if (names == ISO9660_EXTRACT_NAMES_JOLIET)
+	{
+		char *inbuf = (char *)de->Name_ISO9660;
+		size_t inbytesleft = de->Name_ISO9660_Length;
+		char *outbuf = name;
+		size_t outbytesleft = size - 1;
+
+		cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
+		length = outbuf - name;
+	} else {
+		length = strnlen ((char *)de->Name_ISO9660, de->Name_ISO9660_Length);
+		if (length >= size)
+		{
+			return -1;
+		}
+		memcpy (name, de->Name_ISO9660, length);
+	}
+	name[length] = 0;
+
+	if (names != ISO9660_EXTRACT_NAMES_ROCKRIDGE)
+	{ /* remove the ;1 version suffix */
+		char *version = memchr (name, ';', length);
+		if (version)
+		{
+			length = version - name;
+			name[length] = 0;
+		}
+	}
+
+	if (!DumpFS_extract_name_safe (name, length))
+	{
+		return -1;
+	}
+	return length;
+}
+
+/* 'd' directory, '-' file, 'l' symlink, 0 skip */
+static char ISO9660_extract_type (enum ISO9660_extract_names_t names, struct iso_dirent_t *de)
+{
+	if (names == ISO9660_EXTRACT_NAMES_ROCKRIDGE)
+	{
+		if (de->RockRidge_DirectoryIsRedirected)
+		{
+			return 0;
+		}
+		if (de->RockRidge_IsAugmentedDirectory)
+		{
+			return 'd';
+		}
+		if (de->RockRidge_PX_Present)
+		{
+			switch (de->RockRidge_PX_st_mode & 0170000)
+			{
+				case 0040000: return 'd';
+				case 0100000: return '-';
+				case 0120000: return 'l';
+				default:      return 0; /* devices, pipes and sockets */
+			}
+		}
+		if (de->RockRidge_Symlink_Components_Length)
+		{
+			return 'l';
+		}
+	}
+	return (de->Flags & ISO9660_DIRENT_FLAGS_DIR) ? 'd' : '-';
+}
+
+/* Permissions and ownership from RockRidge PX or XA, returns 0 if the entry has none */
+static int ISO9660_extract_mode (enum ISO9660_extract_names_t names, struct iso_dirent_t *de, mode_t *mode, uid_t *uid, gid_t *gid)
+{
+	if ((names == ISO9660_EXTRACT_NAMES_ROCKRIDGE) && de->RockRidge_PX_Present)
+	{
+		*mode = de->RockRidge_PX_st_mode & 07777;
+		*uid = de->RockRidge_PX_st_uid;
+		*gid = de->RockRidge_PX_st_gid;
+		return 1;
+	}
+	if (de->XA)
+	{
+		*mode = ((de->XA_attr & XA_ATTR__OWNER_READ) ? 0400 : 0) |
+		        ((de->XA_attr & XA_ATTR__OWNER_EXEC) ? 0100 : 0) |
+		        ((de->XA_attr & XA_ATTR__GROUP_READ) ? 0040 : 0) |
+		        ((de->XA_attr & XA_ATTR__GROUP_EXEC) ? 0010 : 0) |
+		        ((de->XA_attr & XA_ATTR__OTHER_READ) ? 0004 : 0) |
+		        ((de->XA_attr & XA_ATTR__OTHER_EXEC) ? 0001 : 0);
+		*uid = de->XA_UID;
+		*gid = de->XA_GID;
+		return 1;
+	}
+	return 0;
+}
+
+/* The modification time, from RockRidge TF if present, else the recording date of the directory record */
+static int64_t ISO9660_extract_time (enum ISO9660_extract_names_t names, struct iso_dirent_t *de)
+{
+	if ((names == ISO9660_EXTRACT_NAMES_ROCKRIDGE) && de->RockRidge_TF_Modified_Present)
+	{
+		return DumpFS_record_time_ISO9660 (&de->RockRidge_TF_Modified);
+	}
+	if ((names == ISO9660_EXTRACT_NAMES_ROCKRIDGE) && de->RockRidge_TF_Created_Present)
+	{
+		return DumpFS_record_time_ISO9660 (&de->RockRidge_TF_Created);
+	}
+	return DumpFS_record_time_ISO9660 (&de->Created);
+}
+
+/* Picks the richest namespace in session, returns 0 if there is no filesystem */
+static struct Volume_Description_t *ISO9660_extract_namespace (struct ISO9660_session_t *session, enum ISO9660_extract_names_t *names)
+{
+	if (session && session->Primary_Volume_Description && session->Primary_Volume_Description->RockRidge)
+	{
+		*names = ISO9660_EXTRACT_NAMES_ROCKRIDGE;
+		return session->Primary_Volume_Description;
+	}
+	if (session && session->Supplementary_Volume_Description && session->Supplementary_Volume_Description->UTF16)
+	{
+		*names = ISO9660_EXTRACT_NAMES_JOLIET;
+		return session->Supplementary_Volume_Description;
+	}
+	if (session && session->Primary_Volume_Description)
+	{
+		*names = ISO9660_EXTRACT_NAMES_ISO9660;
+		return session->Primary_Volume_Description;
+	}
+	return 0;
+}
+
+/* path is used if fd is negative */
+static void ISO9660_extract_attributes (struct ISO9660_extract_t *self, int fd, const char *path, struct iso_dirent_t *de, int symlink)
+{
+	struct DumpFS_record_t record;
+	mode_t mode = 0;
+	uid_t uid = 0;
+	gid_t gid = 0;
+
+	memset (&record, 0, sizeof (record));
+	record.type = symlink ? 'l' : ISO9660_extract_type (self->names, de);
+	if (ISO9660_extract_mode (self->names, de, &mode, &uid, &gid))
+	{
+		record.has_mode = 1;
+		record.mode = mode;
+		record.has_owner = 1;
+		record.uid = uid;
+		record.gid = gid;
+	}
+	record.has_mtime = 1;
+	record.mtime = ISO9660_extract_time (self->names, de);
+	DumpFS_extract_attributes (fd, path, &record);
+}
+
+/* list() callback for DumpFS_dir_walk(), name is the path of the directory */
+static void _ISO9660_extract_dir (void *ctx, const char *name, struct iso_dir_t *directory)
+{
+	struct ISO9660_extract_t *self = ctx;
+	char *path;
+	int i;
+
+	if (self->failed)
+	{
+		size_t length = strlen (self->failed);
+		if ((!strncmp (name, self->failed, length)) && (name[length] == '/'))
+		{ /* inside a directory that could not be created */
+			return;
+		}
+		free (self->failed);
+		self->failed = 0;
+	}
+	if (DumpFS_extract_mkdir (name, !strcmp (name, self->root)))
+	{
+		self->failed = strdup (name);
+		self->retval = -1;
+		return;
+	}
+	path = strdup (name);
+	if ((!path) || DumpFS_extract_job_append (&self->directories_count, &self->directories_size, &self->directories_data, path, directory->dirents_count ? directory->dirents_data[0] : 0))
+	{
+		free (path);
+		self->retval = -1;
+		return;
+	}
+
+	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+	{
+		struct iso_dirent_t *de = directory->dirents_data[i];
+		char filename[256*4+1];
+		int length;
+		char type = ISO9660_extract_type (self->names, de);
+
+		if ((type == 'd') || (!type))
+		{ /* directories are created when DumpFS_dir_walk() enters them */
+			continue;
+		}
+
+		length = ISO9660_extract_name (self->names, de, filename, sizeof (filename));
+		if (length < 0)
+		{
+			fprintf (stderr, "Skipping file with an unsafe name in %s\n", name);
+			continue;
+		}
+
+		path = malloc (strlen (name) + 1 + length + 1);
+		if (!path)
+		{
+			fprintf (stderr, "_ISO9660_extract_dir() malloc() failed\n");
+			self->retval = -1;
+			return;
+		}
+		sprintf (path, "%s/%s", name, filename);
+
+		if ((type == 'l') ? DumpFS_extract_job_append (&self->symlinks_count, &self->symlinks_size, &self->symlinks_data, path, de) :
+		                    DumpFS_extract_job_append (&self->files_count, &self->files_size, &self->files_data, path, de))
+		{
+			free (path);
+			self->retval = -1;
+			return;
+		}
+	}
+}
+
+/* child() callbacks for DumpFS_dir_walk(), directories with names that can not be used safely are not entered */
+static int ISO9660_extract_child (enum ISO9660_extract_names_t names, int (*child)(struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path),
+                                  struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
+{
+	char filename[256*4+1];
+
+	if (child (dirent, Location, path))
+	{
+		return -1;
+	}
+	if (ISO9660_extract_name (names, dirent, filename, sizeof (filename)) < 0)
+	{
+		fprintf (stderr, "Skipping directory with an unsafe name in %s\n", path->data);
+		return -1;
+	}
+	return 0;
+}
+
+static int _ISO9660_extract_child_ISO9660 (struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
+{
+	return ISO9660_extract_child (ISO9660_EXTRACT_NAMES_ISO9660, _DumpFS_child_ISO9660, dirent, Location, path);
+}
+
+static int _ISO9660_extract_child_Joliet (struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
+{
+	return ISO9660_extract_child (ISO9660_EXTRACT_NAMES_JOLIET, _DumpFS_child_Joliet, dirent, Location, path);
+}
+
+static int _ISO9660_extract_child_RockRidge (struct iso_dirent_t *dirent, uint32_t *Location, struct DumpFS_path_t *path)
+{
+	return ISO9660_extract_child (ISO9660_EXTRACT_NAMES_ROCKRIDGE, _DumpFS_child_RockRidge, dirent, Location, path);
+}
+
+/* Symlinks are created after all the files have been written */
+static void ISO9660_extract_symlink (struct ISO9660_extract_t *self, struct DumpFS_extract_job_t *job)
+{
+	struct DumpFS_path_t target;
+
+	if (DumpFS_path_init (&target, ""))
+	{
+		self->retval = -1;
+		return;
+	}
+	DumpFS_symlink_RockRidge (job->entry, &target);
+	if (DumpFS_extract_symlink (target.data, job->path))
+	{
+		self->retval = -1;
+	} else {
+		ISO9660_extract_attributes (self, -1, job->path, job->entry, 1);
+		self->symlinks++;
+	}
+	DumpFS_path_free (&target);
+}
+
+static int ISO9660_extract_cmp (const void *a, const void *b)
+{
+	const struct iso_dirent_t *A = ((const struct DumpFS_extract_job_t *)a)->entry;
+	const struct iso_dirent_t *B = ((const struct DumpFS_extract_job_t *)b)->entry;
+
+	if (A->Absolute_Location < B->Absolute_Location) return -1;
+	if (A->Absolute_Location > B->Absolute_Location) return 1;
+	return 0;
+}
+
+/* Copies bytes from count sectors starting at sector */
+static int ISO9660_extract_copy (struct ISO9660_extract_t *self, int fd, uint32_t sector, uint32_t count, uint64_t bytes)
+{
+#ifdef __linux__
+	int srcfd;
+	off_t srcoffset;
+
+	if (!get_absolute_sectors_2048_fd (self->disc, sector, count, &srcfd, &srcoffset))
+	{
+		uint64_t left = bytes;
+		while (left)
+		{
+			ssize_t res = sendfile (fd, srcfd, &srcoffset, (left > 0x40000000) ? 0x40000000 : left);
+			if (res <= 0)
+			{
+				if ((res < 0) && (errno == EINTR))
+				{
+					continue;
+				}
+				break;
+			}
+			left -= res;
+		}
+		if (!left)
+		{
+			return 0;
+		}
+		if (left != bytes)
+		{
+			fprintf (stderr, "sendfile() failed: %s\n", strerror (errno));
+			return -1;
+		}
+		/* sendfile() is not supported for these files, use the normal path */
+	}
+#endif
+
+	while (bytes)
+	{
+		uint32_t n = (count > ISO9660_EXTRACT_BATCH) ? ISO9660_EXTRACT_BATCH : count;
+		uint64_t b = ((uint64_t)n * SECTORSIZE > bytes) ? bytes : (uint64_t)n * SECTORSIZE;
+
+		if (get_absolute_sectors_2048 (self->disc, sector, n, self->buffer))
+		{
+			fprintf (stderr, "Failed to read sector %" PRIu32 "\n", sector);
+			return -1;
+		}
+		if (DumpFS_extract_write (fd, self->buffer, b))
+		{
+			fprintf (stderr, "write() failed: %s\n", strerror (errno));
+			return -1;
+		}
+		sector += n;
+		count -= n;
+		bytes -= b;
+	}
+	return 0;
+}
+
+/* One extent, interleaved files are stored as Interleave_Unit_Size sectors followed by Interleave_Gap_Size sectors of other data */
+static int ISO9660_extract_extent (struct ISO9660_extract_t *self, int fd, struct iso_dirent_t *extent)
+{
+	uint32_t sector = extent->Absolute_Location;
+	uint64_t left = extent->Length;
+	uint32_t unit = extent->Interleave_Unit_Size ? extent->Interleave_Unit_Size : UINT32_MAX;
+	uint32_t gap = extent->Interleave_Unit_Size ? extent->Interleave_Gap_Size : 0;
+	uint32_t unitleft = unit;
+
+	while (left)
+	{
+		uint32_t count = (left + SECTORSIZE - 1) / SECTORSIZE;
+		uint64_t bytes;
+
+		if (count > unitleft)
+		{
+			count = unitleft;
+		}
+		bytes = ((uint64_t)count * SECTORSIZE > left) ? left : (uint64_t)count * SECTORSIZE;
+
+		if (ISO9660_extract_copy (self, fd, sector, count, bytes))
+		{
+			return -1;
+		}
+		sector += count;
+		left -= bytes;
+		unitleft -= count;
+		if (!unitleft)
+		{
+			sector += gap;
+			unitleft = unit;
+		}
+	}
+	return 0;
+}
+
+int ISO9660_Extract (struct cdfs_disc_t *disc, struct ISO9660_session_t *session, const char *directory)
+{
+	struct ISO9660_extract_t self;
+	int i;
+
+	memset (&self, 0, sizeof (self));
+	self.disc = disc;
+
+	self.vd = ISO9660_extract_namespace (session, &self.names);
+	if (!self.vd)
+	{
+		fprintf (stderr, "No ISO9660 filesystem to extract\n");
+		return -1;
+	}
+
+	self.buffer = malloc (ISO9660_EXTRACT_BATCH * SECTORSIZE);
+	if (!self.buffer)
+	{
+		fprintf (stderr, "ISO9660_Extract() malloc() failed\n");
+		return -1;
+	}
+
+	self.root = directory;
+	DumpFS_dir_walk (self.vd, directory, self.vd->root_dirent.Absolute_Location, &self, _ISO9660_extract_dir,
+		(self.names == ISO9660_EXTRACT_NAMES_ROCKRIDGE) ? _ISO9660_extract_child_RockRidge :
+		(self.names == ISO9660_EXTRACT_NAMES_JOLIET)    ? _ISO9660_extract_child_Joliet    : _ISO9660_extract_child_ISO9660);
+	free (self.failed);
+
+	if (self.files_count)
+	{
+		qsort (self.files_data, self.files_count, sizeof (self.files_data[0]), ISO9660_extract_cmp);
+	}
+
+	for (i=0; i < self.files_count; i++)
+	{
+		struct iso_dirent_t *de = self.files_data[i].entry;
+		struct iso_dirent_t *extent;
+		int fd;
+
+		fd = DumpFS_extract_open (self.files_data[i].path, 1);
+		if (fd < 0)
+		{
+			self.retval = -1;
+			continue;
+		}
+		if (de->XA && (de->XA_attr & XA_ATTR__MODE2_FORM2))
+		{
+			fprintf (stderr, "Warning - %s is stored as Mode 2 Form 2, only 2048 bytes per sector are extracted\n", self.files_data[i].path);
+		}
+		for (extent = de; extent; extent = extent->next_extent)
+		{
+			if (ISO9660_extract_extent (&self, fd, extent))
+			{
+				fprintf (stderr, "Failed to extract %s\n", self.files_data[i].path);
+				self.retval = -1;
+				break;
+			}
+		}
+		ISO9660_extract_attributes (&self, fd, self.files_data[i].path, de, 0);
+		if (close (fd))
+		{
+			fprintf (stderr, "close(\"%s\") failed: %s\n", self.files_data[i].path, strerror (errno));
+			self.retval = -1;
+		}
+	}
+
+	for (i=0; i < self.symlinks_count; i++)
+	{
+		ISO9660_extract_symlink (&self, &self.symlinks_data[i]);
+	}
+
+	for (i=self.directories_count - 1; i >= 0; i--)
+	{
+		if (self.directories_data[i].entry)
+		{
+			ISO9660_extract_attributes (&self, -1, self.directories_data[i].path, self.directories_data[i].entry, 0);
+		}
+	}
+
+	TRACE ("Extracted %d files, %d symlinks and %d directories into %s\n", self.files_count, self.symlinks, self.directories_count, directory);
+
+	DumpFS_extract_jobs_free (self.files_count, self.files_data);
+	DumpFS_extract_jobs_free (self.directories_count, self.directories_data);
+	DumpFS_extract_jobs_free (self.symlinks_count, self.symlinks_data);
+	free (self.buffer);
+
+	return self.retval;
+}
@@ -0,0 +1,251 @@
+/* Index of one ISO9660 session for the library API in libcdfs.c, see DumpFS_index_t. The entry of a node is its struct iso_dirent_t,
+ * for directories the . entry, and Location is the sector of the directory.
+ */
+
+struct ISO9660_index_t
+{
+	struct cdfs_disc_t          *disc;
+	struct Volume_Description_t *vd;
+	enum ISO9660_extract_names_t names;
+	struct DumpFS_index_t        tree;
+
+	uint8_t buffer[SECTORSIZE]; /* for reads that does not cover a whole sector */
+};
+
+static int ISO9660_index_append (struct ISO9660_index_t *self, const char *name, struct iso_dirent_t *de, uint32_t parent, char type)
+{
+	struct DumpFS_index_node_t *node = DumpFS_index_append (&self->tree, name, de, parent, type);
+
+	if (!node)
+	{
+		return -1;
+	}
+	if (type == 'd')
+	{
+		node->Location = (de->RockRidge_IsAugmentedDirectory && (self->names == ISO9660_EXTRACT_NAMES_ROCKRIDGE)) ? de->RockRidge_AugmentedDirectoryFrom : de->Absolute_Location;
+		node->size = de->Length;
+	} else {
+		struct iso_dirent_t *extent;
+		for (extent = de; extent; extent = extent->next_extent)
+		{
+			node->size += extent->Length;
+		}
+	}
+	return 0;
+}
+
+/* Adds the content of directory node n */
+static int ISO9660_index_directory (struct ISO9660_index_t *self, uint32_t n)
+{
+	struct DumpFS_index_node_t *nodes;
+	struct iso_dir_t *directory;
+	uint32_t ancestor;
+	int i;
+
+	directory = DumpFS_dir_find (self->vd, self->tree.nodes_data[n].Location);
+	if (!directory)
+	{
+		return 0;
+	}
+	if (directory->dirents_count)
+	{ /* the . entry holds the attributes of the directory itself */
+		self->tree.nodes_data[n].entry = directory->dirents_data[0];
+		self->tree.nodes_data[n].size = directory->dirents_data[0]->Length;
+	}
+
+	nodes = self->tree.nodes_data;
+	for (ancestor = n; ancestor; )
+	{
+		ancestor = nodes[ancestor].parent;
+		if (nodes[ancestor].Location == nodes[n].Location)
+		{ /* loop in the directory structure, leave it empty */
+			return 0;
+		}
+	}
+
+	for (i=2; i < directory->dirents_count; i++) /* skip . and .. */
+	{
+		struct iso_dirent_t *de = directory->dirents_data[i];
+		char name[256*4+1];
+		char type = ISO9660_extract_type (self->names, de);
+
+		if ((!type) || (ISO9660_extract_name (self->names, de, name, sizeof (name)) < 0))
+		{
+			continue;
+		}
+		if (ISO9660_index_append (self, name, de, n, type))
+		{
+			return -1;
+		}
+	}
+	DumpFS_index_sort (&self->tree, n);
+	return 0;
+}
+
+struct ISO9660_index_t *ISO9660_Index (struct cdfs_disc_t *disc, struct ISO9660_session_t *session)
+{
+	struct ISO9660_index_t *self;
+	uint32_t n;
+
+	self = calloc (sizeof (*self), 1);
+	if (!self)
+	{
+		fprintf (stderr, "ISO9660_Index() calloc() failed\n");
+		return 0;
+	}
+	self->disc = disc;
+	self->vd = ISO9660_extract_namespace (session, &self->names);
+	if (!self->vd)
+	{
+		free (self);
+		return 0;
+	}
+
+	if (ISO9660_index_append (self, "", &self->vd->root_dirent, 0, 'd'))
+	{
+		ISO9660_Index_Free (self);
+		return 0;
+	}
+	self->tree.nodes_data[0].Location = self->vd->root_dirent.Absolute_Location;
+
+	for (n = 0; n < self->tree.nodes_count; n++)
+	{
+		if ((self->tree.nodes_data[n].type == 'd') && ISO9660_index_directory (self, n))
+		{
+			ISO9660_Index_Free (self);
+			return 0;
+		}
+	}
+
+	return self;
+}
+
+void ISO9660_Index_Free (struct ISO9660_index_t *self)
+{
+	if (!self)
+	{
+		return;
+	}
+	DumpFS_index_free (&self->tree);
+	free (self);
+}
+
+struct DumpFS_index_t *ISO9660_Index_Tree (struct ISO9660_index_t *self)
+{
+	return &self->tree;
+}
+
+int ISO9660_Index_Stat (struct ISO9660_index_t *self, uint32_t n, struct cdfs_stat_t *st)
+{
+	struct iso_dirent_t *de;
+	mode_t mode = 0;
+	uid_t uid = 0;
+	gid_t gid = 0;
+
+	if (n >= self->tree.nodes_count)
+	{
+		return -1;
+	}
+	de = self->tree.nodes_data[n].entry;
+
+	if (ISO9660_extract_mode (self->names, de, &mode, &uid, &gid))
+	{
+		st->mode = (st->mode & S_IFMT) | mode;
+		st->uid = uid;
+		st->gid = gid;
+	}
+	st->mtime = ISO9660_extract_time (self->names, de);
+	return 0;
+}
+
+ssize_t ISO9660_Index_Read (struct ISO9660_index_t *self, uint32_t n, void *buffer, size_t count, uint64_t offset)
+{
+	struct iso_dirent_t *extent;
+	uint8_t *dst = buffer;
+	size_t done = 0;
+
+	if ((n >= self->tree.nodes_count) || (self->tree.nodes_data[n].type != '-'))
+	{
+		return -1;
+	}
+
+	for (extent = self->tree.nodes_data[n].entry; extent && (done < count); extent = extent->next_extent)
+	{
+		uint32_t unit = extent->Interleave_Unit_Size ? extent->Interleave_Unit_Size : UINT32_MAX;
+		uint32_t gap = extent->Interleave_Unit_Size ? extent->Interleave_Gap_Size : 0;
+
+		if (offset >= extent->Length)
+		{
+			offset -= extent->Length;
+			continue;
+		}
+
+		while ((done < count) && (offset < extent->Length))
+		{
+			uint32_t relsector = offset / SECTORSIZE;
+			uint32_t within = offset % SECTORSIZE;
+			uint32_t sector = extent->Absolute_Location + (relsector / unit) * (unit + gap) + (relsector % unit);
+			uint64_t left = extent->Length - offset;
+			size_t bytes = count - done;
+
+			if (bytes > left)
+			{
+				bytes = left;
+			}
+
+			if ((!within) && (bytes >= SECTORSIZE))
+			{ /* whole sectors go straight into the callers buffer */
+				uint32_t sectors = bytes / SECTORSIZE;
+				if (sectors > (unit - relsector % unit))
+				{
+					sectors = unit - relsector % unit;
+				}
+				if (get_absolute_sectors_2048 (self->disc, sector, sectors, dst + done))
+				{
+					return done ? done : -1;
+				}
+				bytes = (size_t)sectors * SECTORSIZE;
+			} else {
+				if (get_absolute_sector_2048 (self->disc, sector, self->buffer))
+				{
+					return done ? done : -1;
+				}
+				if (bytes > (SECTORSIZE - within))
+				{
+					bytes = SECTORSIZE - within;
+				}
+				memcpy (dst + done, self->buffer + within, bytes);
+			}
+			done += bytes;
+			offset += bytes;
+		}
+		offset = 0;
+	}
+
+	return done;
+}
+
+ssize_t ISO9660_Index_Readlink (struct ISO9660_index_t *self, uint32_t n, char *buffer, size_t size)
+{
+	struct DumpFS_path_t target;
+	ssize_t retval;
+
+	if ((n >= self->tree.nodes_count) || (self->tree.nodes_data[n].type != 'l'))
+	{
+		return -1;
+	}
+	if (DumpFS_path_init (&target, ""))
+	{
+		return -1;
+	}
+	DumpFS_symlink_RockRidge (self->tree.nodes_data[n].entry, &target);
+	retval = target.length;
+	if (size)
+	{
+		size_t length = (target.length < size) ? target.length : size - 1;
+		memcpy (buffer, target.data, length);
+		buffer[length] = 0;
+	}
+	DumpFS_path_free (&target);
+	return retval;
+}
@@ -0,0 +1,493 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cdfs.h"
+#include "cue.h"
+#include "dumpfs.h"
+#include "iso9660.h"
+#include "libcdfs.h"
+#include "main.h"
+#include "toc.h"
+#include "udf.h"
+
+struct cdfs_t
+{
+	struct cdfs_disc_t     *disc;
+	struct UDF_index_t     *udf;     /* only one of udf and iso9660 is set */
+	struct ISO9660_index_t *iso9660;
+	struct DumpFS_index_t  *tree;    /* owned by the index above */
+};
+
+struct cdfs_dir_t
+{
+	struct cdfs_t *self;
+	uint32_t       ino;
+	uint32_t       next;
+};
+
+static char *get_path(const char *sourcefile)
+{
+	char *lastslash = strrchr (sourcefile, '/');
+	char *retval;
+	if (!lastslash)
+	{
+		return strdup ("./");
+	}
+	retval = strdup (sourcefile);
+	retval[lastslash - sourcefile + 1] = 0;
+	return retval;
+}
+
+static int is_filename_cue (const char *filename)
+{
+	int len = strlen (filename);
+	if (len < 4)
+	{
+		return 0;
+	}
+
+	if (!strcasecmp (filename + len - 4, ".cue"))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+static int is_filename_toc (const char *filename)
+{
+	int len = strlen (filename);
+	if (len < 4)
+	{
+		return 0;
+	}
+
+	if (!strcasecmp (filename + len - 4, ".toc"))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+struct cdfs_disc_t *cdfs_disc_open (const char *path)
+{
+	uint32_t            isofile_sectorcount = 0;
+	int                 isofile_fd = -1;
+	enum cdfs_format_t  isofile_format = 0;
+	struct cdfs_disc_t *disc;
+	struct stat         st;
+
+	isofile_fd = open (path, O_RDONLY);
+
+	if (isofile_fd < 0)
+	{
+		perror ("open(argv[1]");
+		return 0;
+	}
+	if (fstat (isofile_fd, &st))
+	{
+		perror ("fstat(argv[1]");
+		close (isofile_fd);
+		return 0;
+	}
+
+	if (is_filename_cue (path))
+	{
+		struct cue_parser_t *cue = cue_parser_from_fd (isofile_fd);
+		char *argv1_path;
+
+		close (isofile_fd);
+		isofile_fd = -1;
+		if (!cue)
+		{
+			return 0;
+		}
+
+		argv1_path = get_path (path);
+		disc = cue_parser_to_cdfs_disc (argv1_path, cue);
+		free (argv1_path);
+		cue_parser_free (cue);
+		if (disc)
+		{
+			disc->has_source = 1;
+			disc->source_dev = st.st_dev;
+			disc->source_ino = st.st_ino;
+		}
+		return disc;
+	}
+
+	if (is_filename_toc (path))
+	{
+		struct toc_parser_t *toc = toc_parser_from_fd (isofile_fd);
+		char *argv1_path;
+
+		close (isofile_fd);
+		isofile_fd = -1;
+		if (!toc)
+		{
+			return 0;
+		}
+
+		argv1_path = get_path (path);
+		disc = toc_parser_to_cdfs_disc (argv1_path, toc);
+		free (argv1_path);
+		toc_parser_free (toc);
+		if (disc)
+		{
+			disc->has_source = 1;
+			disc->source_dev = st.st_dev;
+			disc->source_ino = st.st_ino;
+		}
+		return disc;
+	}
+
+	if (detect_isofile_sectorformat (isofile_fd, path, st.st_size, &isofile_format, &isofile_sectorcount))
+	{
+		fprintf (stderr, "Unable to detect ISOFILE sector format\n");
+		close (isofile_fd);
+		return 0;
+	}
+
+	disc = calloc (sizeof (*disc), 1);
+	if (!disc)
+	{
+		fprintf (stderr, "cdfs_disc_open() calloc() failed\n");
+		close (isofile_fd);
+		return 0;
+	}
+	disc->has_source = 1;
+	disc->source_dev = st.st_dev;
+	disc->source_ino = st.st_ino;
+
+	cdfs_disc_datasource_append (disc,
+	                             0,                   /* sectoroffset */
+	                             isofile_sectorcount,
+	                             isofile_fd,
+	                             path,                /* filename */
+	                             isofile_format,
+	                             0,                   /* offset */
+	                             st.st_size);         /* length */
+
+	/* track 00 */
+	cdfs_disc_track_append (disc,
+	                        0,  /* pregap */
+	                        0,  /* offset */
+	                        0,  /* sectorcount */
+	                        0,  /* title */
+	                        0,  /* performer */
+	                        0,  /* songwriter */
+	                        0,  /* composer */
+	                        0,  /* arranger */
+	                        0); /* message */
+
+	/* track 01 */
+	cdfs_disc_track_append (disc,
+	                        0,  /* pregap */
+	                        0,  /* offset */
+	                        disc->datasources_data[0].sectorcount,
+	                        0,  /* title */
+	                        0,  /* performer */
+	                        0,  /* songwriter */
+	                        0,  /* composer */
+	                        0,  /* arranger */
+	                        0); /* message */
+
+	return disc;
+}
+
+int cdfs_disc_scan (struct cdfs_disc_t *disc)
+{
+	uint8_t buffer[SECTORSIZE];
+	int descriptor = 0;
+	int descriptorend = 0;
+	int ISO9660descriptorend = 0;
+	int retval = 0;
+#ifdef CDFS_TRACE
+	int trace = trace_enabled;
+
+	trace_enabled = disc->trace;
+#endif
+
+	while (!descriptorend)
+	{
+		uint32_t sector = 16 + descriptor;
+
+		if (get_absolute_sector_2048 (disc, sector, buffer))
+		{
+			retval = 1;
+			break;
+		}
+
+		descriptor++; /* descriptor are 1, not zero based... for the user */
+
+		if ((buffer[1] == 'B') &&
+		    (buffer[2] == 'E') &&
+		    (buffer[3] == 'A') &&
+		    (buffer[4] == '0') &&
+		    (buffer[5] == '1'))
+		{
+			TRACE ("descriptor[%d] Beginning Extended Area Descriptor (just a marker)\n", descriptor);
+			continue;
+		}
+
+		if ((buffer[1] == 'T') &&
+		    (buffer[2] == 'E') &&
+		    (buffer[3] == 'A') &&
+		    (buffer[4] == '0') &&
+		    (buffer[5] == '1'))
+		{
+			TRACE ("descriptor[%d] Terminating Extended Area Descriptor (just a marker)\n", descriptor);
+			descriptorend = 1;
+			break;
+		}
+
+		if ((buffer[1] == 'B') &&
+		    (buffer[2] == 'O') &&
+		    (buffer[3] == 'O') &&
+		    (buffer[4] == 'T') &&
+		    (buffer[5] == '2'))
+		{
+#warning TODO ECMA 168 BOOT
+			TRACE ("descriptor[%d] ECMA 167/168 Boot Descriptor\n", descriptor);
+			continue;
+		}
+
+		if ((buffer[1] == 'C') &&
+		    (buffer[2] == 'D') &&
+		    (buffer[3] == 'W') &&
+		    (buffer[4] == '0') &&
+		    (buffer[5] == '2'))
+		{
+#warning TODO ECMA 168
+			TRACE ("descriptor[%d] ISO/IEC 13490 / ECMA 168 Descriptor\n", descriptor);
+			continue;
+		}
+
+		if ((buffer[1] == 'N') &&
+		    (buffer[2] == 'S') &&
+		    (buffer[3] == 'R') &&
+		    (buffer[4] == '0') &&
+		    (buffer[5] == '2'))
+		{
+			TRACE ("descriptor[%d] ISO/IEC 13346:1995 / ECMA 167 2nd edition / UDF Descriptor\n", descriptor);
+			UDF_Descriptor (disc);
+			continue;
+		}
+
+		if ((buffer[1] == 'N') &&
+		    (buffer[2] == 'S') &&
+		    (buffer[3] == 'R') &&
+		    (buffer[4] == '0') &&
+		    (buffer[5] == '3'))
+		{
+			TRACE ("descriptor[%d] ECMA 167 3rd edition / UDF Descriptor\n", descriptor);
+			UDF_Descriptor (disc);
+			continue;
+		}
+
+
+		if ((buffer[1] =='C') ||
+		    (buffer[2] =='D') ||
+		    (buffer[3] =='0') ||
+		    (buffer[4] =='0') ||
+		    (buffer[5] =='1'))
+		{
+			TRACE ("descriptor[%d] ISO 9660 / ECMA 119 Descriptor\n", descriptor);
+			if (ISO9660descriptorend)
+			{
+				TRACE ("WARNING - this is unepected, CD001 parsing should be complete\n");
+			}
+			ISO9660_Descriptor (disc, buffer, sector, descriptor, &ISO9660descriptorend);
+			continue;
+		} else {
+			if (ISO9660descriptorend)
+			{
+				TRACE ("descriptor[%d] has invalid Identifier (got '%c%c%c%c%c'), but ISO9660 has already terminated list, so should be OK\n", descriptor, buffer[1], buffer[2], buffer[3], buffer[4], buffer[5]);
+				descriptorend = 1;
+			} else {
+				TRACE ("descriptor[%d] has invalid Identifier (got '%c%c%c%c%c')\n", descriptor, buffer[1], buffer[2], buffer[3], buffer[4], buffer[5]);
+			}
+			retval = 1;
+			break;
+		}
+	}
+
+	if (disc->iso9660_session)
+	{
+		ISO9660_Sessions (disc);
+	}
+
+#ifdef CDFS_TRACE
+	trace_enabled = trace;
+#endif
+	return retval;
+}
+
+struct cdfs_t *cdfs_open (const char *path)
+{
+	struct cdfs_t *self;
+	struct ISO9660_session_t *session;
+
+	self = calloc (sizeof (*self), 1);
+	if (!self)
+	{
+		fprintf (stderr, "cdfs_open() calloc() failed\n");
+		return 0;
+	}
+
+	self->disc = cdfs_disc_open (path);
+	if (!self->disc)
+	{
+		free (self);
+		return 0;
+	}
+	cdfs_disc_scan (self->disc); /* errors late in the descriptor list are common, the index decides if the image is usable */
+
+	/* UDF is preferred on bridge discs, it has no limits on names and file sizes, and the ISO9660 tree is often only a stub */
+	self->udf = UDF_Index (self->disc);
+	if (self->udf)
+	{
+		self->tree = UDF_Index_Tree (self->udf);
+	} else {
+		for (session = self->disc->iso9660_session; session && session->Next; session = session->Next);
+		self->iso9660 = ISO9660_Index (self->disc, session);
+		if (self->iso9660)
+		{
+			self->tree = ISO9660_Index_Tree (self->iso9660);
+		}
+	}
+	if (!self->tree)
+	{
+		fprintf (stderr, "%s: no UDF or ISO9660 filesystem found\n", path);
+		cdfs_close (self);
+		return 0;
+	}
+
+	return self;
+}
+
+void cdfs_close (struct cdfs_t *self)
+{
+	if (!self)
+	{
+		return;
+	}
+	UDF_Index_Free (self->udf);
+	ISO9660_Index_Free (self->iso9660);
+	if (self->disc->iso9660_session)
+	{
+		ISO9660_Session_Free (&self->disc->iso9660_session);
+	}
+	if (self->disc->udf_session)
+	{
+		UDF_Session_Free (self->disc);
+	}
+	cdfs_disc_free (self->disc);
+	free (self);
+}
+
+static int cdfs_stat_ino (struct cdfs_t *self, uint32_t ino, struct cdfs_stat_t *st)
+{
+	struct DumpFS_index_node_t *node;
+
+	if (ino >= self->tree->nodes_count)
+	{
+		return -1;
+	}
+	node = &self->tree->nodes_data[ino];
+
+	memset (st, 0, sizeof (*st));
+	st->ino = ino;
+	switch (node->type)
+	{
+		case 'd':
+			st->mode = S_IFDIR | 0555;
+			st->nlink = 2 + node->subdirectories;
+			st->size = node->size;
+			break;
+		case 'l':
+		{
+			ssize_t length = cdfs_readlink (self, ino, 0, 0);
+			st->mode = S_IFLNK | 0777;
+			st->nlink = 1;
+			st->size = (length > 0) ? length : 0;
+			break;
+		}
+		default:
+			st->mode = S_IFREG | 0444;
+			st->nlink = 1;
+			st->size = node->size;
+			break;
+	}
+	return self->udf ? UDF_Index_Stat (self->udf, ino, st) : ISO9660_Index_Stat (self->iso9660, ino, st);
+}
+
+int cdfs_stat (struct cdfs_t *self, const char *path, struct cdfs_stat_t *st)
+{
+	int ino = DumpFS_index_lookup (self->tree, path);
+
+	if (ino < 0)
+	{
+		return -1;
+	}
+	return cdfs_stat_ino (self, ino, st);
+}
+
+struct cdfs_dir_t *cdfs_opendir (struct cdfs_t *self, const char *path)
+{
+	struct cdfs_dir_t *dir;
+	struct cdfs_stat_t st;
+
+	if (cdfs_stat (self, path, &st) || ((st.mode & S_IFMT) != S_IFDIR))
+	{
+		return 0;
+	}
+	dir = calloc (sizeof (*dir), 1);
+	if (!dir)
+	{
+		fprintf (stderr, "cdfs_opendir() calloc() failed\n");
+		return 0;
+	}
+	dir->self = self;
+	dir->ino = st.ino;
+	return dir;
+}
+
+const char *cdfs_readdir (struct cdfs_dir_t *dir, struct cdfs_stat_t *st)
+{
+	const char *name;
+	int ino = DumpFS_index_child (dir->self->tree, dir->ino, dir->next, &name);
+
+	if (ino < 0)
+	{
+		return 0;
+	}
+	dir->next++;
+	if (st)
+	{
+		cdfs_stat_ino (dir->self, ino, st);
+	}
+	return name;
+}
+
+void cdfs_closedir (struct cdfs_dir_t *dir)
+{
+	free (dir);
+}
+
+ssize_t cdfs_pread (struct cdfs_t *self, uint32_t ino, void *buffer, size_t count, uint64_t offset)
+{
+	return self->udf ? UDF_Index_Read (self->udf, ino, buffer, count, offset) : ISO9660_Index_Read (self->iso9660, ino, buffer, count, offset);
+}
+
+ssize_t cdfs_readlink (struct cdfs_t *self, uint32_t ino, char *buffer, size_t size)
+{
+	return self->udf ? UDF_Index_Readlink (self->udf, ino, buffer, size) : ISO9660_Index_Readlink (self->iso9660, ino, buffer, size);
+}
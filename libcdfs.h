@@ -0,0 +1,67 @@
+#ifndef LIBCDFS_H
+#define LIBCDFS_H
+
+/* Read-only access to the files on a disc image (.iso, .bin, .cue or .toc), for programs that want to embed the parser.
+ *
+ * The library does not print anything on stdout (the descriptor tracing in main.h is only compiled into dumpiso) and keeps no
+ * global state apart from lookup tables that are filled once through pthread_once(), so link with -pthread. Errors are reported
+ * as return values, with details on stderr. Each handle is independent, so several images can be open at the same time, also
+ * from different threads, but a single handle must not be used from several threads at once.
+ *
+ * The directory tree is indexed when the image is opened. The UDF filesystem is used if there is one (on bridge discs the ISO9660
+ * tree is often only a stub), else the last ISO9660 session, using RockRidge, Joliet or plain ISO9660 names in that order of
+ * preference. Lookups and directory listings after that only touch memory, file data is read on demand. If a directory holds the
+ * same name twice, only one of the entries is visible (a directory before a file before a symlink).
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+
+struct cdfs_t;
+struct cdfs_dir_t;
+
+struct cdfs_stat_t
+{
+	uint32_t ino;   /* can be passed to cdfs_pread() and cdfs_readlink() */
+	uint32_t mode;  /* S_IFDIR, S_IFREG or S_IFLNK + permissions */
+	uint32_t nlink;
+	uint32_t uid;
+	uint32_t gid;
+	uint64_t size;
+	int64_t  mtime; /* seconds since 1970-01-01 00:00:00 UTC */
+};
+
+/* Returns 0 if the image could not be opened, or contains neither a UDF nor an ISO9660 filesystem */
+struct cdfs_t *cdfs_open (const char *path);
+
+void cdfs_close (struct cdfs_t *self);
+
+/* path is relative to the root of the disc, leading and repeated slashes are ignored. Returns 0 on success, -1 if not found */
+int cdfs_stat (struct cdfs_t *self, const char *path, struct cdfs_stat_t *st);
+
+/* Returns 0 if path is not found or is not a directory */
+struct cdfs_dir_t *cdfs_opendir (struct cdfs_t *self, const char *path);
+
+/* Returns the name of the next entry (valid until cdfs_closedir()) and fills st if not 0, or returns 0 at the end. Entries are sorted by name */
+const char *cdfs_readdir (struct cdfs_dir_t *dir, struct cdfs_stat_t *st);
+
+void cdfs_closedir (struct cdfs_dir_t *dir);
+
+/* Reads up to count bytes from offset in the file ino. Returns the number of bytes read, 0 at end of file, or -1 on errors */
+ssize_t cdfs_pread (struct cdfs_t *self, uint32_t ino, void *buffer, size_t count, uint64_t offset);
+
+/* Stores the zero-terminated target of the symlink ino, truncated to size. Returns the length of the target, or -1 if ino is not a symlink */
+ssize_t cdfs_readlink (struct cdfs_t *self, uint32_t ino, char *buffer, size_t size);
+
+/* Lower level, used by dumpiso itself */
+
+struct cdfs_disc_t;
+
+/* Opens an image, .cue or .toc file and sets up the datasources and tracks. Returns 0 on errors */
+struct cdfs_disc_t *cdfs_disc_open (const char *path);
+
+/* Parses the volume descriptors at sector 16 and onwards, the UDF descriptors, and locates additional ISO9660 sessions. disc->trace
+ * selects the descriptor dump, in builds with CDFS_TRACE. Returns non-zero on errors */
+int cdfs_disc_scan (struct cdfs_disc_t *disc);
+
+#endif
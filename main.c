@@ -1,5 +1,6 @@
+#include <errno.h>
 #include <fcntl.h>
-#include <iconv.h>
+#include <getopt.h>
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -11,199 +12,180 @@
 
 #include "cdfs.h"
 #include "cue.h"
+#include "dumpfs.h"
 #include "iso9660.h"
+#include "libcdfs.h"
 #include "main.h"
-#include "toc.h"
 #include "udf.h"
 
-iconv_t UTF16BE_cd;
+int trace_enabled;
 
-static char *get_path(const char *sourcefile)
+static void list_iso9660_session (struct ISO9660_session_t *session, const char *name, struct DumpFS_sink_t *sink)
 {
-	char *lastslash = strrchr (sourcefile, '/');
-	char *retval;
-	if (!lastslash)
+	if (session->Primary_Volume_Description)
 	{
-		return strdup ("./");
+		TRACE ("ISO9660 vanilla\n");
+		DumpFS_dir_ISO9660 (session->Primary_Volume_Description, name, session->Primary_Volume_Description->root_dirent.Absolute_Location, sink);
 	}
-	retval = strdup (sourcefile);
-	retval[lastslash - sourcefile + 1] = 0;
-	return retval;
-}
-
-static int is_filename_cue (const char *filename)
-{
-	int len = strlen (filename);
-	if (len < 4)
+	if (session->Primary_Volume_Description && session->Primary_Volume_Description->RockRidge)
 	{
-		return 0;
+		TRACE ("ISO9660 RockRidge\n");
+		DumpFS_dir_RockRidge (session->Primary_Volume_Description, name, session->Primary_Volume_Description->root_dirent.Absolute_Location, sink);
 	}
-
-	if (!strcasecmp (filename + len - 4, ".cue"))
+	if (session->Supplementary_Volume_Description && session->Supplementary_Volume_Description->UTF16)
 	{
-		return 1;
+		TRACE ("ISO9660 Joliet\n");
+		DumpFS_dir_Joliet (session->Supplementary_Volume_Description, name, session->Supplementary_Volume_Description->root_dirent.Absolute_Location, sink);
 	}
-
-	return 0;
 }
 
-static int is_filename_toc (const char *filename)
+/* Accepts "YYYY-MM-DD", "YYYY-MM-DD HH:MM:SS" (UTC, a T separator also works) or @SECONDS since the UNIX epoch. Returns non-zero on errors */
+static int parse_timestamp (const char *text, int64_t *timestamp)
 {
-	int len = strlen (filename);
-	if (len < 4)
+	static const int days[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	int year, month, day, hour = 0, minute = 0, second = 0;
+	int length = 0;
+
+	if (text[0] == '@')
 	{
-		return 0;
+		char *end;
+		errno = 0;
+		*timestamp = strtoll (text + 1, &end, 10);
+		return (end == (text + 1)) || *end || errno;
 	}
-
-	if (!strcasecmp (filename + len - 4, ".toc"))
+	if (sscanf (text, "%d-%d-%d%n", &year, &month, &day, &length) != 3)
 	{
-		return 1;
+		return -1;
 	}
-
+	text += length;
+	if (*text && (((*text != ' ') && (*text != 'T')) || (sscanf (text + 1, "%d:%d:%d%n", &hour, &minute, &second, &length) != 3) || text[1 + length]))
+	{
+		return -1;
+	}
+	/* out of range fields would silently be normalized into a different date */
+	if ((year < 1) || (year > 9999) || (month < 1) || (month > 12) || (day < 1) || (day > days[month - 1]) ||
+	    ((month == 2) && (day == 29) && ((year % 4) || ((!(year % 100)) && (year % 400)))) ||
+	    (hour < 0) || (hour > 23) || (minute < 0) || (minute > 59) || (second < 0) || (second > 59))
+	{
+		return -1;
+	}
+	*timestamp = DumpFS_time (year, month, day, hour, minute, second, 0);
 	return 0;
 }
 
 int main(int argc, char *argv[])
 {
-	uint32_t            isofile_sectorcount = 0;
-	int                 isofile_fd = -1;
-	//const char       *isofile_filename,
-	enum cdfs_format_t  isofile_format = 0;
-
 	struct cdfs_disc_t *disc;
-
-	struct stat st;
-
-	int descriptor = 0;
-	int descriptorend = 0;
-	int ISO9660descriptorend = 0 ;
-	uint8_t buffer[SECTORSIZE];
 	int retval = 0;
 
-	UTF16BE_cd = iconv_open ("UTF-8", "UTF-16BE");
-	if (UTF16BE_cd == ((iconv_t) -1))
+	enum DumpFS_format_t  output_format = 0;
+	int                   output_fd = -1;
+	struct DumpFS_sink_t *sink = 0;
+	const char           *boot_directory = 0;
+	const char           *extract_directory = 0;
+	const char           *udf_directory = 0;
+	int64_t               udf_timestamp = 0;
+	int                   udf_has_timestamp = 0;
+	int                   udf_spacecheck = 0;
+	const char           *convert_filename = 0;
+	int                   verify_edc = 0;
+	const char           *raw_filename = 0;
+	int                   raw_mode = 1;
+
+	static const struct option long_options[] =
 	{
-		perror ("iconv_open()");
-		return 1;
-	}
-
-	if (argc != 2)
+		{"jsonl",        no_argument,       0, 'j'},
+		{"null",         no_argument,       0, '0'},
+		{"quiet",        no_argument,       0, 'q'},
+		{"extract-boot", required_argument, 0, 'b'},
+		{"extract",      required_argument, 0, 'x'},
+		{"extract-udf",  required_argument, 0, 'u'},
+		{"at-timestamp", required_argument, 0, 't'},
+		{"check-space",  no_argument,       0, 's'},
+		{"convert",      required_argument, 0, 'c'},
+		{"verify-edc",   no_argument,       0, 'e'},
+		{"raw",          required_argument, 0, 'r'},
+		{"mode2",        no_argument,       0, '2'},
+		{0,              0,                 0, 0}
+	};
+	int c;
+
+	trace_enabled = 1;
+
+	while ((c = getopt_long (argc, argv, "j0qb:x:u:t:sc:er:2", long_options, 0)) != -1)
 	{
-		fprintf (stderr, "Usage:\n%s <file.iso file.bin>\n%s <file.toc>\n%s <file.toc>\n", argv[0], argv[0], argv[0]);
-		iconv_close (UTF16BE_cd);
-		return 1;
+		switch (c)
+		{
+			case 'j': output_format = DUMPFS_FORMAT_JSONL; break;
+			case '0': output_format = DUMPFS_FORMAT_NUL; break;
+			case 'q': trace_enabled = 0; break;
+			case 'b': boot_directory = optarg; break;
+			case 'x': extract_directory = optarg; break;
+			case 'u': udf_directory = optarg; break;
+			case 't':
+				if (parse_timestamp (optarg, &udf_timestamp))
+				{
+					fprintf (stderr, "Invalid timestamp \"%s\"\n", optarg);
+					argc = 0;
+				}
+				udf_has_timestamp = 1;
+				break;
+			case 's': udf_spacecheck = 1; break;
+			case 'c': convert_filename = optarg; break;
+			case 'e': verify_edc = 1; break;
+			case 'r': raw_filename = optarg; break;
+			case '2': raw_mode = 2; break;
+			default: argc = 0; break;
+		}
 	}
 
-	isofile_fd = open (argv[1], O_RDONLY);
-
-	if (isofile_fd < 0)
-	{
-		perror ("open(argv[1]");
-		iconv_close (UTF16BE_cd);
-		return 1;
-	}
-	if (fstat (isofile_fd, &st))
+	if ((argc - optind) != 1)
 	{
-		perror ("fstat(argv[1]");
-		close (isofile_fd);
-		iconv_close (UTF16BE_cd);
+		fprintf (stderr, "Usage:\n%s [options] <file.iso file.bin>\n%s [options] <file.cue>\n%s [options] <file.toc>\n"
+		                 "Options:\n"
+		                 " -j, --jsonl  list files as JSON Lines on stdout, all other output goes to stderr\n"
+		                 " -0, --null   list files as NUL terminated fields on stdout, all other output goes to stderr\n"
+		                 " -q, --quiet  do not dump the descriptors, only list the files\n"
+		                 " -b, --extract-boot DIR  write the El Torito boot images into DIR\n"
+		                 " -x, --extract DIR       write the files of the last ISO9660 session into DIR\n"
+		                 " -u, --extract-udf DIR   write the files of the UDF filesystem into DIR\n"
+		                 " -t, --at-timestamp TIME show rewritten UDF files and directories as they were at TIME, \"YYYY-MM-DD[ HH:MM:SS]\" UTC or @SECONDS\n"
+		                 " -s, --check-space       check the UDF space bitmaps against the blocks used by the file tree\n"
+		                 " -c, --convert FILE      write the data tracks as a plain 2048 byte sector ISO image\n"
+		                 " -e, --verify-edc        check the EDC of raw sectors while converting\n"
+		                 " -r, --raw FILE.bin      write the data tracks as raw 2352 byte MODE1 sectors, plus FILE.cue and FILE.toc\n"
+		                 " -2, --mode2             use MODE2 XA Form 1 sectors for --raw\n", argv[0], argv[0], argv[0]);
 		return 1;
 	}
+	argv += optind - 1;
 
-	if (is_filename_cue (argv[1]))
-	{
-		struct cue_parser_t *cue = cue_parser_from_fd (isofile_fd);
-		char *argv1_path;
-
-		close (isofile_fd);
-		isofile_fd = -1;
-		if (!cue)
-		{
-			iconv_close (UTF16BE_cd);
-			return 1;
-		}
-
-		argv1_path = get_path (argv[1]);
-		disc = cue_parser_to_cdfs_disc (argv1_path, cue);
-		free (argv1_path);
-		cue_parser_free (cue);
-		if (!disc)
-		{
-			iconv_close (UTF16BE_cd);
-			return 1;
-		}
-	} else if (is_filename_toc (argv[1]))
-	{
-		struct toc_parser_t *toc = toc_parser_from_fd (isofile_fd);
-		char *argv1_path;
-
-		close (isofile_fd);
-		isofile_fd = -1;
-		if (!toc)
-		{
-			iconv_close (UTF16BE_cd);
-			return 1;
-		}
-
-		argv1_path = get_path (argv[1]);
-		disc = toc_parser_to_cdfs_disc (argv1_path, toc);
-		free (argv1_path);
-		toc_parser_free (toc);
-		if (!disc)
+	if (output_format)
+	{ /* stdout is reserved for the records */
+		fflush (stdout);
+		output_fd = dup (1);
+		if ((output_fd < 0) || (dup2 (2, 1) < 0))
 		{
-			iconv_close (UTF16BE_cd);
+			perror ("dup()");
 			return 1;
 		}
-	} else {
-		disc = calloc (sizeof (*disc), 1);
-
-		if (detect_isofile_sectorformat (isofile_fd, argv[1], st.st_size, &isofile_format, &isofile_sectorcount))
+		sink = DumpFS_sink_open (output_fd, output_format);
+		if (!sink)
 		{
-			fprintf (stderr, "Unable to detect ISOFILE sector format\n");
-			close (isofile_fd);
-			iconv_close (UTF16BE_cd);
 			return 1;
 		}
+	}
 
-		cdfs_disc_datasource_append (disc,
-		                             0,                   /* sectoroffset */
-		                             isofile_sectorcount,
-		                             isofile_fd,
-		                             argv[1],             /* filename */
-		                             isofile_format,
-		                             0,                   /* offset */
-		                             st.st_size);         /* length */
-
-		/* track 00 */
-		cdfs_disc_track_append (disc,
-		                        0,  /* pregap */
-		                        0,  /* offset */
-		                        0,  /* sectorcount */
-		                        0,  /* title */
-		                        0,  /* performer */
-		                        0,  /* songwriter */
-		                        0,  /* composer */
-		                        0,  /* arranger */
-		                        0); /* message */
-
-		/* track 01 */
-		cdfs_disc_track_append (disc,
-		                        0,  /* pregap */
-		                        0,  /* offset */
-		                        disc->datasources_data[0].sectorcount,
-		                        0,  /* title */
-		                        0,  /* performer */
-		                        0,  /* songwriter */
-		                        0,  /* composer */
-		                        0,  /* arranger */
-		                        0); /* message */
+	disc = cdfs_disc_open (argv[1]);
+	if (!disc)
+	{
+		return 1;
 	}
 
 	{
 		int i;
 		for (i=0; i < disc->datasources_count; i++)
 		{
-			printf ("DISC-SOURCE.%d first:%d last:%d (length=%d) zerofill=%d\n",
+			TRACE ("DISC-SOURCE.%d first:%d last:%d (length=%d) zerofill=%d\n",
 				i,
 				disc->datasources_data[i].sectoroffset,
 				disc->datasources_data[i].sectoroffset + disc->datasources_data[i].sectorcount - 1,
@@ -212,139 +194,112 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	while (!descriptorend)
+	disc->trace = trace_enabled;
+	disc->udf_has_timestamp = udf_has_timestamp;
+	disc->udf_timestamp = udf_timestamp;
+	disc->udf_spacecheck = udf_spacecheck;
+	retval = cdfs_disc_scan (disc);
+
+	if (disc->iso9660_session)
 	{
-		uint32_t sector = 16 + descriptor;
+		ISO9660_SystemArea (disc);
+	}
 
-		if (get_absolute_sector_2048 (disc, sector, buffer))
+	if (!sink)
+	{ /* the text listings are printed even when quiet */
+		trace_enabled = 1;
+	}
+
+	if (disc->iso9660_session)
+	{
+		if (boot_directory && ElTorito_Extract (disc, boot_directory))
 		{
 			retval = 1;
-			break;
 		}
+		struct ISO9660_session_t *session;
+		int sessionnumber = 2;
 
-		descriptor++; /* descriptor are 1, not zero based... for the user */
+		list_iso9660_session (disc->iso9660_session, ".", sink);
 
-		if ((buffer[1] == 'B') &&
-		    (buffer[2] == 'E') &&
-		    (buffer[3] == 'A') &&
-		    (buffer[4] == '0') &&
-		    (buffer[5] == '1'))
-		{
-			printf ("descriptor[%d] Beginning Extended Area Descriptor (just a marker)\n", descriptor);
-			continue;
-		}
+		for (session = disc->iso9660_session->Next; session; session = session->Next, sessionnumber++)
+		{ /* files in later sessions are listed as sessionN/... */
+			char name[32];
 
-		if ((buffer[1] == 'T') &&
-		    (buffer[2] == 'E') &&
-		    (buffer[3] == 'A') &&
-		    (buffer[4] == '0') &&
-		    (buffer[5] == '1'))
-		{
-			printf ("descriptor[%d] Terminating Extended Area Descriptor (just a marker)\n", descriptor);
-			descriptorend = 1;
-			break;
-		}
+			TRACE ("ISO9660 session %d, changes since session %d\n", sessionnumber, sessionnumber - 1);
+			ISO9660_Session_Delta (session);
 
-		if ((buffer[1] == 'B') &&
-		    (buffer[2] == 'O') &&
-		    (buffer[3] == 'O') &&
-		    (buffer[4] == 'T') &&
-		    (buffer[5] == '2'))
-		{
-#warning TODO ECMA 168 BOOT
-			printf ("descriptor[%d] ECMA 167/168 Boot Descriptor\n", descriptor);
-			continue;
+			snprintf (name, sizeof (name), "session%d", sessionnumber);
+			list_iso9660_session (session, name, sink);
 		}
 
-		if ((buffer[1] == 'C') &&
-		    (buffer[2] == 'D') &&
-		    (buffer[3] == 'W') &&
-		    (buffer[4] == '0') &&
-		    (buffer[5] == '2'))
-		{
-#warning TODO ECMA 168
-			printf ("descriptor[%d] ISO/IEC 13490 / ECMA 168 Descriptor\n", descriptor);
-			continue;
+		if (extract_directory)
+		{ /* the last session holds the most recent version of the tree */
+			for (session = disc->iso9660_session; session->Next; session = session->Next);
+			if (ISO9660_Extract (disc, session, extract_directory))
+			{
+				retval = 1;
+			}
 		}
 
-		if ((buffer[1] == 'N') &&
-		    (buffer[2] == 'S') &&
-		    (buffer[3] == 'R') &&
-		    (buffer[4] == '0') &&
-		    (buffer[5] == '2'))
-		{
-			printf ("descriptor[%d] ISO/IEC 13346:1995 / ECMA 167 2nd edition / UDF Descriptor\n", descriptor);
-			UDF_Descriptor (disc);
-			continue;
-		}
+		ISO9660_Session_Free (&disc->iso9660_session);
+	} else if (extract_directory)
+	{
+		fprintf (stderr, "No ISO9660 filesystem found, nothing to extract\n");
+		retval = 1;
+	}
 
-		if ((buffer[1] == 'N') &&
-		    (buffer[2] == 'S') &&
-		    (buffer[3] == 'R') &&
-		    (buffer[4] == '0') &&
-		    (buffer[5] == '3'))
+	if (disc->udf_session)
+	{
+		DumpFS_UDF (disc, sink);
+		if (udf_directory && UDF_Extract (disc, udf_directory))
 		{
-			printf ("descriptor[%d] ECMA 167 3rd edition / UDF Descriptor\n", descriptor);
-			UDF_Descriptor (disc);
-			continue;
+			retval = 1;
 		}
+		UDF_Session_Free (disc);
+	} else if (udf_directory)
+	{
+		fprintf (stderr, "No UDF filesystem found, nothing to extract\n");
+		retval = 1;
+	}
 
-
-		if ((buffer[1] =='C') ||
-		    (buffer[2] =='D') ||
-		    (buffer[3] =='0') ||
-		    (buffer[4] =='0') ||
-		    (buffer[5] =='1'))
+	if (convert_filename && cdfs_disc_is_source (disc, convert_filename))
+	{
+		fprintf (stderr, "%s: refusing to overwrite an input file of the disc\n", convert_filename);
+		retval = 1;
+	} else if (convert_filename)
+	{
+		int fd = open (convert_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
 		{
-			printf ("descriptor[%d] ISO 9660 / ECMA 119 Descriptor\n", descriptor);
-			if (ISO9660descriptorend)
+			perror ("open(convert_filename)");
+			retval = 1;
+		} else {
+			if (cdfs_disc_convert (disc, fd, verify_edc))
 			{
-				printf ("WARNING - this is unepected, CD001 parsing should be complete\n");
+				retval = 1;
 			}
-			ISO9660_Descriptor (disc, buffer, sector, descriptor, &ISO9660descriptorend);
-			continue;
-		} else {
-			if (ISO9660descriptorend)
+			if (close (fd))
 			{
-				printf ("descriptor[%d] has invalid Identifier (got '%c%c%c%c%c'), but ISO9660 has already terminated list, so should be OK\n", descriptor, buffer[1], buffer[2], buffer[3], buffer[4], buffer[5]);
-				descriptorend = 1;
-			} else {
-				printf ("descriptor[%d] has invalid Identifier (got '%c%c%c%c%c')\n", descriptor, buffer[1], buffer[2], buffer[3], buffer[4], buffer[5]);
+				perror ("close(convert_filename)");
+				retval = 1;
 			}
-			retval = 1;
-			break;
 		}
 	}
 
-	if (disc->iso9660_session)
+	if (raw_filename && cdfs_disc_write_raw (disc, raw_filename, raw_mode))
 	{
-		if (disc->iso9660_session->Primary_Volume_Description)
-		{
-			printf ("ISO9660 vanilla\n");
-			DumpFS_dir_ISO9660 (disc->iso9660_session->Primary_Volume_Description, ".", disc->iso9660_session->Primary_Volume_Description->root_dirent.Absolute_Location);
-		}
-		if (disc->iso9660_session->Primary_Volume_Description && disc->iso9660_session->Primary_Volume_Description->RockRidge)
-		{
-			printf ("ISO9660 RockRidge\n");
-			DumpFS_dir_RockRidge (disc->iso9660_session->Primary_Volume_Description, ".", disc->iso9660_session->Primary_Volume_Description->root_dirent.Absolute_Location);
-		}
-		if (disc->iso9660_session->Supplementary_Volume_Description && disc->iso9660_session->Supplementary_Volume_Description->UTF16)
-		{
-			printf ("ISO9660 Joliet\n");
-			DumpFS_dir_Joliet (disc->iso9660_session->Supplementary_Volume_Description, ".", disc->iso9660_session->Supplementary_Volume_Description->root_dirent.Absolute_Location);
-		}
-
-		ISO9660_Session_Free (&disc->iso9660_session);
+		retval = 1;
 	}
 
-	if (disc->udf_session)
+	if (sink)
 	{
-		DumpFS_UDF (disc);
-		UDF_Session_Free (disc);
+		if (DumpFS_sink_close (sink))
+		{
+			retval = 1;
+		}
+		close (output_fd);
 	}
 
-	iconv_close (UTF16BE_cd);
-
 	cdfs_disc_free (disc);
 
 	return retval;
@@ -1,8 +1,33 @@
 #ifndef _MAIN_H
 #define _MAIN_H
 
-#include <iconv.h>
+#include <stdio.h>
 
-extern iconv_t UTF16BE_cd;
+/* Descriptor tracing on stdout. The decoders print through these instead of
+ * printf(), putchar() and fwrite(). Everything else (errors on stderr, the
+ * cue/toc files written by cdfs_disc_write_raw()) uses stdio directly.
+ *
+ * Only dumpiso is built with CDFS_TRACE (the *-trace.o objects in the
+ * Makefile). There the output follows trace_enabled, so that --quiet skips the
+ * formatting work entirely instead of just hiding it, and cdfs_disc_scan()
+ * sets it from disc->trace while it runs. In libcdfs.a the tracing is compiled
+ * out, the arguments are still type-checked but never evaluated, and the
+ * library has no trace state at all.
+ */
+#ifdef CDFS_TRACE
+
+extern int trace_enabled;
+
+#define TRACE(...)                ((void)(trace_enabled && printf (__VA_ARGS__)))
+#define TRACE_PUTCHAR(c)          ((void)(trace_enabled && putchar (c)))
+#define TRACE_FWRITE(p, s, n, f)  ((void)(trace_enabled && fwrite (p, s, n, f)))
+
+#else
+
+#define TRACE(...)                ((void)(0 && printf (__VA_ARGS__)))
+#define TRACE_PUTCHAR(c)          ((void)(0 && putchar (c)))
+#define TRACE_FWRITE(p, s, n, f)  ((void)(0 && fwrite (p, s, n, f)))
+
+#endif
 
 #endif
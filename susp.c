@@ -40,7 +40,7 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 		if ((self->XA1) && (len >= 14))
 		{
 /*
-			printf ("(DEBUG) %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x\n",
+			TRACE ("(DEBUG) %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x\n",
 				buffer[ 0], buffer[ 1], buffer[ 2], buffer[ 3],
 				buffer[ 4], buffer[ 5], buffer[ 6], buffer[ 7],
 				buffer[ 8], buffer[ 9], buffer[10], buffer[11],
@@ -48,27 +48,27 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 */
 			if ((buffer[6] == 'X') && (buffer[7] == 'A') && (buffer[9] == 0))
 			{
-				printf ("      XA1\n");
+				TRACE ("      XA1\n");
 				de->XA = 1;
 				de->XA_GID = decode_uint16_msb (buffer + 0, "       GID");
 				de->XA_UID = decode_uint16_msb (buffer + 2, "       UID");
 				de->XA_attr = decode_uint16_msb (buffer + 4, "       attr");
-				if (de->XA_attr & XA_ATTR__OWNER_READ)  printf ("        r"); /* owner read */
-				printf ("-");
-				if (de->XA_attr & XA_ATTR__OWNER_EXEC)  printf (        "x"); /* owner exec */
-				if (de->XA_attr & XA_ATTR__GROUP_READ)  printf (        "r"); /* group read */
-				printf ("-");
-				if (de->XA_attr & XA_ATTR__GROUP_EXEC)  printf (        "x"); /* group exec */
-				if (de->XA_attr & XA_ATTR__OTHER_READ)  printf (        "r"); /* other read */
-				printf ("-");
-				if (de->XA_attr & XA_ATTR__OTHER_EXEC)  printf (        "x"); /* other exec */
-				if (de->XA_attr & XA_ATTR__MODE2_FORM1) printf (" MODE2-FORM1-DATA/2048");
-				if (de->XA_attr & XA_ATTR__MODE2_FORM2) printf (" MODE2-FORM2-DATA/2324"); /* A regular 2048 sector format ISO file can not contain this */
-				if (de->XA_attr & XA_ATTR__INTERLEAVED) printf (" INTERLEAVED-DATA/AUDIO"); /* A regular 2048 sector format ISO file can not contain this */
-				if (de->XA_attr & XA_ATTR__CDDA)        printf (" CDDA"); /* AUDIO */ /* A regular 2048 sector format ISO file can not contain this */
-				if (de->XA_attr & XA_ATTR__DIR)         printf (" DIR");
-				printf ("\n");
-				printf ("       FileNumber: %d\n", buffer[8]);
+				if (de->XA_attr & XA_ATTR__OWNER_READ)  TRACE ("        r"); /* owner read */
+				TRACE ("-");
+				if (de->XA_attr & XA_ATTR__OWNER_EXEC)  TRACE (        "x"); /* owner exec */
+				if (de->XA_attr & XA_ATTR__GROUP_READ)  TRACE (        "r"); /* group read */
+				TRACE ("-");
+				if (de->XA_attr & XA_ATTR__GROUP_EXEC)  TRACE (        "x"); /* group exec */
+				if (de->XA_attr & XA_ATTR__OTHER_READ)  TRACE (        "r"); /* other read */
+				TRACE ("-");
+				if (de->XA_attr & XA_ATTR__OTHER_EXEC)  TRACE (        "x"); /* other exec */
+				if (de->XA_attr & XA_ATTR__MODE2_FORM1) TRACE (" MODE2-FORM1-DATA/2048");
+				if (de->XA_attr & XA_ATTR__MODE2_FORM2) TRACE (" MODE2-FORM2-DATA/2324"); /* A regular 2048 sector format ISO file can not contain this */
+				if (de->XA_attr & XA_ATTR__INTERLEAVED) TRACE (" INTERLEAVED-DATA/AUDIO"); /* A regular 2048 sector format ISO file can not contain this */
+				if (de->XA_attr & XA_ATTR__CDDA)        TRACE (" CDDA"); /* AUDIO */ /* A regular 2048 sector format ISO file can not contain this */
+				if (de->XA_attr & XA_ATTR__DIR)         TRACE (" DIR");
+				TRACE ("\n");
+				TRACE ("       FileNumber: %d\n", buffer[8]);
 			}
 		}
 
@@ -83,7 +83,7 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 
 	if ((*loopcount) > 1000)
 	{
-		printf ("WARNING - decode_susp recursion limit reached\n");
+		TRACE ("WARNING - decode_susp recursion limit reached\n");
 		return -1;
 	}
 
@@ -93,31 +93,31 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 		int i;
 		if (buffer[2] < 4)
 		{
-			printf ("WARNING - invalid length for entry\n");
+			TRACE ("WARNING - invalid length for entry\n");
 			return -1;
 		}
 		if (buffer[2] > len)
 		{
-			printf ("WARNING - overflow parsing entry\n");
+			TRACE ("WARNING - overflow parsing entry\n");
 			return -1;
 		}
-		printf ("      %c%c version %d  ", buffer[0], buffer[1], buffer[3]);
+		TRACE ("      %c%c version %d  ", buffer[0], buffer[1], buffer[3]);
 		for (i=4; i < buffer[2]; i++)
 		{
-			printf (" 0x%02" PRIx8, buffer[i]);
+			TRACE (" 0x%02" PRIx8, buffer[i]);
 		}
-		putchar ('\n');
+		TRACE_PUTCHAR ('\n');
 
 		if (((buffer[0] != 'S') || (buffer[1] != 'P')) && ((SP_precount==0)) && isrootnode)
 		{
-			printf ("WARNING - first entry in the rootnode should have been a SP node\n");
+			TRACE ("WARNING - first entry in the rootnode should have been a SP node\n");
 		}
 
 		if ((buffer[0] == 'C') && (buffer[1] == 'E'))
 		{
 			if (CE_count)
 			{
-				printf ("WARNING - multiple CE entries in the same block is not allowed\n");
+				TRACE ("WARNING - multiple CE entries in the same block is not allowed\n");
 			}
 			decode_susp_CE (disc, self, de, buffer, isrootnode, loopcount);
 			CE_count++;
@@ -126,11 +126,11 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 		{
 			if (!isrootnode)
 			{
-				printf ("WARNING - only rootnode is allowed to contain SP\n");
+				TRACE ("WARNING - only rootnode is allowed to contain SP\n");
 			} else {
 				if (SP_precount)
 				{
-					printf ("WARNING - SP should be the first entry (in the rootnode)\n");
+					TRACE ("WARNING - SP should be the first entry (in the rootnode)\n");
 				}
 				decode_susp_SP (self, buffer);
 			}
@@ -142,7 +142,7 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 		{
 			if (!isrootnode)
 			{
-				printf ("WARNING - only rootnode is allowed to contain ER\n");
+				TRACE ("WARNING - only rootnode is allowed to contain ER\n");
 			} else {
 				decode_susp_ER (self, buffer);
 			}
@@ -150,7 +150,7 @@ static int decode_susp (struct cdfs_disc_t *disc, struct Volume_Description_t *s
 		{
 			if (!isrootnode)
 			{
-				printf ("WARNING - only rootnode is allowed to contain ER\n");
+				TRACE ("WARNING - only rootnode is allowed to contain ER\n");
 			} else {
 				decode_susp_ES (self, buffer);
 			}
@@ -185,15 +185,15 @@ static void decode_susp_CE (struct cdfs_disc_t *disc, struct Volume_Description_
 
 	uint8_t newbuffer[SECTORSIZE];
 
-	printf ("       Continuation Area:\n");
+	TRACE ("       Continuation Area:\n");
 	if (buffer[2] != 28)
 	{
-		printf ("WARNING - Length is wrong\n");
+		TRACE ("WARNING - Length is wrong\n");
 		return;
 	}
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
 	BlockLocation = decode_uint32_both (buffer + 4, "        BlockLocation");
@@ -201,7 +201,7 @@ static void decode_susp_CE (struct cdfs_disc_t *disc, struct Volume_Description_
 	Length = decode_uint32_both (buffer + 20, "        Length");
 	if (Offset > SECTORSIZE)
 	{
-		printf ("WARNING - Offset is > SECTORSIZE\n");
+		TRACE ("WARNING - Offset is > SECTORSIZE\n");
 		return;
 	}
 	if (Length == 0)
@@ -210,7 +210,7 @@ static void decode_susp_CE (struct cdfs_disc_t *disc, struct Volume_Description_
 	}
 	if ((Length > SECTORSIZE) || (Offset + Length > SECTORSIZE))
 	{
-		printf ("WARNING - Length+Offset is > SECTORSIZE\n");
+		TRACE ("WARNING - Length+Offset is > SECTORSIZE\n");
 		return;
 	}
 
@@ -224,10 +224,10 @@ static void decode_susp_CE (struct cdfs_disc_t *disc, struct Volume_Description_
 
 static void decode_susp_PD (uint8_t *buffer)
 {
-	printf ("       Padding:\n");
+	TRACE ("       Padding:\n");
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
 	/* no-op */
@@ -235,26 +235,26 @@ static void decode_susp_PD (uint8_t *buffer)
 
 static void decode_susp_SP (struct Volume_Description_t *self, uint8_t *buffer)
 {
-	printf ("       system use Sharing Protocol:\n");
+	TRACE ("       system use Sharing Protocol:\n");
 	if (buffer[2] != 7)
 	{
-		printf ("WARNING - Length is wrong\n");
+		TRACE ("WARNING - Length is wrong\n");
 		return;
 	}
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
 	if (buffer[4] != 0xbe)
 	{
-		printf ("WARNING - CheckByte1 is wrong\n");
+		TRACE ("WARNING - CheckByte1 is wrong\n");
 	}
 	if (buffer[5] != 0xef)
 	{
-		printf ("WARNING - CheckByte2 is wrong\n");
+		TRACE ("WARNING - CheckByte2 is wrong\n");
 	}
-	printf ("        Skip Bytes per record: %" PRId8 "\n", buffer[6]);
+	TRACE ("        Skip Bytes per record: %" PRId8 "\n", buffer[6]);
 	self->SystemUse_Skip = buffer[6];
 
 	return;
@@ -262,15 +262,15 @@ static void decode_susp_SP (struct Volume_Description_t *self, uint8_t *buffer)
 
 static void decode_susp_ST (struct Volume_Description_t *self, uint8_t *buffer)
 {
-	printf ("       SUSP Terminator:\n");
+	TRACE ("       SUSP Terminator:\n");
 	if (buffer[2] != 4)
 	{
-		printf ("WARNING - Length is wrong\n");
+		TRACE ("WARNING - Length is wrong\n");
 		return;
 	}
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
 	/* parent handles us */
@@ -280,62 +280,62 @@ static void decode_susp_ST (struct Volume_Description_t *self, uint8_t *buffer)
 static void decode_susp_ER (struct Volume_Description_t *self, uint8_t *buffer)
 {
 	int i;
-	printf ("       Extension Record\n");
+	TRACE ("       Extension Record\n");
 	if (buffer[2] < 8)
 	{
-		printf ("WARNING - Length is way too short\n");
+		TRACE ("WARNING - Length is way too short\n");
 		return;
 	}
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
 	if ((8 + buffer[4] + buffer[5] + buffer[6]) > buffer[2])
 	{
-		printf ("WARNING - Length is too short\n");
+		TRACE ("WARNING - Length is too short\n");
 		return;
 	} else if ((8 + buffer[4] + buffer[5] + buffer[6]) < buffer[2])
 	{
-		printf ("WARNING - Length is too long\n");
+		TRACE ("WARNING - Length is too long\n");
 	}
 
-	printf ("        Identifier: \"");
+	TRACE ("        Identifier: \"");
 	for (i=0; i < buffer[4]; i++)
 	{
-		putchar (buffer[8 + i]);
+		TRACE_PUTCHAR (buffer[8 + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("        Descriptor: \"");
+	TRACE ("        Descriptor: \"");
 	for (i=0; i < buffer[5]; i++)
 	{
-		putchar (buffer[8 + buffer[4] + i]);
+		TRACE_PUTCHAR (buffer[8 + buffer[4] + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("        Source: \"");
+	TRACE ("        Source: \"");
 	for (i=0; i < buffer[6]; i++)
 	{
-		putchar (buffer[8 + buffer[4] + buffer[5] + i]);
+		TRACE_PUTCHAR (buffer[8 + buffer[4] + buffer[5] + i]);
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
-	printf ("        Version: %" PRId8 "\n", buffer[7]);
+	TRACE ("        Version: %" PRId8 "\n", buffer[7]);
 }
 
 static void decode_susp_ES (struct Volume_Description_t *self, uint8_t *buffer)
 {
-	printf ("       Extension Sequence\n");
+	TRACE ("       Extension Sequence\n");
 	if (buffer[2] < 5)
 	{
-		printf ("WARNING - Length is wrong\n");
+		TRACE ("WARNING - Length is wrong\n");
 		return;
 	}
 	if (buffer[3] != 1)
 	{
-		printf ("WARNING - Version is wrong\n");
+		TRACE ("WARNING - Version is wrong\n");
 		return;
 	}
-	printf ("        Sequence: %" PRId8 "\n", buffer[4]);
+	TRACE ("        Sequence: %" PRId8 "\n", buffer[4]);
 }
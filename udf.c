@@ -1,13 +1,20 @@
 #include <assert.h>
 #include <ctype.h>
-#include <iconv.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include <time.h>
+#include <unistd.h>
 #include "cdfs.h"
+#include "dumpfs.h"
+#include "libcdfs.h"
 #include "main.h"
 #include "udf.h"
 
@@ -44,12 +51,18 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 static void ExtendedAttributesInline (int n, uint8_t *buffer, uint32_t ExtentLocation, uint32_t ExtentLength, int isfile, struct UDF_FileEntry_t *extendedattributes_target);
 static void ExtendedAttributes (int n, struct cdfs_disc_t *disc, struct UDF_longad *L, int isfile, struct UDF_FileEntry_t *extendedattributes_target);
 
+static int64_t DumpFS_UDF_time (uint8_t buffer[12]);
+
+static void UDF_Directory_Free (struct UDF_FS_DirectoryEntry_t *Directory);
+
+static void UDF_SpaceCheck (int n, struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir);
+
 static void N(int n)
 {
 	int i;
 	for (i=0; i < n; i++)
 	{
-		putchar (' ');
+		TRACE_PUTCHAR (' ');
 	}
 }
 
@@ -87,20 +100,20 @@ static void print_1_7_2_1 (uint8_t buffer[64]) //Character Set Type (RBP 0)
 	int i;
 	switch (buffer[0])
 	{
-		case 0x00: printf ("CS0 <="); break; // any character set
-		case 0x01: printf ("CS1 <="); break; // the whole or any subset of the graphic characters specified by ECMA-6
-		case 0x02: printf ("CS2 <="); break; // 38 graphical characters + standard from ECMA 119 Volume Descriptor
-		case 0x03: printf ("CS3 <="); break; // the 63 graphic characters of the portable ISO/IEC 9945-1 file name set
-		case 0x04: printf ("CS4 <="); break; // the 95 graphic characters of the International Reference Version of ECMA-6
-		case 0x05: printf ("CS5 <="); break; // the 191 graphic characters of ECMA-94, Latin Alphabet No. 1
-		case 0x06: printf ("CS6 <="); break; // a set of graphic characters that may be identified by ECMA-35 and ECMA-48
-		case 0x07: printf ("CS7 <="); break; // a set of graphic characters that may be identified by ECMA-35 and ECMA-48 and, optionally, code extension characters using ECMA-35 and ECMA-48
-		case 0x08: printf ("CS8 <="); break; // a set of 53 graphic characters that are highly portable to most personal computers
-		default:   printf ("??? <="); break;
+		case 0x00: TRACE ("CS0 <="); break; // any character set
+		case 0x01: TRACE ("CS1 <="); break; // the whole or any subset of the graphic characters specified by ECMA-6
+		case 0x02: TRACE ("CS2 <="); break; // 38 graphical characters + standard from ECMA 119 Volume Descriptor
+		case 0x03: TRACE ("CS3 <="); break; // the 63 graphic characters of the portable ISO/IEC 9945-1 file name set
+		case 0x04: TRACE ("CS4 <="); break; // the 95 graphic characters of the International Reference Version of ECMA-6
+		case 0x05: TRACE ("CS5 <="); break; // the 191 graphic characters of ECMA-94, Latin Alphabet No. 1
+		case 0x06: TRACE ("CS6 <="); break; // a set of graphic characters that may be identified by ECMA-35 and ECMA-48
+		case 0x07: TRACE ("CS7 <="); break; // a set of graphic characters that may be identified by ECMA-35 and ECMA-48 and, optionally, code extension characters using ECMA-35 and ECMA-48
+		case 0x08: TRACE ("CS8 <="); break; // a set of 53 graphic characters that are highly portable to most personal computers
+		default:   TRACE ("??? <="); break;
 	}
 	if (buffer[1])
 	{
-		printf (" \"");
+		TRACE (" \"");
 		for (i=1; i < 64; i++)
 		{
 			if (buffer[i] == 0x00)
@@ -109,12 +122,12 @@ static void print_1_7_2_1 (uint8_t buffer[64]) //Character Set Type (RBP 0)
 			}
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		printf ("\"");
+		TRACE ("\"");
 	}
 }
 
@@ -158,7 +171,7 @@ static void print_1_7_2_12_VolumeSetIdentifier2 (uint8_t *buffer, int len)
 		    (buffer[14] == 0) &&
 		    (buffer[15] == 0))
 		{
-			printf ("unique_timestamp=%c%c%c%c-%c%c-%c%c",
+			TRACE ("unique_timestamp=%c%c%c%c-%c%c-%c%c",
 				buffer[0],
 				buffer[1],
 				buffer[2],
@@ -189,7 +202,7 @@ static void print_1_7_2_12_VolumeSetIdentifier2 (uint8_t *buffer, int len)
 	{
 		uint32_t Stamp;
 		time_t t1;
-		struct tm *t2;
+		struct tm t2;
 
 
 		Stamp  = unhex(buffer[7]) << 28;
@@ -202,16 +215,16 @@ static void print_1_7_2_12_VolumeSetIdentifier2 (uint8_t *buffer, int len)
 		Stamp |= unhex(buffer[0]);
 		t1 = Stamp;
 
-		t2 = localtime (&t1);
+		localtime_r (&t1, &t2); /* libcdfs handles may be used from several threads */
 
-		printf ("unique_timestamp=%04d-%02d-%02d_%02d:%02d:%02d",
-			t2->tm_year + 1900,
-			t2->tm_mon + 1,
-			t2->tm_mday,
-			t2->tm_hour,
-			t2->tm_min,
-			t2->tm_sec);
-		putchar (' ');
+		TRACE ("unique_timestamp=%04d-%02d-%02d_%02d:%02d:%02d",
+			t2.tm_year + 1900,
+			t2.tm_mon + 1,
+			t2.tm_mday,
+			t2.tm_hour,
+			t2.tm_min,
+			t2.tm_sec);
+		TRACE_PUTCHAR (' ');
 		buffer += 8;
 		len -= 8;
 	}
@@ -228,20 +241,20 @@ skipme:
 	    ishex(buffer[7]))
 	{
 		int i;
-		printf ("unique_id=0x");
+		TRACE ("unique_id=0x");
 		for (i=0; i< 8; i++)
 		{
-			printf ("%c", buffer[i]);
+			TRACE ("%c", buffer[i]);
 		}
-		putchar (' ');
+		TRACE_PUTCHAR (' ');
 		buffer += 8;
 		len -= 8;
 	}
 	if (len)
 	{
-		printf (" \"");
-		fwrite (buffer, 1, len, stdout);
-		putchar ('\"');
+		TRACE (" \"");
+		TRACE_FWRITE (buffer, 1, len, stdout);
+		TRACE_PUTCHAR ('\"');
 	}
 }
 
@@ -256,7 +269,7 @@ static void print_1_7_2_12_VolumeSetIdentifier (uint8_t *buffer, uint8_t len, ui
 		{
 			case 0:
 			{
-				printf ("(null)");
+				TRACE ("(null)");
 				break;
 			}
 
@@ -275,9 +288,9 @@ static void print_1_7_2_12_VolumeSetIdentifier (uint8_t *buffer, uint8_t len, ui
 				size_t outbytesleft = sizeof (outbuffer);
 				//size_t res;
 
-				/* res = */ iconv (UTF16BE_cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
+				/* res = */ cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
 
-				fwrite (outbuffer, 1, (uint8_t *)outbuf - outbuffer, stdout);
+				TRACE_FWRITE (outbuffer, 1, (uint8_t *)outbuf - outbuffer, stdout);
 				print_1_7_2_12_VolumeSetIdentifier2 (outbuffer, (uint8_t *)outbuf - outbuffer);
 				break;
 			}
@@ -288,23 +301,23 @@ static void print_1_7_2_12_VolumeSetIdentifier (uint8_t *buffer, uint8_t len, ui
 				break;
 
 			default:
-				printf ("WARNING - Invalid OSTA Compression Unicode prefix: 0x%02" PRIx8 " ", buffer[0]);
+				TRACE ("WARNING - Invalid OSTA Compression Unicode prefix: 0x%02" PRIx8 " ", buffer[0]);
 				goto fallback;
 		}
 	} else {
 fallback: /* The not recommented path according to OSTA */
 		/* fallback to ASCII / what-ever */
-		putchar ('\"');
+		TRACE_PUTCHAR ('\"');
 		for (i=0; i < rlen; i++)
 		{
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		putchar ('\"');
+		TRACE_PUTCHAR ('\"');
 	}
 }
 
@@ -318,7 +331,7 @@ static void print_1_7_2 (uint8_t *buffer, uint8_t rlen, uint8_t *encoding, char
 		{
 			case 0:
 			{
-				printf ("(null)");
+				TRACE ("(null)");
 				if (output)
 				{
 					*output = 0;
@@ -328,9 +341,9 @@ static void print_1_7_2 (uint8_t *buffer, uint8_t rlen, uint8_t *encoding, char
 
 			case 8: /* UTF8 */
 			{
-				putchar ('\"');
-				fwrite (buffer + 1, rlen - 1, 1, stdout);
-				putchar ('\"');
+				TRACE_PUTCHAR ('\"');
+				TRACE_FWRITE (buffer + 1, rlen - 1, 1, stdout);
+				TRACE_PUTCHAR ('\"');
 
 				if (output)
 				{
@@ -350,11 +363,11 @@ static void print_1_7_2 (uint8_t *buffer, uint8_t rlen, uint8_t *encoding, char
 				size_t outbytesleft = sizeof (outbuffer);
 				//size_t res;
 
-				/* res = */ iconv (UTF16BE_cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
+				/* res = */ cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
 
-				putchar ('\"');
-				fwrite (outbuffer, 1, (uint8_t *)outbuf - outbuffer, stdout);
-				putchar ('\"');
+				TRACE_PUTCHAR ('\"');
+				TRACE_FWRITE (outbuffer, 1, (uint8_t *)outbuf - outbuffer, stdout);
+				TRACE_PUTCHAR ('\"');
 
 				if (output)
 				{
@@ -367,7 +380,7 @@ static void print_1_7_2 (uint8_t *buffer, uint8_t rlen, uint8_t *encoding, char
 
 			case 254: /* UTF-8 empty string */
 			case 255: /* UTF-16BE empty string */
-				printf ("\"\"");
+				TRACE ("\"\"");
 				if (output)
 				{
 					*output = strdup ("");
@@ -375,23 +388,23 @@ static void print_1_7_2 (uint8_t *buffer, uint8_t rlen, uint8_t *encoding, char
 				break;
 
 			default:
-				printf ("WARNING - Invalid OSTA Compression Unicode prefix: %02" PRIx8 " ", buffer[0]);
+				TRACE ("WARNING - Invalid OSTA Compression Unicode prefix: %02" PRIx8 " ", buffer[0]);
 				goto fallback;
 		}
 	} else {
 fallback: /* The not recommented path according to OSTA */
 		/* fallback to ASCII / what-ever */
-		putchar ('\"');
+		TRACE_PUTCHAR ('\"');
 		for (i=0; i < rlen; i++)
 		{
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		putchar ('\"');
+		TRACE_PUTCHAR ('\"');
 
 		if (output)
 		{
@@ -409,7 +422,7 @@ static void print_1_7_2_12 (uint8_t *buffer, uint8_t len, uint8_t *encoding, cha
 
 	if (rlen >= len)
 	{
-		printf ("(WARNING: length overflow)");
+		TRACE ("(WARNING: length overflow)");
 		rlen = len - 1;
 	}
 
@@ -419,7 +432,7 @@ static void print_1_7_2_12 (uint8_t *buffer, uint8_t len, uint8_t *encoding, cha
 		{
 			case 0:
 			{
-				printf ("(null)");
+				TRACE ("(null)");
 				if (output)
 				{
 					*output = 0;
@@ -429,9 +442,9 @@ static void print_1_7_2_12 (uint8_t *buffer, uint8_t len, uint8_t *encoding, cha
 
 			case 8: /* UTF8 */
 			{
-				putchar ('\"');
-				fwrite (buffer + 1, rlen - 1, 1, stdout);
-				putchar ('\"');
+				TRACE_PUTCHAR ('\"');
+				TRACE_FWRITE (buffer + 1, rlen - 1, 1, stdout);
+				TRACE_PUTCHAR ('\"');
 
 				if (output)
 				{
@@ -451,11 +464,11 @@ static void print_1_7_2_12 (uint8_t *buffer, uint8_t len, uint8_t *encoding, cha
 				size_t outbytesleft = sizeof (outbuffer);
 				//size_t res;
 
-				/* res = */ iconv (UTF16BE_cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
+				/* res = */ cdfs_utf16be_to_utf8 (&inbuf, &inbytesleft, &outbuf, &outbytesleft);
 
-				putchar ('\"');
-				fwrite (outbuffer, 1, (uint8_t *)outbuf - outbuffer, stdout);
-				putchar ('\"');
+				TRACE_PUTCHAR ('\"');
+				TRACE_FWRITE (outbuffer, 1, (uint8_t *)outbuf - outbuffer, stdout);
+				TRACE_PUTCHAR ('\"');
 
 				if (output)
 				{
@@ -468,7 +481,7 @@ static void print_1_7_2_12 (uint8_t *buffer, uint8_t len, uint8_t *encoding, cha
 
 			case 254: /* UTF-8 empty string */
 			case 255: /* UTF-16BE empty string */
-				printf ("\"\"");
+				TRACE ("\"\"");
 				if (output)
 				{
 					*output = strdup ("");
@@ -476,23 +489,23 @@ static void print_1_7_2_12 (uint8_t *buffer, uint8_t len, uint8_t *encoding, cha
 				break;
 
 			default:
-				printf ("WARNING - Invalid OSTA Compression Unicode prefix: %02" PRIx8 " ", buffer[0]);
+				TRACE ("WARNING - Invalid OSTA Compression Unicode prefix: %02" PRIx8 " ", buffer[0]);
 				goto fallback;
 		}
 	} else {
 fallback: /* The not recommented path according to OSTA */
 		/* fallback to ASCII / what-ever */
-		putchar ('\"');
+		TRACE_PUTCHAR ('\"');
 		for (i=0; i < rlen; i++)
 		{
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		putchar ('\"');
+		TRACE_PUTCHAR ('\"');
 
 		if (output)
 		{
@@ -507,7 +520,7 @@ static void print_1_7_3 (uint8_t buffer[12]) // Time Stamp
 {
 	uint16_t TypeTimeZone = (buffer[1] << 8) | buffer[0];
 
-	printf ("%04d-%02d-%02d %02d:%02d:%02d.%02d.%02d.%02d",
+	TRACE ("%04d-%02d-%02d %02d:%02d:%02d.%02d.%02d.%02d",
 		(buffer[3]<<8) | buffer[2], /* year */
 		buffer[4],                  /* month */
 		buffer[5],                  /* day */
@@ -520,7 +533,7 @@ static void print_1_7_3 (uint8_t buffer[12]) // Time Stamp
 
 	switch (TypeTimeZone >> 12)
 	{
-		case 0: printf ("UTC"); return; /* Not allowed according to OSTA */
+		case 0: TRACE ("UTC"); return; /* Not allowed according to OSTA */
 		case 1: /* OSTA requires this path */
 		{
 			uint16_t a = TypeTimeZone & 0x0fff;
@@ -529,12 +542,12 @@ static void print_1_7_3 (uint8_t buffer[12]) // Time Stamp
 			b = (int16_t)a;
 			if (b != -2047)
 			{
-				printf ("%+05d", (b / 60) * 100 + b % 60);
+				TRACE ("%+05d", (b / 60) * 100 + b % 60);
 			}
 			return;
 		}
-		//case 2: printf ("agreement???");
-		default: printf ("\?\?\?\?(0x%1x 0x%03x)", TypeTimeZone >> 12, TypeTimeZone & 0x0fff); return;
+		//case 2: TRACE ("agreement???");
+		default: TRACE ("\?\?\?\?(0x%1x 0x%03x)", TypeTimeZone >> 12, TypeTimeZone & 0x0fff); return;
 	}
 }
 
@@ -635,12 +648,12 @@ static void print_1_7_4 (uint8_t buffer[32], const int IsImplementation) // regi
 
 	switch (buffer[1])
 	{
-		case 0x00: printf ("(null)"); return;
-		case 0x2b: printf ("(ECMA-167 / ECMA-168) "); break;
-		case 0x2d: printf ("(private) "); break;
-		default:   printf ("(may be registered according to ISO/IEC 13800)%c ", buffer[1]); break;
+		case 0x00: TRACE ("(null)"); return;
+		case 0x2b: TRACE ("(ECMA-167 / ECMA-168) "); break;
+		case 0x2d: TRACE ("(private) "); break;
+		default:   TRACE ("(may be registered according to ISO/IEC 13800)%c ", buffer[1]); break;
 	}
-	printf ("\"");
+	TRACE ("\"");
 	for (i=2; i < 24; i++)
 	{
 		if (buffer[i] == 0x00)
@@ -649,27 +662,27 @@ static void print_1_7_4 (uint8_t buffer[32], const int IsImplementation) // regi
 		}
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf ("\"");
+	TRACE ("\"");
 
-	if (buffer[0] & 0x01) printf (" DIRTY");
-	if (buffer[0] & 0x02) printf (" PROTECTED"); else printf (" EDITABLE");
+	if (buffer[0] & 0x01) TRACE (" DIRTY");
+	if (buffer[0] & 0x02) TRACE (" PROTECTED"); else TRACE (" EDITABLE");
 
-	printf (" \"");
+	TRACE (" \"");
 	for (i=24; i < 32; i++)
 	{
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf ("\"");
+	TRACE ("\"");
 
 	/* Test for UDF Identifier Suffix - This is according to OSTA */
 	if ((!memcmp (buffer + 1, "*UDF LV Info", 13)) ||
@@ -681,20 +694,20 @@ static void print_1_7_4 (uint8_t buffer[32], const int IsImplementation) // regi
 	    (!memcmp (buffer + 1, "*UDF FreeEASpace", 17)))
 	{ /* UDF Identifier Suffix */
 		uint16_t UDF_Revision = (buffer[25] << 8) | buffer[24];
-		printf (" UDF_Revision=%d.%d%d", UDF_Revision >> 8, (UDF_Revision & 0xf0) >> 4, UDF_Revision & 0x0f);
-		printf (" OS_Class=\"%s\"", GetOSClass (buffer[26]));
-		printf (" OS_Identifier=\"%s\"", GetOSIdentifier (buffer[26], buffer[27]));
+		TRACE (" UDF_Revision=%d.%d%d", UDF_Revision >> 8, (UDF_Revision & 0xf0) >> 4, UDF_Revision & 0x0f);
+		TRACE (" OS_Class=\"%s\"", GetOSClass (buffer[26]));
+		TRACE (" OS_Identifier=\"%s\"", GetOSIdentifier (buffer[26], buffer[27]));
 	} else if ((!memcmp (buffer + 1, "*OSTA UDF Compliant", 20)))
 	{ /* Domain Identifier Suffix */
 
 		uint16_t UDF_Revision = (buffer[25] << 8) | buffer[24];
-		printf (" UDF_Revision=%d.%d%d", UDF_Revision >> 8, (UDF_Revision & 0xf0) >> 4, UDF_Revision & 0x0f);
-		if (buffer[26] & 0x01) printf (" HardWriteProtect");
-		if (buffer[26] & 0x02) printf (" SoftWriteProtect");
+		TRACE (" UDF_Revision=%d.%d%d", UDF_Revision >> 8, (UDF_Revision & 0xf0) >> 4, UDF_Revision & 0x0f);
+		if (buffer[26] & 0x01) TRACE (" HardWriteProtect");
+		if (buffer[26] & 0x02) TRACE (" SoftWriteProtect");
 	} else if (IsImplementation)
 	{
-		printf (" OS_Class=\"%s\"", GetOSClass (buffer[24]));
-		printf (" OS_Identifier=\"%s\"", GetOSIdentifier (buffer[24], buffer[25]));
+		TRACE (" OS_Class=\"%s\"", GetOSClass (buffer[24]));
+		TRACE (" OS_Identifier=\"%s\"", GetOSIdentifier (buffer[24], buffer[25]));
 	}
 }
 
@@ -703,129 +716,163 @@ static void print_4_14_6 (int n, const char *prefix, uint8_t *buffer, uint16_t *
 	uint16_t StrategyType;
 	uint16_t MaximumNumberofEntries;
 
-	N(n); printf ("%s.Prior Recorded Number of Direct Entries:        %" PRId32 "\n", prefix, (buffer[3] << 24) | (buffer[2] << 16) | (buffer[1] << 8) | buffer[0]);
-	N(n); printf ("%s.Strategy Type:                                  %" PRId16 "\n", prefix, StrategyType = (buffer[5] << 8) | buffer[4]); // Type 4096 = WORM, see section 6.6 in OSTA
+	N(n); TRACE ("%s.Prior Recorded Number of Direct Entries:        %" PRId32 "\n", prefix, (buffer[3] << 24) | (buffer[2] << 16) | (buffer[1] << 8) | buffer[0]);
+	StrategyType = (buffer[5] << 8) | buffer[4];
+	N(n); TRACE ("%s.Strategy Type:                                  %" PRId16 "\n", prefix, StrategyType); // Type 4096 = WORM, see section 6.6 in OSTA
 
 	(*strategy4096) = (StrategyType==4096);
 
 	switch (StrategyType)
 	{
-		case 0: N(n+2); printf ("Unspecified - implies direct entry\n"); break;
-		case 1: N(n+2); printf ("INVALID - The strategy specificied in ECMA-167 4/A.2 is not valid according to UDF-2.60\n"); break;
-		case 2: N(n+2); printf ("INVALID - The strategy specificied in ECMA-167 4/A.3 is not valid according to UDF-2.60\n"); break;
-		case 3: N(n+2); printf ("INVALID - The strategy specificied in ECMA-167 4/A.4 is not valid according to UDF-2.60\n"); break;
-		case 4: N(n+2); printf ("Recorded as a direct entry (ECMA-167 4/A.5)\n"); break;
-		case 4096: N(n+2); printf ("Recorded as a direct entry followed by an possible indirect entry referencing a rewritten version (according to UDF 2.60 section 6.6\n"); break; // not part of ECMA-167 specification break;
-		default: N(n+2); printf ("INVALID - Unknown strategy\n"); break;
+		case 0: N(n+2); TRACE ("Unspecified - implies direct entry\n"); break;
+		case 1: N(n+2); TRACE ("INVALID - The strategy specificied in ECMA-167 4/A.2 is not valid according to UDF-2.60\n"); break;
+		case 2: N(n+2); TRACE ("INVALID - The strategy specificied in ECMA-167 4/A.3 is not valid according to UDF-2.60\n"); break;
+		case 3: N(n+2); TRACE ("INVALID - The strategy specificied in ECMA-167 4/A.4 is not valid according to UDF-2.60\n"); break;
+		case 4: N(n+2); TRACE ("Recorded as a direct entry (ECMA-167 4/A.5)\n"); break;
+		case 4096: N(n+2); TRACE ("Recorded as a direct entry followed by an possible indirect entry referencing a rewritten version (according to UDF 2.60 section 6.6\n"); break; // not part of ECMA-167 specification break;
+		default: N(n+2); TRACE ("INVALID - Unknown strategy\n"); break;
 	}
 
-	N(n); printf ("%s.Strategy Parameter:                             %d %d\n", prefix, buffer[6], buffer[7]);
-	N(n); printf ("%s.Maximum Number of Entries:                      %" PRId16 "\n", prefix, MaximumNumberofEntries = ((buffer[9] << 8) | buffer[8])); /* should be 1 for Strategy 4, and 2 for Strategy 4096 */
+	N(n); TRACE ("%s.Strategy Parameter:                             %d %d\n", prefix, buffer[6], buffer[7]);
+	MaximumNumberofEntries = ((buffer[9] << 8) | buffer[8]);
+	N(n); TRACE ("%s.Maximum Number of Entries:                      %" PRId16 "\n", prefix, MaximumNumberofEntries); /* should be 1 for Strategy 4, and 2 for Strategy 4096 */
 	if ((StrategyType == 4) && (MaximumNumberofEntries != 1))
 	{
-		N(n+2); printf ("WARNING - This value was expected to be 1 for Strategy Type 4\n");
+		N(n+2); TRACE ("WARNING - This value was expected to be 1 for Strategy Type 4\n");
 	}
 	if ((StrategyType == 4096) && (MaximumNumberofEntries != 2))
 	{
-		N(n+2); printf ("WARNING - This value was expected to be 2 for Strategy Type 4096\n");
+		N(n+2); TRACE ("WARNING - This value was expected to be 2 for Strategy Type 4096\n");
 	}
-	N(n); printf ("%s.File Type:                                      %" PRId8 "\n", prefix, *FileType = buffer[11]);
+	*FileType = buffer[11];
+	N(n); TRACE ("%s.File Type:                                      %" PRId8 "\n", prefix, *FileType);
 	switch (*FileType)
 	{
-		default:                                     N(n+1); printf ("Unknown\n"); break;
-		case FILETYPE_UNSET:                         N(n+1); printf ("Unset\n"); break;
-		case FILETYPE_UNSPECIFIED:                   N(n+1); printf ("Unspecified\n"); break;
-		case FILETYPE_UNALLOCATED_SPACE_ENTRY:       N(n+1); printf ("Unallocated Space Entry\n"); break; // (see 4/14.11)
-		case FILETYPE_PARTITION_INTEGRITY_ENTRY:     N(n+1); printf ("Partition Integrity Entry\n"); break; // (see 4/14.13)
-		case FILETYPE_INDIRECT_ENTRY:                N(n+1); printf ("Indirect Entry\n"); break; // (see 4/14.7)
-		case FILETYPE_DIRECTORY:                     N(n+1); printf ("Directory\n"); break; // (see 4/14.7) (see 4/8.6)
-		case FILETYPE_FILE:                          N(n+1); printf ("File (Random Access)\n"); break;
-		case FILETYPE_BLOCK_SPECIAL_DEVICE:          N(n+1); printf ("Block special device\n"); break; // ISO/IEC 9945-1
-		case FILETYPE_CHARACTER_SPECIAL_DEVICE:      N(n+1); printf ("Character special device\n"); break; // ISO/IEC 9945-1
-		case FILETYPE_RECORDING_EXTENDED_ATTRIBUTES: N(n+1); printf ("Recording Extended Attributes\n"); break; // see  4/9.1
-		case FILETYPE_FIFO:                          N(n+1); printf ("FIFO\n"); break; // ISO/IEC 9945-1
-		case FILETYPE_C_ISSOCK:                      N(n+1); printf ("C_ISSOCK\n"); break; // ISO/IEC 9945-1
-		case FILETYPE_TERMINAL_ENTRY:                N(n+1); printf ("Terminal Entry\n"); break; // (see 4/14.8)
-		case FILETYPE_SYMLINK:                       N(n+1); printf ("Symlink\n"); break; // (see 4/8.7)
-		case FILETYPE_STREAM_DIRECTORY:              N(n+1); printf ("Stream Directory\n"); break; // (see 4/9.2)
-
-		case FILETYPE_THE_VIRTUAL_ALLOCATED_TABLE:   N(n+1); printf ("The Virtual Allocation Table (VAT)\n"); break; // OSTA 2.2.11
-		case FILETYPE_REAL_TIME_FILE:                N(n+1); printf ("Real-Time File"); break; // OSTA Appendix 6.11.1)
-		case FILETYPE_METADATA_FILE:                 N(n+1); printf ("Metadata File\n"); break; // OSTA 2.2.13.1
-		case FILETYPE_METADATA_MIRROR_FILE:          N(n+1); printf ("Metadata Mirror File\n"); break; // OSTA 2.2.13.1
-		case FILETYPE_METADATA_BITMAP_FILE:          N(n+1); printf ("Metadata Bitmap File\n"); break; // OSTA 2.2.13.2
-	}
-	N(n); printf ("%s.Parent ICB Location.Logical Block Number:       %" PRId32 "\n", prefix, (buffer[15] << 24) | (buffer[14] << 16) | (buffer[13] << 8) | buffer[12]);
-	N(n); printf ("%s.Parent ICB Location.Partition Reference Number: %" PRId16 "\n", prefix, (buffer[17] << 8) | buffer[16]);
-	N(n); printf ("%s.Flags:                                          %" PRId16 "\n", prefix, *Flags=(buffer[19] << 8) | buffer[18]);
+		default:                                     N(n+1); TRACE ("Unknown\n"); break;
+		case FILETYPE_UNSET:                         N(n+1); TRACE ("Unset\n"); break;
+		case FILETYPE_UNSPECIFIED:                   N(n+1); TRACE ("Unspecified\n"); break;
+		case FILETYPE_UNALLOCATED_SPACE_ENTRY:       N(n+1); TRACE ("Unallocated Space Entry\n"); break; // (see 4/14.11)
+		case FILETYPE_PARTITION_INTEGRITY_ENTRY:     N(n+1); TRACE ("Partition Integrity Entry\n"); break; // (see 4/14.13)
+		case FILETYPE_INDIRECT_ENTRY:                N(n+1); TRACE ("Indirect Entry\n"); break; // (see 4/14.7)
+		case FILETYPE_DIRECTORY:                     N(n+1); TRACE ("Directory\n"); break; // (see 4/14.7) (see 4/8.6)
+		case FILETYPE_FILE:                          N(n+1); TRACE ("File (Random Access)\n"); break;
+		case FILETYPE_BLOCK_SPECIAL_DEVICE:          N(n+1); TRACE ("Block special device\n"); break; // ISO/IEC 9945-1
+		case FILETYPE_CHARACTER_SPECIAL_DEVICE:      N(n+1); TRACE ("Character special device\n"); break; // ISO/IEC 9945-1
+		case FILETYPE_RECORDING_EXTENDED_ATTRIBUTES: N(n+1); TRACE ("Recording Extended Attributes\n"); break; // see  4/9.1
+		case FILETYPE_FIFO:                          N(n+1); TRACE ("FIFO\n"); break; // ISO/IEC 9945-1
+		case FILETYPE_C_ISSOCK:                      N(n+1); TRACE ("C_ISSOCK\n"); break; // ISO/IEC 9945-1
+		case FILETYPE_TERMINAL_ENTRY:                N(n+1); TRACE ("Terminal Entry\n"); break; // (see 4/14.8)
+		case FILETYPE_SYMLINK:                       N(n+1); TRACE ("Symlink\n"); break; // (see 4/8.7)
+		case FILETYPE_STREAM_DIRECTORY:              N(n+1); TRACE ("Stream Directory\n"); break; // (see 4/9.2)
+
+		case FILETYPE_THE_VIRTUAL_ALLOCATED_TABLE:   N(n+1); TRACE ("The Virtual Allocation Table (VAT)\n"); break; // OSTA 2.2.11
+		case FILETYPE_REAL_TIME_FILE:                N(n+1); TRACE ("Real-Time File"); break; // OSTA Appendix 6.11.1)
+		case FILETYPE_METADATA_FILE:                 N(n+1); TRACE ("Metadata File\n"); break; // OSTA 2.2.13.1
+		case FILETYPE_METADATA_MIRROR_FILE:          N(n+1); TRACE ("Metadata Mirror File\n"); break; // OSTA 2.2.13.1
+		case FILETYPE_METADATA_BITMAP_FILE:          N(n+1); TRACE ("Metadata Bitmap File\n"); break; // OSTA 2.2.13.2
+	}
+	N(n); TRACE ("%s.Parent ICB Location.Logical Block Number:       %" PRId32 "\n", prefix, (buffer[15] << 24) | (buffer[14] << 16) | (buffer[13] << 8) | buffer[12]);
+	N(n); TRACE ("%s.Parent ICB Location.Partition Reference Number: %" PRId16 "\n", prefix, (buffer[17] << 8) | buffer[16]);
+	*Flags = (buffer[19] << 8) | buffer[18];
+	N(n); TRACE ("%s.Flags:                                          %" PRId16 "\n", prefix, *Flags);
 	switch (*Flags & 0x03)
 	{
-		case 0x00: N(n+1); printf("Short Allocation Descriptors (4/14.14.1) are used\n"); break;
-		case 0x01: N(n+1); printf("Long Allocation Descriptors(4/14.14.2) are used\n"); break;
-		case 0x02: N(n+1); printf("Extended Allocation Descriptors (4/14.14.3) are used\n");
-		case 0x03: N(n+1); printf("File stored directly in extent\n"); break;
-		default: N(n+2); printf("WARNING - Illegal store method used\n"); break;
+		case 0x00: N(n+1); TRACE("Short Allocation Descriptors (4/14.14.1) are used\n"); break;
+		case 0x01: N(n+1); TRACE("Long Allocation Descriptors(4/14.14.2) are used\n"); break;
+		case 0x02: N(n+1); TRACE("Extended Allocation Descriptors (4/14.14.3) are used\n");
+		case 0x03: N(n+1); TRACE("File stored directly in extent\n"); break;
+		default: N(n+2); TRACE("WARNING - Illegal store method used\n"); break;
 	}
 	if ((*FileType == FILETYPE_DIRECTORY) || (*FileType == FILETYPE_STREAM_DIRECTORY))
 	{
 		if (*Flags & 0x04)
 		{
-			N(n+1); printf("Entries are sorted according to 4/8.6.1\n");
+			N(n+1); TRACE("Entries are sorted according to 4/8.6.1\n");
 		} else {
-			N(n+1); printf("Entries are NOT sorted according to 4/8.6.1\n");
+			N(n+1); TRACE("Entries are NOT sorted according to 4/8.6.1\n");
 		}
 	}
 	if (*Flags & 0x08)
 	{
-		N(n+1); printf("Not relocatable\n");
+		N(n+1); TRACE("Not relocatable\n");
 	} else {
-		N(n+1); printf("Is relocatable\n");
+		N(n+1); TRACE("Is relocatable\n");
 	}
-	N(n+1); printf("Archived: %s\n", (*Flags & 0x10) ? "Yes": "No");
+	N(n+1); TRACE("Archived: %s\n", (*Flags & 0x10) ? "Yes": "No");
 	if (*Flags & 0x20)
 	{
-		N(n+1); printf("S_ISUID (SetUID)\n");
+		N(n+1); TRACE("S_ISUID (SetUID)\n");
 	}
 	if (*Flags & 0x40)
 	{
-		N(n+1); printf("S_ISGID (setGID)\n");
+		N(n+1); TRACE("S_ISGID (setGID)\n");
 	}
 	if (*Flags & 0x80)
 	{
-		N(n+2); printf("S_ISVTX (Sticky)\n");
+		N(n+2); TRACE("S_ISVTX (Sticky)\n");
 	}
 	if (*Flags & 0x100)
 	{
-		N(n+2); printf("S_ISVTX (Sticky)\n");
+		N(n+2); TRACE("S_ISVTX (Sticky)\n");
 	}
-	N(n+1); printf("Contiguous: %s\n", (*Flags & 0x200) ? "Yes": "No"); // If no, file can contain holes
-	//N(n+1); printf("System: %s\n", (*Flags & 0x400) ? "Yes": "No");
-	N(n+1); printf("Transformed: %s\n", (*Flags & 0x800) ? "Yes": "No"); // File properties has been converted in a non-reversiable manner
-	//N(n+1); printf("Multi-versions: %s\n", (*Flags & 0x1000) ? "Yes": "No"); // Hardlinks
-	N(n+1); printf("Stream: %s\n", (*Flags & 0x2000) ? "Yes": "No"); // 4/9.2 TODO
+	N(n+1); TRACE("Contiguous: %s\n", (*Flags & 0x200) ? "Yes": "No"); // If no, file can contain holes
+	//N(n+1); TRACE("System: %s\n", (*Flags & 0x400) ? "Yes": "No");
+	N(n+1); TRACE("Transformed: %s\n", (*Flags & 0x800) ? "Yes": "No"); // File properties has been converted in a non-reversiable manner
+	//N(n+1); TRACE("Multi-versions: %s\n", (*Flags & 0x1000) ? "Yes": "No"); // Hardlinks
+	N(n+1); TRACE("Stream: %s\n", (*Flags & 0x2000) ? "Yes": "No"); // 4/9.2 TODO
 }
 
-static uint16_t crc16(uint8_t *ptr, int count)
+static uint16_t       crc16_table[8][256]; /* CRC-16-CCITT, crc16_table[j][i] is the CRC of byte i followed by j zero bytes */
+static pthread_once_t crc16_table_once = PTHREAD_ONCE_INIT;
+
+static void crc16_init (void)
 {
-	uint_fast16_t crc = 0;
-	int i;
+	int i, j;
 
-	while (count)
+	for (i=0; i < 256; i++)
 	{
-		crc ^= (*ptr << 8);
-
-		for (i=0; i < 8; i++)
+		uint16_t crc = i << 8;
+		for (j=0; j < 8; j++)
 		{
-			if (crc & 0x8000)
-			{
-				crc = crc << 1 ^ 0x1021;
-			} else {
-				crc = crc << 1;
-			}
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+		crc16_table[0][i] = crc;
+	}
+	for (i=0; i < 256; i++)
+	{
+		for (j=1; j < 8; j++)
+		{
+			crc16_table[j][i] = (crc16_table[j-1][i] << 8) ^ crc16_table[0][crc16_table[j-1][i] >> 8];
 		}
-		ptr++;
+	}
+}
+
+/* slice-by-8, 8 bytes per iteration */
+static uint16_t crc16(uint8_t *ptr, int count)
+{
+	uint16_t crc = 0;
+
+	pthread_once (&crc16_table_once, crc16_init);
+
+	while (count >= 8)
+	{
+		crc = crc16_table[7][ptr[0] ^ (crc >> 8)  ] ^
+		      crc16_table[6][ptr[1] ^ (crc & 0xff)] ^
+		      crc16_table[5][ptr[2]] ^
+		      crc16_table[4][ptr[3]] ^
+		      crc16_table[3][ptr[4]] ^
+		      crc16_table[2][ptr[5]] ^
+		      crc16_table[1][ptr[6]] ^
+		      crc16_table[0][ptr[7]];
+		ptr += 8;
+		count -= 8;
+	}
+	while (count > 0)
+	{
+		crc = (crc << 8) ^ crc16_table[0][(crc >> 8) ^ *(ptr++)];
 		count--;
 	}
+
 	return crc;
 }
 
@@ -848,19 +895,19 @@ static int print_tag_format (int n, char *prefix, uint8_t buffer[SECTORSIZE], ui
 
 	*TagIdentifier = (buffer[1] << 8) | buffer[0];
 
-	N(n); printf ("%sDescriptorTag.TagIdentifier:       %d - %s\n", prefix, *TagIdentifier, TagIdentifierName (*TagIdentifier));
-	N(n); printf ("%sDescriptorTag.DescriptorVersion:   %d\n", prefix, (buffer[3]<<8) | buffer[2]);
-	N(n); printf ("%sDescriptorTag.TagChecksum:         0x%02x", prefix, buffer[4]); if (buffer[4] != CheckSum) printf (" EXPECTED 0x%02x", CheckSum); putchar ('\n');
-	//N(n); printf ("%sDescriptorTag.Reserved:            %d\n", prefix, buffer[5]);
-	N(n); printf ("%sDescriptorTag.TagSerialNumber:     %d\n", prefix, (buffer[7]<<8) | buffer[6]);
-	N(n); printf ("%sDescriptorTag.DescriptorCRC:       0x%04x", prefix, (buffer[9]<<8) | buffer[8]); if (_DescriptorCRC != DescriptorCRC) printf (" EXPECTED 0x%04x", _DescriptorCRC); putchar ('\n');
-	N(n); printf ("%sDescriptorTag.DescriptorCRCLength: %d%s\n", prefix, DescriptorCRCLength, (DescriptorCRCLength <= (SECTORSIZE - 16)) ? "" : " - WARNING too big");
-	N(n); printf ("%sDescriptorTag.TagLocation:         %d", prefix, TagLocation);
+	N(n); TRACE ("%sDescriptorTag.TagIdentifier:       %d - %s\n", prefix, *TagIdentifier, TagIdentifierName (*TagIdentifier));
+	N(n); TRACE ("%sDescriptorTag.DescriptorVersion:   %d\n", prefix, (buffer[3]<<8) | buffer[2]);
+	N(n); TRACE ("%sDescriptorTag.TagChecksum:         0x%02x", prefix, buffer[4]); if (buffer[4] != CheckSum) TRACE (" EXPECTED 0x%02x", CheckSum); TRACE_PUTCHAR ('\n');
+	//N(n); TRACE ("%sDescriptorTag.Reserved:            %d\n", prefix, buffer[5]);
+	N(n); TRACE ("%sDescriptorTag.TagSerialNumber:     %d\n", prefix, (buffer[7]<<8) | buffer[6]);
+	N(n); TRACE ("%sDescriptorTag.DescriptorCRC:       0x%04x", prefix, (buffer[9]<<8) | buffer[8]); if (_DescriptorCRC != DescriptorCRC) TRACE (" EXPECTED 0x%04x", _DescriptorCRC); TRACE_PUTCHAR ('\n');
+	N(n); TRACE ("%sDescriptorTag.DescriptorCRCLength: %d%s\n", prefix, DescriptorCRCLength, (DescriptorCRCLength <= (SECTORSIZE - 16)) ? "" : " - WARNING too big");
+	N(n); TRACE ("%sDescriptorTag.TagLocation:         %d", prefix, TagLocation);
 	if (_TagLocation != TagLocation)
 	{
-		printf (" - WARNING wrong, expected %"PRIu32, _TagLocation);
+		TRACE (" - WARNING wrong, expected %"PRIu32, _TagLocation);
 	}
-	putchar('\n');
+	TRACE_PUTCHAR('\n');
 
 	return (buffer[4] == CheckSum) &&
 	       ((_TagLocation == TagLocation) || (!WrongTagIsFatal)) &&
@@ -874,9 +921,9 @@ static void UDF_shortad_from_data (int n, const char *prefix, struct UDF_shortad
 	target->ExtentLength   = ((source[3] & 0x3f)<<24) | (source[2]<<16) | (source[1]<<8) | source[0];
 	target->ExtentPosition = ( source[7]        <<24) | (source[6]<<16) | (source[5]<<8) | source[4];
 	target->ExtentInterpretation = (enum eExtentInterpretation)(source[3]>>6);
-	N(n); printf ("%sExtentLength:         %"PRIu32"\n", prefix, target->ExtentLength);
-	N(n); printf ("%sExtentPosition:       %"PRIu32"\n", prefix, target->ExtentPosition);
-	N(n); printf ("%sExtentInterpretation: %"PRIu8"\n", prefix, target->ExtentInterpretation);
+	N(n); TRACE ("%sExtentLength:         %"PRIu32"\n", prefix, target->ExtentLength);
+	N(n); TRACE ("%sExtentPosition:       %"PRIu32"\n", prefix, target->ExtentPosition);
+	N(n); TRACE ("%sExtentInterpretation: %"PRIu8"\n", prefix, target->ExtentInterpretation);
 }
 
 /* ECMA-167 4/14.14.2 */
@@ -886,18 +933,18 @@ static void UDF_longad_from_data (int n, const char *prefix, struct UDF_longad *
 	target->ExtentLocation.LogicalBlockNumber = (source[7]<<24) | (source[6]<<16) | (source[5]<<8) | source[4];
 	target->ExtentLocation.PartitionReferenceNumber =                               (source[9]<<8) | source[8];
 	target->ExtentErased = !!(((source[11]<<8) | source[10]) & 0x0001);
-	N(n); printf ("%sExtentLength:                            %"PRIu32"\n", prefix, target->ExtentLength);
-	N(n); printf ("%sExtentLocation.LogicalBlockNumber:       %"PRIu32"\n", prefix, target->ExtentLocation.LogicalBlockNumber);
-	N(n); printf ("%sExtentLocation.PartitionReferenceNumber: %"PRIu16"\n", prefix, target->ExtentLocation.PartitionReferenceNumber);
-	N(n); printf ("%sExtentErased:                            %"PRIu8"\n",  prefix, target->ExtentErased);
+	N(n); TRACE ("%sExtentLength:                            %"PRIu32"\n", prefix, target->ExtentLength);
+	N(n); TRACE ("%sExtentLocation.LogicalBlockNumber:       %"PRIu32"\n", prefix, target->ExtentLocation.LogicalBlockNumber);
+	N(n); TRACE ("%sExtentLocation.PartitionReferenceNumber: %"PRIu16"\n", prefix, target->ExtentLocation.PartitionReferenceNumber);
+	N(n); TRACE ("%sExtentErased:                            %"PRIu8"\n",  prefix, target->ExtentErased);
 }
 
 static void UDF_extent_ad_from_data (int n, const char *prefix, struct UDF_extent_ad *target, uint8_t *source)
 {
 	target->ExtentLength   = (source[3]<<24) | (source[2]<<16) | (source[1]<<8) | source[0];
 	target->ExtentLocation = (source[7]<<24) | (source[6]<<16) | (source[5]<<8) | source[4];
-	N(n); printf ("%sExtentLength:       %"PRIu32"\n", prefix, target->ExtentLength);
-	N(n); printf ("%sExtentLocation:     %"PRIu32"\n", prefix, target->ExtentLocation);
+	N(n); TRACE ("%sExtentLength:       %"PRIu32"\n", prefix, target->ExtentLength);
+	N(n); TRACE ("%sExtentLocation:     %"PRIu32"\n", prefix, target->ExtentLocation);
 }
 
 static void UDF_shortad_from_longad (struct UDF_shortad *target, struct UDF_longad *source)
@@ -933,11 +980,87 @@ static struct UDF_PhysicalPartition_t *UDF_GetPhysicalPartition (struct cdfs_dis
 	return 0;
 }
 
+/* Reads count sectors from a partition. Sectors that are contiguous on disc are read in one go. Returns non-zero on errors */
+static int UDF_ReadSectors (struct cdfs_disc_t *disc, struct UDF_Partition_Common *source, uint32_t ExtentLocation, uint32_t count, uint8_t *buffer)
+{
+	uint32_t i;
+	uint32_t run;
+
+	for (i=0; i < count; i += run)
+	{
+		uint32_t absolute;
+
+		run = 1;
+		if (!source->MapSector)
+		{ /* not backed by disc sectors */
+			if (source->FetchSector (disc, source, buffer + i * SECTORSIZE, ExtentLocation + i))
+			{
+				return -1;
+			}
+			continue;
+		}
+		if (source->MapSector (disc, source, ExtentLocation + i, &absolute, &run))
+		{
+			return -1;
+		}
+		if (run > (count - i))
+		{
+			run = count - i;
+		}
+		if (get_absolute_sectors_2048 (disc, absolute, run, buffer + i * SECTORSIZE))
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Reads length bytes, starting offset bytes into the extent at ExtentLocation. Returns non-zero on errors */
+static int UDF_ReadBytes (struct cdfs_disc_t *disc, struct UDF_Partition_Common *source, uint32_t ExtentLocation, uint64_t offset, uint8_t *buffer, uint64_t length)
+{
+	uint8_t temp[SECTORSIZE];
+
+	while (length)
+	{
+		uint32_t sector = ExtentLocation + offset / SECTORSIZE;
+		uint32_t within = offset % SECTORSIZE;
+		uint64_t bytes;
+
+		if ((!within) && (length >= SECTORSIZE))
+		{
+			bytes = length / SECTORSIZE;
+			if (bytes > 65536)
+			{
+				bytes = 65536;
+			}
+			if (UDF_ReadSectors (disc, source, sector, bytes, buffer))
+			{
+				return -1;
+			}
+			bytes *= SECTORSIZE;
+		} else {
+			if (UDF_ReadSectors (disc, source, sector, 1, temp))
+			{
+				return -1;
+			}
+			bytes = SECTORSIZE - within;
+			if (bytes > length)
+			{
+				bytes = length;
+			}
+			memcpy (buffer, temp + within, bytes);
+		}
+		buffer += bytes;
+		offset += bytes;
+		length -= bytes;
+	}
+	return 0;
+}
+
 /* ExtentLength is rounded up to SECTORSIZE */
 static uint8_t *UDF_FetchSectors (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Common *source, uint32_t ExtentLocation, uint32_t ExtentLength)
 {
 	uint8_t *buffer;
-	int i;
 
 	if (!source)
 	{
@@ -952,18 +1075,15 @@ static uint8_t *UDF_FetchSectors (int n, struct cdfs_disc_t *disc, struct UDF_Pa
 	buffer = calloc (1, ExtentLength);
 	if (!buffer)
 	{
-		N(n); printf ("Error - UDF_FetchSectors() calloc(%"PRIu32") failed\n", ExtentLength);
+		N(n); TRACE ("Error - UDF_FetchSectors() calloc(%"PRIu32") failed\n", ExtentLength);
 		return 0;
 	}
 
-	for (i=0; i < ExtentLength / SECTORSIZE; i++)
+	if (UDF_ReadSectors (disc, source, ExtentLocation, ExtentLength / SECTORSIZE, buffer))
 	{
-		if (source->FetchSector (disc, source, buffer + i * SECTORSIZE, ExtentLocation + i))
-		{
-			N(n); printf ("Error - UDF_FetchSectors() FetchSector(%" PRIu32 " %d) failed\n", ExtentLocation, i);
-			free (buffer);
-			return 0;
-		}
+		N(n); TRACE ("Error - UDF_FetchSectors() FetchSector(%" PRIu32 " +%" PRIu32 ") failed\n", ExtentLocation, ExtentLength / SECTORSIZE);
+		free (buffer);
+		return 0;
 	}
 
 	return buffer;
@@ -980,24 +1100,24 @@ static int IndirectEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_
 	uint16_t Flags;
 	int strategy4096;
 
-	N(n); printf ("[Indirect Entry]\n");
+	N(n); TRACE ("[Indirect Entry]\n");
 
 #if 0 // Length is always SECTORSIZE
 	if (ExtentLength < 46)
 	{
-		N(n+1); printf ("Error - Length too small to contain header\n");
+		N(n+1); TRACE ("Error - Length too small to contain header\n");
 		return -1;
 	}
 
 	if (ExtentLength != SECTORSIZE)
 	{
-		N(n+1); printf ("Warning - ExtentLength != SECTORSIZE\n");
+		N(n+1); TRACE ("Warning - ExtentLength != SECTORSIZE\n");
 	}
 #endif
 	buffer = UDF_FetchSectors (n+1, disc, PartitionCommon, ExtentLocation, SECTORSIZE);
 	if (!buffer)
 	{
-		N(n+1); printf ("Error - failed fetching data");
+		N(n+1); TRACE ("Error - failed fetching data");
 		return -1;
 	}
 
@@ -1009,7 +1129,7 @@ static int IndirectEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_
 
 	if (TagIdentifier != 0x0103)
 	{
-		N(n+1); printf ("Error - Wrong TagIdentifier\n");
+		N(n+1); TRACE ("Error - Wrong TagIdentifier\n");
 		free (buffer);
 		return -1;
 	}
@@ -1017,7 +1137,7 @@ static int IndirectEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_
 	print_4_14_6 (n+1, "ICB TAG", buffer + 16, &Flags, &FileType, &strategy4096 /* ignore */);
 	if (FileType != FILETYPE_INDIRECT_ENTRY)
 	{
-		N(n+2); printf ("Error - FileType should have been \"Indirect Entry\"\n");
+		N(n+2); TRACE ("Error - FileType should have been \"Indirect Entry\"\n");
 		free (buffer);
 		return -1;
 	}
@@ -1038,11 +1158,11 @@ static void TerminalEntry (int n, struct cdfs_disc_t *disc, uint8_t *buffer)
 	int l;
 	int strategy4096;
 
-	N(n);   printf ("[Terminal Entry]\n");
+	N(n);   TRACE ("[Terminal Entry]\n");
 	print_4_14_6 (n+1, "ICB TAG", buffer + 16, &Flags, &FileType, &strategy4096 /* ignore */);
 	if (FileType != FILETYPE_TERMINAL_ENTRY)
 	{
-		N(n+2);printf ("Error - FileType should have been \"Terminal Entry\"\n");
+		N(n+2);TRACE ("Error - FileType should have been \"Terminal Entry\"\n");
 		return;
 	}
 }
@@ -1070,7 +1190,7 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 		recursion++;
 		if (recursion > 10000)
 		{
-			N(n+2); printf ("Warning - recursion limit hit\n"); break;
+			N(n+2); TRACE ("Warning - recursion limit hit\n"); break;
 		}
 
 		switch (Flags & 0x03)
@@ -1078,7 +1198,7 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 			case 0:
 				if (l < 8)
 				{
-					N(n+1); printf ("WARNING - Ran out of extent data (l=%d)\n", l);
+					N(n+1); TRACE ("WARNING - Ran out of extent data (l=%d)\n", l);
 					return;
 				}
 
@@ -1087,8 +1207,8 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 				DataExtentLocation = (b[7] << 24) | (b[6] << 16) | (b[5] << 8) | b[4];
 				DataFlags =           b[3] >> 6;
 
-				N(n+1); printf ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
-				N(n+1); printf ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
+				N(n+1); TRACE ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
+				N(n+1); TRACE ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
 				l -= 8;
 				b += 8;
 				break;
@@ -1096,7 +1216,7 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 			case 1:
 				if (l < 16)
 				{
-					N(n+1); printf ("WARNING - Ran out of extent data (l=%d)\n", l);
+					N(n+1); TRACE ("WARNING - Ran out of extent data (l=%d)\n", l);
 					return;
 				}
 
@@ -1111,9 +1231,9 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 					Extent erased
 				}*/
 				/* Implementation Use:  b[12], b[13], b[14], b[15] */
-				N(n+1); printf ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
-				N(n+1); printf ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
-				N(n+1); printf ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
+				N(n+1); TRACE ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
+				N(n+1); TRACE ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
+				N(n+1); TRACE ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
 
 				DataExtentVolume = 0;
 				lv = UDF_GetLogicalPartition (disc, DataExtentPartId);
@@ -1128,7 +1248,7 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 			case 2:
 				if (l < 20)
 				{
-					N(n+1); printf ("WARNING - Ran out of extent data (l=%d)\n", l);
+					N(n+1); TRACE ("WARNING - Ran out of extent data (l=%d)\n", l);
 					return;
 				}
 				DataExtentLength =  ((b[ 3] << 24) | (b[ 2] << 16) | (b[ 1] << 8) | b[ 0]) & 0x3fffffff;
@@ -1137,11 +1257,11 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 				DataExtentLocation = (b[15] << 24) | (b[14] << 16) | (b[13] << 8) | b[12];
 				DataExtentPartId =                                   (b[17] << 8) | b[16];
 
-				N(n+1); printf ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
-				N(n+1); printf ("Recorded.Length:       %" PRId32 "\n", RecordedLength);
-				N(n+1); printf ("Information.Length:    %" PRId32 "\n", InformationLength);
-				N(n+1); printf ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
-				N(n+1); printf ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
+				N(n+1); TRACE ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
+				N(n+1); TRACE ("Recorded.Length:       %" PRId32 "\n", RecordedLength);
+				N(n+1); TRACE ("Information.Length:    %" PRId32 "\n", InformationLength);
+				N(n+1); TRACE ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
+				N(n+1); TRACE ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
 
 				/* Implementation Use: b[18], b[19] */
 				DataExtentVolume = 0;
@@ -1155,38 +1275,38 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 				break;
 
 			case 3:
-				N(n+1); printf ("(Data stored directly in the FileEntry record\n");
+				N(n+1); TRACE ("(Data stored directly in the FileEntry record\n");
 				return;
 		}
 
-		N(n+1); printf ("Data.Flags:            0x%" PRIx8 "\n", DataFlags);
+		N(n+1); TRACE ("Data.Flags:            0x%" PRIx8 "\n", DataFlags);
 
 		switch (DataFlags)
 		{
 			case 0: /* Extent recorded and allocated */
-				N(n+2); printf ("Extent recorded and allocated\n");
+				N(n+2); TRACE ("Extent recorded and allocated\n");
 				if (!DataExtentVolume)
 				{
-					N(n+1); printf ("WARNING - Unable to find partition\n");
+					N(n+1); TRACE ("WARNING - Unable to find partition\n");
 					return;
 				}
 				break;
 
 			case 1: /* Extent not recorded but allocated */
-				N(n+2); printf ("Extent not recorded but allocated\n");
+				N(n+2); TRACE ("Extent not recorded but allocated\n");
 				break;
 
 			case 2: /* Extent not recorded and not allocated */
-				N(n+2); printf ("Extent not recorded and not allocated\n");
+				N(n+2); TRACE ("Extent not recorded and not allocated\n");
 				break;
 
 			case 3: /* The extent is the next extent of allocation descriptors */
-				N(n+2); printf ("The extent is the next extent of allocation descriptors\n");
+				N(n+2); TRACE ("The extent is the next extent of allocation descriptors\n");
 				OuterExtentLength = DataExtentLength;
 				OuterExtentLocation = DataExtentLocation;
 				if (!DataExtentVolume)
 				{
-					N(n+1); printf ("WARNING - Unable to find partition\n");
+					N(n+1); TRACE ("WARNING - Unable to find partition\n");
 					return;
 				}
 				PartitionCommon = DataExtentVolume;
@@ -1197,7 +1317,7 @@ static void SpaceEntryDumpData (int n, struct cdfs_disc_t *disc, uint8_t *b, uin
 		{
 			if (PartitionCommon->FetchSector (disc, PartitionCommon, buffer, OuterExtentLocation))
 			{
-				N(n+1); printf ("WARNING - Failed to fetch Chain-Extent: %"PRIu32"\n", OuterExtentLocation);
+				N(n+1); TRACE ("WARNING - Failed to fetch Chain-Extent: %"PRIu32"\n", OuterExtentLocation);
 				return;
 			}
 			l = OuterExtentLength > SECTORSIZE ? SECTORSIZE : OuterExtentLength;
@@ -1224,15 +1344,15 @@ static void SpaceEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Co
 	struct UDF_shortad NShort;
 	struct UDF_PhysicalPartition_t *NPartition;
 
-	N(n); printf ("[%s Space Entry Sequence]\n", prefix);
+	N(n); TRACE ("[%s Space Entry Sequence]\n", prefix);
 	if (L->ExtentLength < SECTORSIZE)
 	{
-		N(n+1); printf ("WARNING - ExtentLength < BUFFERSIZE\n");
+		N(n+1); TRACE ("WARNING - ExtentLength < BUFFERSIZE\n");
 	}
 
 	if (PartitionCommon->FetchSector (disc, PartitionCommon, buffer, L->ExtentPosition))
 	{
-		N(n+1); printf ("Error - Failed fetching data\n");
+		N(n+1); TRACE ("Error - Failed fetching data\n");
 		return;
 	}
 
@@ -1242,7 +1362,7 @@ static void SpaceEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Co
 	}
 	if (TagIdentifier != 0x0107)
 	{
-		N(n+1); printf ("Error - Wrong TagIdentifier\n");
+		N(n+1); TRACE ("Error - Wrong TagIdentifier\n");
 		return;
 	}
 
@@ -1250,17 +1370,18 @@ static void SpaceEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Co
 
 	if (FileType != FILETYPE_UNALLOCATED_SPACE_ENTRY)
 	{
-		N(n+1); printf ("Error - Wrong FileType\n");
+		N(n+1); TRACE ("Error - Wrong FileType\n");
 		return;
 	}
 
-	N(n+1); printf ("Length of Allocation Descriptors: %" PRId32 "\n", L_AD = (buffer[39] << 24) | (buffer[38] << 16) | (buffer[37] << 8) | buffer[36]);
-	N(n+1); printf ("Allocation descriptors:\n");
+	L_AD = (buffer[39] << 24) | (buffer[38] << 16) | (buffer[37] << 8) | buffer[36];
+	N(n+1); TRACE ("Length of Allocation Descriptors: %" PRId32 "\n", L_AD);
+	N(n+1); TRACE ("Allocation descriptors:\n");
 	b = buffer + 40;
 	l = L_AD;
 	if (L_AD > (SECTORSIZE - 40))
 	{
-		N(n+2); printf ("WARNING - buffer shrunk due to size overflow\n");
+		N(n+2); TRACE ("WARNING - buffer shrunk due to size overflow\n");
 	}
 
 	SpaceEntryDumpData (n, disc, b, l, PartitionCommon, Flags, buffer);
@@ -1273,7 +1394,7 @@ static void SpaceEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Co
 	/* try to find newer version */
 	if (recursion > MAX_INDIRECT_RECURSION)
 	{
-		N(n+2);printf ("Error - indirect recursion limit reached\n");
+		N(n+2);TRACE ("Error - indirect recursion limit reached\n");
 		return;
 	}
 
@@ -1284,19 +1405,65 @@ static void SpaceEntry (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Co
 	NPartition = UDF_GetPhysicalPartition (disc, NLong.ExtentLocation.PartitionReferenceNumber);
 	if (!NPartition)
 	{
-		N(n+2);printf ("Error - Partition not found\n");
+		N(n+2);TRACE ("Error - Partition not found\n");
 		return;
 	}
 	UDF_shortad_from_longad (&NShort, &NLong);
 	SpaceEntry (n+3, disc, &NPartition->PartitionCommon, &NShort, prefix, recursion + 1);
 }
 
-static int FileEntryLoadData (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE, uint8_t **filedata, uint64_t MaxLength)
+/* Copies length bytes, starting at offset in the file. Holes, and data past the last allocation, are read as zeroes. Returns non-zero on errors */
+static int FileEntryReadData (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE, uint64_t offset, uint8_t *buffer, uint64_t length)
 {
-	uint8_t *b;
-	uint64_t l;
-	int i, j;
+	uint64_t position = 0; /* where the current allocation starts in the file */
+	int i;
+
+	if ((offset > FE->InformationLength) || (length > (FE->InformationLength - offset)))
+	{
+		return -1;
+	}
+
+	if (FE->InlineData)
+	{
+		memcpy (buffer, FE->InlineData + offset, length);
+		return 0;
+	}
+
+	for (i=0; (i < FE->FileAllocations) && length; i++)
+	{
+		uint64_t skip, bytes;
+
+		if (offset >= (position + FE->FileAllocation[i].InformationLength))
+		{
+			position += FE->FileAllocation[i].InformationLength;
+			continue;
+		}
+		skip = offset - position;
+		bytes = FE->FileAllocation[i].InformationLength - skip;
+		if (bytes > length)
+		{
+			bytes = length;
+		}
+
+		if (!FE->FileAllocation[i].Partition)
+		{
+			memset (buffer, 0, bytes);
+		} else if (UDF_ReadBytes (disc, FE->FileAllocation[i].Partition, FE->FileAllocation[i].ExtentLocation, skip, buffer, bytes))
+		{
+			return -1;
+		}
+		buffer += bytes;
+		offset += bytes;
+		length -= bytes;
+		position += FE->FileAllocation[i].InformationLength;
+	}
 
+	memset (buffer, 0, length);
+	return 0;
+}
+
+static int FileEntryLoadData (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE, uint8_t **filedata, uint64_t MaxLength)
+{
 	*filedata = 0;
 
 	if (!FE->InformationLength)
@@ -1309,45 +1476,20 @@ static int FileEntryLoadData (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *
 		return -1;
 	}
 
-	*filedata = calloc (FE->InformationLength + SECTORSIZE - 1, 1); /* taking into account a possible overshoot */
-	b = *filedata;
-	l = FE->InformationLength;
-
-	if (FE->InlineData)
+	*filedata = calloc (FE->InformationLength + SECTORSIZE - 1, 1); /* the parsers have always had zero padding after the data */
+	if (!*filedata)
 	{
-		memcpy (b, FE->InlineData, l);
-		return 0;
+		fprintf (stderr, "FileEntryLoadData() calloc() failed\n");
+		return -1;
 	}
 
-	for (i=0; i < FE->FileAllocations; i++)
+	if (FileEntryReadData (disc, FE, 0, *filedata, FE->InformationLength))
 	{
-		if (!FE->FileAllocation[i].Partition)
-		{
-			b += FE->FileAllocation[i].InformationLength;
-			if (l < FE->FileAllocation[i].InformationLength)
-			{ /* should not happend if UDF image is healthy */
-				return 0;
-			}
-			l -= FE->FileAllocation[i].InformationLength;
-			continue;
-		}
-		for (j=0; j < FE->FileAllocation[i].InformationLength; j += SECTORSIZE)
-		{
-			uint32_t r = FE->FileAllocation[i].InformationLength - j;
-			if (r > SECTORSIZE)
-			{
-				r = SECTORSIZE;
-			}
-			FE->FileAllocation[i].Partition->FetchSector (disc, FE->FileAllocation[i].Partition, b, FE->FileAllocation[i].ExtentLocation + (j / SECTORSIZE));
-			b += r;
-			if (l < r)
-			{ /* should not happend if UDF image is healthy */
-				return 0;
-			}
-			l -= r;
-		}
+		free (*filedata);
+		*filedata = 0;
+		return -1;
 	}
-	
+
 	return 0;
 }
 
@@ -1361,8 +1503,10 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 	int                    Size = 0;
 	int                    Fill = 0;
 	struct FileAllocation *Data = 0;
+	int                    ChainFill = 0;
+	struct FileAllocation *Chain = 0;
 
-	N(n); printf ("Allocation descriptors: (l=%d)\n", l);
+	N(n); TRACE ("Allocation descriptors: (l=%d)\n", l);
 	while (targetleft && l)
 	{
 		uint32_t DataExtentLength = 0;
@@ -1379,8 +1523,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 			case 0:
 				if (l < 8)
 				{
-					N(n+1); printf ("WARNING - Ran out of extent data (targetleft=%" PRIu64 " l=%d)\n", targetleft, l);
+					N(n+1); TRACE ("WARNING - Ran out of extent data (targetleft=%" PRIu64 " l=%d)\n", targetleft, l);
 					free (Data);
+					free (Chain);
 					return -1;
 				}
 
@@ -1389,8 +1534,8 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				DataExtentLocation = (b[7] << 24) | (b[6] << 16) | (b[5] << 8) | b[4];
 				DataFlags =           b[3] >> 6;
 
-				N(n+1); printf ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
-				N(n+1); printf ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
+				N(n+1); TRACE ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
+				N(n+1); TRACE ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
 				l -= 8;
 				b += 8;
 				break;
@@ -1398,8 +1543,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 			case 1:
 				if (l < 16)
 				{
-					N(n+1); printf ("WARNING - Ran out of extent data (targetleft=%" PRIu64 " l=%d)\n", targetleft, l);
+					N(n+1); TRACE ("WARNING - Ran out of extent data (targetleft=%" PRIu64 " l=%d)\n", targetleft, l);
 					free (Data);
+					free (Chain);
 					return -1;
 				}
 
@@ -1414,9 +1560,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 					Extent erased
 				}*/
 				/* Implementation Use:  b[12], b[13], b[14], b[15] */
-				N(n+1); printf ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
-				N(n+1); printf ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
-				N(n+1); printf ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
+				N(n+1); TRACE ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
+				N(n+1); TRACE ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
+				N(n+1); TRACE ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
 
 				DataExtentVolume = 0;
 				lv = UDF_GetLogicalPartition (disc, DataExtentPartId);
@@ -1431,8 +1577,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 			case 2:
 				if (l < 20)
 				{
-					N(n+1); printf ("WARNING - Ran out of extent data (targetleft=%" PRIu64 " l=%d)\n", targetleft, l);
+					N(n+1); TRACE ("WARNING - Ran out of extent data (targetleft=%" PRIu64 " l=%d)\n", targetleft, l);
 					free (Data);
+					free (Chain);
 					return -1;
 				}
 				DataExtentLength =  ((b[ 3] << 24) | (b[ 2] << 16) | (b[ 1] << 8) | b[ 0]) & 0x3fffffff;
@@ -1441,11 +1588,11 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				DataExtentLocation = (b[15] << 24) | (b[14] << 16) | (b[13] << 8) | b[12];
 				DataExtentPartId =                                   (b[17] << 8) | b[16];
 
-				N(n+1); printf ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
-				N(n+1); printf ("Recorded.Length:       %" PRId32 "\n", RecordedLength);
-				N(n+1); printf ("Information.Length:    %" PRId32 "\n", InformationLength);
-				N(n+1); printf ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
-				N(n+1); printf ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
+				N(n+1); TRACE ("Data.Extent.Length:    %" PRId32 "\n", DataExtentLength);
+				N(n+1); TRACE ("Recorded.Length:       %" PRId32 "\n", RecordedLength);
+				N(n+1); TRACE ("Information.Length:    %" PRId32 "\n", InformationLength);
+				N(n+1); TRACE ("Data.Extent.Location:  %" PRId32 "\n", DataExtentLocation);
+				N(n+1); TRACE ("Data.Extent.Partition: %" PRId32 "\n", DataExtentPartId);
 
 				/* Implementation Use: b[18], b[19] */
 				DataExtentVolume = 0;
@@ -1459,11 +1606,12 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				break;
 
 			case 3:
-				N(n+1); printf ("(Data stored directly in the FileEntry record\n");
+				N(n+1); TRACE ("(Data stored directly in the FileEntry record\n");
 				if (targetleft > l)
 				{
-					N(n+1); printf ("Error - inline-data is smalled than the required InformationLength\n");
+					N(n+1); TRACE ("Error - inline-data is smalled than the required InformationLength\n");
 					free (Data);
+					free (Chain);
 					return -1;
 				}
 
@@ -1472,8 +1620,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 					temp = realloc (*target, sizeof (**target) + sizeof ((*target)->FileAllocation[0]) + targetleft);
 					if (!temp)
 					{
-						N(n+2); printf ("Error - FileEntryAllocations() realloc() failed\n");
+						N(n+2); TRACE ("Error - FileEntryAllocations() realloc() failed\n");
 						free (Data);
+						free (Chain);
 						return -1;
 					}
 					*target = temp;
@@ -1485,18 +1634,21 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				(*target)->FileAllocation[0].ExtentLocation = (*target)->ExtentLocation;
 				(*target)->FileAllocation[0].SkipLength = InitialOffset;
 				(*target)->FileAllocation[0].InformationLength = (*target)->InformationLength;
+				(*target)->FileAllocation[0].AllocatedPartition = 0; /* inside the File Entry */
+				(*target)->FileAllocation[0].AllocatedLength = 0;
 				return 0;
 		}
 
-		N(n+1); printf ("Data.Flags:            0x%" PRIx8 "\n", DataFlags);
+		N(n+1); TRACE ("Data.Flags:            0x%" PRIx8 "\n", DataFlags);
 
 		if (Fill >= Size)
 		{
 			void *temp = realloc (Data, sizeof(Data[0]) * (Size + 100));
 			if (!temp)
 			{
-				N(n+2); printf ("Error - FileEntryAllocations() realloc() failed\n");
+				N(n+2); TRACE ("Error - FileEntryAllocations() realloc() failed\n");
 				free (Data);
+				free (Chain);
 				return -1;
 			}
 			Data = temp;
@@ -1506,11 +1658,12 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 		switch (DataFlags)
 		{
 			case 0: /* Extent recorded and allocated */
-				N(n+2); printf ("Extent recorded and allocated\n");
+				N(n+2); TRACE ("Extent recorded and allocated\n");
 				if (!DataExtentVolume)
 				{
-					N(n+1); printf ("WARNING - Unable to find partition\n");
+					N(n+1); TRACE ("WARNING - Unable to find partition\n");
 					free (Data);
+					free (Chain);
 					return -1;
 				}
 
@@ -1518,6 +1671,8 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				Data[Fill].ExtentLocation = DataExtentLocation;
 				Data[Fill].SkipLength = 0;
 				Data[Fill].InformationLength = InformationLength;
+				Data[Fill].AllocatedPartition = DataExtentVolume;
+				Data[Fill].AllocatedLength = DataExtentLength;
 				Fill++;
 
 				while (DataExtentLength && InformationLength)
@@ -1526,7 +1681,7 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 					Go = InformationLength > SECTORSIZE ? SECTORSIZE : InformationLength;
 					if (Go > targetleft)
 					{
-						N(n+1); printf ("WARNING - Data-over-shoot\n");
+						N(n+1); TRACE ("WARNING - Data-over-shoot\n");
 						Go = targetleft;
 					}
 					RecordedLength -= RecordedLength > SECTORSIZE ? SECTORSIZE : RecordedLength;
@@ -1538,12 +1693,14 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				break;
 
 			case 1: /* Extent not recorded but allocated */
-				N(n+2); printf ("Extent not recorded but allocated\n");
+				N(n+2); TRACE ("Extent not recorded but allocated\n");
 
 				Data[Fill].Partition = 0;
 				Data[Fill].ExtentLocation = DataExtentLocation;
 				Data[Fill].SkipLength = 0;
 				Data[Fill].InformationLength = InformationLength;
+				Data[Fill].AllocatedPartition = DataExtentVolume;
+				Data[Fill].AllocatedLength = DataExtentLength;
 				Fill++;
 
 				if (InformationLength > targetleft)
@@ -1554,12 +1711,14 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				break;
 
 			case 2: /* Extent not recorded and not allocated */
-				N(n+2); printf ("Extent not recorded and not allocated\n");
+				N(n+2); TRACE ("Extent not recorded and not allocated\n");
 
 				Data[Fill].Partition = 0;
 				Data[Fill].ExtentLocation = DataExtentLocation;
 				Data[Fill].SkipLength = 0;
 				Data[Fill].InformationLength = InformationLength;
+				Data[Fill].AllocatedPartition = 0;
+				Data[Fill].AllocatedLength = 0;
 				Fill++;
 
 				if (InformationLength > targetleft)
@@ -1570,15 +1729,32 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 				break;
 
 			case 3: /* The extent is the next extent of allocation descriptors */
-				N(n+2); printf ("The extent is the next extent of allocation descriptors\n");
+				N(n+2); TRACE ("The extent is the next extent of allocation descriptors\n");
 				OuterExtentLength = DataExtentLength;
 				OuterExtentLocation = DataExtentLocation;
 				if (!DataExtentVolume)
 				{
-					N(n+1); printf ("WARNING - Unable to find partition\n");
+					N(n+1); TRACE ("WARNING - Unable to find partition\n");
 					free (Data);
+					free (Chain);
 					return -1;
 				}
+				{
+					void *temp = realloc (Chain, sizeof (Chain[0]) * (ChainFill + 1));
+					if (!temp)
+					{
+						N(n+2); TRACE ("Error - FileEntryAllocations() realloc() failed\n");
+						free (Data);
+						free (Chain);
+						return -1;
+					}
+					Chain = temp;
+					memset (&Chain[ChainFill], 0, sizeof (Chain[0]));
+					Chain[ChainFill].ExtentLocation = DataExtentLocation;
+					Chain[ChainFill].AllocatedPartition = DataExtentVolume;
+					Chain[ChainFill].AllocatedLength = DataExtentLength;
+					ChainFill++;
+				}
 				PartitionCommon = DataExtentVolume;
 				l = 0; /* force full break */
 				break;
@@ -1588,8 +1764,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 		{
 			if (PartitionCommon->FetchSector (disc, PartitionCommon, OuterBuffer, OuterExtentLocation))
 			{
-				N(n+1); printf ("WARNING - Failed to fetch Chain-Extent: %"PRIu32"\n", OuterExtentLocation);
+				N(n+1); TRACE ("WARNING - Failed to fetch Chain-Extent: %"PRIu32"\n", OuterExtentLocation);
 				free (Data);
+				free (Chain);
 				return -1;
 			}
 			l = OuterExtentLength > SECTORSIZE ? SECTORSIZE : OuterExtentLength;
@@ -1601,8 +1778,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 
 	if (targetleft)
 	{
-		N(n+1); printf ("WARNING - Did not find enough extents\n");
+		N(n+1); TRACE ("WARNING - Did not find enough extents\n");
 		free (Data);
+		free (Chain);
 		return -1;
 	}
 
@@ -1611,8 +1789,9 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 		temp = realloc (*target, sizeof (**target) + sizeof ((*target)->FileAllocation[0]) * Fill);
 		if (!temp)
 		{
-			N(n+2); printf ("Error - FileEntryAllocations() realloc() failed\n");
+			N(n+2); TRACE ("Error - FileEntryAllocations() realloc() failed\n");
 			free (Data);
+			free (Chain);
 			return -1;
 		}
 		*target = temp;
@@ -1620,13 +1799,104 @@ static int FileEntryAllocations (int n, struct cdfs_disc_t *disc, struct UDF_Par
 	(*target)->FileAllocations = Fill;
 	memcpy ((*target)->FileAllocation, Data, sizeof (Data[0]) * Fill);
 	free (Data);
+	(*target)->AllocationExtents_N = ChainFill;
+	(*target)->AllocationExtents = Chain;
 
 	return 0;
 }
 
 /* 0x0105 */
 /* 0x010a */
-static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint32_t TagLocation, struct UDF_Partition_Common *PartitionCommon, int recursion /* set to zero */)
+#define UDF_ICB_BATCH 1024 /* directory children whose File Entries are prefetched together */
+
+struct UDF_ICB_Batch_Entry_t
+{
+	struct UDF_Partition_Common *Partition;
+	uint32_t                     Location;
+	uint32_t                     Absolute; /* only used if Mapped */
+	uint8_t                      Mapped;
+	uint8_t                      Valid;    /* Data holds the sector */
+	uint8_t                     *Data;
+};
+
+/* The File Entries of the next UDF_ICB_BATCH children of a directory, read sorted by disc sector instead of in directory order */
+struct UDF_ICB_Batch_t
+{
+	int                           Entries_N; /* sorted by Partition and Location once loaded */
+	struct UDF_ICB_Batch_Entry_t *Entries;
+	uint8_t                      *Data;
+};
+
+static int UDF_ICB_Batch_cmp_location (const void *a, const void *b)
+{
+	const struct UDF_ICB_Batch_Entry_t *A = a;
+	const struct UDF_ICB_Batch_Entry_t *B = b;
+
+	if (A->Partition != B->Partition)
+	{
+		return ((uintptr_t)A->Partition < (uintptr_t)B->Partition) ? -1 : 1;
+	}
+	if (A->Location != B->Location)
+	{
+		return (A->Location < B->Location) ? -1 : 1;
+	}
+	return 0;
+}
+
+/* Fetches an ICB sector, from the prefetched File Entries if possible */
+static int UDF_FetchICB (struct cdfs_disc_t *disc, struct UDF_Partition_Common *PartitionCommon, uint8_t *buffer, uint32_t Location)
+{
+	struct UDF_ICB_Batch_t *batch = disc->udf_session ? disc->udf_session->ICB_Batch : 0;
+
+	if (batch && batch->Entries_N)
+	{
+		struct UDF_ICB_Batch_Entry_t key, *entry;
+
+		key.Partition = PartitionCommon;
+		key.Location = Location;
+		entry = bsearch (&key, batch->Entries, batch->Entries_N, sizeof (batch->Entries[0]), UDF_ICB_Batch_cmp_location);
+		if (entry && entry->Valid)
+		{
+			memcpy (buffer, entry->Data, SECTORSIZE);
+			return 0;
+		}
+	}
+	return PartitionCommon->FetchSector (disc, PartitionCommon, buffer, Location);
+}
+
+static void FileEntry_Free (struct UDF_FileEntry_t *FE)
+{
+	if (FE)
+	{
+		if (FE->Streams)
+		{
+			UDF_Directory_Free (FE->Streams);
+			free (FE->Streams);
+		}
+		free (FE->PreviousVersions);
+		free (FE->AllocationExtents);
+		free (FE);
+	}
+}
+
+/* Records an older version of the ICB in FE, for strategy 4096 */
+static void FileEntry_AppendVersion (struct UDF_FileEntry_t *FE, struct UDF_Partition_Common *Partition, uint32_t Location, uint8_t TimeStamp[12])
+{
+	struct UDF_FileEntry_Version_t *temp = realloc (FE->PreviousVersions, sizeof (FE->PreviousVersions[0]) * (FE->PreviousVersions_N + 1));
+	if (!temp)
+	{
+		fprintf (stderr, "FileEntry_AppendVersion() realloc() failed\n");
+		return;
+	}
+	FE->PreviousVersions = temp;
+	FE->PreviousVersions[FE->PreviousVersions_N].Partition = Partition;
+	FE->PreviousVersions[FE->PreviousVersions_N].Location = Location;
+	memcpy (FE->PreviousVersions[FE->PreviousVersions_N].TimeStamp, TimeStamp, 12);
+	FE->PreviousVersions_N++;
+}
+
+/* Decodes a single File Entry, without following strategy 4096 to newer versions */
+static struct UDF_FileEntry_t *FileEntryDecode (int n, struct cdfs_disc_t *disc, uint32_t TagLocation, struct UDF_Partition_Common *PartitionCommon, int *strategy4096)
 {
 	struct UDF_FileEntry_t *retval;
 	uint32_t L_AD;
@@ -1636,29 +1906,30 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 	uint8_t buffer[SECTORSIZE];
 	struct UDF_longad ExtendedAttributeICB;
 
-	int strategy4096 = 0;
 	int isextended;
 
-	N(n); printf ("..[File Entry]\n");
+	*strategy4096 = 0;
+
+	N(n); TRACE ("..[File Entry]\n");
 
 	if (!PartitionCommon)
 	{
-		N(n+1); printf ("Error - unable to find Partition\n");
+		N(n+1); TRACE ("Error - unable to find Partition\n");
 		return 0;
 	}
 
 	retval = calloc (1, sizeof (*retval));
 	if (!retval)
 	{
-		N(n+1); printf ("Error - FileEntry() calloc failed\n");
+		N(n+1); TRACE ("Error - FileEntry() calloc failed\n");
 		return 0;
 	}
 	retval->PartitionCommon = PartitionCommon;
 	retval->ExtentLocation = TagLocation;
 
-	if (PartitionCommon->FetchSector (disc, PartitionCommon, buffer, TagLocation))
+	if (UDF_FetchICB (disc, PartitionCommon, buffer, TagLocation))
 	{
-		N(n+1); printf ("Error - unable to fetch sector\n");
+		N(n+1); TRACE ("Error - unable to fetch sector\n");
 		free (retval);
 		return 0;
 	}
@@ -1671,39 +1942,43 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 
 	switch (retval->TagIdentifier)
 	{
-		case 0x0105: isextended = 0; N(n); printf ("[File Entry]\n"); break;
-		case 0x010a: isextended = 1; N(n); printf ("[Extended File Entry]\n"); break;
+		case 0x0105: isextended = 0; N(n); TRACE ("[File Entry]\n"); break;
+		case 0x010a: isextended = 1; N(n); TRACE ("[Extended File Entry]\n"); break;
 		default:
-			printf ("WARNING - unexpected TagIdentifier\n");
+			TRACE ("WARNING - unexpected TagIdentifier\n");
 			free (retval);
 			return 0;
 	}
 
-	print_4_14_6 (n+1, "ICB TAG", buffer + 16, &retval->Flags, &retval->FileType, &strategy4096);
-	N(n+1); printf ("UID:                               %" PRId32 "\n", retval->UID =         (buffer[39] << 24) | (buffer[38] << 16) | (buffer[37] <<  8) |  buffer[36]);
-	N(n+1); printf ("GID:                               %" PRId32 "\n", retval->GID =         (buffer[43] << 24) | (buffer[42] << 16) | (buffer[41] <<  8) |  buffer[40]);
-	N(n+1); printf ("Permissions:                       %" PRId32 "\n", retval->Permissions = (buffer[47] << 24) | (buffer[46] << 16) | (buffer[45] <<  8) |  buffer[44]);
-	N(n+1); printf ("File Link Count:                   %" PRIu16 "\n",                                                                 (buffer[49] <<  8) |  buffer[48]);
-	N(n+1); printf ("Record Format:                     %" PRIu8  "\n",                                                                                       buffer[50]);
+	print_4_14_6 (n+1, "ICB TAG", buffer + 16, &retval->Flags, &retval->FileType, strategy4096);
+	retval->Strategy4096 = *strategy4096;
+	retval->UID = (buffer[39] << 24) | (buffer[38] << 16) | (buffer[37] <<  8) |  buffer[36];
+	N(n+1); TRACE ("UID:                               %" PRId32 "\n", retval->UID);
+	retval->GID = (buffer[43] << 24) | (buffer[42] << 16) | (buffer[41] <<  8) |  buffer[40];
+	N(n+1); TRACE ("GID:                               %" PRId32 "\n", retval->GID);
+	retval->Permissions = (buffer[47] << 24) | (buffer[46] << 16) | (buffer[45] <<  8) |  buffer[44];
+	N(n+1); TRACE ("Permissions:                       %" PRId32 "\n", retval->Permissions);
+	N(n+1); TRACE ("File Link Count:                   %" PRIu16 "\n",                                                                 (buffer[49] <<  8) |  buffer[48]);
+	N(n+1); TRACE ("Record Format:                     %" PRIu8  "\n",                                                                                       buffer[50]);
 	switch (buffer[50])
 	{
-		case  0: N(n+2); printf ("structure of the information recorded in the file is not specified by this field.\n"); break;
-		case  1: N(n+2); printf ("information in the file is a sequence of padded fixed-length records.\n"); break; // (see 5/9.2.1)
-		case  2: N(n+2); printf ("information in the file is a sequence of fixed-length records.\n"); break; // (see 5/9.2.2)
-		case  3: N(n+3); printf ("information in the file is a sequence of variable-length-8 records.\n"); break; // (see 5/9.2.3.1)
-		case  4: N(n+3); printf ("information in the file is a sequence of variable-length-16 records.\n"); break; // (see 5/9.2.3.2)
-		case  5: N(n+3); printf ("information in the file is a sequence of variable-length-16-MSB records.\n"); break; // (see 5/9.2.3.3)
-		case  6: N(n+3); printf ("information in the file is a sequence of variable-length-32 records.\n"); break; // (see 5/9.2.3.4)
-		case  7: N(n+3); printf ("information in the file is a sequence of stream-print records.\n"); break; // (see 5/9.2.4)
-		case  8: N(n+3); printf ("information in the file is a sequence of stream-LF records.\n"); break; // (see 5/9.2.5)
-		case  9: N(n+3); printf ("information in the file is a sequence of stream-CR records.\n"); break; // (see 5/9.2.6)
-		case 10: N(n+3); printf ("information in the file is a sequence of stream-CRLF records.\n"); break; // (see 5/9.2.7)
-		case 11: N(n+3); printf ("information in the file is a sequence of stream-LFCR records.\n"); break; // (see 5/9.2.8
-		default: N(n+3); printf ("record format value is reserved.\n");
-	}
-	N(n+1); printf ("Record Display Attributes:         %" PRIu8  "\n",                                                                 buffer[51]);
-	N(n+1); printf ("Record Length:                     %" PRId32 "\n", (buffer[55] << 24) | (buffer[54] << 16) | (buffer[53] <<  8) |  buffer[52]);
-	N(n+1); printf ("Information Length:                %" PRId64 "\n", retval->InformationLength = (
+		case  0: N(n+2); TRACE ("structure of the information recorded in the file is not specified by this field.\n"); break;
+		case  1: N(n+2); TRACE ("information in the file is a sequence of padded fixed-length records.\n"); break; // (see 5/9.2.1)
+		case  2: N(n+2); TRACE ("information in the file is a sequence of fixed-length records.\n"); break; // (see 5/9.2.2)
+		case  3: N(n+3); TRACE ("information in the file is a sequence of variable-length-8 records.\n"); break; // (see 5/9.2.3.1)
+		case  4: N(n+3); TRACE ("information in the file is a sequence of variable-length-16 records.\n"); break; // (see 5/9.2.3.2)
+		case  5: N(n+3); TRACE ("information in the file is a sequence of variable-length-16-MSB records.\n"); break; // (see 5/9.2.3.3)
+		case  6: N(n+3); TRACE ("information in the file is a sequence of variable-length-32 records.\n"); break; // (see 5/9.2.3.4)
+		case  7: N(n+3); TRACE ("information in the file is a sequence of stream-print records.\n"); break; // (see 5/9.2.4)
+		case  8: N(n+3); TRACE ("information in the file is a sequence of stream-LF records.\n"); break; // (see 5/9.2.5)
+		case  9: N(n+3); TRACE ("information in the file is a sequence of stream-CR records.\n"); break; // (see 5/9.2.6)
+		case 10: N(n+3); TRACE ("information in the file is a sequence of stream-CRLF records.\n"); break; // (see 5/9.2.7)
+		case 11: N(n+3); TRACE ("information in the file is a sequence of stream-LFCR records.\n"); break; // (see 5/9.2.8
+		default: N(n+3); TRACE ("record format value is reserved.\n");
+	}
+	N(n+1); TRACE ("Record Display Attributes:         %" PRIu8  "\n",                                                                 buffer[51]);
+	N(n+1); TRACE ("Record Length:                     %" PRId32 "\n", (buffer[55] << 24) | (buffer[54] << 16) | (buffer[53] <<  8) |  buffer[52]);
+	retval->InformationLength = (
 		((uint64_t)(buffer[63]) << 56) |
 		((uint64_t)(buffer[62]) << 48) |
 		((uint64_t)(buffer[61]) << 40) |
@@ -1711,10 +1986,11 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 		((uint64_t)(buffer[59]) << 24) |
 		((uint64_t)(buffer[58]) << 16) |
 		((uint64_t)(buffer[57]) <<  8) |
-		            buffer[56]));
+		            buffer[56]);
+	N(n+1); TRACE ("Information Length:                %" PRId64 "\n", retval->InformationLength);
 	if (!isextended)
 	{
-		N(n+1); printf ("Logical Blocks Recorded:           %" PRId64 "\n",
+		N(n+1); TRACE ("Logical Blocks Recorded:           %" PRId64 "\n",
 			((uint64_t)(buffer[71]) << 56) |
 			((uint64_t)(buffer[70]) << 48) |
 			((uint64_t)(buffer[69]) << 40) |
@@ -1724,7 +2000,7 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 			((uint64_t)(buffer[65]) <<  8) |
 			            buffer[64]);
 	} else {
-		N(n+1); printf ("Object Size:                       %" PRId64 "\n",
+		N(n+1); TRACE ("Object Size:                       %" PRId64 "\n",
 			((uint64_t)(buffer[71]) << 56) |
 			((uint64_t)(buffer[70]) << 48) |
 			((uint64_t)(buffer[69]) << 40) |
@@ -1733,7 +2009,7 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 			((uint64_t)(buffer[66]) << 16) |
 			((uint64_t)(buffer[65]) <<  8) |
 			            buffer[64]);
-		N(n+1); printf ("Logical Blocks Recorded:           %" PRId64 "\n",
+		N(n+1); TRACE ("Logical Blocks Recorded:           %" PRId64 "\n",
 			((uint64_t)(buffer[79]) << 56) |
 			((uint64_t)(buffer[78]) << 48) |
 			((uint64_t)(buffer[77]) << 40) |
@@ -1749,39 +2025,47 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 	memcpy (retval->ctime, buffer + (isextended?104:84), 12); /* use mtime if not extended */
 	memcpy (retval->attrtime, buffer + (isextended?116:112), 12);
 
-	N(n+1); printf ("Access Date and Time:              "); print_1_7_3 (buffer + (isextended?80:72)); putchar ('\n');
-	N(n+1); printf ("Modification Date and Time:        "); print_1_7_3 (buffer + (isextended?92:84)); putchar ('\n');
+	N(n+1); TRACE ("Access Date and Time:              "); print_1_7_3 (buffer + (isextended?80:72)); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Modification Date and Time:        "); print_1_7_3 (buffer + (isextended?92:84)); TRACE_PUTCHAR ('\n');
 	memcpy (retval->TimeStamp, buffer + (isextended?92:84), 12);
 	if (isextended)
 	{
-		N(n+1); printf ("Creation Date and Time:            "); print_1_7_3 (buffer + 104); putchar ('\n');
+		N(n+1); TRACE ("Creation Date and Time:            "); print_1_7_3 (buffer + 104); TRACE_PUTCHAR ('\n');
 	}
-	N(n+1); printf ("Attribute Date and Time:           "); print_1_7_3 (buffer + (isextended?116:96)); putchar ('\n');
-	N(n+1); printf ("Checkpoint:                        %" PRId32 "\n", (buffer[isextended?131:111] << 24) | (buffer[isextended?130:110] << 16) | (buffer[isextended?129:109] <<  8) |  buffer[isextended?128:108]);
+	N(n+1); TRACE ("Attribute Date and Time:           "); print_1_7_3 (buffer + (isextended?116:96)); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Checkpoint:                        %" PRId32 "\n", (buffer[isextended?131:111] << 24) | (buffer[isextended?130:110] << 16) | (buffer[isextended?129:109] <<  8) |  buffer[isextended?128:108]);
 	/* if extended, 4 bytes are reserved */
 
 	UDF_longad_from_data(n+1, "Extended Attribute ICB.", &ExtendedAttributeICB, buffer + (isextended?136:112));
+	retval->ExtendedAttributeICB = ExtendedAttributeICB;
 
 	if (isextended)
 	{
-		N(n+1); printf ("Stream Directory ICB.Extent Length: %" PRId32 "\n", (buffer[155] << 24) | (buffer[154] << 16) | (buffer[153] <<  8) |  buffer[152]);
-		N(n+1); printf ("Stream Directory ICB.Extent Location.Logical Block Number: %" PRId32 "\n", (buffer[159] << 24) | (buffer[158] << 16) | (buffer[157] <<  8) |  buffer[156]);
-		N(n+1); printf ("Stream Directory ICB.Extent Location.Partition Reference Number: %" PRId16 "\n", (buffer[161] <<  8) |  buffer[160]);
+		N(n+1); TRACE ("Stream Directory ICB.Extent Length: %" PRId32 "\n", (buffer[155] << 24) | (buffer[154] << 16) | (buffer[153] <<  8) |  buffer[152]);
+		N(n+1); TRACE ("Stream Directory ICB.Extent Location.Logical Block Number: %" PRId32 "\n", (buffer[159] << 24) | (buffer[158] << 16) | (buffer[157] <<  8) |  buffer[156]);
+		N(n+1); TRACE ("Stream Directory ICB.Extent Location.Partition Reference Number: %" PRId16 "\n", (buffer[161] <<  8) |  buffer[160]);
 		/* next 6 bytes are reserved in the "Stream Directory ICB" */
-	}
-	N(n+1); printf ("Implementation Identifier:         "); print_1_7_4 (buffer + (isextended?168:128), 1 /* IsImplementation */); putchar ('\n');
-	N(n+1); printf ("Unique Id:                         0x%02x%02x%02x%02x%02x%02x%02x%02x\n", buffer[isextended?207:167], buffer[isextended?206:166], buffer[isextended?205:165], buffer[isextended?204:164], buffer[isextended?203:163], buffer[isextended?202:162], buffer[isextended?201:161], buffer[isextended?200:160]);
-	N(n+1); printf ("Length of Extended Attributes:     %" PRId32 "\n", L_EA = (buffer[isextended?211:171] << 24) | (buffer[isextended?210:170] << 16) | (buffer[isextended?209:169] <<  8) |  buffer[isextended?208:168]);
-	N(n+1); printf ("Length of Allocation Descriptors:  %" PRId32 "\n", L_AD = (buffer[isextended?215:175] << 24) | (buffer[isextended?214:174] << 16) | (buffer[isextended?213:173] <<  8) |  buffer[isextended?212:172]);
-	N(n+1); printf ("Extended Attributes:\n");
+		retval->StreamDirectoryICB.ExtentLength                      = (buffer[155] << 24) | (buffer[154] << 16) | (buffer[153] <<  8) |  buffer[152];
+		retval->StreamDirectoryICB.ExtentLocation.LogicalBlockNumber = (buffer[159] << 24) | (buffer[158] << 16) | (buffer[157] <<  8) |  buffer[156];
+		retval->StreamDirectoryICB.ExtentLocation.PartitionReferenceNumber =                                      (buffer[161] <<  8) |  buffer[160];
+	}
+	N(n+1); TRACE ("Implementation Identifier:         "); print_1_7_4 (buffer + (isextended?168:128), 1 /* IsImplementation */); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Unique Id:                         0x%02x%02x%02x%02x%02x%02x%02x%02x\n", buffer[isextended?207:167], buffer[isextended?206:166], buffer[isextended?205:165], buffer[isextended?204:164], buffer[isextended?203:163], buffer[isextended?202:162], buffer[isextended?201:161], buffer[isextended?200:160]);
+	L_EA = (buffer[isextended?211:171] << 24) | (buffer[isextended?210:170] << 16) | (buffer[isextended?209:169] <<  8) |  buffer[isextended?208:168];
+	N(n+1); TRACE ("Length of Extended Attributes:     %" PRId32 "\n", L_EA);
+	L_AD = (buffer[isextended?215:175] << 24) | (buffer[isextended?214:174] << 16) | (buffer[isextended?213:173] <<  8) |  buffer[isextended?212:172];
+	N(n+1); TRACE ("Length of Allocation Descriptors:  %" PRId32 "\n", L_AD);
+	N(n+1); TRACE ("Extended Attributes:\n");
 
 	b = buffer + (isextended?216:176);
 	l = L_EA;
 	if (L_EA > (SECTORSIZE - (isextended?216:176)))
 	{
-		N(n+2); printf ("WARNING - buffer shrunk due to size overflow\n");
+		N(n+2); TRACE ("WARNING - buffer shrunk due to size overflow\n");
 		l = SECTORSIZE - (isextended?216:176);
 	}
+	retval->InlineExtendedAttributes_Offset = b - buffer;
+	retval->InlineExtendedAttributes_Length = l;
 	if (l)
 	{
 		ExtendedAttributesInline (n+2, b, l, TagLocation, (retval->FileType != FILETYPE_DIRECTORY)&&(retval->FileType != FILETYPE_STREAM_DIRECTORY), retval);
@@ -1795,7 +2079,7 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 	l = L_AD;
 	if (L_AD + L_EA > (SECTORSIZE - (isextended?216:176)))
 	{
-		N(n+2); printf ("WARNING - buffer not big enough for allocation entries");
+		N(n+2); TRACE ("WARNING - buffer not big enough for allocation entries");
 		free (retval);
 		return 0;
 	}
@@ -1806,6 +2090,22 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 		return 0;
 	}
 
+	return retval;
+#undef buffer
+}
+
+/* Returns the newest version of the ICB at TagLocation. Older strategy 4096 versions are only kept as locations in PreviousVersions */
+static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint32_t TagLocation, struct UDF_Partition_Common *PartitionCommon, int recursion /* set to zero */)
+{
+	struct UDF_FileEntry_t *retval;
+	int strategy4096;
+
+	retval = FileEntryDecode (n, disc, TagLocation, PartitionCommon, &strategy4096);
+	if (!retval)
+	{
+		return 0;
+	}
+
 	if (strategy4096)
 	{
 		struct UDF_FileEntry_t *retval2;
@@ -1815,7 +2115,7 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 		/* try to find newer version */
 		if (recursion > MAX_INDIRECT_RECURSION)
 		{
-			N(n+2);printf ("Error - indirect recursion limit reached\n");
+			N(n+2);TRACE ("Error - indirect recursion limit reached\n");
 			return retval;
 		}
 
@@ -1826,31 +2126,75 @@ static struct UDF_FileEntry_t *FileEntry (int n, struct cdfs_disc_t *disc, uint3
 		NPartition = UDF_GetLogicalPartition (disc, NLong.ExtentLocation.PartitionReferenceNumber);
 		if (!NPartition)
 		{
-			N(n+2);printf ("Error - Partition not found\n");
+			N(n+2);TRACE ("Error - Partition not found\n");
 			return retval;
 		}
 
 		retval2 = FileEntry (n+3, disc, NLong.ExtentLocation.LogicalBlockNumber, &NPartition->PartitionCommon, recursion + 1);
 		if (retval2)
-		{
-			retval2->PreviousVersion = retval;
+		{ /* only the location of this version is kept, the recursion appends them oldest last */
+			FileEntry_AppendVersion (retval2, retval->PartitionCommon, retval->ExtentLocation, retval->TimeStamp);
+			FileEntry_Free (retval);
 			return retval2;
 		}
 	}
 
 	return retval;
-#undef buffer
 }
 
-static void FileEntry_Free (struct UDF_FileEntry_t *FE)
+/* Decodes previous version index of FE, 0 being the newest of them. The older versions are copied over, so the result can be
+ * walked further back. Returns NULL on errors */
+static struct UDF_FileEntry_t *FileEntry_PreviousVersion (int n, struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE, int index)
 {
-	struct UDF_FileEntry_t *next;
-	while (FE)
+	struct UDF_FileEntry_t *retval;
+	int strategy4096;
+	int i;
+
+	if ((index < 0) || (index >= FE->PreviousVersions_N))
 	{
-		next = FE->PreviousVersion;
-		free (FE);
-		FE=next;
+		return 0;
+	}
+	retval = FileEntryDecode (n, disc, FE->PreviousVersions[index].Location, FE->PreviousVersions[index].Partition, &strategy4096);
+	if (!retval)
+	{
+		return 0;
+	}
+	for (i = index + 1; i < FE->PreviousVersions_N; i++)
+	{
+		FileEntry_AppendVersion (retval, FE->PreviousVersions[i].Partition, FE->PreviousVersions[i].Location, FE->PreviousVersions[i].TimeStamp);
+	}
+	return retval;
+}
+
+/* For --at-timestamp, replaces *FE with the newest version recorded at or before disc->udf_timestamp. ICBs without history are kept
+ * as is. Returns non-zero if all versions are newer, or on errors, in that case *FE has been released */
+static int FileEntry_AtTimeStamp (int n, struct cdfs_disc_t *disc, struct UDF_FileEntry_t **FE)
+{
+	struct UDF_FileEntry_t *old;
+	int i;
+
+	if ((!disc->udf_has_timestamp) || (!(*FE)->PreviousVersions_N) || (DumpFS_UDF_time ((*FE)->TimeStamp) <= disc->udf_timestamp))
+	{
+		return 0;
+	}
+	for (i=0; i < (*FE)->PreviousVersions_N; i++)
+	{
+		if (DumpFS_UDF_time ((*FE)->PreviousVersions[i].TimeStamp) <= disc->udf_timestamp)
+		{
+			break;
+		}
+	}
+	if (i >= (*FE)->PreviousVersions_N)
+	{
+		N(n); TRACE ("All versions of this ICB are newer than the requested timestamp\n");
+		old = 0;
+	} else {
+		N(n); TRACE ("Using version %d of this ICB\n", (*FE)->PreviousVersions_N - i);
+		old = FileEntry_PreviousVersion (n + 1, disc, *FE, i);
 	}
+	FileEntry_Free (*FE);
+	*FE = old;
+	return old ? 0 : -1;
 }
 
 /* 0x0106 */
@@ -1872,7 +2216,7 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 
 	if (l < 24)
 	{
-		printf ("WARNING - Extended Attributes is not big enough to contain the initial header (%d < 24)\n", (int)l);
+		TRACE ("WARNING - Extended Attributes is not big enough to contain the initial header (%d < 24)\n", (int)l);
 		return;
 	}
 
@@ -1883,12 +2227,12 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 
 	if (TagIdentifier != 0x0106)
 	{
-		N(n+1); printf ("Error - TagIdentifier was not the expected 0x0106\n");
+		N(n+1); TRACE ("Error - TagIdentifier was not the expected 0x0106\n");
 		return;
 	}
 
-	N(n+2); printf ("Implementation Attributes Location: %"PRIu32"%s\n", (b[19] << 24) | (b[18] << 16) | (b[17] << 8) | (b[16]), ((b[19] << 24) | (b[18] << 16) | (b[17] << 8) | (b[16])) > l ? " OUT OF RANGE":"");
-	N(n+2); printf ("Application Attributes Location: %"PRIu32"%s\n", (b[23] << 24) | (b[22] << 16) | (b[21] << 8) | (b[20]), ((b[23] << 24) | (b[22] << 16) | (b[21] << 8) | (b[20])) > l ? " OUT OF RANGE":"");
+	N(n+2); TRACE ("Implementation Attributes Location: %"PRIu32"%s\n", (b[19] << 24) | (b[18] << 16) | (b[17] << 8) | (b[16]), ((b[19] << 24) | (b[18] << 16) | (b[17] << 8) | (b[16])) > l ? " OUT OF RANGE":"");
+	N(n+2); TRACE ("Application Attributes Location: %"PRIu32"%s\n", (b[23] << 24) | (b[22] << 16) | (b[21] << 8) | (b[20]), ((b[23] << 24) | (b[22] << 16) | (b[21] << 8) | (b[20])) > l ? " OUT OF RANGE":"");
 	b += 24;
 	l -= 24;
 
@@ -1897,81 +2241,81 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 		uint32_t AttributeType =   (b[ 3] << 24) | (b[ 2] << 16) | (b[1] << 8) | (b[0]);
 		uint8_t  AttributeSubtype =                                               b[4];
 		uint32_t AttributeLength = (b[11] << 24) | (b[10] << 16) | (b[9] << 8) | (b[8]);
-		N(n+2); printf ("ExtendedAttribute.%d.AttributeType:    %"PRIu32"\n", i, AttributeType);
-		N(n+2); printf ("ExtendedAttribute.%d.AttributeSubType: %"PRIu8"\n", i, AttributeSubtype);
-		N(n+2); printf ("ExtendedAttribute.%d.AttributeLength:  %"PRIu32"\n", i, AttributeLength);
+		N(n+2); TRACE ("ExtendedAttribute.%d.AttributeType:    %"PRIu32"\n", i, AttributeType);
+		N(n+2); TRACE ("ExtendedAttribute.%d.AttributeSubType: %"PRIu8"\n", i, AttributeSubtype);
+		N(n+2); TRACE ("ExtendedAttribute.%d.AttributeLength:  %"PRIu32"\n", i, AttributeLength);
 		i++;
 
 		if ((AttributeLength > l) || (AttributeLength < 12))
 		{
-			N(n+2); printf ("WARNING - buffer overrun 12 >= %d <= %d\n", AttributeLength, l); return;
+			N(n+2); TRACE ("WARNING - buffer overrun 12 >= %d <= %d\n", AttributeLength, l); return;
 		}
 		switch (AttributeType)
 		{
 			case 1: /* not mentioned in UDF */
-				N(n+3); printf ("[Character Set Information]\n"); // 4/14.10.3
+				N(n+3); TRACE ("[Character Set Information]\n"); // 4/14.10.3
 				if (AttributeLength < 17)
 				{
-					N(n+4);printf ("Error - Attribute too short\n");
+					N(n+4);TRACE ("Error - Attribute too short\n");
 					break;
 				}
 				{
 					uint32_t ES_L = (b[15]<<24) | (b[14]<<16) | (b[13]<<8) | b[12];
 					uint8_t CharacterSetType = b[16];
 					int j;
-					N(n+4);printf ("EscapeSequencesLength: %"PRIu32"\n", ES_L);
-					N(n+4);printf ("CharacterSetType:      CS%"PRIu8"\n", CharacterSetType);
+					N(n+4);TRACE ("EscapeSequencesLength: %"PRIu32"\n", ES_L);
+					N(n+4);TRACE ("CharacterSetType:      CS%"PRIu8"\n", CharacterSetType);
 					if ((ES_L > AttributeLength) ||
 					    (ES_L + 17 > AttributeLength))
 					{
-						N(n+4);printf ("Error - Attribute too short to contain the data\n");
+						N(n+4);TRACE ("Error - Attribute too short to contain the data\n");
 						break;
 					}
-					N(n+4); printf ("Escape Sequence:    ");
+					N(n+4); TRACE ("Escape Sequence:    ");
 					for (j=0; j < ES_L; j++)
 					{
-						printf (" 0x%02" PRIu8, b[17+j]);
+						TRACE (" 0x%02" PRIu8, b[17+j]);
 					}
-					putchar ('\n');
+					TRACE_PUTCHAR ('\n');
 				}
 				break;
 			case 3: /* UDF standard prohibits this one*/
-				N(n+3); printf ("[Alternate Permissions] (tag not allowed according to UDF standard)\n"); // 4/14.10.4
+				N(n+3); TRACE ("[Alternate Permissions] (tag not allowed according to UDF standard)\n"); // 4/14.10.4
 				if (AttributeLength < 18)
 				{
-					N(n+4);printf ("Error - Attribute too short\n");
+					N(n+4);TRACE ("Error - Attribute too short\n");
 					break;
 				}
-				N(n+4);printf ("Owner Identification:   %"PRIu16"\n", (b[13]<<8) | b[12]);
-				N(n+4);printf ("Group Identification:   %"PRIu16"\n", (b[15]<<8) | b[14]);
-				N(n+4);printf ("Permission:             0x%04"PRIx16"\n", (b[17]<<8) | b[16]);
+				N(n+4);TRACE ("Owner Identification:   %"PRIu16"\n", (b[13]<<8) | b[12]);
+				N(n+4);TRACE ("Group Identification:   %"PRIu16"\n", (b[15]<<8) | b[14]);
+				N(n+4);TRACE ("Permission:             0x%04"PRIx16"\n", (b[17]<<8) | b[16]);
 				break;
 			case 5:
-				N(n+3); printf ("[File Times Extended Attribute]\n"); // 4/14.10.5
+				N(n+3); TRACE ("[File Times Extended Attribute]\n"); // 4/14.10.5
 				if (AttributeLength < 20)
 				{
-					N(n+4);printf ("Error - Attribute too short\n");
+					N(n+4);TRACE ("Error - Attribute too short\n");
 					break;
 				}
 				{
 					int index = 0;
 					uint32_t D_L =               (b[15]<<24) | (b[14]<<16) | (b[13]<<8) | b[12];
 					uint32_t FileTimeExistence = (b[19]<<24) | (b[18]<<16) | (b[17]<<8) | b[16];
-					N(n+4);printf ("DataLength:        %"PRIu32"\n", D_L);
-					N(n+4);printf ("FileTimeExistence: %"PRIu32"\n", FileTimeExistence);
+					N(n+4);TRACE ("DataLength:        %"PRIu32"\n", D_L);
+					N(n+4);TRACE ("FileTimeExistence: %"PRIu32"\n", FileTimeExistence);
 					if ((D_L > AttributeLength) ||
 					    (D_L + 20 > AttributeLength))
 					{
-						N(n+4); printf ("Error - Attribute too short to contain the data\n");
+						N(n+4); TRACE ("Error - Attribute too short to contain the data\n");
 						break;
 					}
 					if (FileTimeExistence & 1)
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Created Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Created Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 					/* 2 is reserved due to compatability with ECMA-168 */
@@ -1979,18 +2323,18 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Delete Request Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Delete Request Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 					if (FileTimeExistence & 8)
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Effective Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Effective Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 					/* 16 is reserved due to compatability with ECMA-168 */
@@ -1998,94 +2342,94 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Last Backup Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Last Backup Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 				}
 				break;
 			case 6: /* not mentioned in UDF - when was then information inside the file created - user supplied information? */
-				N(n+3); printf ("[Information Times Extended Attribute]\n"); // 4/14.10.6
+				N(n+3); TRACE ("[Information Times Extended Attribute]\n"); // 4/14.10.6
 				if (AttributeLength < 20)
 				{
-					N(n+4);printf ("Error - Attribute too short\n");
+					N(n+4);TRACE ("Error - Attribute too short\n");
 					break;
 				}
 				{
 					int index = 0;
 					uint32_t D_L =               (b[15]<<24) | (b[14]<<16) | (b[13]<<8) | b[12];
 					uint32_t FileTimeExistence = (b[19]<<24) | (b[18]<<16) | (b[17]<<8) | b[16];
-					N(n+4);printf ("DataLength:        %"PRIu32"\n", D_L);
-					N(n+4);printf ("FileTimeExistence: %"PRIu32"\n", FileTimeExistence);
+					N(n+4);TRACE ("DataLength:        %"PRIu32"\n", D_L);
+					N(n+4);TRACE ("FileTimeExistence: %"PRIu32"\n", FileTimeExistence);
 					if ((D_L > AttributeLength) ||
 					    (D_L + 20 > AttributeLength))
 					{
-						N(n+4); printf ("Error - Attribute too short to contain the data\n");
+						N(n+4); TRACE ("Error - Attribute too short to contain the data\n");
 						break;
 					}
 					if (FileTimeExistence & 1)
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Information Created Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Information Created Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 					if (FileTimeExistence & 2)
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Information Last Modified Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Information Last Modified Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 					if (FileTimeExistence & 4)
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Information Expiration Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Information Expiration Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 					if (FileTimeExistence & 8)
 					{
 						if (index * 12 > D_L)
 						{
-							N(n+4);printf ("Error - Buffer overrun\n");
+							N(n+4);TRACE ("Error - Buffer overrun\n");
 						}
-						N(n+4); printf ("Information Effective Date/Time: "); print_1_7_3 (b + 20 + index * 12); putchar ('\n');
+						N(n+4); TRACE ("Information Effective Date/Time: "); print_1_7_3 (b + 20 + index * 12); TRACE_PUTCHAR ('\n');
 						index++;
 					}
 				}
 				break;
 			case 12:
-				N(n+3); printf ("[Device Specification]\n"); // 4/14.10.7
+				N(n+3); TRACE ("[Device Specification]\n"); // 4/14.10.7
 				if (AttributeLength < 24)
 				{
-					printf ("Error - Attribute too short\n");
+					TRACE ("Error - Attribute too short\n");
 					break;
 				}
 				{
 					uint32_t I_UL = (b[15]<<24) | (b[14]<<16) | (b[13]<<8) | b[12];
 					uint32_t major = (b[19]<<24) | (b[18]<<16) | (b[17]<<8) | b[16];
 					uint32_t minor = (b[23]<<24) | (b[22]<<16) | (b[21]<<8) | b[20];
-					N(n+4); printf ("Implementation Use Length %"PRIu32"\n", I_UL);
+					N(n+4); TRACE ("Implementation Use Length %"PRIu32"\n", I_UL);
 					if ((I_UL        > AttributeLength) ||
 					    ((I_UL + 24) > AttributeLength))
 					{
-						N(n+5); printf ("WARNING - size will overflow buffer\n");
+						N(n+5); TRACE ("WARNING - size will overflow buffer\n");
 						I_UL = 0;
 					}
 					if (I_UL && I_UL < 32)
 					{
-						N(n+5); printf ("WARNING - size is too small\n");
+						N(n+5); TRACE ("WARNING - size is too small\n");
 					}
-					N(n+4); printf ("Major: %"PRIu32"\n", major);
-					N(n+4); printf ("Minor: %"PRIu32"\n", minor);
+					N(n+4); TRACE ("Major: %"PRIu32"\n", major);
+					N(n+4); TRACE ("Minor: %"PRIu32"\n", minor);
 					if (extendedattributes_target)
 					{
 						extendedattributes_target->HasMajorMinor = 1;
@@ -2094,25 +2438,25 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 					}
 					if (I_UL)
 					{
-						N(n+4); printf ("Implementation Identifier: "); print_1_7_4 (b + 24, 1); putchar ('\n');
+						N(n+4); TRACE ("Implementation Identifier: "); print_1_7_4 (b + 24, 1); TRACE_PUTCHAR ('\n');
 						if (I_UL > 32)
 						{
 							int j;
 							N(n+5);
 							for (j = 32; j < I_UL; j++)
 							{
-								printf ("%s0x%02x", j!=32?" ":"", b[24+j]);
+								TRACE ("%s0x%02x", j!=32?" ":"", b[24+j]);
 							}
-							putchar ('\n');
+							TRACE_PUTCHAR ('\n');
 						}
 					}
 				}
 				break;
 			case 2048:
-				N(n+3); printf ("[Implementation Use Extended Attribute]\n"); // 4/14.10.8
+				N(n+3); TRACE ("[Implementation Use Extended Attribute]\n"); // 4/14.10.8
 				if (AttributeLength < 48)
 				{
-					printf ("Error - Attribute too short\n");
+					TRACE ("Error - Attribute too short\n");
 					break;
 				}
 				{
@@ -2120,151 +2464,151 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 					uint16_t I_CheckSum = (b[49]<<8) | b[48];
 					uint32_t I_UL = (b[15]<<24) | (b[14]<<16) | (b[13]<<8) | b[12];
 					int j;
-					N(n+4); printf ("Implementation Use Length %"PRIu32"\n", I_UL);
+					N(n+4); TRACE ("Implementation Use Length %"PRIu32"\n", I_UL);
 					if ((I_UL        > AttributeLength) ||
 					    ((I_UL + 48) > AttributeLength))
 					{
-						N(n+5); printf ("WARNING - size will overflow buffer, capping (I_UL %d + 48 > AttributeLength %d)\n", I_UL, AttributeLength);
+						N(n+5); TRACE ("WARNING - size will overflow buffer, capping (I_UL %d + 48 > AttributeLength %d)\n", I_UL, AttributeLength);
 						I_UL = AttributeLength - 48;
 					}
-					N(n+4); printf ("Implementation Identifier: "); print_1_7_4 (b + 16, 1); putchar ('\n');
+					N(n+4); TRACE ("Implementation Identifier: "); print_1_7_4 (b + 16, 1); TRACE_PUTCHAR ('\n');
 					if (!memcmp (b + 16 + 1, "*UDF FreeEASpace", 17))
 					{
-						N(n+5); printf ("[Free EASpace]\n"); // UDF 2.60 3.3.4.5.1.1 - this is a place-holder for potentially unused space that can be reused
+						N(n+5); TRACE ("[Free EASpace]\n"); // UDF 2.60 3.3.4.5.1.1 - this is a place-holder for potentially unused space that can be reused
 						if (I_UL < 2)
 						{
-							N(n+5); printf ("WARNING - buffer underflow %d < 2\n", I_UL);
+							N(n+5); TRACE ("WARNING - buffer underflow %d < 2\n", I_UL);
 							break;
 						}
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
 						if (I_UL > 2)
 						{
 							N(n+6);
 							for (j = 2; j < I_UL; j++)
 							{
-								printf (" 0x%02x", b[48+j]);
+								TRACE (" 0x%02x", b[48+j]);
 							}
 						}
 					} else if (!memcmp (b + 16 + 1, "*UDF DVD CGMS Info", 19)) // UDF 2.60 3.3.4.5.1.2
 					{
-						N(n+5); printf ("[DVD Copyright Management Information]\n");
+						N(n+5); TRACE ("[DVD Copyright Management Information]\n");
 						if (I_UL < 8)
 						{
-							N(n+5); printf ("WARNING - buffer will underflow\n");
+							N(n+5); TRACE ("WARNING - buffer will underflow\n");
 							break;
 						}
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
-						N(n+6); printf ("CGMS Information:              %"PRIu8"\n", b[50]); // Part of the DVD specification....
-						N(n+6); printf ("Data Structure Type:           %"PRIu8"\n", b[51]); // Part of the DVD specification....
-						N(n+6); printf ("Protection System Information: %"PRIu32"\n", (b[55]<<24) | (b[54]<<16) | (b[53]<<8) | b[52]);
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
+						N(n+6); TRACE ("CGMS Information:              %"PRIu8"\n", b[50]); // Part of the DVD specification....
+						N(n+6); TRACE ("Data Structure Type:           %"PRIu8"\n", b[51]); // Part of the DVD specification....
+						N(n+6); TRACE ("Protection System Information: %"PRIu32"\n", (b[55]<<24) | (b[54]<<16) | (b[53]<<8) | b[52]);
 					} else if (!memcmp (b + 16 + 1, "*UDF OS/2 EALength", 19))
 					{
-						N(n+5); printf ("[OS2EALength]\n"); // UDF 2.60 3.3.4.5.3.1 - Optimization OS/2 needs during directory scanning in order to prepare something
+						N(n+5); TRACE ("[OS2EALength]\n"); // UDF 2.60 3.3.4.5.3.1 - Optimization OS/2 needs during directory scanning in order to prepare something
 						if (I_UL < 6)
 						{
-							N(n+5); printf ("WARNING - buffer will underflow\n");
+							N(n+5); TRACE ("WARNING - buffer will underflow\n");
 							break;
 						}
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
-						N(n+6); printf ("OS/2 Extended Attribute Length: %"PRIu32"\n", (b[53]<<24) | (b[52]<<16) | (b[51]<<8) | b[50]);
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
+						N(n+6); TRACE ("OS/2 Extended Attribute Length: %"PRIu32"\n", (b[53]<<24) | (b[52]<<16) | (b[51]<<8) | b[50]);
 					} else if (!memcmp (b + 16 + 1, "*UDF Mac VolumeInfo", 20))
 					{
-						N(n+5); printf ("[Macintosh volume information]\n"); // UDF 2.60 3.3.4.5.4.1
+						N(n+5); TRACE ("[Macintosh volume information]\n"); // UDF 2.60 3.3.4.5.4.1
 						if (I_UL < 58)
 						{
-							N(n+5); printf ("WARNING - buffer will underflow\n");
+							N(n+5); TRACE ("WARNING - buffer will underflow\n");
 							break;
 						}
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
-						N(n+6); printf ("Last Modification Date: "); print_1_7_3 (b+50); putchar ('\n');
-						N(n+6); printf ("Last Backup Date:        "); print_1_7_3 (b+62); putchar ('\n');
-						N(n+6); printf ("Volume Finder Information:\n");
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
+						N(n+6); TRACE ("Last Modification Date: "); print_1_7_3 (b+50); TRACE_PUTCHAR ('\n');
+						N(n+6); TRACE ("Last Backup Date:        "); print_1_7_3 (b+62); TRACE_PUTCHAR ('\n');
+						N(n+6); TRACE ("Volume Finder Information:\n");
 						N(n+6);
 						for (j = 0; j < 32; j++)
 						{
-							printf (" 0x%02x", b[48+26+j]);
+							TRACE (" 0x%02x", b[48+26+j]);
 						}
-						putchar ('\n');
+						TRACE_PUTCHAR ('\n');
 					} else if (!memcmp (b + 16 + 1, "*UDF Mac FinderInfo", 20))
 					{
-						N(n+5); printf ("[Macintosh Finder information]\n"); // UDF 2.60 3.3.4.5.4.2
+						N(n+5); TRACE ("[Macintosh Finder information]\n"); // UDF 2.60 3.3.4.5.4.2
 						if (isfile)
 						{
 							if (I_UL < (40))
 							{
-								N(n+5); printf ("WARNING - buffer will underflow\n");
+								N(n+5); TRACE ("WARNING - buffer will underflow\n");
 								break;
 							}
 						} else {
 							if (I_UL < (48))
 							{
-								N(n+5); printf ("WARNING - buffer will underflow\n");
+								N(n+5); TRACE ("WARNING - buffer will underflow\n");
 								break;
 							}
 						}
 
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
 						// 2 bytes padding, should be zero...
-						N(n+6); printf ("Parent Directory ID: %"PRIu32"\n", (b[55]<<24) | (b[54]<<16) | (b[53]<<8) | b[52]);
+						N(n+6); TRACE ("Parent Directory ID: %"PRIu32"\n", (b[55]<<24) | (b[54]<<16) | (b[53]<<8) | b[52]);
 						if (isfile)
 						{
-							N(n+6); printf ("File Information.FdType:             %"PRIu32"\n", (b[59]<<24) | (b[58]<<16) | (b[57]<<8) | b[56]);
-							N(n+6); printf ("File Information.FdCreator:          %"PRIu32"\n", (b[63]<<24) | (b[62]<<16) | (b[61]<<8) | b[60]);
-							N(n+6); printf ("File Information.FdFlags:            %"PRIu16"\n",                             (b[65]<<8) | b[64]);
-							N(n+6); printf ("File Information.FdLocation.V:       %"PRIu16"\n",                             (b[67]<<8) | b[66]);
-							N(n+6); printf ("File Information.FdLocation.H:       %"PRIu16"\n",                             (b[69]<<8) | b[68]);
-							N(n+6); printf ("File Information.FdFldr:             %"PRIu16"\n",                             (b[71]<<8) | b[70]);
-							N(n+6); printf ("File Extended Information.FdIconID:  %"PRIu16"\n",                             (b[73]<<8) | b[72]);
+							N(n+6); TRACE ("File Information.FdType:             %"PRIu32"\n", (b[59]<<24) | (b[58]<<16) | (b[57]<<8) | b[56]);
+							N(n+6); TRACE ("File Information.FdCreator:          %"PRIu32"\n", (b[63]<<24) | (b[62]<<16) | (b[61]<<8) | b[60]);
+							N(n+6); TRACE ("File Information.FdFlags:            %"PRIu16"\n",                             (b[65]<<8) | b[64]);
+							N(n+6); TRACE ("File Information.FdLocation.V:       %"PRIu16"\n",                             (b[67]<<8) | b[66]);
+							N(n+6); TRACE ("File Information.FdLocation.H:       %"PRIu16"\n",                             (b[69]<<8) | b[68]);
+							N(n+6); TRACE ("File Information.FdFldr:             %"PRIu16"\n",                             (b[71]<<8) | b[70]);
+							N(n+6); TRACE ("File Extended Information.FdIconID:  %"PRIu16"\n",                             (b[73]<<8) | b[72]);
 							// 6 bytes of unused data....
-							N(n+6); printf ("File Extended Information.FdScript:  %"PRIu8"\n",                                           b[80]);
-							N(n+6); printf ("File Extended Information.FdXflags:  %"PRIu8"\n",                                           b[81]);
-							N(n+6); printf ("File Extended Information.FrComment: %"PRIu16"\n",                             (b[83]<<8) | b[82]);
-							N(n+6); printf ("File Extended Information.FrPutAway: %"PRIu32"\n", (b[87]<<24) | (b[86]<<16) | (b[85]<<8) | b[84]);
-							N(n+6); printf ("Resource Fork Data Length:       %"PRIu32"\n", (b[91]<<24) | (b[90]<<16) | (b[89]<<8) | b[88]);
-							N(n+6); printf ("Resource Fork Allocation Length: %"PRIu32"\n", (b[95]<<24) | (b[94]<<16) | (b[93]<<8) | b[92]);
+							N(n+6); TRACE ("File Extended Information.FdScript:  %"PRIu8"\n",                                           b[80]);
+							N(n+6); TRACE ("File Extended Information.FdXflags:  %"PRIu8"\n",                                           b[81]);
+							N(n+6); TRACE ("File Extended Information.FrComment: %"PRIu16"\n",                             (b[83]<<8) | b[82]);
+							N(n+6); TRACE ("File Extended Information.FrPutAway: %"PRIu32"\n", (b[87]<<24) | (b[86]<<16) | (b[85]<<8) | b[84]);
+							N(n+6); TRACE ("Resource Fork Data Length:       %"PRIu32"\n", (b[91]<<24) | (b[90]<<16) | (b[89]<<8) | b[88]);
+							N(n+6); TRACE ("Resource Fork Allocation Length: %"PRIu32"\n", (b[95]<<24) | (b[94]<<16) | (b[93]<<8) | b[92]);
 						} else {
-							N(n+6); printf ("Directory Information.FrRect.Top:           %"PRIu16"\n",                             (b[57]<<8) | b[56]);
-							N(n+6); printf ("Directory Information.FrRect.Left:          %"PRIu16"\n",                             (b[59]<<8) | b[58]);
-							N(n+6); printf ("Directory Information.FrRect.Bottom:        %"PRIu16"\n",                             (b[61]<<8) | b[60]);
-							N(n+6); printf ("Directory Information.FrRect.Right:         %"PRIu16"\n",                             (b[63]<<8) | b[62]);
-							N(n+6); printf ("Directory Information.FrFlags:              %"PRIu16"\n",                             (b[65]<<8) | b[64]);
-							N(n+6); printf ("Directory Information.FrLocation.V:         %"PRIu16"\n",                             (b[67]<<8) | b[66]);
-							N(n+6); printf ("Directory Information.FrLocation.H:         %"PRIu16"\n",                             (b[69]<<8) | b[68]);
-							N(n+6); printf ("Directory Information.FrView:               %"PRIu16"\n",                             (b[71]<<8) | b[70]);
-							N(n+6); printf ("Directory Extended Information.FrScroll.V:  %"PRIu16"\n",                             (b[73]<<8) | b[72]);
-							N(n+6); printf ("Directory Extended Information.FrScroll.H:  %"PRIu16"\n",                             (b[75]<<8) | b[74]);
-							N(n+6); printf ("Directory Extended Information.FrOpenChain: %"PRIu32"\n", (b[79]<<24) | (b[78]<<16) | (b[77]<<8) | b[76]);
-							N(n+6); printf ("Directory Extended Information.FrScript:    %"PRIu8"\n",                                           b[80]);
-							N(n+6); printf ("Directory Extended Information.FrXflags:    %"PRIu8"\n",                                           b[81]);
-							N(n+6); printf ("Directory Extended Information.FrComment:   %"PRIu16"\n",                             (b[83]<<8) | b[82]);
-							N(n+6); printf ("Directory Extended Information.FrPutAway:   %"PRIu32"\n", (b[87]<<24) | (b[86]<<16) | (b[85]<<8) | b[84]);
+							N(n+6); TRACE ("Directory Information.FrRect.Top:           %"PRIu16"\n",                             (b[57]<<8) | b[56]);
+							N(n+6); TRACE ("Directory Information.FrRect.Left:          %"PRIu16"\n",                             (b[59]<<8) | b[58]);
+							N(n+6); TRACE ("Directory Information.FrRect.Bottom:        %"PRIu16"\n",                             (b[61]<<8) | b[60]);
+							N(n+6); TRACE ("Directory Information.FrRect.Right:         %"PRIu16"\n",                             (b[63]<<8) | b[62]);
+							N(n+6); TRACE ("Directory Information.FrFlags:              %"PRIu16"\n",                             (b[65]<<8) | b[64]);
+							N(n+6); TRACE ("Directory Information.FrLocation.V:         %"PRIu16"\n",                             (b[67]<<8) | b[66]);
+							N(n+6); TRACE ("Directory Information.FrLocation.H:         %"PRIu16"\n",                             (b[69]<<8) | b[68]);
+							N(n+6); TRACE ("Directory Information.FrView:               %"PRIu16"\n",                             (b[71]<<8) | b[70]);
+							N(n+6); TRACE ("Directory Extended Information.FrScroll.V:  %"PRIu16"\n",                             (b[73]<<8) | b[72]);
+							N(n+6); TRACE ("Directory Extended Information.FrScroll.H:  %"PRIu16"\n",                             (b[75]<<8) | b[74]);
+							N(n+6); TRACE ("Directory Extended Information.FrOpenChain: %"PRIu32"\n", (b[79]<<24) | (b[78]<<16) | (b[77]<<8) | b[76]);
+							N(n+6); TRACE ("Directory Extended Information.FrScript:    %"PRIu8"\n",                                           b[80]);
+							N(n+6); TRACE ("Directory Extended Information.FrXflags:    %"PRIu8"\n",                                           b[81]);
+							N(n+6); TRACE ("Directory Extended Information.FrComment:   %"PRIu16"\n",                             (b[83]<<8) | b[82]);
+							N(n+6); TRACE ("Directory Extended Information.FrPutAway:   %"PRIu32"\n", (b[87]<<24) | (b[86]<<16) | (b[85]<<8) | b[84]);
 						}
 					} else if (!memcmp (b + 16 + 1, "*UDF OS/400 DirInfo", 20))
 					{
-						N(n+5); printf ("[OS/400 extended directory information]\n"); // UDF 2.60 3.3.4.5.6.1 - Cache for OS/400 Directory listing
+						N(n+5); TRACE ("[OS/400 extended directory information]\n"); // UDF 2.60 3.3.4.5.6.1 - Cache for OS/400 Directory listing
 						if (I_UL < (48))
 						{
-							N(n+5); printf ("WARNING - buffer will underflow\n");
+							N(n+5); TRACE ("WARNING - buffer will underflow\n");
 							break;
 						}
 
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
 						// 2 bytes padding, should be zero...
 						// 44 bytes of DirectoryInfo - information propetiary by IBM
 					} else {
 						N(n+5);
 						for (j = 0; j < I_UL; j++)
 						{
-							printf ("%s0x%02x", j?" ":"", b[48+j]);
+							TRACE ("%s0x%02x", j?" ":"", b[48+j]);
 						}
 					}
-					putchar ('\n');
+					TRACE_PUTCHAR ('\n');
 				}
 				break;
-			case 65536: N(n+3); printf ("[Application Use Extended Attribute]\n"); // 4/14.10.9
+			case 65536: N(n+3); TRACE ("[Application Use Extended Attribute]\n"); // 4/14.10.9
 				if (AttributeLength < 48)
 				{
-					printf ("Error - Attribute too short\n");
+					TRACE ("Error - Attribute too short\n");
 					break;
 				}
 				{
@@ -2272,40 +2616,40 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 					uint16_t I_CheckSum = (b[49]<<8) | b[48];
 					uint32_t AU_L = (b[15]<<24) | (b[14]<<16) | (b[13]<<8) | b[12];
 					int j;
-					N(n+4); printf ("Application Use Length %"PRIu32"\n", AU_L);
+					N(n+4); TRACE ("Application Use Length %"PRIu32"\n", AU_L);
 					if ((AU_L        > AttributeLength) ||
 					    ((AU_L + 48) > AttributeLength))
 					{
-						N(n+5); printf ("WARNING - size will overflow buffer, capping (AU_L %d + 48 > AttributeLength %d)\n", AU_L, AttributeLength);
+						N(n+5); TRACE ("WARNING - size will overflow buffer, capping (AU_L %d + 48 > AttributeLength %d)\n", AU_L, AttributeLength);
 						AU_L = AttributeLength - 48;
 					}
-					N(n+4); printf ("Application Identifier: "); print_1_7_4 (b + 16, 1); putchar ('\n');
+					N(n+4); TRACE ("Application Identifier: "); print_1_7_4 (b + 16, 1); TRACE_PUTCHAR ('\n');
 
 					if (!memcmp (b + 16 + 1, "*UDF FreeEASpace", 17))
 					{
-						N(n+5); printf ("[Free EASpace]\n"); // UDF 2.60 3.3.4.5.1.1 - this is a place-holder for potentially unused space that can be reused
+						N(n+5); TRACE ("[Free EASpace]\n"); // UDF 2.60 3.3.4.5.1.1 - this is a place-holder for potentially unused space that can be reused
 						if (AU_L < 2)
 						{
-							N(n+5); printf ("WARNING - buffer underflow %d < 2\n", AU_L);
+							N(n+5); TRACE ("WARNING - buffer underflow %d < 2\n", AU_L);
 							break;
 						}
-						N(n+6); printf ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) printf (" INVALID - expected %"PRIu16"\n", C_CheckSum); putchar('\n');
+						N(n+6); TRACE ("Header Checksum: %"PRIu16, I_CheckSum); if (I_CheckSum != C_CheckSum) TRACE (" INVALID - expected %"PRIu16"\n", C_CheckSum); TRACE_PUTCHAR('\n');
 						if (AU_L > 2)
 						{
 							N(n+6);
 							for (j = 2; j < AU_L; j++)
 							{
-								printf (" 0x%02x", b[48+j]);
+								TRACE (" 0x%02x", b[48+j]);
 							}
 						}
 					} else {
 						N(n+5);
 						for (j = 0; j < AU_L; j++)
 						{
-							printf ("%s0x%02x", j?" ":"", b[48+j]);
+							TRACE ("%s0x%02x", j?" ":"", b[48+j]);
 						}
 					}
-					putchar ('\n');
+					TRACE_PUTCHAR ('\n');
 				}
 
 				break;
@@ -2318,7 +2662,7 @@ static void ExtendedAttributesCommon (int n, uint8_t *b, uint32_t l, uint32_t Ta
 
 static void ExtendedAttributesInline (int n, uint8_t *buffer, uint32_t ExtentLength, uint32_t ExtentLocation, int isfile, struct UDF_FileEntry_t *extendedattributes_target)
 {
-	N(n); printf ("[Extended Attribute Header Descriptor]\n");
+	N(n); TRACE ("[Extended Attribute Header Descriptor]\n");
 	ExtendedAttributesCommon (n, buffer, ExtentLength, ExtentLocation, isfile, extendedattributes_target);
 }
 
@@ -2327,126 +2671,229 @@ static void ExtendedAttributes (int n, struct cdfs_disc_t *disc, struct UDF_long
 	struct UDF_LogicalVolume_Common *lv = UDF_GetLogicalPartition (disc, L->ExtentLocation.PartitionReferenceNumber);
 	uint8_t *buffer;
 
-	N(n); printf ("[Extended Attribute Header Descriptor]\n");
+	N(n); TRACE ("[Extended Attribute Header Descriptor]\n");
 
 	if (L->ExtentLength < 24)
 	{
-		N(n+1); printf ("Error - Length too small to contain header\n");
+		N(n+1); TRACE ("Error - Length too small to contain header\n");
 		return;
 	}
 
 	if (!lv)
 	{
-		N(n+1); printf ("Warning - unable to find partition for ExtendedAttributes\n");
+		N(n+1); TRACE ("Warning - unable to find partition for ExtendedAttributes\n");
 		return;
 	}
 
 	if (L->ExtentLength < SECTORSIZE)
 	{
-		N(n+1); printf ("Warning - ExtentLength < SECTORSIZE\n");
+		N(n+1); TRACE ("Warning - ExtentLength < SECTORSIZE\n");
 	}
 
 	buffer = UDF_FetchSectors (n+1, disc, &lv->PartitionCommon, L->ExtentLocation.LogicalBlockNumber, L->ExtentLength);
 	if (!buffer)
 	{
-		N(n+1); printf ("Error fetching data");
+		N(n+1); TRACE ("Error fetching data");
 		return;
 	}
 	ExtendedAttributesCommon (n, buffer, L->ExtentLength, L->ExtentLocation.LogicalBlockNumber, isfile, extendedattributes_target);
 	free (buffer);
 }
 
-/* 0x0108 - No strategy possible */
-static void SpaceBitMapCommon (int n, uint8_t *buffer, uint32_t ExtentLocation, uint32_t ExtentLength)
+/* Space bitmaps are handled 64 blocks at the time, so a volume of many gigabytes only takes a few million steps */
+static int UDF_Bits_Count64 (uint64_t v)
 {
-	int i;
-	uint32_t bits;
-	uint32_t bytes;
-	uint16_t TagIdentifier;
+#ifdef __GNUC__
+	return __builtin_popcountll (v);
+#else
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (v * 0x0101010101010101ULL) >> 56;
+#endif
+}
 
-#if 0
-	if (ExtentLength < 24)
+static int UDF_Bits_First64 (uint64_t v) /* v can not be zero */
+{
+#ifdef __GNUC__
+	return __builtin_ctzll (v);
+#else
+	int i = 0;
+	while (!(v & 1))
 	{
-		N(n); printf ("Error - Length too small to contain header\n");
-		return;
+		v >>= 1;
+		i++;
 	}
+	return i;
 #endif
+}
 
-	if (print_tag_format (n, "", buffer, ExtentLocation, 1, &TagIdentifier))
+static uint32_t UDF_Bits_Count (const uint64_t *words, uint32_t bits)
+{
+	uint32_t retval = 0;
+	uint32_t i;
+
+	for (i=0; i < ((bits + 63) >> 6); i++)
 	{
-		free (buffer);
-		return;
+		retval += UDF_Bits_Count64 (words[i]);
 	}
-	if (TagIdentifier != 0x0108)
+	return retval;
+}
+
+/* returns the first block from position that is set (or clear if set is zero), or bits if none */
+static uint32_t UDF_Bits_Next (const uint64_t *words, uint32_t bits, uint32_t position, int set)
+{
+	while (position < bits)
 	{
-		N(n); printf ("Error - Wrong TagIdentifier\n");
-		free (buffer);
-		return;
+		uint64_t w = set ? words[position >> 6] : ~words[position >> 6];
+
+		w &= ~(uint64_t)0 << (position & 63);
+		if (w)
+		{
+			position = (position & ~63) + UDF_Bits_First64 (w);
+			return (position < bits) ? position : bits;
+		}
+		position = (position | 63) + 1;
+	}
+	return bits;
+}
+
+static void UDF_Bits_PrintRuns (int n, const uint64_t *words, uint32_t bits)
+{
+	uint32_t start = UDF_Bits_Next (words, bits, 0, 1);
+
+	while (start < bits)
+	{
+		uint32_t end = UDF_Bits_Next (words, bits, start, 0);
+
+		N(n); TRACE ("%" PRIu32 "-%" PRIu32 " (%" PRIu32 " block%s)\n", start, end - 1, end - start, (end - start) == 1 ? "" : "s");
+		start = UDF_Bits_Next (words, bits, end, 1);
+	}
+}
+
+static void UDF_SpaceBitmap_Free (struct UDF_SpaceBitmap_t *bitmap)
+{
+	free (bitmap->Map);
+	bitmap->Map = 0;
+	bitmap->Bits = 0;
+	bitmap->FreeBlocks = 0;
+}
+
+/* 0x0108 - No strategy possible */
+static void SpaceBitMapCommon (int n, uint8_t *buffer, uint32_t ExtentLocation, uint32_t ExtentLength, struct UDF_SpaceBitmap_t *target)
+{
+	uint32_t i;
+	uint32_t bits;
+	uint32_t bytes;
+	uint16_t TagIdentifier;
+	uint64_t *map;
+
+#if 0
+	if (ExtentLength < 24)
+	{
+		N(n); TRACE ("Error - Length too small to contain header\n");
+		return;
+	}
+#endif
+
+	if (print_tag_format (n, "", buffer, ExtentLocation, 1, &TagIdentifier))
+	{
+		return;
+	}
+	if (TagIdentifier != 0x0108)
+	{
+		N(n); TRACE ("Error - Wrong TagIdentifier\n");
+		return;
 	}
 
 	bits = (buffer[19]<<24) | (buffer[18]<<16) | (buffer[17]<<8) | buffer[16];
 	bytes = (buffer[23]<<24) | (buffer[22]<<16) | (buffer[21]<<8) | buffer[20];
-	N(n); printf ("Number of bits:  %d\n", bits);
-	N(n); printf ("Number of bytes: %d\n", bytes);
+	N(n); TRACE ("Number of bits:  %" PRIu32 "\n", bits);
+	N(n); TRACE ("Number of bytes: %" PRIu32 "\n", bytes);
 	if (bytes > (ExtentLength - 24))
 	{
-		N(n); printf ("Warning - too big, clamping value\n");
+		N(n); TRACE ("Warning - too big, clamping value\n");
 		bytes = ExtentLength - 24;
 	}
-	N(n); printf ("Map:\n");
-	for (i=0; i < bytes; i++)
+	if (bits > ((uint64_t)bytes * 8))
 	{
-		if ((i & (32-1)) == 0)
-		{
-			if (i) putchar ('\n');
-			N(n+1);
-		}
-		printf (" 0x%02x", buffer[24+i]);
+		N(n); TRACE ("Warning - more bits than bytes, clamping value\n");
+		bits = bytes * 8;
+	}
+
+	map = calloc ((bits + 63) >> 6, sizeof (map[0]));
+	if (!map)
+	{
+		N(n); TRACE ("Error - SpaceBitMapCommon() calloc() failed\n");
+		return;
+	}
+	for (i=0; i < ((bits + 7) >> 3); i++)
+	{
+		map[i >> 3] |= (uint64_t)buffer[24 + i] << ((i & 7) << 3);
+	}
+	if (bits & 63)
+	{
+		map[bits >> 6] &= ((uint64_t)1 << (bits & 63)) - 1;
+	}
+
+	i = UDF_Bits_Count (map, bits);
+	N(n); TRACE ("Unallocated blocks: %" PRIu32 "\n", i);
+	N(n); TRACE ("Allocated blocks:   %" PRIu32 "\n", bits - i);
+	N(n); TRACE ("Unallocated extents:\n");
+	UDF_Bits_PrintRuns (n + 1, map, bits);
+
+	if (target)
+	{
+		UDF_SpaceBitmap_Free (target);
+		target->Bits = bits;
+		target->FreeBlocks = i;
+		target->Map = map;
+	} else {
+		free (map);
 	}
-	putchar ('\n');
 }
 
-static void SpaceBitMapInline (int n, uint8_t *buffer, uint32_t ExtentLocation, uint32_t ExtentLength)
+static void SpaceBitMapInline (int n, uint8_t *buffer, uint32_t ExtentLocation, uint32_t ExtentLength, struct UDF_SpaceBitmap_t *target)
 {
-	N(n); printf ("[MetaData Space Bitmap]\n");
+	N(n); TRACE ("[MetaData Space Bitmap]\n");
 	if (ExtentLength < 24)
 	{
-		N(n+1); printf ("Error - Length too small to contain header\n");
+		N(n+1); TRACE ("Error - Length too small to contain header\n");
 		return;
 	}
 
 	if (ExtentLength < SECTORSIZE)
 	{
-		N(n+1); printf ("Warning - ExtentLength < SECTORSIZE\n");
+		N(n+1); TRACE ("Warning - ExtentLength < SECTORSIZE\n");
 	}
 
-	SpaceBitMapCommon (n + 1, buffer, ExtentLocation, ExtentLength);
+	SpaceBitMapCommon (n + 1, buffer, ExtentLocation, ExtentLength, target);
 }
 
-static void SpaceBitMap (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Common *PartitionCommon, struct UDF_shortad *L, const char *prefix)
+static void SpaceBitMap (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Common *PartitionCommon, struct UDF_shortad *L, const char *prefix, struct UDF_SpaceBitmap_t *target)
 {
 	uint8_t *buffer;
 
-	N(n); printf ("[%s Space Bitmap]\n", prefix);
+	N(n); TRACE ("[%s Space Bitmap]\n", prefix);
 
 	if (L->ExtentLength < 24)
 	{
-		N(n+1); printf ("Error - Length too small to contain header\n");
+		N(n+1); TRACE ("Error - Length too small to contain header\n");
 		return;
 	}
 
 	if (L->ExtentLength < SECTORSIZE)
 	{
-		N(n+1); printf ("Warning - ExtentLength < SECTORSIZE\n");
+		N(n+1); TRACE ("Warning - ExtentLength < SECTORSIZE\n");
 	}
 
 	buffer = UDF_FetchSectors (n+1, disc, PartitionCommon, L->ExtentPosition, L->ExtentLength);
 	if (!buffer)
 	{
-		N(n+1); printf ("Error fetching data");
+		N(n+1); TRACE ("Error fetching data");
 		return;
 	}
-	SpaceBitMapCommon (n, buffer, L->ExtentPosition, L->ExtentLength);
+	SpaceBitMapCommon (n, buffer, L->ExtentPosition, L->ExtentLength, target);
 	free (buffer);
 }
 
@@ -2464,24 +2911,24 @@ static void PartitionIntegrityEntry (int n, struct cdfs_disc_t *disc, struct UDF
 	struct UDF_shortad NShort;
 	struct UDF_PhysicalPartition_t *NPartition;
 
-	N(n); printf ("[Partition Integrity Entry]\n");
-	N(n+1); printf ("Warning - this entry should not be recorded according to UDF 2.60 standard\n");
+	N(n); TRACE ("[Partition Integrity Entry]\n");
+	N(n+1); TRACE ("Warning - this entry should not be recorded according to UDF 2.60 standard\n");
 
 	if (L->ExtentLength < 512)
 	{
-		N(n+1); printf ("Error - Length too small to contain header\n");
+		N(n+1); TRACE ("Error - Length too small to contain header\n");
 		return;
 	}
 
 	if (L->ExtentLength != SECTORSIZE)
 	{
-		N(n+1); printf ("Warning - ExtentLength != SECTORSIZE\n");
+		N(n+1); TRACE ("Warning - ExtentLength != SECTORSIZE\n");
 	}
 
 	buffer = UDF_FetchSectors (n+1, disc, PartitionCommon, L->ExtentPosition, SECTORSIZE);
 	if (!buffer)
 	{
-		N(n+1); printf ("Error fetching data");
+		N(n+1); TRACE ("Error fetching data");
 		return;
 	}
 
@@ -2492,7 +2939,7 @@ static void PartitionIntegrityEntry (int n, struct cdfs_disc_t *disc, struct UDF
 	}
 	if (TagIdentifier != 0x0109)
 	{
-		N(n+1); printf ("Error - Wrong TagIdentifier\n");
+		N(n+1); TRACE ("Error - Wrong TagIdentifier\n");
 		free (buffer);
 		return;
 	}
@@ -2505,27 +2952,27 @@ static void PartitionIntegrityEntry (int n, struct cdfs_disc_t *disc, struct UDF
 		return;
 	}
 
-	N(n+1); printf ("Recording Date and Time: "); print_1_7_3 (buffer + 36); putchar ('\n');
+	N(n+1); TRACE ("Recording Date and Time: "); print_1_7_3 (buffer + 36); TRACE_PUTCHAR ('\n');
 
-	N(n+1); printf ("Integrity Type: %d\n", buffer[48]);
+	N(n+1); TRACE ("Integrity Type: %d\n", buffer[48]);
 	switch (buffer[48])
 	{
-		case 0: N(n+2); printf ("entry is an Open Integrity Entry\n"); break;
-		case 1: N(n+2); printf ("entry is an Close Integrity Entry\n"); break;
-		case 2: N(n+2); printf ("entry is an Stable Integrity Entry\n"); break;
-		default: N(n+2); printf ("Reserved value\n"); break;
+		case 0: N(n+2); TRACE ("entry is an Open Integrity Entry\n"); break;
+		case 1: N(n+2); TRACE ("entry is an Close Integrity Entry\n"); break;
+		case 2: N(n+2); TRACE ("entry is an Stable Integrity Entry\n"); break;
+		default: N(n+2); TRACE ("Reserved value\n"); break;
 	}
 
 	/* 175 reserved bytes */
 
-	printf ("Implementation Identifier: "); print_1_7_4 (buffer + 224, 1); putchar ('\n');
+	TRACE ("Implementation Identifier: "); print_1_7_4 (buffer + 224, 1); TRACE_PUTCHAR ('\n');
 
-	N(n+1); printf ("Implementation Use:\n");
+	N(n+1); TRACE ("Implementation Use:\n");
 	for (i=256; i < 512; i++)
 	{
-		printf (" 0x%02x", buffer[i]);
+		TRACE (" 0x%02x", buffer[i]);
 	}
-	putchar ('\n');
+	TRACE_PUTCHAR ('\n');
 
 	free(buffer);
 	buffer = 0;
@@ -2538,7 +2985,7 @@ static void PartitionIntegrityEntry (int n, struct cdfs_disc_t *disc, struct UDF
 	/* try to find newer version */
 	if (recursion > MAX_INDIRECT_RECURSION)
 	{
-		N(n+2);printf ("Error - indirect recursion limit reached\n");
+		N(n+2);TRACE ("Error - indirect recursion limit reached\n");
 		return;
 	}
 
@@ -2549,7 +2996,7 @@ static void PartitionIntegrityEntry (int n, struct cdfs_disc_t *disc, struct UDF
 	NPartition = UDF_GetPhysicalPartition (disc, NLong.ExtentLocation.PartitionReferenceNumber);
 	if (!NPartition)
 	{
-		N(n+2);printf ("Error - Partition not found\n");
+		N(n+2);TRACE ("Error - Partition not found\n");
 		return;
 	}
 	UDF_shortad_from_longad (&NShort, &NLong);
@@ -2571,48 +3018,52 @@ static void PrimaryVolumeDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *b
 	struct UDF_extent_ad VolumeCopyright;
 	uint32_t CharacterSetList;
 
-	N(n);   printf ("[Primary Volume Descriptor]\n");
-	N(n+1); printf ("Volume Descriptor Sequence Number:  %" PRId32 "\n", VolumeDescriptorSequenceNumber = (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
-	N(n+1); printf ("Primary Volume Descriptor Number:   %" PRId32 "\n", (buffer[23] << 24) | (buffer[22] << 16) | (buffer[21] << 8) | buffer[20]);
-	N(n+1); printf ("Volume Identifier:                  "); print_1_7_2_12 (buffer + 24, 32, buffer + 200 /* Descriptor Character Set */, &VolumeIdentifier); putchar ('\n');
-	N(n+1); printf ("Volume Sequence Number:             %" PRId16 "\n", VolumeSequenceNumber = (buffer[57] << 8) | buffer[56]);
-	N(n+1); printf ("Maximum Volume Sequence Number:     %" PRId16 "\n", (buffer[59] << 8) | buffer[58]);
-	N(n+1); printf ("Interchange Level:                  %" PRId16 "\n", (buffer[61] << 8) | buffer[60]);
-	N(n+1); printf ("Maximum Interchange Level:          %" PRId16 "\n", (buffer[63] << 8) | buffer[62]);
-	N(n+1); printf ("Character Set List:                 %" PRId32 "\n", CharacterSetList = (buffer[67] << 24) | (buffer[66] << 16) | (buffer[65] << 8) | buffer[64]);
-	if (CharacterSetList & 0x001) { N(n+2); printf ("CS0 in use\n"); }
-	if (CharacterSetList & 0x002) { N(n+2); printf ("CS1 in use\n"); }
-	if (CharacterSetList & 0x004) { N(n+2); printf ("CS2 in use\n"); }
-	if (CharacterSetList & 0x008) { N(n+2); printf ("CS3 in use\n"); }
-	if (CharacterSetList & 0x010) { N(n+2); printf ("CS4 in use\n"); }
-	if (CharacterSetList & 0x020) { N(n+2); printf ("CS5 in use\n"); }
-	if (CharacterSetList & 0x040) { N(n+2); printf ("CS6 in use\n"); }
-	if (CharacterSetList & 0x080) { N(n+2); printf ("CS7 in use\n"); }
-	if (CharacterSetList & 0x100) { N(n+2); printf ("CS8 in use\n"); }
-	N(n+1); printf ("Maximum Character Set List:         %" PRId32 "\n", (buffer[71] << 24) | (buffer[70] << 16) | (buffer[69] << 8) | buffer[68]);
-	N(n+1); printf ("Volume Set Identifier:              "); print_1_7_2_12_VolumeSetIdentifier (buffer + 72, 128, buffer + 200 /* Descriptor Character Set */); putchar ('\n');
-	N(n+1); printf ("Descriptor Character Set:           "); print_1_7_2_1 (buffer + 200); putchar ('\n');
-	N(n+1); printf ("Explanatory Character Set:          "); print_1_7_2_1 (buffer + 264); putchar ('\n');
+	N(n);   TRACE ("[Primary Volume Descriptor]\n");
+	VolumeDescriptorSequenceNumber = (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16];
+	N(n+1); TRACE ("Volume Descriptor Sequence Number:  %" PRId32 "\n", VolumeDescriptorSequenceNumber);
+	N(n+1); TRACE ("Primary Volume Descriptor Number:   %" PRId32 "\n", (buffer[23] << 24) | (buffer[22] << 16) | (buffer[21] << 8) | buffer[20]);
+	N(n+1); TRACE ("Volume Identifier:                  "); print_1_7_2_12 (buffer + 24, 32, buffer + 200 /* Descriptor Character Set */, &VolumeIdentifier); TRACE_PUTCHAR ('\n');
+	VolumeSequenceNumber = (buffer[57] << 8) | buffer[56];
+	N(n+1); TRACE ("Volume Sequence Number:             %" PRId16 "\n", VolumeSequenceNumber);
+	N(n+1); TRACE ("Maximum Volume Sequence Number:     %" PRId16 "\n", (buffer[59] << 8) | buffer[58]);
+	N(n+1); TRACE ("Interchange Level:                  %" PRId16 "\n", (buffer[61] << 8) | buffer[60]);
+	N(n+1); TRACE ("Maximum Interchange Level:          %" PRId16 "\n", (buffer[63] << 8) | buffer[62]);
+	CharacterSetList = (buffer[67] << 24) | (buffer[66] << 16) | (buffer[65] << 8) | buffer[64];
+	N(n+1); TRACE ("Character Set List:                 %" PRId32 "\n", CharacterSetList);
+	if (CharacterSetList & 0x001) { N(n+2); TRACE ("CS0 in use\n"); }
+	if (CharacterSetList & 0x002) { N(n+2); TRACE ("CS1 in use\n"); }
+	if (CharacterSetList & 0x004) { N(n+2); TRACE ("CS2 in use\n"); }
+	if (CharacterSetList & 0x008) { N(n+2); TRACE ("CS3 in use\n"); }
+	if (CharacterSetList & 0x010) { N(n+2); TRACE ("CS4 in use\n"); }
+	if (CharacterSetList & 0x020) { N(n+2); TRACE ("CS5 in use\n"); }
+	if (CharacterSetList & 0x040) { N(n+2); TRACE ("CS6 in use\n"); }
+	if (CharacterSetList & 0x080) { N(n+2); TRACE ("CS7 in use\n"); }
+	if (CharacterSetList & 0x100) { N(n+2); TRACE ("CS8 in use\n"); }
+	N(n+1); TRACE ("Maximum Character Set List:         %" PRId32 "\n", (buffer[71] << 24) | (buffer[70] << 16) | (buffer[69] << 8) | buffer[68]);
+	N(n+1); TRACE ("Volume Set Identifier:              "); print_1_7_2_12_VolumeSetIdentifier (buffer + 72, 128, buffer + 200 /* Descriptor Character Set */); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Descriptor Character Set:           "); print_1_7_2_1 (buffer + 200); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Explanatory Character Set:          "); print_1_7_2_1 (buffer + 264); TRACE_PUTCHAR ('\n');
 	UDF_extent_ad_from_data (n+1, "Volume Abstract.", &VolumeAbstract, buffer + 328);
 	UDF_extent_ad_from_data (n+1, "Volume Copyright Notice.", &VolumeCopyright, buffer + 336);
-	N(n+1); printf ("Application Identifier:             "); print_1_7_4 (buffer + 344, 0); putchar ('\n');
-	N(n+1); printf ("Recording Date and Time:            "); print_1_7_3 (buffer + 376); putchar ('\n');
-	N(n+1); printf ("Implementation Identifier:          "); print_1_7_4 (buffer + 388, 1); putchar ('\n');
-	N(n+1); printf ("Implementation Use:                 \"");
+	N(n+1); TRACE ("Application Identifier:             "); print_1_7_4 (buffer + 344, 0); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Recording Date and Time:            "); print_1_7_3 (buffer + 376); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Implementation Identifier:          "); print_1_7_4 (buffer + 388, 1); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Implementation Use:                 \"");
 	for (i=420; i < 484; i++)
 	{
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf("\"\n");
-	N(n+1); printf ("Predecessor Volume Descriptor\n");
-	N(n+1); printf (" Sequence Location:                 %" PRId32 "\n", (buffer[487] << 24) | (buffer[486] << 16) | (buffer[485] << 8) | buffer[484]);
-	N(n+1); printf ("Flags:                              %" PRId16 "\n", Flags = (buffer[489] << 8) | buffer[488]);
-	if (Flags & 0x01) {N(n+2); printf ("Volume Set Identification are all common / copies\n");} else { N(n+2); printf ("Volume Set Identification are all uniqe\n"); }
+	TRACE("\"\n");
+	N(n+1); TRACE ("Predecessor Volume Descriptor\n");
+	N(n+1); TRACE (" Sequence Location:                 %" PRId32 "\n", (buffer[487] << 24) | (buffer[486] << 16) | (buffer[485] << 8) | buffer[484]);
+	Flags = (buffer[489] << 8) | buffer[488];
+	N(n+1); TRACE ("Flags:                              %" PRId16 "\n", Flags);
+	if (Flags & 0x01) {N(n+2); TRACE ("Volume Set Identification are all common / copies\n");} else { N(n+2); TRACE ("Volume Set Identification are all uniqe\n"); }
 
 // TODO Copyright       (uses "Explanatory Character Set")
 // TODO Volume Abstract (uses "Explanatory Character Set")
@@ -2625,43 +3076,43 @@ static void ImplementationUseVolumeDescriptor (int n, struct cdfs_disc_t *disc,
 {
 	int i;
 
-	N(n);   printf ("[Implementation Use Volume Descriptor]\n");
-	N(n+1); printf ("Volume Descriptor Sequence Number:  %" PRId32 "\n", (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
+	N(n);   TRACE ("[Implementation Use Volume Descriptor]\n");
+	N(n+1); TRACE ("Volume Descriptor Sequence Number:  %" PRId32 "\n", (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
 // we configure one of the possible CS0..CS8 here
-	N(n+1); printf ("Implementation Identifier:          "); print_1_7_4 (buffer + 20, 1); putchar ('\n');
-	N(n+1); printf ("Implementation Use:                 \"");
+	N(n+1); TRACE ("Implementation Identifier:          "); print_1_7_4 (buffer + 20, 1); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Implementation Use:                 \"");
 	if (!memcmp (buffer + 20 + 1, "*UDF LV Info", 13))
 	{
-		N(n+1); printf ("Implementation Use:\n");
-		N(n+2); printf ("LVICharset:                "); print_1_7_2_1 (buffer + 52); putchar ('\n');                     /*  52 +  64 = 116 */
-		N(n+2); printf ("LogicalVolumeIdentifier:   "); print_1_7_2_12 (buffer + 116, 128, buffer + 52, 0 /* output */); putchar ('\n'); /* 116 + 128 = 244 */
-		N(n+2); printf ("LVInfo1:                   "); print_1_7_2_12 (buffer + 244,  36, buffer + 52, 0 /* output */); putchar ('\n');  /* 244 +  36 = 280 */
-		N(n+2); printf ("LVInfo2:                   "); print_1_7_2_12 (buffer + 280,  36, buffer + 52, 0 /* output */); putchar ('\n');  /* 280 +  36 = 316 */
-		N(n+2); printf ("LVInfo3:                   "); print_1_7_2_12 (buffer + 316,  36, buffer + 52, 0 /* output */); putchar ('\n');  /* 316 +  36 = 352 */
-		N(n+2); printf ("Implementation Identifier: "); print_1_7_4 (buffer + 352, 1); putchar ('\n');                   /* 352 +  32 = 384 */
-		N(n+2); printf ("Implementation Use:        \"");
+		N(n+1); TRACE ("Implementation Use:\n");
+		N(n+2); TRACE ("LVICharset:                "); print_1_7_2_1 (buffer + 52); TRACE_PUTCHAR ('\n');                     /*  52 +  64 = 116 */
+		N(n+2); TRACE ("LogicalVolumeIdentifier:   "); print_1_7_2_12 (buffer + 116, 128, buffer + 52, 0 /* output */); TRACE_PUTCHAR ('\n'); /* 116 + 128 = 244 */
+		N(n+2); TRACE ("LVInfo1:                   "); print_1_7_2_12 (buffer + 244,  36, buffer + 52, 0 /* output */); TRACE_PUTCHAR ('\n');  /* 244 +  36 = 280 */
+		N(n+2); TRACE ("LVInfo2:                   "); print_1_7_2_12 (buffer + 280,  36, buffer + 52, 0 /* output */); TRACE_PUTCHAR ('\n');  /* 280 +  36 = 316 */
+		N(n+2); TRACE ("LVInfo3:                   "); print_1_7_2_12 (buffer + 316,  36, buffer + 52, 0 /* output */); TRACE_PUTCHAR ('\n');  /* 316 +  36 = 352 */
+		N(n+2); TRACE ("Implementation Identifier: "); print_1_7_4 (buffer + 352, 1); TRACE_PUTCHAR ('\n');                   /* 352 +  32 = 384 */
+		N(n+2); TRACE ("Implementation Use:        \"");
 		for (i=384; i < 512; i++)
 		{
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		printf("\"\n");
+		TRACE("\"\n");
 	} else {
-		N(n+1); printf ("Implementation Use:                 \"");
+		N(n+1); TRACE ("Implementation Use:                 \"");
 		for (i=52; i < 512; i++)
 		{
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		printf("\"\n");
+		TRACE("\"\n");
 	}
 }
 
@@ -2686,13 +3137,16 @@ static void PartitionDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *buffe
 	struct UDF_shortad FreedSpaceTable;
 	struct UDF_shortad FreedSpaceBitMap;
 
-	N(n);   printf ("[Partition Descriptor]\n");
-	N(n+1); printf ("Volume Descriptor Sequence Number:  %" PRId32 "\n", VolumeDescriptorSequenceNumber = (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
+	N(n);   TRACE ("[Partition Descriptor]\n");
+	VolumeDescriptorSequenceNumber = (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16];
+	N(n+1); TRACE ("Volume Descriptor Sequence Number:  %" PRId32 "\n", VolumeDescriptorSequenceNumber);
 // we configure one of the possible CS0..CS8 here
-	N(n+1); printf ("Partition Flags:                    %" PRId16 "\n", PartitionFlags = (buffer[21] << 8) | buffer[20]);
-	N(n+2); if (PartitionFlags & 0x0001) printf ("Space unallocated\n"); else printf ("Space allocated\n");
-	N(n+1); printf ("Partition Number:                   %" PRId16 "\n", PartitionNumber = (buffer[23] << 8) | buffer[22]);
-	N(n+1); printf ("Partition Contents:                 "); print_1_7_4 (buffer + 24, 0); putchar ('\n');
+	PartitionFlags = (buffer[21] << 8) | buffer[20];
+	N(n+1); TRACE ("Partition Flags:                    %" PRId16 "\n", PartitionFlags);
+	N(n+2); if (PartitionFlags & 0x0001) TRACE ("Space unallocated\n"); else TRACE ("Space allocated\n");
+	PartitionNumber = (buffer[23] << 8) | buffer[22];
+	N(n+1); TRACE ("Partition Number:                   %" PRId16 "\n", PartitionNumber);
+	N(n+1); TRACE ("Partition Contents:                 "); print_1_7_4 (buffer + 24, 0); TRACE_PUTCHAR ('\n');
 
 	     if (!memcmp (buffer + 25, "+FDC01", 7)) Content = PhysicalPartition_Content_ECMA107__FDC01;
 	else if (!memcmp (buffer + 25, "+CD001", 7)) Content = PhysicalPartition_Content_ECMA119__CD001;
@@ -2705,8 +3159,8 @@ static void PartitionDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *buffe
 		// EMCA-167 3nd edition - 14.3 Partition Header Descriptor
 		// EMCA-167 3rd edition - 14.3 Partition Header Descriptor
 
-		N(n+1); printf ("Partition Contents Use:\n");
-		N(n+2); printf ("[Partition Header Descriptor]\n");
+		N(n+1); TRACE ("Partition Contents Use:\n");
+		N(n+2); TRACE ("[Partition Header Descriptor]\n");
 		UDF_shortad_from_data (n+3, "Unallocated Space Table.", &UnallocatedSpaceTable,   buffer + 56 +  0);
 		UDF_shortad_from_data (n+3, "Unallocated Space Bitmap.", &UnallocatedSpaceBitMap,  buffer + 56 +  8);
 		UDF_shortad_from_data (n+3, "Partition Integrity Table.", &PartitionIntegrityTable, buffer + 56 + 16);
@@ -2715,58 +3169,67 @@ static void PartitionDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *buffe
 		N(n+1);
 		for (i=56 + 44; i < 184; i++)
 		{
-			printf (" 0x%02x", buffer[i]);
+			TRACE (" 0x%02x", buffer[i]);
 		}
-		putchar ('\n');
+		TRACE_PUTCHAR ('\n');
 	} else {
-		N(n+1); printf ("Partition Contents Use:             \"");
+		N(n+1); TRACE ("Partition Contents Use:             \"");
 		for (i=56; i < 184; i++)
 		{
 			if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 			{
-				putchar (buffer[i]);
+				TRACE_PUTCHAR (buffer[i]);
 			} else {
-				printf ("\\x%02x", buffer[i]);
+				TRACE ("\\x%02x", buffer[i]);
 			}
 		}
-		printf("\"\n");
+		TRACE("\"\n");
 	}
-	N(n+1); printf ("Access Type:                        %" PRId32 " ", AccessType = (buffer[187] << 24) | (buffer[186] << 16) | (buffer[185] << 8) | buffer[184]);
+	AccessType = (buffer[187] << 24) | (buffer[186] << 16) | (buffer[185] << 8) | buffer[184];
+	N(n+1); TRACE ("Access Type:                        %" PRId32 " ", AccessType);
 	switch (AccessType)
 	{
-		case 0: printf ("unspecified\n"); break;
-		case 1: printf ("Read only\n"); break;
-		case 2: printf ("Write once\n"); break;
-		case 3: printf ("Rewritable\n"); break;
-		case 4: printf ("Overwritable\n"); break;
-		default: printf("???\n"); break;
-	}
-	N(n+1); printf ("Partition Starting Location:        %" PRId32 "\n", PartitionStartingLocation = (buffer[191] << 24) | (buffer[190] << 16) | (buffer[189] << 8) | buffer[188]);
-	N(n+1); printf ("Partition Length:                   %" PRId32 "\n", PartitionLength = (buffer[195] << 24) | (buffer[194] << 16) | (buffer[193] << 8) | buffer[192]);
-	N(n+1); printf ("Implementation Identifier:          "); print_1_7_4 (buffer + 196, 1); putchar ('\n');
-	N(n+1); printf ("Implementation Use:                 \"");
+		case 0: TRACE ("unspecified\n"); break;
+		case 1: TRACE ("Read only\n"); break;
+		case 2: TRACE ("Write once\n"); break;
+		case 3: TRACE ("Rewritable\n"); break;
+		case 4: TRACE ("Overwritable\n"); break;
+		default: TRACE("???\n"); break;
+	}
+	PartitionStartingLocation = (buffer[191] << 24) | (buffer[190] << 16) | (buffer[189] << 8) | buffer[188];
+	N(n+1); TRACE ("Partition Starting Location:        %" PRId32 "\n", PartitionStartingLocation);
+	PartitionLength = (buffer[195] << 24) | (buffer[194] << 16) | (buffer[193] << 8) | buffer[192];
+	N(n+1); TRACE ("Partition Length:                   %" PRId32 "\n", PartitionLength);
+	N(n+1); TRACE ("Implementation Identifier:          "); print_1_7_4 (buffer + 196, 1); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Implementation Use:                 \"");
 	for (i=228; i < 356; i++)
 	{
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 
 	UDF_Session_Add_PhysicalPartition (disc, VolumeDescriptorSequenceNumber, PartitionNumber, Content, SECTORSIZE, PartitionStartingLocation, PartitionLength);
 	PhysicalPartition = UDF_GetPhysicalPartition (disc, PartitionNumber);
 	if (PhysicalPartition)
 	{
+		int current = PhysicalPartition->VolumeDescriptorSequenceNumber == VolumeDescriptorSequenceNumber; /* an older descriptor does not replace the bitmaps */
+
 		if (UnallocatedSpaceTable.ExtentLength)
 		{
 			SpaceEntry              (n+4, disc, &PhysicalPartition->PartitionCommon, &UnallocatedSpaceTable, "Unallocated", 0);
 		}
 		if (UnallocatedSpaceBitMap.ExtentLength)
 		{
-			SpaceBitMap             (n+4, disc, &PhysicalPartition->PartitionCommon, &UnallocatedSpaceBitMap, "Unallocated");
+			SpaceBitMap             (n+4, disc, &PhysicalPartition->PartitionCommon, &UnallocatedSpaceBitMap, "Unallocated", current ? &PhysicalPartition->UnallocatedSpaceBitmap : 0);
+			if (current)
+			{
+				PhysicalPartition->UnallocatedSpaceBitmapExtent = UnallocatedSpaceBitMap;
+			}
 		}
 		if (PartitionIntegrityTable.ExtentLength)
 		{
@@ -2778,7 +3241,11 @@ static void PartitionDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *buffe
 		}
 		if (FreedSpaceBitMap.ExtentLength)
 		{
-			SpaceBitMap             (n+4, disc, &PhysicalPartition->PartitionCommon, &FreedSpaceBitMap, "Freed");
+			SpaceBitMap             (n+4, disc, &PhysicalPartition->PartitionCommon, &FreedSpaceBitMap, "Freed", current ? &PhysicalPartition->FreedSpaceBitmap : 0);
+			if (current)
+			{
+				PhysicalPartition->FreedSpaceBitmapExtent = FreedSpaceBitMap;
+			}
 		}
 	}
 }
@@ -2796,25 +3263,26 @@ static void LogicalVolumeDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *b
 	uint8_t *b;
 	int l;
 
-	N(n);   printf ("[Logical Volume Descriptor]\n");
-	N(n+1); printf ("Volume Descriptor Sequence Number:  %" PRId32 "\n", VolumeDescriptorSequenceNumber = (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
+	N(n);   TRACE ("[Logical Volume Descriptor]\n");
+	VolumeDescriptorSequenceNumber = (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16];
+	N(n+1); TRACE ("Volume Descriptor Sequence Number:  %" PRId32 "\n", VolumeDescriptorSequenceNumber);
 // we configure one of the possible CS0..CS8 here
-	N(n+1); printf ("Descriptor Character Set:           "); print_1_7_2_1 (buffer + 20); putchar ('\n');
-	N(n+1); printf ("Logical Volume Identifier:          "); print_1_7_2_12 (buffer + 84, 128, buffer + 20 /* Descriptor Character Set */, &LogicalVolumeIdentifier); putchar ('\n');
-	N(n+1); printf ("Logical Block Size:                 %" PRId32 "\n", (buffer[215] << 24) | (buffer[214] << 16) | (buffer[213] << 8) | buffer[212]);
-	N(n+1); printf ("Domain Identifier:                  "); print_1_7_4 (buffer + 216, 0); putchar ('\n');
+	N(n+1); TRACE ("Descriptor Character Set:           "); print_1_7_2_1 (buffer + 20); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Logical Volume Identifier:          "); print_1_7_2_12 (buffer + 84, 128, buffer + 20 /* Descriptor Character Set */, &LogicalVolumeIdentifier); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Logical Block Size:                 %" PRId32 "\n", (buffer[215] << 24) | (buffer[214] << 16) | (buffer[213] << 8) | buffer[212]);
+	N(n+1); TRACE ("Domain Identifier:                  "); print_1_7_4 (buffer + 216, 0); TRACE_PUTCHAR ('\n');
 	volume = UDF_LogicalVolumes_Create (VolumeDescriptorSequenceNumber, LogicalVolumeIdentifier, buffer + 20);
-	N(n+1); printf ("Logical Volume Contents Use:        \"");
+	N(n+1); TRACE ("Logical Volume Contents Use:        \"");
 	for (i=248; i < 264; i++)
 	{
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 	if (!memcmp (buffer + 216 + 1, "*OSTA UDF Compliant", 20))
 	{ // OSTA UDF2.60 2.2.4.4
 		struct UDF_longad RootLocation;
@@ -2823,88 +3291,95 @@ static void LogicalVolumeDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *b
 		// Ignore AdImpUse.flags
 	}
 
-	N(n+1); printf ("Map Table Length:                   %" PRId32 "\n", MT_L = (buffer[267] << 24) | (buffer[266] << 16) | (buffer[265] << 8) | buffer[264]);
-	N(n+1); printf ("Number of Partition Maps:           %" PRId32 "\n", N_PM = (buffer[271] << 24) | (buffer[270] << 16) | (buffer[269] << 8) | buffer[268]);
-	N(n+1); printf ("Implementation Identifier:          "); print_1_7_4 (buffer + 272, 1); putchar ('\n');
-	N(n+1); printf ("Implementation Use:                 \"");
+	MT_L = (buffer[267] << 24) | (buffer[266] << 16) | (buffer[265] << 8) | buffer[264];
+	N(n+1); TRACE ("Map Table Length:                   %" PRId32 "\n", MT_L);
+	N_PM = (buffer[271] << 24) | (buffer[270] << 16) | (buffer[269] << 8) | buffer[268];
+	N(n+1); TRACE ("Number of Partition Maps:           %" PRId32 "\n", N_PM);
+	N(n+1); TRACE ("Implementation Identifier:          "); print_1_7_4 (buffer + 272, 1); TRACE_PUTCHAR ('\n');
+	N(n+1); TRACE ("Implementation Use:                 \"");
 	for (i=304; i < 432; i++)
 	{
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf ("\"\n");
+	TRACE ("\"\n");
 	UDF_extent_ad_from_data (n+1, "Integrity Sequence Extent.", &IntegritySequenceExtent, buffer + 432);
 
 	b = buffer + 440;
 	l = MT_L;
 	if ((l + 440) > SECTORSIZE)
 	{
-		N(n+1); printf ("WARNING: buffer overflow, length will be clamped\n");
+		N(n+1); TRACE ("WARNING: buffer overflow, length will be clamped\n");
 		l = SECTORSIZE - 440;
 	}
-	N(n+1); printf ("Partition Maps:\n");
+	N(n+1); TRACE ("Partition Maps:\n");
 	for (i=0; i < N_PM; i++)
 	{
 		uint8_t PM_L;
 		if (l < 2)
 		{
-			N(n+2); printf ("WARNING: ran out of data in buffer\n");
+			N(n+2); TRACE ("WARNING: ran out of data in buffer\n");
 			break;
 		}
-		N(n+2); printf ("%d.Partition Map Type: ", i);
+		N(n+2); TRACE ("%d.Partition Map Type: ", i);
 		switch (b[0])
 		{
-			case 0: printf ("unspecified\n"); break;
-			case 1: printf ("Type 1 Partition Map\n"); break;
-			case 2: printf ("Type 2 Partition Map\n"); break;
-			default: printf ("Unknown (%d)\n", b[0]); break;
+			case 0: TRACE ("unspecified\n"); break;
+			case 1: TRACE ("Type 1 Partition Map\n"); break;
+			case 2: TRACE ("Type 2 Partition Map\n"); break;
+			default: TRACE ("Unknown (%d)\n", b[0]); break;
 		}
-		N(n+2); printf ("%d.Partition Map Length: %d\n", i, PM_L = b[1]);
+		PM_L = b[1];
+		N(n+2); TRACE ("%d.Partition Map Length: %d\n", i, PM_L);
 
 		if (l < PM_L)
 		{
-			N(n+2); printf ("WARNING: ran out of data in buffer\n");
+			N(n+2); TRACE ("WARNING: ran out of data in buffer\n");
 			break;
 		}
 
 		switch (b[0])
 		{
 			default:
-				printf ("     ");
+				TRACE ("     ");
 				for (j=2; i < PM_L; j++)
 				{
-					printf ("\\x%02x", b[j]);
+					TRACE ("\\x%02x", b[j]);
 				}
-				printf ("\n");
+				TRACE ("\n");
 				break;
 			case 1:
 				if (PM_L != 6)
 				{
-					N(n+2); printf ("%d WARNING: Wrong Length\n", i);
+					N(n+2); TRACE ("%d WARNING: Wrong Length\n", i);
 				} else {
 					uint16_t PhysicalPartition_VolumeSequenceNumber;
 					uint16_t PhysicalPartition_PartitionNumber;
-					N(n+2); printf ("%d.Volume Sequence Number: %d\n", i, PhysicalPartition_VolumeSequenceNumber = (b[3] << 8) | (b[2]));
-					N(n+2); printf ("%d.Partition Number:       %d\n", i, PhysicalPartition_PartitionNumber = (b[5] << 8) | (b[4]));
+					PhysicalPartition_VolumeSequenceNumber = (b[3] << 8) | (b[2]);
+					N(n+2); TRACE ("%d.Volume Sequence Number: %d\n", i, PhysicalPartition_VolumeSequenceNumber);
+					PhysicalPartition_PartitionNumber = (b[5] << 8) | (b[4]);
+					N(n+2); TRACE ("%d.Partition Number:       %d\n", i, PhysicalPartition_PartitionNumber);
 					UDF_LogicalVolume_Append_Type1 (volume, i, PhysicalPartition_VolumeSequenceNumber, PhysicalPartition_PartitionNumber);
 				}
 				break;
 			case 2:
 				if (PM_L != 64)
 				{
-					N(n+2); printf ("%d WARNING: Wrong Length\n", i);
+					N(n+2); TRACE ("%d WARNING: Wrong Length\n", i);
 				} else {
-					N(n+2); printf ("%d.Partition Identifier: ", i); print_1_7_4 (b + 4, 0); putchar ('\n');
+					N(n+2); TRACE ("%d.Partition Identifier: ", i); print_1_7_4 (b + 4, 0); TRACE_PUTCHAR ('\n');
 					if (!memcmp (b + 4 + 1, "*UDF Virtual Partition", 23))
 					{
 						uint16_t LogicalVolume_VolumeSequenceNumber;
 						uint16_t LogicalVolume_PartitionNumber;
-						N(n+2); printf ("%d.Volume Sequence Number:  %" PRId16 " (Volume upon which the VAT and Partition is recorded)\n", i, LogicalVolume_VolumeSequenceNumber = (b[37] << 8) | (b[36]));
-						N(n+2); printf ("%d.Partition Number:        %" PRId16 " (a Type 1 Partition Map in the same logical volume descriptor)\n", i, LogicalVolume_PartitionNumber = (b[39] << 8) | (b[38]));
+						LogicalVolume_VolumeSequenceNumber = (b[37] << 8) | (b[36]);
+						N(n+2); TRACE ("%d.Volume Sequence Number:  %" PRId16 " (Volume upon which the VAT and Partition is recorded)\n", i, LogicalVolume_VolumeSequenceNumber);
+						LogicalVolume_PartitionNumber = (b[39] << 8) | (b[38]);
+						N(n+2); TRACE ("%d.Partition Number:        %" PRId16 " (a Type 1 Partition Map in the same logical volume descriptor)\n", i, LogicalVolume_PartitionNumber);
 						UDF_LogicalVolume_Append_Type2_VAT (volume, i, LogicalVolume_VolumeSequenceNumber, LogicalVolume_PartitionNumber);
 					} else if (!memcmp (b + 4 + 1, "*UDF Sparable Partition", 23))
 					{
@@ -2915,31 +3390,31 @@ static void LogicalVolumeDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *b
 						uint8_t  NumberOfSparingTables  = b[42];
 						uint32_t SizeOfEachSparingTable = (b[47] << 24) | (b[46] << 16) | (b[45] << 8) | (b[44]);
 						uint32_t SparingTableLocations[256];
-						N(n+2); printf ("%d.Volume Sequence Number:    %" PRId16 "\n", i, VolumeSequenceNumber);
-						N(n+2); printf ("%d.Partition Number:          %" PRId16 "\n", i, PartitionNumber);
-						N(n+2); printf ("%d.Packet Length:             %" PRId16 " (number of user data blocks per fixed packet)\n", i, PacketLength);
-						N(n+2); printf ("%d.Number of Sparing Tables   %" PRIu8  "\n", i, NumberOfSparingTables);
+						N(n+2); TRACE ("%d.Volume Sequence Number:    %" PRId16 "\n", i, VolumeSequenceNumber);
+						N(n+2); TRACE ("%d.Partition Number:          %" PRId16 "\n", i, PartitionNumber);
+						N(n+2); TRACE ("%d.Packet Length:             %" PRId16 " (number of user data blocks per fixed packet)\n", i, PacketLength);
+						N(n+2); TRACE ("%d.Number of Sparing Tables   %" PRIu8  "\n", i, NumberOfSparingTables);
 						if (NumberOfSparingTables < 0)
 						{
-							N(n+3); printf ("Error - must be atleast 1\n");
+							N(n+3); TRACE ("Error - must be atleast 1\n");
 						} else if (NumberOfSparingTables == 1)
 						{
-							N(n+3); printf ("WARNING - should be bigger bigger than 1\n");
+							N(n+3); TRACE ("WARNING - should be bigger bigger than 1\n");
 						} else if (NumberOfSparingTables > 4)
 						{
-							N(n+3); printf ("WARNING - should be smaller than 5\n");
+							N(n+3); TRACE ("WARNING - should be smaller than 5\n");
 						}
-						N(n+2); printf ("%d.Size of Each Sparing Table %" PRId32 "\n", i, SizeOfEachSparingTable);
+						N(n+2); TRACE ("%d.Size of Each Sparing Table %" PRId32 "\n", i, SizeOfEachSparingTable);
 						for (j = 0; j < b[42]; j++)
 						{
 							if ((j * 4 + 48) > 64)
 							{
-								N(n+3); printf ("%d WARNING - buffer overflow\n", j);
+								N(n+3); TRACE ("%d WARNING - buffer overflow\n", j);
 								NumberOfSparingTables = j;
 								break;
 							} else {
 								SparingTableLocations[j] = (b[j*4 + 51] << 24) | (b[j*4 + 50] << 16) | (b[j*4 + 49] << 8) | (b[j*4 + 48]);
-								N(n+3); printf ("%d.Locations of Sparing Table.Position %" PRIu32 " 0x%08" PRIu32 "\n", j, SparingTableLocations[j], SparingTableLocations[j]);
+								N(n+3); TRACE ("%d.Locations of Sparing Table.Position %" PRIu32 " 0x%08" PRIu32 "\n", j, SparingTableLocations[j], SparingTableLocations[j]);
 							}
 						}
 						UDF_LogicalVolume_Append_Type2_SparingPartition (volume, i, VolumeSequenceNumber, PartitionNumber, PacketLength, NumberOfSparingTables, SizeOfEachSparingTable, SparingTableLocations);
@@ -2955,29 +3430,29 @@ static void LogicalVolumeDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *b
 						uint8_t  Flags                      =                                                (b[58]);
 						// 5 bytes reserved */
 
-						N(n+2); printf ("%d.Volume Sequence Number:        %" PRId16 "\n", i, VolumeSequenceNumber);
-						N(n+2); printf ("%d.Partition Number:              %" PRId16 "\n", i, PartitionNumber);
-						N(n+2); printf ("%d.Metadata File Location:        %" PRId32 "\n", i, MetadataFileLocation);
-						N(n+2); printf ("%d.Metadata Mirror File Location: %" PRId32 "\n", i, MetadataMirrorFileLocation);
-						N(n+2); printf ("%d.Metadata Bitmap File Location: %" PRId32 "\n", i, MetadataBitmapFileLocation);
-						N(n+2); printf ("%d.Allocation Unit Size (blocks): %" PRId32 "\n", i, AllocationUnitSize);
-						N(n+2); printf ("%d.Alignment Unit Size (blocks):  %" PRIu16 "\n", i, AlignmentUnitSize);
-						N(n+2); printf ("%d.Flags:                         %" PRId8  "\n", i, (b[60]));
-						N(n+3); printf ("Duplicate Metadata Flag: %d\n", b[60] & 0x01);
+						N(n+2); TRACE ("%d.Volume Sequence Number:        %" PRId16 "\n", i, VolumeSequenceNumber);
+						N(n+2); TRACE ("%d.Partition Number:              %" PRId16 "\n", i, PartitionNumber);
+						N(n+2); TRACE ("%d.Metadata File Location:        %" PRId32 "\n", i, MetadataFileLocation);
+						N(n+2); TRACE ("%d.Metadata Mirror File Location: %" PRId32 "\n", i, MetadataMirrorFileLocation);
+						N(n+2); TRACE ("%d.Metadata Bitmap File Location: %" PRId32 "\n", i, MetadataBitmapFileLocation);
+						N(n+2); TRACE ("%d.Allocation Unit Size (blocks): %" PRId32 "\n", i, AllocationUnitSize);
+						N(n+2); TRACE ("%d.Alignment Unit Size (blocks):  %" PRIu16 "\n", i, AlignmentUnitSize);
+						N(n+2); TRACE ("%d.Flags:                         %" PRId8  "\n", i, (b[60]));
+						N(n+3); TRACE ("Duplicate Metadata Flag: %d\n", b[60] & 0x01);
 						UDF_LogicalVolume_Append_Type2_Metadata (volume, i, VolumeSequenceNumber, PartitionNumber, MetadataFileLocation, MetadataMirrorFileLocation, MetadataBitmapFileLocation, AllocationUnitSize, AlignmentUnitSize, Flags);
 					} else {
-						N(n+3); putchar ('\"');
+						N(n+3); TRACE_PUTCHAR ('\"');
 						for (j=36; i < 64; i++)
 						{
 							if (!b[j]) break;
 							if ((b[j] >= 0x20) && (b[j] < 0x7f) && (b[j] != '"') && (b[j] != '\\'))
 							{
-								putchar (b[j]);
+								TRACE_PUTCHAR (b[j]);
 							} else {
-								printf ("\\x%02x", b[j]);
+								TRACE ("\\x%02x", b[j]);
 							}
 						}
-						printf ("\"\n");
+						TRACE ("\"\n");
 					}
 				}
 				break;
@@ -2997,9 +3472,10 @@ static void UnallocatedSpaceDescriptor (int n, struct cdfs_disc_t *disc, uint8_t
 	uint32_t N_AD;
 	int i;
 
-	N(n);   printf ("[Unallocated Space Descriptor]\n");
-	N(n+1); printf ("Volume Descriptor Sequence Number: %" PRId32 "\n", (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
-	N(n+1); printf ("Number of Allocation Descriptors:  %" PRId32 "\n", N_AD = (buffer[23] << 24) | (buffer[22] << 16) | (buffer[21] << 8) | buffer[20]);
+	N(n);   TRACE ("[Unallocated Space Descriptor]\n");
+	N(n+1); TRACE ("Volume Descriptor Sequence Number: %" PRId32 "\n", (buffer[19] << 24) | (buffer[18] << 16) | (buffer[17] << 8) | buffer[16]);
+	N_AD = (buffer[23] << 24) | (buffer[22] << 16) | (buffer[21] << 8) | buffer[20];
+	N(n+1); TRACE ("Number of Allocation Descriptors:  %" PRId32 "\n", N_AD);
 
 	for (i=0; i < N_AD; i++)
 	{
@@ -3008,7 +3484,7 @@ static void UnallocatedSpaceDescriptor (int n, struct cdfs_disc_t *disc, uint8_t
 
 		if ((i * 8 + 24) > SECTORSIZE)
 		{
-			printf ("    WARNING - buffer overflow\n");
+			TRACE ("    WARNING - buffer overflow\n");
 			break;
 		} /* given in "Logical Sector" 512 bytes logic */
 		snprintf (prefix, 32, "%d.Allocation.", i);
@@ -3019,7 +3495,7 @@ static void UnallocatedSpaceDescriptor (int n, struct cdfs_disc_t *disc, uint8_t
 /* 0x0008 */
 static void TerminatingDescriptor (int n, struct cdfs_disc_t *disc, uint8_t *buffer)
 {
-	N(n); printf ("[Terminating Descriptor]\n");
+	N(n); TRACE ("[Terminating Descriptor]\n");
 	// no extra data in this type
 }
 
@@ -3033,28 +3509,31 @@ static void LogicalVolumeIntegrityDescriptor (int n, struct cdfs_disc_t *disc, u
 	uint8_t *b;
 	int l;
 
-	N(n);   printf ("[Logical Volume Integrity Descriptor]\n");
-	N(n+1); printf ("Recording Date and Time:             "); print_1_7_3 (buffer + 16); putchar ('\n');
-	N(n+1); printf ("Integrity Type:                      %" PRId32 " ", IntegrityType = (buffer[31] << 24) | (buffer[30] << 16) | (buffer[29] << 8) | buffer[28]); if (IntegrityType == 0) printf ("Open Integrity Descriptor\n"); else if (IntegrityType == 1) printf ("Close Integrity Descriptor\n"); else printf ("??? Integrity Descriptor\n");
+	N(n);   TRACE ("[Logical Volume Integrity Descriptor]\n");
+	N(n+1); TRACE ("Recording Date and Time:             "); print_1_7_3 (buffer + 16); TRACE_PUTCHAR ('\n');
+	IntegrityType = (buffer[31] << 24) | (buffer[30] << 16) | (buffer[29] << 8) | buffer[28];
+	N(n+1); TRACE ("Integrity Type:                      %" PRId32 " ", IntegrityType); if (IntegrityType == 0) TRACE ("Open Integrity Descriptor\n"); else if (IntegrityType == 1) TRACE ("Close Integrity Descriptor\n"); else TRACE ("??? Integrity Descriptor\n");
 	UDF_extent_ad_from_data (n+1, "Next Integrity Extent.", &NextIntegrityExtent, buffer + 32);
-	N(n+1); printf ("Logical Volume Contents Use:         \"");
+	N(n+1); TRACE ("Logical Volume Contents Use:         \"");
 	for (i=40; i < 72; i++)
 	{
 		if ((buffer[i] >= 0x20) && (buffer[i] < 0x7f) && (buffer[i] != '"') && (buffer[i] != '\\'))
 		{
-			putchar (buffer[i]);
+			TRACE_PUTCHAR (buffer[i]);
 		} else {
-			printf ("\\x%02x", buffer[i]);
+			TRACE ("\\x%02x", buffer[i]);
 		}
 	}
-	printf ("\"\n");
-	N(n+1); printf ("(next available) UniqueID=0x%02x%02x%02x%02x.%02x%02x%02x%02x\n",
+	TRACE ("\"\n");
+	N(n+1); TRACE ("(next available) UniqueID=0x%02x%02x%02x%02x.%02x%02x%02x%02x\n",
 		buffer[47], buffer[46], buffer[45], buffer[44],
 		buffer[43], buffer[42], buffer[41], buffer[40]);
 
-	N(n+1); printf ("Number of Partitions:                %" PRId32 "\n", N_P = (buffer[75] << 24) | (buffer[74] << 16) | (buffer[73] << 8) | buffer[72]);
-	N(n+1); printf ("Length of Implementation Use:        %" PRId32 "\n", L_IU = (buffer[79] << 24) | (buffer[78] << 16) | (buffer[77] << 8) | buffer[76]);
-	N(n+1); printf ("Free Space Table:\n");
+	N_P = (buffer[75] << 24) | (buffer[74] << 16) | (buffer[73] << 8) | buffer[72];
+	N(n+1); TRACE ("Number of Partitions:                %" PRId32 "\n", N_P);
+	L_IU = (buffer[79] << 24) | (buffer[78] << 16) | (buffer[77] << 8) | buffer[76];
+	N(n+1); TRACE ("Length of Implementation Use:        %" PRId32 "\n", L_IU);
+	N(n+1); TRACE ("Free Space Table:\n");
 
 	b = buffer + 80;
 	l = SECTORSIZE - 80;
@@ -3063,10 +3542,10 @@ static void LogicalVolumeIntegrityDescriptor (int n, struct cdfs_disc_t *disc, u
 	{
 		if (l < 4)
 		{
-			N(n+2); printf ("WARNING: run out of buffer\n");
+			N(n+2); TRACE ("WARNING: run out of buffer\n");
 			break;
 		}
-		N(n+2); printf ("%d.PartitionFreeSpace: %" PRId32 "\n", i, (b[3] << 24) | (b[2] << 16) || (b[1] << 8) | b[0]); // Given in Logical Blocks - 2048 bytes
+		N(n+2); TRACE ("%d.PartitionFreeSpace: %" PRId32 "\n", i, (b[3] << 24) | (b[2] << 16) || (b[1] << 8) | b[0]); // Given in Logical Blocks - 2048 bytes
 		b += 4;
 		l -= 4;
 	}
@@ -3074,21 +3553,21 @@ static void LogicalVolumeIntegrityDescriptor (int n, struct cdfs_disc_t *disc, u
 	{
 		if (l < 4)
 		{
-			N(n+2); printf ("WARNING: run out of buffer\n");
+			N(n+2); TRACE ("WARNING: run out of buffer\n");
 			break;
 		}
-		N(n+2); printf ("%d.PartitionSize: %" PRId32 "\n", i, (b[3] << 24) | (b[2] << 16) || (b[1] << 8) | b[0]); // Given in Logical Blocks - 2048 bytes
+		N(n+2); TRACE ("%d.PartitionSize: %" PRId32 "\n", i, (b[3] << 24) | (b[2] << 16) || (b[1] << 8) | b[0]); // Given in Logical Blocks - 2048 bytes
 		b += 4;
 		l -= 4;
 	}
 
 	if (L_IU > l)
 	{
-		N(n+2); printf ("WARNING: run out of buffer\n");
+		N(n+2); TRACE ("WARNING: run out of buffer\n");
 	} else {
 		if (L_IU >= 32)
 		{
-			N(n+1); printf ("Implementation Use:       "); print_1_7_4 (b, 1); putchar ('\n');
+			N(n+1); TRACE ("Implementation Use:       "); print_1_7_4 (b, 1); TRACE_PUTCHAR ('\n');
 			L_IU -= 32;
 			b += 32;
 			l -= 32;
@@ -3099,11 +3578,11 @@ static void LogicalVolumeIntegrityDescriptor (int n, struct cdfs_disc_t *disc, u
 				uint16_t v2 = (b[11] << 8) | b[10];
 				uint16_t v3 = (b[13] << 8) | b[12];
 
-				N(n+3); printf ("Number Of Files:       %" PRId32 "\n", (b[3]<<24) | (b[2] << 16) | (b[1] << 8) | b[0]);
-				N(n+3); printf ("Number Of Directories: %" PRId32 "\n", (b[7]<<24) | (b[6] << 16) | (b[5] << 8) | b[4]);
-				N(n+3); printf ("Minimum UDF Read Revision:  %d.%d%d\n", v1 >> 8, (v1 & 0xf0) >> 4, v1 & 0x0f);
-				N(n+3); printf ("Minimum UDF Write Revision: %d.%d%d\n", v2 >> 8, (v2 & 0xf0) >> 4, v2 & 0x0f);
-				N(n+3); printf ("Maximum UDF Write Revision: %d.%d%d\n", v3 >> 8, (v3 & 0xf0) >> 4, v3 & 0x0f);
+				N(n+3); TRACE ("Number Of Files:       %" PRId32 "\n", (b[3]<<24) | (b[2] << 16) | (b[1] << 8) | b[0]);
+				N(n+3); TRACE ("Number Of Directories: %" PRId32 "\n", (b[7]<<24) | (b[6] << 16) | (b[5] << 8) | b[4]);
+				N(n+3); TRACE ("Minimum UDF Read Revision:  %d.%d%d\n", v1 >> 8, (v1 & 0xf0) >> 4, v1 & 0x0f);
+				N(n+3); TRACE ("Minimum UDF Write Revision: %d.%d%d\n", v2 >> 8, (v2 & 0xf0) >> 4, v2 & 0x0f);
+				N(n+3); TRACE ("Maximum UDF Write Revision: %d.%d%d\n", v3 >> 8, (v3 & 0xf0) >> 4, v3 & 0x0f);
 
 				b += 14;
 				l -= 14;
@@ -3111,20 +3590,20 @@ static void LogicalVolumeIntegrityDescriptor (int n, struct cdfs_disc_t *disc, u
 
 			if (l)
 			{
-				N(n+3); printf ("\"");
+				N(n+3); TRACE ("\"");
 				while (L_IU)
 				{
 					if ((b[i] >= 0x20) && (b[i] < 0x7f) && (b[i] != '"') && (b[i] != '\\'))
 					{
-						putchar (b[i]);
+						TRACE_PUTCHAR (b[i]);
 					} else {
-						printf ("\\x%02x", b[i]);
+						TRACE ("\\x%02x", b[i]);
 					}
 					b++;
 					l--;
 					L_IU--;
 				}
-				printf ("\"\n");
+				TRACE ("\"\n");
 			}
 		}
 	}
@@ -3136,7 +3615,7 @@ static void VolumeDescriptorSequence (int n, struct cdfs_disc_t *disc, struct UD
 {
 	int i;
 	int Terminated = 0;
-	N(n); printf ("[Volume Descriptor Sequence]\n");
+	N(n); TRACE ("[Volume Descriptor Sequence]\n");
 	for (i=0; i*SECTORSIZE < bufferlen; i++)
 	{
 		char prefix[16];
@@ -3157,14 +3636,14 @@ static void VolumeDescriptorSequence (int n, struct cdfs_disc_t *disc, struct UD
 #else
 		TagIdentifier = (buffer[i * SECTORSIZE + 1] << 8) | buffer[i * SECTORSIZE + 0];
 
-		N(n+1); printf ("%d.DescriptorTag.TagIdentifier:       %d - %s\n", i + 1, TagIdentifier, TagIdentifierName (TagIdentifier));
-		N(n+1); printf ("%d.DescriptorTag.DescriptorVersion:   %d\n", i + 1, (buffer[i * SECTORSIZE + 3]<<8) | buffer[i * SECTORSIZE + 2]);
-		N(n+1); printf ("%d.DescriptorTag.TagChecksum:         %d\n", i + 1, buffer[i * SECTORSIZE + 4]);
-		//N(n+1); printf ("%d.DescriptorTag.Reserved:            %d\n", i + 1, buffer[i * SECTORSIZE + 5]);
-		N(n+1); printf ("%d.DescriptorTag.TagSerialNumber:     %d\n", i + 1, (buffer[i * SECTORSIZE + 7]<<8) | buffer[i * SECTORSIZE + 6]);
-		N(n+1); printf ("%d.DescriptorTag.DescriptorCRC:       %d\n", i + 1, (buffer[i * SECTORSIZE + 9]<<8) | buffer[i * SECTORSIZE + 8]);
-		N(n+1); printf ("%d.DescriptorTag.DescriptorCRCLength: %d\n", i + 1, (buffer[i * SECTORSIZE + 11]<<8) | buffer[i * SECTORSIZE + 10]);
-		N(n+1); printf ("%d.DescriptorTag.TagLocation:         %d\n", i + 1, (buffer[i * SECTORSIZE + 15]<<24) | (buffer[i * SECTORSIZE + 14]<<16) | (buffer[i * SECTORSIZE + 13]<<8) | buffer[i * SECTORSIZE + 12]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagIdentifier:       %d - %s\n", i + 1, TagIdentifier, TagIdentifierName (TagIdentifier));
+		N(n+1); TRACE ("%d.DescriptorTag.DescriptorVersion:   %d\n", i + 1, (buffer[i * SECTORSIZE + 3]<<8) | buffer[i * SECTORSIZE + 2]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagChecksum:         %d\n", i + 1, buffer[i * SECTORSIZE + 4]);
+		//N(n+1); TRACE ("%d.DescriptorTag.Reserved:            %d\n", i + 1, buffer[i * SECTORSIZE + 5]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagSerialNumber:     %d\n", i + 1, (buffer[i * SECTORSIZE + 7]<<8) | buffer[i * SECTORSIZE + 6]);
+		N(n+1); TRACE ("%d.DescriptorTag.DescriptorCRC:       %d\n", i + 1, (buffer[i * SECTORSIZE + 9]<<8) | buffer[i * SECTORSIZE + 8]);
+		N(n+1); TRACE ("%d.DescriptorTag.DescriptorCRCLength: %d\n", i + 1, (buffer[i * SECTORSIZE + 11]<<8) | buffer[i * SECTORSIZE + 10]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagLocation:         %d\n", i + 1, (buffer[i * SECTORSIZE + 15]<<24) | (buffer[i * SECTORSIZE + 14]<<16) | (buffer[i * SECTORSIZE + 13]<<8) | buffer[i * SECTORSIZE + 12]);
 #endif
 
 		switch (TagIdentifier)
@@ -3180,7 +3659,7 @@ static void VolumeDescriptorSequence (int n, struct cdfs_disc_t *disc, struct UD
 			case 0x0008: TerminatingDescriptor (n+2, disc, buffer + i * SECTORSIZE); Terminated = 1; break;
 		//	case 0x0009: LogicalVolumeIntegrityDescriptor (n+2, disc, buffer + i * SECTORSIZE); break;
 			default:
-				printf ("Illegal sequence\n");
+				TRACE ("Illegal sequence\n");
 				break;
 		}
 
@@ -3189,14 +3668,14 @@ static void VolumeDescriptorSequence (int n, struct cdfs_disc_t *disc, struct UD
 			break;
 		}
 	}
-	printf ("\n");
+	TRACE ("\n");
 }
 
 static void LogicalVolumeIntegritySequence (int n, struct cdfs_disc_t *disc, struct UDF_Partition_Common *PartitionCommon, uint32_t TagLocation, uint8_t *buffer, uint32_t bufferlen, void *userpointer)
 {
 	int i;
 	int Terminated = 0;
-	N(n); printf ("[Logical Volume Integrity Sequence]\n");
+	N(n); TRACE ("[Logical Volume Integrity Sequence]\n");
 	for (i=0; i*SECTORSIZE < bufferlen; i++)
 	{
 		char prefix[16];
@@ -3217,14 +3696,14 @@ static void LogicalVolumeIntegritySequence (int n, struct cdfs_disc_t *disc, str
 #else
 		TagIdentifier = (buffer[i * SECTORSIZE + 1] << 8) | buffer[i * SECTORSIZE + 0];
 
-		N(n+1); printf ("%d.DescriptorTag.TagIdentifier:       %d - %s\n", i + 1, TagIdentifier, TagIdentifierName (TagIdentifier));
-		N(n+1); printf ("%d.DescriptorTag.DescriptorVersion:   %d\n", i + 1, (buffer[i * SECTORSIZE + 3]<<8) | buffer[i * SECTORSIZE + 2]);
-		N(n+1); printf ("%d.DescriptorTag.TagChecksum:         %d\n", i + 1, buffer[i * SECTORSIZE + 4]);
-		//N(n+1); printf ("%d.DescriptorTag.Reserved:            %d\n", i + 1, buffer[i * SECTORSIZE + 5]);
-		N(n+1); printf ("%d.DescriptorTag.TagSerialNumber:     %d\n", i + 1, (buffer[i * SECTORSIZE + 7]<<8) | buffer[i * SECTORSIZE + 6]);
-		N(n+1); printf ("%d.DescriptorTag.DescriptorCRC:       %d\n", i + 1, (buffer[i * SECTORSIZE + 9]<<8) | buffer[i * SECTORSIZE + 8]);
-		N(n+1); printf ("%d.DescriptorTag.DescriptorCRCLength: %d\n", i + 1, (buffer[i * SECTORSIZE + 11]<<8) | buffer[i * SECTORSIZE + 10]);
-		N(n+1); printf ("%d.DescriptorTag.TagLocation:         %d\n", i + 1, (buffer[i * SECTORSIZE + 15]<<24) | (buffer[i * SECTORSIZE + 14]<<16) | (buffer[i * SECTORSIZE + 13]<<8) | buffer[i * SECTORSIZE + 12]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagIdentifier:       %d - %s\n", i + 1, TagIdentifier, TagIdentifierName (TagIdentifier));
+		N(n+1); TRACE ("%d.DescriptorTag.DescriptorVersion:   %d\n", i + 1, (buffer[i * SECTORSIZE + 3]<<8) | buffer[i * SECTORSIZE + 2]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagChecksum:         %d\n", i + 1, buffer[i * SECTORSIZE + 4]);
+		//N(n+1); TRACE ("%d.DescriptorTag.Reserved:            %d\n", i + 1, buffer[i * SECTORSIZE + 5]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagSerialNumber:     %d\n", i + 1, (buffer[i * SECTORSIZE + 7]<<8) | buffer[i * SECTORSIZE + 6]);
+		N(n+1); TRACE ("%d.DescriptorTag.DescriptorCRC:       %d\n", i + 1, (buffer[i * SECTORSIZE + 9]<<8) | buffer[i * SECTORSIZE + 8]);
+		N(n+1); TRACE ("%d.DescriptorTag.DescriptorCRCLength: %d\n", i + 1, (buffer[i * SECTORSIZE + 11]<<8) | buffer[i * SECTORSIZE + 10]);
+		N(n+1); TRACE ("%d.DescriptorTag.TagLocation:         %d\n", i + 1, (buffer[i * SECTORSIZE + 15]<<24) | (buffer[i * SECTORSIZE + 14]<<16) | (buffer[i * SECTORSIZE + 13]<<8) | buffer[i * SECTORSIZE + 12]);
 #endif
 
 		switch (TagIdentifier)
@@ -3232,7 +3711,7 @@ static void LogicalVolumeIntegritySequence (int n, struct cdfs_disc_t *disc, str
 			case 0x0008: TerminatingDescriptor (n + 2, disc, buffer + i * SECTORSIZE); Terminated = 1; break;
 			case 0x0009: LogicalVolumeIntegrityDescriptor (n + 2, disc, buffer + i * SECTORSIZE); break;
 			default:
-				printf ("Illegal sequence\n");
+				TRACE ("Illegal sequence\n");
 				break;
 		}
 
@@ -3241,14 +3720,14 @@ static void LogicalVolumeIntegritySequence (int n, struct cdfs_disc_t *disc, str
 			break;
 		}
 	}
-	printf ("\n");
+	TRACE ("\n");
 }
 
 int AnchorVolumeDescriptorPointer (int n, uint8_t buffer[SECTORSIZE], uint32_t sector, struct UDF_extent_ad *MainVolumeDescriptorSequenceExtent, struct UDF_extent_ad *ReserveVolumeDescriptorSequenceExtent)
 {
 	uint16_t TagIdentifier;
 
-	N(n); printf ("[Anchor Volume Descriptor Pointer] (sector %" PRIu32 ")\n", sector);
+	N(n); TRACE ("[Anchor Volume Descriptor Pointer] (sector %" PRIu32 ")\n", sector);
 
 	if (print_tag_format (n+1, "", buffer, sector, 1, &TagIdentifier))
 	{
@@ -3257,7 +3736,7 @@ int AnchorVolumeDescriptorPointer (int n, uint8_t buffer[SECTORSIZE], uint32_t s
 
 	if (TagIdentifier != 0x0002)
 	{
-		N(n+1); printf ("WARNING - TagIdentifier is wrong, should have been 2\n");
+		N(n+1); TRACE ("WARNING - TagIdentifier is wrong, should have been 2\n");
 		return -1;
 	}
 
@@ -3290,12 +3769,12 @@ static int LoadFileSetDescriptor (
 	LogicalPartition = UDF_GetLogicalPartition (disc, LogicalPartitionRef);
 	if (!LogicalPartition)
 	{
-		printf ("LoadRootDirectory: unable to find Partition\n");
+		TRACE ("LoadRootDirectory: unable to find Partition\n");
 		return -1;
 	}
 	if (LogicalPartition->PartitionCommon.FetchSector (disc, &LogicalPartition->PartitionCommon, buffer, LogicalSector))
 	{
-		printf ("LoadRootDirectory: unable to fetch sector\n");
+		TRACE ("LoadRootDirectory: unable to fetch sector\n");
 		return -1;
 	}
 
@@ -3306,39 +3785,42 @@ static int LoadFileSetDescriptor (
 
 	if (TagIdentifier != 0x0100)
 	{
-		printf ("LoadRootDirectory: Unexpected TagIdentifier (0x%04x)\n", TagIdentifier);
+		TRACE ("LoadRootDirectory: Unexpected TagIdentifier (0x%04x)\n", TagIdentifier);
 		return -1;
 	}
-	      printf ("[File Set Descriptor]\n");
-	N(1); printf ("Recording Date and Time:    "); print_1_7_3 (buffer + 16); putchar ('\n');
+	      TRACE ("[File Set Descriptor]\n");
+	N(1); TRACE ("Recording Date and Time:    "); print_1_7_3 (buffer + 16); TRACE_PUTCHAR ('\n');
 	memcpy (TimeStamp, buffer + 16, 12);
-	N(1); printf ("Interchange Level:          %" PRId16 "\n", (buffer[29] << 8) | buffer[28]);
-	N(1); printf ("Maximum Interchange Level:  %" PRId16 "\n", (buffer[31] << 8) | buffer[30]);
-	N(1); printf ("Character Set List:         %" PRId32 "\n", CharacterSetList = ((buffer[35] << 24) | (buffer[34] << 16) | (buffer[33] << 8) | buffer[32]));
-	if (CharacterSetList & 0x001) { N(2); printf ("CS0 in use\n"); }
-	if (CharacterSetList & 0x002) { N(2); printf ("CS1 in use\n"); }
-	if (CharacterSetList & 0x004) { N(2); printf ("CS2 in use\n"); }
-	if (CharacterSetList & 0x008) { N(2); printf ("CS3 in use\n"); }
-	if (CharacterSetList & 0x010) { N(2); printf ("CS4 in use\n"); }
-	if (CharacterSetList & 0x020) { N(2); printf ("CS5 in use\n"); }
-	if (CharacterSetList & 0x040) { N(2); printf ("CS6 in use\n"); }
-	if (CharacterSetList & 0x080) { N(2); printf ("CS7 in use\n"); }
-	if (CharacterSetList & 0x100) { N(2); printf ("CS8 in use\n"); }
-	N(1); printf ("Maximum Character Set List: %" PRId32 "\n", ((buffer[39] << 24) | (buffer[38] << 16) | (buffer[37] << 8) | buffer[36]));
-	N(1); printf ("File Set Number:            %" PRId32 "\n", FileSetNumber = ((buffer[43] << 24) | (buffer[42] << 16) | (buffer[41] << 8) | buffer[40]));
-	N(1); printf ("File Set Descriptor Number: %" PRId32 "\n", FileSetDescriptorNumber = ((buffer[47] << 24) | (buffer[46] << 16) | (buffer[45] << 8) | buffer[44]));
-	N(1); printf ("Logical Volume Identifier Character Set: "); print_1_7_2_1 (buffer + 48); putchar ('\n');
-	N(1); printf ("Logical Volume Identifier   "); print_1_7_2_12 (buffer + 112, 128, buffer + 48 /* encoding*/, 0); putchar ('\n');
-	N(1); printf ("File Set Character Set:     "); print_1_7_2_1 (buffer + 240); putchar ('\n');
+	N(1); TRACE ("Interchange Level:          %" PRId16 "\n", (buffer[29] << 8) | buffer[28]);
+	N(1); TRACE ("Maximum Interchange Level:  %" PRId16 "\n", (buffer[31] << 8) | buffer[30]);
+	CharacterSetList = ((buffer[35] << 24) | (buffer[34] << 16) | (buffer[33] << 8) | buffer[32]);
+	N(1); TRACE ("Character Set List:         %" PRId32 "\n", CharacterSetList);
+	if (CharacterSetList & 0x001) { N(2); TRACE ("CS0 in use\n"); }
+	if (CharacterSetList & 0x002) { N(2); TRACE ("CS1 in use\n"); }
+	if (CharacterSetList & 0x004) { N(2); TRACE ("CS2 in use\n"); }
+	if (CharacterSetList & 0x008) { N(2); TRACE ("CS3 in use\n"); }
+	if (CharacterSetList & 0x010) { N(2); TRACE ("CS4 in use\n"); }
+	if (CharacterSetList & 0x020) { N(2); TRACE ("CS5 in use\n"); }
+	if (CharacterSetList & 0x040) { N(2); TRACE ("CS6 in use\n"); }
+	if (CharacterSetList & 0x080) { N(2); TRACE ("CS7 in use\n"); }
+	if (CharacterSetList & 0x100) { N(2); TRACE ("CS8 in use\n"); }
+	N(1); TRACE ("Maximum Character Set List: %" PRId32 "\n", ((buffer[39] << 24) | (buffer[38] << 16) | (buffer[37] << 8) | buffer[36]));
+	FileSetNumber = ((buffer[43] << 24) | (buffer[42] << 16) | (buffer[41] << 8) | buffer[40]);
+	N(1); TRACE ("File Set Number:            %" PRId32 "\n", FileSetNumber);
+	FileSetDescriptorNumber = ((buffer[47] << 24) | (buffer[46] << 16) | (buffer[45] << 8) | buffer[44]);
+	N(1); TRACE ("File Set Descriptor Number: %" PRId32 "\n", FileSetDescriptorNumber);
+	N(1); TRACE ("Logical Volume Identifier Character Set: "); print_1_7_2_1 (buffer + 48); TRACE_PUTCHAR ('\n');
+	N(1); TRACE ("Logical Volume Identifier   "); print_1_7_2_12 (buffer + 112, 128, buffer + 48 /* encoding*/, 0); TRACE_PUTCHAR ('\n');
+	N(1); TRACE ("File Set Character Set:     "); print_1_7_2_1 (buffer + 240); TRACE_PUTCHAR ('\n');
 	memcpy (FileSetCharacterSet, buffer + 240, 32);
-	N(1); printf ("File Set Identifier:        "); print_1_7_2_12 (buffer + 304, 32, buffer + 240 /* encoding*/, 0); putchar ('\n');
-	N(1); printf ("Copyright File Identifier:  "); print_1_7_2_12 (buffer + 336, 32, buffer + 240 /* encoding*/, 0); putchar ('\n');
-	N(1); printf ("Abstract File Identifier:   "); print_1_7_2_12 (buffer + 368, 32, buffer + 240 /* encoding*/, 0); putchar ('\n');
+	N(1); TRACE ("File Set Identifier:        "); print_1_7_2_12 (buffer + 304, 32, buffer + 240 /* encoding*/, 0); TRACE_PUTCHAR ('\n');
+	N(1); TRACE ("Copyright File Identifier:  "); print_1_7_2_12 (buffer + 336, 32, buffer + 240 /* encoding*/, 0); TRACE_PUTCHAR ('\n');
+	N(1); TRACE ("Abstract File Identifier:   "); print_1_7_2_12 (buffer + 368, 32, buffer + 240 /* encoding*/, 0); TRACE_PUTCHAR ('\n');
 
 	UDF_longad_from_data (1, "Root Directory ICB.", RootDirectoryICB, buffer + 400);
 	/* next 6 bytes are reserved */
 
-	N(1); printf ("Domain Identifier:          "); print_1_7_4 (buffer + 416, 0);  putchar ('\n');
+	N(1); TRACE ("Domain Identifier:          "); print_1_7_4 (buffer + 416, 0);  TRACE_PUTCHAR ('\n');
 
 	UDF_longad_from_data (1, "Next Extent.", Prev, buffer + 448);
 
@@ -3366,34 +3848,34 @@ static int pathname_4_14_16 (int n, uint8_t *symlinkfiledata, uint64_t symlinkfi
 		uint8_t L_CI = d[1];
 		uint16_t ComponentFileVersionNumber = (d[3]<<8) | d[2];
 		int j;
-		N(n); printf ("Component.%d.Component Type:      %" PRIu8 " ", i, ComponentType);
+		N(n); TRACE ("Component.%d.Component Type:      %" PRIu8 " ", i, ComponentType);
 		switch (ComponentType)
 		{
-			case 0: printf ("\"Reserved for future standardisation.\"\n"); return -1;
+			case 0: TRACE ("\"Reserved for future standardisation.\"\n"); return -1;
 			case 1: /* subject to agreement between the originator and recipient of the medium */
 			default:
-				printf ("undefined\n"); break;
-			case 2: printf ("/ - root (current drive)\n"); length++; break;
-			case 3: printf (".. - parent directory\n");    length += 3; break;
-			case 4: printf (". - same directory\n");       length += 3; break;
-			case 5: printf ("component\n");                length += 1 + (uint_fast32_t)L_CI * 3 / 2; /* estimate worst case if UTF16 is used, no other code-maps are valid */ break;
-		}
-		N(n); printf ("Component.%d.Length of Component: %" PRIu8 "\n", i, L_CI);
-		N(n); printf ("Component.%d.Component File Version Number: %" PRIu16 "%s\n", i, ComponentFileVersionNumber, (ComponentFileVersionNumber==0)?"":" WARNING, should be zero according to UDF standard");
+				TRACE ("undefined\n"); break;
+			case 2: TRACE ("/ - root (current drive)\n"); length++; break;
+			case 3: TRACE (".. - parent directory\n");    length += 3; break;
+			case 4: TRACE (". - same directory\n");       length += 3; break;
+			case 5: TRACE ("component\n");                length += 1 + (uint_fast32_t)L_CI * 3 / 2; /* estimate worst case if UTF16 is used, no other code-maps are valid */ break;
+		}
+		N(n); TRACE ("Component.%d.Length of Component: %" PRIu8 "\n", i, L_CI);
+		N(n); TRACE ("Component.%d.Component File Version Number: %" PRIu16 "%s\n", i, ComponentFileVersionNumber, (ComponentFileVersionNumber==0)?"":" WARNING, should be zero according to UDF standard");
 		d+=4; l-=4;
 		if (L_CI)
 		{
 			if (L_CI > l)
 			{
-				N(n); printf ("WARNING - Buffer overflow\n");
+				N(n); TRACE ("WARNING - Buffer overflow\n");
 				return -1;
 			}
-			N(n); printf ("Component.%d.Component Identifier", i);
+			N(n); TRACE ("Component.%d.Component Identifier", i);
 			for (j=0; j < L_CI; j++)
 			{
-				printf (" 0x%02x", d[j]);
+				TRACE (" 0x%02x", d[j]);
 			}
-			putchar ('\n');
+			TRACE_PUTCHAR ('\n');
 			d+=L_CI; l-=L_CI;
 		}
 		i++;
@@ -3403,7 +3885,7 @@ static int pathname_4_14_16 (int n, uint8_t *symlinkfiledata, uint64_t symlinkfi
 	*symlink = calloc(1, length + 1);
 	if (!*symlink)
 	{
-		N(n+1); printf ("WARNING - calloc() failed in pathname_4_14_16\n"); return -1;
+		N(n+1); TRACE ("WARNING - calloc() failed in pathname_4_14_16\n"); return -1;
 	}
 	t = *symlink;
 	d = symlinkfiledata; l = symlinkfilesize;
@@ -3431,7 +3913,7 @@ static int pathname_4_14_16 (int n, uint8_t *symlinkfiledata, uint64_t symlinkfi
 					char *temp = 0;
 					N(n+1);
 					print_1_7_2 (d+4, L_CI, encoding, &temp);
-					putchar ('\n');
+					TRACE_PUTCHAR ('\n');
 					if (temp)
 					{
 						strcpy (t, temp);
@@ -3448,19 +3930,17 @@ static int pathname_4_14_16 (int n, uint8_t *symlinkfiledata, uint64_t symlinkfi
 }
 
 
-static struct UDF_FS_FileEntry_t *FileDecoder2 (int n, struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir, const char *pathname, int IsStream, struct UDF_FileEntry_t *FE)
+/* Fills retval, returns non-zero on errors */
+static int FileDecoder2 (int n, struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir, const char *pathname, int IsStream, struct UDF_FileEntry_t *FE, struct UDF_FS_FileEntry_t *retval)
 {
-	struct UDF_FS_FileEntry_t *retval;
-
-	retval = calloc (1, sizeof (*retval));
-	if (!retval)
-	{
-		fprintf (stderr, "FileDecoder - calloc() failed\n");
-		return 0;
-	}
-
+	memset (retval, 0, sizeof (*retval));
 	retval->FE = FE;
 	retval->FileName = strdup (pathname);
+	if (!retval->FileName)
+	{
+		fprintf (stderr, "FileDecoder - strdup() failed\n");
+		return -1;
+	}
 
 	switch (FE->FileType)
 	{
@@ -3476,22 +3956,21 @@ static struct UDF_FS_FileEntry_t *FileDecoder2 (int n, struct cdfs_disc_t *disc,
 		case FILETYPE_METADATA_MIRROR_FILE:          /* This will be loaded via Type2_Metadata_LoadData() */
 		case FILETYPE_METADATA_BITMAP_FILE:          /* This will be loaded via Type2_MetaData_LoadBitmap() */
 		case FILETYPE_TERMINAL_ENTRY:                /* This should be inside a Terminal Entry Descriptor */
-			N(n+2); printf ("WARNING - filetype was unexpected\n");
+			N(n+2); TRACE ("WARNING - filetype was unexpected\n");
 			free (retval->FileName);
-			free (retval);
-			return 0;
+			return -1;
 
 
 		case FILETYPE_FILE:           /* do not load data until demanded */
 		case FILETYPE_REAL_TIME_FILE: /* do not load data until demanded */
 		case FILETYPE_FIFO:           /* no data to load */
 		case FILETYPE_C_ISSOCK:       /* no data to load */
-			return retval;
+			return 0;
 
 		case FILETYPE_BLOCK_SPECIAL_DEVICE:
 		case FILETYPE_CHARACTER_SPECIAL_DEVICE:
 			/* Major/Minor is filled in by ExtendedAttributesCommon() */
-			return retval;
+			return 0;
 
 		case FILETYPE_SYMLINK:
 		{
@@ -3502,213 +3981,400 @@ static struct UDF_FS_FileEntry_t *FileDecoder2 (int n, struct cdfs_disc_t *disc,
 			/* load data */
 			if (FileEntryLoadData (disc, FE, &symlinkfiledata, 10*1024))
 			{
-				N(n+2); printf ("WARNING - Unable to load the \"Symlink\" FileEntry\n");
+				N(n+2); TRACE ("WARNING - Unable to load the \"Symlink\" FileEntry\n");
 				free (retval->FileName);
-				free (retval);
-				return 0;
+				return -1;
 			}
 			symlinkfilesize = FE->InformationLength;
 
 			if (symlinkfiledata)
 			{
-				N(n+2); printf ("[Symlink]\n"); pathname_4_14_16 (n+3, symlinkfiledata, symlinkfilesize, rootdir->FileSetCharacterSet, &symlink); putchar ('\n');
+				N(n+2); TRACE ("[Symlink]\n"); pathname_4_14_16 (n+3, symlinkfiledata, symlinkfilesize, rootdir->FileSetCharacterSet, &symlink); TRACE_PUTCHAR ('\n');
 				free (symlinkfiledata);
 			}
 			if (!symlink)
 			{
 				free (retval->FileName);
-				free (retval);
-				return 0;
+				return -1;
 			}
 			retval->Symlink = symlink;
-			return retval;
+			return 0;
 		}
 	}
 
 	/* this should be non-reachable */
 	free (retval->FileName);
-	free (retval);
-	return 0;
+	return -1;
 }
 
-static struct UDF_FS_FileEntry_t *FileDecoder (int n, struct cdfs_disc_t *disc, uint32_t LogicalPartitionRef, struct UDF_RootDirectory_t *rootdir, uint32_t LogicalSector, const char *pathname, int IsStream)
+/* Fills retval with the newest version, or the one selected by --at-timestamp. Returns non-zero on errors */
+static int FileDecoder (int n, struct cdfs_disc_t *disc, uint32_t LogicalPartitionRef, struct UDF_RootDirectory_t *rootdir, uint32_t LogicalSector, const char *pathname, int IsStream, struct UDF_FS_FileEntry_t *retval)
 {
-	struct UDF_FS_FileEntry_t *retval = 0;
-	struct UDF_FS_FileEntry_t *iter;
-	struct UDF_FS_FileEntry_t **prev = &retval;
 	struct UDF_LogicalVolume_Common *LogicalPartition = 0;
 	struct UDF_FileEntry_t *FE;
 
-	N(n); printf ("..[FileDecoder]\n");
+	N(n); TRACE ("..[FileDecoder]\n");
 	LogicalPartition = UDF_GetLogicalPartition (disc, LogicalPartitionRef);
 	if (!LogicalPartition)
 	{
-		N(n+1); printf ("Error - unable to find Partition\n");
-		return 0;
+		N(n+1); TRACE ("Error - unable to find Partition\n");
+		return -1;
 	}
 
 	FE = FileEntry (n+2, disc, LogicalSector, &LogicalPartition->PartitionCommon, 0);
-	if (!FE)
+	if ((!FE) || FileEntry_AtTimeStamp (n+2, disc, &FE))
+	{
+		return -1;
+	}
+
+	if (FileDecoder2 (n + 2, disc, rootdir, pathname, IsStream, FE, retval))
+	{
+		FileEntry_Free (FE);
+		return -1;
+	}
+	return 0;
+}
+
+#define UDF_FID_WINDOW (4 * SECTORSIZE)
+
+/* Streams the File Identifier Descriptors of a directory using constant memory. The window always holds the next UDF_FID_WINDOW / 2
+ * bytes of the directory (zero padded at the end), so a descriptor can straddle both sector and extent boundaries */
+struct UDF_FID_Iterator_t
+{
+	struct cdfs_disc_t     *disc;
+	struct UDF_FileEntry_t *FE;
+	uint64_t                Offset; /* position in the directory of window[Used] */
+	uint32_t                Used;
+	uint32_t                Fill;
+	uint8_t                 window[UDF_FID_WINDOW];
+};
+
+/* Returns non-zero on read errors */
+static int UDF_FID_Iterator_Fill (struct UDF_FID_Iterator_t *self)
+{
+	uint64_t left;
+	uint32_t bytes;
+
+	if ((self->Fill - self->Used) >= (UDF_FID_WINDOW / 2))
 	{
-		free (retval);
 		return 0;
 	}
+	memmove (self->window, self->window + self->Used, self->Fill - self->Used);
+	self->Fill -= self->Used;
+	self->Used = 0;
+
+	left = self->FE->InformationLength - self->Offset - self->Fill;
+	bytes = UDF_FID_WINDOW - self->Fill;
+	if (bytes > left)
+	{
+		bytes = left;
+	}
+	if (bytes && FileEntryReadData (self->disc, self->FE, self->Offset + self->Fill, self->window + self->Fill, bytes))
+	{
+		return -1;
+	}
+	self->Fill += bytes;
+	memset (self->window + self->Fill, 0, UDF_FID_WINDOW - self->Fill);
+	return 0;
+}
+
+/* The partition sector that holds the given byte of a file, as expected by the tag location checks */
+static uint32_t FileEntryLocation (struct UDF_FileEntry_t *FE, uint64_t offset)
+{
+	int i;
 
-	while (FE)
+	for (i=0; i < FE->FileAllocations; i++)
 	{
-		*prev = FileDecoder2 (n + 2, disc, rootdir, pathname, IsStream, FE);
-		if (!*prev)
+		if (offset < FE->FileAllocation[i].InformationLength)
 		{
-			break;
+			return FE->FileAllocation[i].ExtentLocation + (offset / SECTORSIZE);
 		}
-		FE = FE->PreviousVersion;
-		prev = &(*prev)->PreviousVersion;
+		offset -= FE->FileAllocation[i].InformationLength;
 	}
-	if (!retval)
-	{ /* if there is no UDF_FS_FileEntry_t to attach a FE too, release the whole chain... */
-		FileEntry_Free (FE);
+	return 0;
+}
+
+static int UDF_ICB_Batch_cmp_disc (const void *a, const void *b)
+{
+	const struct UDF_ICB_Batch_Entry_t *A = a;
+	const struct UDF_ICB_Batch_Entry_t *B = b;
+
+	if (A->Mapped != B->Mapped)
+	{
+		return A->Mapped ? -1 : 1;
+	}
+	if (!A->Mapped)
+	{
+		return UDF_ICB_Batch_cmp_location (a, b);
+	}
+	if (A->Absolute != B->Absolute)
+	{
+		return (A->Absolute < B->Absolute) ? -1 : 1;
+	}
+	return 0;
+}
+
+static void UDF_ICB_Batch_Free (struct UDF_ICB_Batch_t *batch)
+{
+	free (batch->Entries);
+	free (batch->Data);
+	batch->Entries = 0;
+	batch->Data = 0;
+	batch->Entries_N = 0;
+}
+
+/* Collects the ICB locations of the next UDF_ICB_BATCH File Identifier Descriptors, starting at the position of from, and reads them
+ * sorted by disc sector, merging neighbours into one read. Returns how many descriptors that were covered, zero if none could be
+ * parsed. Read errors are not reported here, FileEntry() fetches those sectors again and reports them */
+static int UDF_ICB_Batch_Load (struct cdfs_disc_t *disc, struct UDF_ICB_Batch_t *batch, const struct UDF_FID_Iterator_t *from)
+{
+	struct UDF_FID_Iterator_t *iter;
+	uint32_t run;
+	int count;
+	int i, j;
+
+	UDF_ICB_Batch_Free (batch);
+
+	iter = malloc (sizeof (*iter));
+	batch->Entries = malloc (sizeof (batch->Entries[0]) * UDF_ICB_BATCH);
+	if ((!iter) || (!batch->Entries))
+	{
+		fprintf (stderr, "UDF_ICB_Batch_Load() malloc() failed\n");
+		free (iter);
+		UDF_ICB_Batch_Free (batch);
 		return 0;
 	}
-	/* detach each FE node as long as there is another UDF_FS_FileEntry_t that owns it */
-	for (iter = retval; iter; iter = iter->PreviousVersion)
+	*iter = *from;
+
+	for (count = 0; (count < UDF_ICB_BATCH) && ((iter->FE->InformationLength - iter->Offset) >= 38); count++)
 	{
-		if (iter->PreviousVersion)
+		uint8_t *b = iter->window + iter->Used;
+		uint8_t L_FI = b[19];
+		uint16_t L_IU = (b[37] << 8) | b[36];
+		uint32_t padlength = (L_FI + L_IU + 38 + 3) & ~3;
+
+		if ((((b[1] << 8) | b[0]) != 0x0101) ||
+		    ((38 + L_IU + L_FI) > (UDF_FID_WINDOW / 2)) ||
+		    ((iter->FE->InformationLength - iter->Offset) < padlength))
+		{
+			break;
+		}
+		if (L_FI && !(b[18] & 0x08)) /* the same entries that DirectoryDecoder2() decodes */
+		{
+			struct UDF_LogicalVolume_Common *LogicalPartition = UDF_GetLogicalPartition (disc, (b[29]<<8) | b[28]);
+			if (LogicalPartition)
+			{
+				struct UDF_ICB_Batch_Entry_t *entry = &batch->Entries[batch->Entries_N++];
+				entry->Partition = &LogicalPartition->PartitionCommon;
+				entry->Location = (b[27]<<24) | (b[26]<<16) | (b[25]<<8) | b[24];
+				entry->Mapped = entry->Partition->MapSector && !entry->Partition->MapSector (disc, entry->Partition, entry->Location, &entry->Absolute, &run);
+				entry->Valid = 0;
+			}
+		}
+		iter->Used += padlength;
+		iter->Offset += padlength;
+		if (UDF_FID_Iterator_Fill (iter))
 		{
-			assert (iter->FE);
-			iter->FE->PreviousVersion = 0;
+			count++;
+			break;
 		}
 	}
-	return retval;
+	free (iter);
+
+	if (!batch->Entries_N)
+	{
+		return count;
+	}
+	batch->Data = malloc ((size_t)batch->Entries_N * SECTORSIZE);
+	if (!batch->Data)
+	{
+		fprintf (stderr, "UDF_ICB_Batch_Load() malloc() failed\n");
+		UDF_ICB_Batch_Free (batch);
+		return count;
+	}
+
+	/* partitions that are not backed by disc sectors are read in logical order */
+	qsort (batch->Entries, batch->Entries_N, sizeof (batch->Entries[0]), UDF_ICB_Batch_cmp_disc);
+	for (i=0; i < batch->Entries_N; i++)
+	{
+		batch->Entries[i].Data = batch->Data + (size_t)i * SECTORSIZE;
+	}
+	for (i=0; i < batch->Entries_N; i += run)
+	{
+		struct UDF_ICB_Batch_Entry_t *entry = &batch->Entries[i];
+
+		run = 1;
+		if (!entry->Mapped)
+		{
+			entry->Valid = !entry->Partition->FetchSector (disc, entry->Partition, entry->Data, entry->Location);
+			continue;
+		}
+		while (((i + run) < batch->Entries_N) && batch->Entries[i + run].Mapped && (batch->Entries[i + run].Absolute == (entry->Absolute + run)))
+		{
+			run++;
+		}
+		if (!get_absolute_sectors_2048 (disc, entry->Absolute, run, entry->Data))
+		{
+			for (j=0; j < run; j++)
+			{
+				entry[j].Valid = 1;
+			}
+		}
+	}
+	qsort (batch->Entries, batch->Entries_N, sizeof (batch->Entries[0]), UDF_ICB_Batch_cmp_location);
+
+	return count;
 }
 
-static struct UDF_FS_DirectoryEntry_t *DirectoryDecoder (int n, const char *_prefix, struct cdfs_disc_t *disc, uint16_t LogicalPartitionRef, struct UDF_RootDirectory_t *rootdir, uint32_t LogicalSector, const char *pathname, int IsStream);
+static int DirectoryDecoder (int n, const char *_prefix, struct cdfs_disc_t *disc, uint16_t LogicalPartitionRef, struct UDF_RootDirectory_t *rootdir, uint32_t LogicalSector, const char *pathname, int IsStream, struct UDF_FS_DirectoryEntry_t *retval);
 
-static struct UDF_FS_DirectoryEntry_t *DirectoryDecoder2 (int n, const char *_prefix, struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir, const char *pathname, int IsStream, struct UDF_FileEntry_t *FE)
+/* Fills retval, returns non-zero on errors */
+static int DirectoryDecoder2 (int n, const char *_prefix, struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir, const char *pathname, int IsStream, struct UDF_FileEntry_t *FE, struct UDF_FS_DirectoryEntry_t *retval)
 {
-	uint8_t *filedata = 0;
-	uint64_t filesize;
-	uint8_t *b;
-	uint32_t l;
-	uint32_t offset = 0;
+	struct UDF_FID_Iterator_t *iter;
+	struct UDF_ICB_Batch_t batch;
+	struct UDF_ICB_Batch_t *parent_batch;
+	int batch_left = 0;
+	int DirectoryEntries_Size = 0;
+	int FileEntries_Size = 0;
 	int index;
-	struct UDF_FS_DirectoryEntry_t *retval = 0;
-	struct UDF_FS_DirectoryEntry_t **PrevDirectory;
-	struct UDF_FS_FileEntry_t      **PrevFile;
-
-	int CFA_Index = 0;
-	int CFA_Offset = 0;
 
 	if (IsStream)
 	{
 		if (FE->FileType != FILETYPE_STREAM_DIRECTORY)
 		{
-			N(n+2); printf ("WARNING - Didn't find an expected stream directory\n");
-			return 0;
+			N(n+2); TRACE ("WARNING - Didn't find an expected stream directory\n");
+			return -1;
 		}
 	} else {
 		if (FE->FileType != FILETYPE_DIRECTORY)
 		{
-			N(n+2); printf ("WARNING - Didn't find an expected directory\n");
-			return 0;
+			N(n+2); TRACE ("WARNING - Didn't find an expected directory\n");
+			return -1;
 		}
 	}
 
-	if (FileEntryLoadData (disc, FE, &filedata, 1024 * 1024))
+	if (!FE->InformationLength)
 	{
-		N(n+2); printf ("WARNING - Unable to load the \"Directory\" FileEntry\n");
-		return 0;
+		return -1;
 	}
-	filesize = FE->InformationLength;
 
-	if (!filedata)
+	iter = calloc (1, sizeof (*iter));
+	if (!iter)
 	{
-		return 0;
+		fprintf (stderr, "DirectoryDecoder - calloc() failed\n");
+		return -1;
+	}
+	iter->disc = disc;
+	iter->FE = FE;
+	if (UDF_FID_Iterator_Fill (iter))
+	{
+		N(n+2); TRACE ("WARNING - Unable to load the \"Directory\" FileEntry\n");
+		free (iter);
+		return -1;
 	}
-	b = filedata;
-	l = filesize;
 
-	retval = calloc (1, sizeof (*retval));
+	memset (retval, 0, sizeof (*retval));
 	retval->FE = FE;
-#if 0
-	retval->Location_Partition = LogicalPartitionRef;
-	retval->Location_Sector = LogicalSector;
-#endif
 	retval->DirectoryName = pathname ? strdup (pathname) : 0;
 
-	PrevDirectory = &retval->DirectoryEntries;
-	PrevFile      = &retval->FileEntries;
+	memset (&batch, 0, sizeof (batch));
+	parent_batch = disc->udf_session->ICB_Batch;
 
-	for (index = 0; l >= 38; index++)
+	for (index = 0; (FE->InformationLength - iter->Offset) >= 38; index++)
 	{
+		uint64_t l = FE->InformationLength - iter->Offset;
+		uint8_t *b = iter->window + iter->Used;
 		uint16_t TagIdentifier = 0;
 		char prefix[128];
 		uint8_t L_FI;
 		uint16_t L_IU;
 		int padlength;
 
+		if (!batch_left)
+		{ /* the File Entries of the children are scattered over the disc, fetch the next batch of them in disc order */
+			batch_left = UDF_ICB_Batch_Load (disc, &batch, iter);
+			disc->udf_session->ICB_Batch = &batch;
+			if (!batch_left)
+			{
+				batch_left = -1;
+			}
+		}
+		if (batch_left > 0)
+		{
+			batch_left--;
+		}
+
 		snprintf (prefix, sizeof (prefix), "%s%d.", _prefix, index);
-		if (print_tag_format (n+2, prefix, b, FE->FileAllocation[CFA_Index].ExtentLocation + (CFA_Offset / SECTORSIZE) , 0, &TagIdentifier))
+		if (print_tag_format (n+2, prefix, b, FileEntryLocation (FE, iter->Offset), 0, &TagIdentifier))
 		{
 			break;
 		}
 		if (TagIdentifier != 0x0101)
 		{
-			N(n+3); printf ("Error - Invalid TagIdentifier, expected 0x0101\n");
+			N(n+3); TRACE ("Error - Invalid TagIdentifier, expected 0x0101\n");
 			break;
 		}
-		N(n+3); printf ("[File Identifier Descriptor]\n");
-		N(n+4); printf ("File Version Number:       %d%s\n", (b[17] << 8) | (b[16]), ((b[17] << 8) | (b[16]))==1?"":" WARNING - only \"1\" is allowed value according to the UDF standard\n");
-		N(n+4); printf ("File Characteristics:      0x%08" PRIx8 "\n", b[18]);
-		N(n+5); printf ("Existence:    %s\n", (b[18] & 0x01) ? "Hidden file" : "Visible");
-		N(n+5); printf ("Is directory: %s\n", (b[18] & 0x02) ? "Yes, entry is a directory" : "No, entry is a file");
-		N(n+5); printf ("Is deleted:   %s\n", (b[18] & 0x04) ? "Yes, entry is deleted" : "No");
-		N(n+5); printf ("Is parent:    %s\n", (b[18] & 0x08) ? "Yes, entry is the \"..\"" : "No");
-		N(n+5); printf ("Is metadata:  %s\n", (b[18] & 0x10) ? "Yes, but this is invalid for non-stream-directories" : "No");
-		N(n+4); printf ("Length of File Identifier: %d\n", L_FI = b[19]);
-		N(n+4); printf ("ICB.Extent Length:                              %d\n", (b[23]<<24) | (b[22]<<16) | (b[21]<<8) | b[20]);
-		N(n+4); printf ("ICB.Extent Location.Logical Block Number:       %d\n", (b[27]<<24) | (b[26]<<16) | (b[25]<<8) | b[24]);
-		N(n+4); printf ("ICB.Extent Location.Partition Reference Number: %d\n", (b[29]<<8) | b[28]);
-		N(n+4); printf ("ICB.Flags: 0x%04" PRIx16 "\n", (b[31] << 8) | b[30]);
-		if (b[30] & 0x01) { N(n+5); printf ("EXTENTErased: YES\n"); }
-		N(n+4); printf ("ICB.UDF UniqueID: %" PRIu32 "\n", (b[35]<<24) | (b[34]<<16) | (b[33]<<8) | b[32]);
-		N(n+4); printf ("Length of Implementation Use: %" PRIu16 "\n", L_IU = ((b[37]<<8) | b[36]));
+		N(n+3); TRACE ("[File Identifier Descriptor]\n");
+		N(n+4); TRACE ("File Version Number:       %d%s\n", (b[17] << 8) | (b[16]), ((b[17] << 8) | (b[16]))==1?"":" WARNING - only \"1\" is allowed value according to the UDF standard\n");
+		N(n+4); TRACE ("File Characteristics:      0x%08" PRIx8 "\n", b[18]);
+		N(n+5); TRACE ("Existence:    %s\n", (b[18] & 0x01) ? "Hidden file" : "Visible");
+		N(n+5); TRACE ("Is directory: %s\n", (b[18] & 0x02) ? "Yes, entry is a directory" : "No, entry is a file");
+		N(n+5); TRACE ("Is deleted:   %s\n", (b[18] & 0x04) ? "Yes, entry is deleted" : "No");
+		N(n+5); TRACE ("Is parent:    %s\n", (b[18] & 0x08) ? "Yes, entry is the \"..\"" : "No");
+		N(n+5); TRACE ("Is metadata:  %s\n", (b[18] & 0x10) ? "Yes, but this is invalid for non-stream-directories" : "No");
+		L_FI = b[19];
+		N(n+4); TRACE ("Length of File Identifier: %d\n", L_FI);
+		N(n+4); TRACE ("ICB.Extent Length:                              %d\n", (b[23]<<24) | (b[22]<<16) | (b[21]<<8) | b[20]);
+		N(n+4); TRACE ("ICB.Extent Location.Logical Block Number:       %d\n", (b[27]<<24) | (b[26]<<16) | (b[25]<<8) | b[24]);
+		N(n+4); TRACE ("ICB.Extent Location.Partition Reference Number: %d\n", (b[29]<<8) | b[28]);
+		N(n+4); TRACE ("ICB.Flags: 0x%04" PRIx16 "\n", (b[31] << 8) | b[30]);
+		if (b[30] & 0x01) { N(n+5); TRACE ("EXTENTErased: YES\n"); }
+		N(n+4); TRACE ("ICB.UDF UniqueID: %" PRIu32 "\n", (b[35]<<24) | (b[34]<<16) | (b[33]<<8) | b[32]);
+		L_IU = ((b[37]<<8) | b[36]);
+		N(n+4); TRACE ("Length of Implementation Use: %" PRIu16 "\n", L_IU);
 		if (l < (38 + L_IU))
 		{
-			N(n+5); printf ("WARNING - buffer overrun\n");
+			N(n+5); TRACE ("WARNING - buffer overrun\n");
+			break;
+		}
+		if ((38 + L_IU + L_FI) > (UDF_FID_WINDOW / 2))
+		{
+			N(n+5); TRACE ("WARNING - File Identifier Descriptor is too big\n");
 			break;
 		}
 		if (L_IU >= 32)
 		{
-			N(n+4); printf ("Implementation Use:\n");
-			N(n+5); printf ("Entity Identifier: "); print_1_7_4 (b + 38, 1);
+			N(n+4); TRACE ("Implementation Use:\n");
+			N(n+5); TRACE ("Entity Identifier: "); print_1_7_4 (b + 38, 1);
 			if (L_IU > 32)
 			{
 				int i;
 				N(n+5);
 				for (i=32; i < L_IU; i++)
 				{
-					printf(" 0x%02" PRIx8, b[38 + i]);
+					TRACE(" 0x%02" PRIx8, b[38 + i]);
 				}
-				printf ("\n");
+				TRACE ("\n");
 			}
 		} else if (L_IU)
 		{
 				int i;
-				N(n+4); printf ("Implementation Use:\n");
+				N(n+4); TRACE ("Implementation Use:\n");
 				N(n+4);
 				for (i=32; i < L_IU; i++)
 				{
-					printf(" 0x%02" PRIx8, b[38 + i]);
+					TRACE(" 0x%02" PRIx8, b[38 + i]);
 				}
-				printf ("\n");
+				TRACE ("\n");
 
 		}
 		if (l < (38 + L_IU + L_FI))
 		{
-			N(n+5); printf ("WARNING - buffer overrun\n");
+			N(n+5); TRACE ("WARNING - buffer overrun\n");
 			break;
 		}
-		N(n+4); printf ("File Identifier:            ");
+		N(n+4); TRACE ("File Identifier:            ");
 		if (L_FI)
 		{
 			char *childname = 0;
@@ -3716,116 +4382,117 @@ static struct UDF_FS_DirectoryEntry_t *DirectoryDecoder2 (int n, const char *_pr
 			uint32_t Location_Sector    = (b[27]<<24) | (b[26]<<16) | (b[25]<<8) | b[24];
 
 			print_1_7_2(b + 38 + L_IU, L_FI, rootdir->FileSetCharacterSet, &childname);
-			putchar ('\n');
+			TRACE_PUTCHAR ('\n');
 			if (!childname)
 			{
-				continue; /* filename decoding failed */
-			}
-
-			if (b[18] & 0x08) /* .. */
+				/* filename decoding failed */
+			} else if (b[18] & 0x08) /* .. */
 			{
 				/* ..  - parent directory */
-				free (childname);
-				continue;
-			}
-
-			if (b[18] & 0x02)
+			} else if (b[18] & 0x02)
 			{
 				/* directory */
-				*PrevDirectory = DirectoryDecoder (n + 5, prefix, disc, Location_Partition, rootdir, Location_Sector, childname, IsStream);
-				if (*PrevDirectory)
+				if (retval->DirectoryEntries_N >= DirectoryEntries_Size)
+				{
+					struct UDF_FS_DirectoryEntry_t *temp = realloc (retval->DirectoryEntries, sizeof (retval->DirectoryEntries[0]) * (DirectoryEntries_Size * 2 + 16));
+					if (temp)
+					{
+						retval->DirectoryEntries = temp;
+						DirectoryEntries_Size = DirectoryEntries_Size * 2 + 16;
+					}
+				}
+				if ((retval->DirectoryEntries_N < DirectoryEntries_Size) &&
+				    !DirectoryDecoder (n + 5, prefix, disc, Location_Partition, rootdir, Location_Sector, childname, IsStream, &retval->DirectoryEntries[retval->DirectoryEntries_N]))
 				{
-					PrevDirectory = &(*PrevDirectory)->Next;
+					retval->DirectoryEntries_N++;
 				}
 			} else {
 				/* file */
-				*PrevFile = FileDecoder (n + 5, disc, Location_Partition, rootdir, Location_Sector, childname, IsStream);
-				putchar ('\n');
-				if (*PrevFile)
+				if (retval->FileEntries_N >= FileEntries_Size)
+				{
+					struct UDF_FS_FileEntry_t *temp = realloc (retval->FileEntries, sizeof (retval->FileEntries[0]) * (FileEntries_Size * 2 + 16));
+					if (temp)
+					{
+						retval->FileEntries = temp;
+						FileEntries_Size = FileEntries_Size * 2 + 16;
+					}
+				}
+				if ((retval->FileEntries_N < FileEntries_Size) &&
+				    !FileDecoder (n + 5, disc, Location_Partition, rootdir, Location_Sector, childname, IsStream, &retval->FileEntries[retval->FileEntries_N]))
 				{
-					PrevFile = &(*PrevFile)->Next;
+					retval->FileEntries_N++;
 				}
+				TRACE_PUTCHAR ('\n');
 			}
 			free (childname);
 		} else {
-			printf("(null)\n");
+			TRACE("(null)\n");
 		}
 		padlength = (L_FI + L_IU + 38 + 3) & ~3;
-		if (l >= padlength)
+		if (l < padlength)
 		{
-			offset += padlength;
-			l -= padlength;
-			b += padlength;
-
-			while (padlength)
-			{
-				if (padlength >= (FE->FileAllocation[CFA_Index].InformationLength + CFA_Offset))
-				{
-					padlength -= FE->FileAllocation[CFA_Index].InformationLength - CFA_Offset;
-					CFA_Offset = 0;
-					CFA_Index++;
-				} else {
-					CFA_Offset += padlength;
-					break;
-				}
-			}
-		} else {
-			l = 0;
+			break;
+		}
+		iter->Used += padlength;
+		iter->Offset += padlength;
+		if (UDF_FID_Iterator_Fill (iter))
+		{
+			N(n+3); TRACE ("WARNING - Unable to read the rest of the \"Directory\"\n");
+			break;
 		}
 	}
 
-	free (filedata);
+	free (iter);
+	disc->udf_session->ICB_Batch = parent_batch;
+	UDF_ICB_Batch_Free (&batch);
 
-	return retval;
+	/* shrink the arrays to fit */
+	if (retval->DirectoryEntries_N < DirectoryEntries_Size)
+	{
+		void *temp = realloc (retval->DirectoryEntries, sizeof (retval->DirectoryEntries[0]) * retval->DirectoryEntries_N);
+		if (temp || !retval->DirectoryEntries_N)
+		{
+			retval->DirectoryEntries = temp;
+		}
+	}
+	if (retval->FileEntries_N < FileEntries_Size)
+	{
+		void *temp = realloc (retval->FileEntries, sizeof (retval->FileEntries[0]) * retval->FileEntries_N);
+		if (temp || !retval->FileEntries_N)
+		{
+			retval->FileEntries = temp;
+		}
+	}
+
+	return 0;
 }
 
-static struct UDF_FS_DirectoryEntry_t *DirectoryDecoder (int n, const char *_prefix, struct cdfs_disc_t *disc, uint16_t LogicalPartitionRef, struct UDF_RootDirectory_t *rootdir, uint32_t LogicalSector, const char *pathname, int IsStream)
+/* Fills retval with the newest version, or the one selected by --at-timestamp. Returns non-zero on errors */
+static int DirectoryDecoder (int n, const char *_prefix, struct cdfs_disc_t *disc, uint16_t LogicalPartitionRef, struct UDF_RootDirectory_t *rootdir, uint32_t LogicalSector, const char *pathname, int IsStream, struct UDF_FS_DirectoryEntry_t *retval)
 {
-	struct UDF_FS_DirectoryEntry_t *retval = 0;
-	struct UDF_FS_DirectoryEntry_t *iter;
-	struct UDF_FS_DirectoryEntry_t **prev = &retval;
 	struct UDF_LogicalVolume_Common *LogicalPartition = 0;
 	struct UDF_FileEntry_t *FE;
 
-	N(n); printf ("..[DirectoryDecoder]\n");
+	N(n); TRACE ("..[DirectoryDecoder]\n");
 	LogicalPartition = UDF_GetLogicalPartition (disc, LogicalPartitionRef);
 	if (!LogicalPartition)
 	{
-		N(n+1); printf ("Error - unable to find Partition\n");
-		return 0;
+		N(n+1); TRACE ("Error - unable to find Partition\n");
+		return -1;
 	}
 
 	FE = FileEntry (n+2, disc, LogicalSector, &LogicalPartition->PartitionCommon, 0);
-	if (!FE)
+	if ((!FE) || FileEntry_AtTimeStamp (n+2, disc, &FE))
 	{
-		return 0;
+		return -1;
 	}
 
-	while (FE)
+	if (DirectoryDecoder2 (n + 2, _prefix, disc, rootdir, pathname, IsStream, FE, retval))
 	{
-		*prev = DirectoryDecoder2 (n + 2, _prefix, disc, rootdir, pathname, IsStream, FE);
-		if (!*prev)
-		{
-			break;
-		}
-		FE = FE->PreviousVersion;
-		prev = &(*prev)->PreviousVersion;
-	}
-	if (!retval)
-	{ /* if there is no UDF_FS_DirectoryEntry_t to attach a FE too, release the whole chain... */
 		FileEntry_Free (FE);
-		return 0;
-	}
-	/* detach each FE node as long as there is another UDF_FS_DirectoryEntry_t that can own it */
-	for (iter = retval; iter; iter = iter->PreviousVersion)
-	{
-		if (iter->PreviousVersion)
-		{
-			assert (iter->FE);
-			iter->FE->PreviousVersion = 0;
-		}
+		return -1;
 	}
-	return retval;
+	return 0;
 }
 
 static int UDF_CompleteDiskIO_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self)
@@ -3874,51 +4541,48 @@ void UDF_Descriptor (struct cdfs_disc_t *disc)
 	struct UDF_extent_ad ReserveVolumeDescriptorSequenceExtent_N_minus_256 = {0, 0};
 
 	{
-		uint32_t SearchBegin = 256;
-		uint32_t SearchEnd = 4500000;
-		uint32_t SearchHalf;
-		int iteration = 0;
-
-		while ((SearchBegin < SearchEnd) && (SearchBegin + 1) != SearchEnd)
-		{
-			uint32_t FetchLength = 64;
+		uint32_t sectorcount = cdfs_disc_sectorcount (disc);
+		uint32_t Location[3]; /* fetched in ascending order: 256, N-256 and N */
+		int failed[3] = {1, 1, 1};
+		uint8_t anchors[3][SECTORSIZE];
+		int i;
 
-			iteration++;
+		TRACE ("Disc size: %" PRIu32 " sectors\n", sectorcount);
 
-			SearchHalf = ((SearchEnd - SearchBegin) >> 1) + SearchBegin;
-
-			printf ("UDF_Descriptor iteration %d, SearchBegin=%"PRId32" SearchEnd=%"PRId32" SearchHalf=%"PRId32" FetchLength=%"PRId32"\n", iteration, SearchBegin, SearchEnd, SearchHalf, FetchLength);
-			if (get_absolute_sector_2048 (disc, SearchHalf, buffer))
+		Location[0] = 256;
+		Location[1] = sectorcount - 1 - 256;
+		Location[2] = sectorcount - 1;
+		for (i=0; i < 3; i++)
+		{
+			if ((i == 0) || (Location[2] > 256))
 			{
-				printf (" FetchSector %" PRIu32 " failed\n", SearchHalf);
-				SearchEnd = SearchHalf - 1;
-			} else {
-				SearchBegin = SearchHalf;
+				failed[i] = get_absolute_sector_2048 (disc, Location[i], anchors[i]);
 			}
 		}
-		printf ("SearchEnd=%" PRId32 "\n", SearchEnd);
-		if (SearchEnd > 256)
+
+		if (Location[2] > 256)
 		{
-			if (get_absolute_sector_2048 (disc, SearchEnd, buffer))
+			if (failed[2])
 			{
-				printf ("Failed to fetch sector N");
+				TRACE ("Failed to fetch sector N");
 			} else {
-				invalid_N = AnchorVolumeDescriptorPointer (n, buffer, SearchEnd, &MainVolumeDescriptorSequenceExtent_N, &ReserveVolumeDescriptorSequenceExtent_N);
+				invalid_N = AnchorVolumeDescriptorPointer (n, anchors[2], Location[2], &MainVolumeDescriptorSequenceExtent_N, &ReserveVolumeDescriptorSequenceExtent_N);
 			}
 
-			if (get_absolute_sector_2048 (disc, SearchEnd - 256, buffer))
+			if (failed[1])
 			{
-				printf ("Failed to fetch sector N-256");
+				TRACE ("Failed to fetch sector N-256");
 			} else {
-				invalid_N_minus_256 = AnchorVolumeDescriptorPointer (n, buffer, SearchEnd - 256, &MainVolumeDescriptorSequenceExtent_N_minus_256, &ReserveVolumeDescriptorSequenceExtent_N_minus_256);
+				invalid_N_minus_256 = AnchorVolumeDescriptorPointer (n, anchors[1], Location[1], &MainVolumeDescriptorSequenceExtent_N_minus_256, &ReserveVolumeDescriptorSequenceExtent_N_minus_256);
 			}
 		}
-	}
 
-	/* Anchor Volume Descriptor Pointer is always located at sector 256 in the given session */
-	if (get_absolute_sector_2048 (disc, 256, buffer))
-	{
-		return;
+		/* Anchor Volume Descriptor Pointer is always located at sector 256 in the given session */
+		if (failed[0])
+		{
+			return;
+		}
+		memcpy (buffer, anchors[0], SECTORSIZE);
 	}
 
 	invalid_256 = AnchorVolumeDescriptorPointer (n, buffer, 256, &MainVolumeDescriptorSequenceExtent_256, &ReserveVolumeDescriptorSequenceExtent_256);
@@ -4044,13 +4708,21 @@ void UDF_Descriptor (struct cdfs_disc_t *disc)
 				temp->Root = 0;
 				temp->SystemStream = 0;
 
-				if (temp->RootDirectory.ExtentLength)
+				if (temp->RootDirectory.ExtentLength && (temp->Root = malloc (sizeof (*temp->Root))))
 				{
-					temp->Root = DirectoryDecoder (n+2, "ROOT.", disc, temp->RootDirectory.ExtentLocation.PartitionReferenceNumber, temp, temp->RootDirectory.ExtentLocation.LogicalBlockNumber, 0, 0);
+					if (DirectoryDecoder (n+2, "ROOT.", disc, temp->RootDirectory.ExtentLocation.PartitionReferenceNumber, temp, temp->RootDirectory.ExtentLocation.LogicalBlockNumber, 0, 0, temp->Root))
+					{
+						free (temp->Root);
+						temp->Root = 0;
+					}
 				}
-				if (temp->SystemStreamDirectory.ExtentLength)
+				if (temp->SystemStreamDirectory.ExtentLength && (temp->SystemStream = malloc (sizeof (*temp->SystemStream))))
 				{
-					temp->SystemStream = DirectoryDecoder (n+2, "ROOT.", disc, temp->SystemStreamDirectory.ExtentLocation.PartitionReferenceNumber, temp, temp->SystemStreamDirectory.ExtentLocation.LogicalBlockNumber, 0, 1);
+					if (DirectoryDecoder (n+2, "ROOT.", disc, temp->SystemStreamDirectory.ExtentLocation.PartitionReferenceNumber, temp, temp->SystemStreamDirectory.ExtentLocation.LogicalBlockNumber, 0, 1, temp->SystemStream))
+					{
+						free (temp->SystemStream);
+						temp->SystemStream = 0;
+					}
 				}
 
 				if (!fsd_prev.ExtentLength)
@@ -4062,6 +4734,12 @@ void UDF_Descriptor (struct cdfs_disc_t *disc)
 			} while (1);
 
 		} while (!lv->PartitionCommon.NextSession (disc, &lv->PartitionCommon, &lv_Location, lv_TimeStamp));
+
+		/* the bitmaps describe the current state, and not the one selected by --at-timestamp */
+		if (disc->udf_spacecheck && disc->udf_session->LogicalVolumes->RootDirectories_N && (!disc->udf_has_timestamp))
+		{
+			UDF_SpaceCheck (n, disc, &disc->udf_session->LogicalVolumes->RootDirectories[0]);
+		}
 	}
 }
 
@@ -4103,6 +4781,8 @@ static void SequenceRawdisk (int n, struct cdfs_disc_t *disc, struct UDF_extent_
 
 void UDF_Session_Free (struct cdfs_disc_t *disc)
 {
+	int i;
+
 	if (!disc)
 	{
 		return;
@@ -4121,6 +4801,11 @@ void UDF_Session_Free (struct cdfs_disc_t *disc)
 		      disc->udf_session->PrimaryVolumeDescriptor = 0;
 	}
 
+	for (i=0; i < disc->udf_session->PhysicalPartition_N; i++)
+	{
+		UDF_SpaceBitmap_Free (&disc->udf_session->PhysicalPartition[i].UnallocatedSpaceBitmap);
+		UDF_SpaceBitmap_Free (&disc->udf_session->PhysicalPartition[i].FreedSpaceBitmap);
+	}
 	free (disc->udf_session->PhysicalPartition);
 	disc->udf_session->PhysicalPartition = 0;
 
@@ -4161,15 +4846,93 @@ static void UDF_Session_Add_PrimaryVolumeDescriptor (struct cdfs_disc_t *disc, u
 	disc->udf_session->PrimaryVolumeDescriptor->VolumeSequenceNumber = VolumeSequenceNumber;
 }
 
+/* Runs must be appended in order. Returns non-zero on errors */
+static int UDF_Translation_Append (struct UDF_Translation_t *self, uint32_t Logical, uint32_t Absolute, uint32_t Length)
+{
+	if (self->Runs_N)
+	{
+		struct UDF_TranslationRun_t *last = &self->Runs[self->Runs_N - 1];
+		if (((last->Logical + last->Length) == Logical) && ((last->Absolute + last->Length) == Absolute))
+		{
+			last->Length += Length;
+			return 0;
+		}
+	}
+	if (self->Runs_N >= self->Runs_Size)
+	{
+		struct UDF_TranslationRun_t *temp = realloc (self->Runs, sizeof (self->Runs[0]) * (self->Runs_Size + 256));
+		if (!temp)
+		{
+			fprintf (stderr, "UDF_Translation_Append() realloc() failed\n");
+			return -1;
+		}
+		self->Runs = temp;
+		self->Runs_Size += 256;
+	}
+	self->Runs[self->Runs_N].Logical = Logical;
+	self->Runs[self->Runs_N].Absolute = Absolute;
+	self->Runs[self->Runs_N].Length = Length;
+	self->Runs_N++;
+	return 0;
+}
+
+static int UDF_Translation_Lookup (struct UDF_Translation_t *self, uint32_t sector, uint32_t *absolute, uint32_t *run)
+{
+	uint32_t low = 0;
+	uint32_t high = self->Runs_N;
+
+	while (low < high)
+	{
+		uint32_t mid = low + (high - low) / 2;
+
+		if (sector < self->Runs[mid].Logical)
+		{
+			high = mid;
+		} else if ((sector - self->Runs[mid].Logical) >= self->Runs[mid].Length)
+		{
+			low = mid + 1;
+		} else {
+			*absolute = self->Runs[mid].Absolute + (sector - self->Runs[mid].Logical);
+			*run = self->Runs[mid].Length - (sector - self->Runs[mid].Logical);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static void UDF_Translation_Free (struct UDF_Translation_t *self)
+{
+	free (self->Runs);
+	self->Runs = 0;
+	self->Runs_N = 0;
+	self->Runs_Size = 0;
+}
+
+/* FetchSector for all partitions that can MapSector */
+static int UDF_Mapped_FetchSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector)
+{
+	uint32_t absolute, run;
+
+	if (self->MapSector (disc, self, sector, &absolute, &run))
+	{
+		return -1;
+	}
+	return get_absolute_sector_2048 (disc, absolute, buffer);
+}
+
 static int PhysicalPartitionInitialize (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self)
 {
 	return 0;
 }
 
-static int PhysicalPartitionFetchSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector)
+static int PhysicalPartitionMapSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t sector, uint32_t *absolute, uint32_t *run)
 {
 	struct UDF_PhysicalPartition_t *_self = (struct UDF_PhysicalPartition_t *)self;
-	return get_absolute_sector_2048 (disc, sector + _self->Start, buffer);
+
+	/* Sectors past Length are not rejected, but they are not assumed to be contiguous either */
+	*absolute = sector + _self->Start;
+	*run = (sector < _self->Length) ? (_self->Length - sector) : 1;
+	return 0;
 }
 
 static void UDF_Session_Add_PhysicalPartition (struct cdfs_disc_t *disc, uint32_t VolumeDescriptorSequenceNumber, uint16_t PartitionNumber, enum PhysicalPartition_Content Content, uint32_t SectorSize, uint32_t Start, uint32_t Length)
@@ -4193,6 +4956,10 @@ static void UDF_Session_Add_PhysicalPartition (struct cdfs_disc_t *disc, uint32_
 				disc->udf_session->PhysicalPartition[i].SectorSize = SectorSize;
 				disc->udf_session->PhysicalPartition[i].Start = Start;
 				disc->udf_session->PhysicalPartition[i].Length = Length;
+				UDF_SpaceBitmap_Free (&disc->udf_session->PhysicalPartition[i].UnallocatedSpaceBitmap);
+				UDF_SpaceBitmap_Free (&disc->udf_session->PhysicalPartition[i].FreedSpaceBitmap);
+				disc->udf_session->PhysicalPartition[i].UnallocatedSpaceBitmapExtent.ExtentLength = 0;
+				disc->udf_session->PhysicalPartition[i].FreedSpaceBitmapExtent.ExtentLength = 0;
 				return;
 			}
 		}
@@ -4205,10 +4972,12 @@ static void UDF_Session_Add_PhysicalPartition (struct cdfs_disc_t *disc, uint32_
 	}
 	disc->udf_session->PhysicalPartition = temp;
 	memmove (disc->udf_session->PhysicalPartition + i + 1, disc->udf_session->PhysicalPartition + i, sizeof (struct UDF_PhysicalPartition_t) * (disc->udf_session->PhysicalPartition_N  - i ));
+	memset (disc->udf_session->PhysicalPartition + i, 0, sizeof (struct UDF_PhysicalPartition_t));
 	disc->udf_session->PhysicalPartition[i].VolumeDescriptorSequenceNumber = VolumeDescriptorSequenceNumber;
 	disc->udf_session->PhysicalPartition[i].PartitionNumber = PartitionNumber;
 	disc->udf_session->PhysicalPartition[i].PartitionCommon.Initialize = PhysicalPartitionInitialize;
-	disc->udf_session->PhysicalPartition[i].PartitionCommon.FetchSector = PhysicalPartitionFetchSector;
+	disc->udf_session->PhysicalPartition[i].PartitionCommon.FetchSector = UDF_Mapped_FetchSector;
+	disc->udf_session->PhysicalPartition[i].PartitionCommon.MapSector = PhysicalPartitionMapSector;
 	disc->udf_session->PhysicalPartition[i].Content = Content;
 	disc->udf_session->PhysicalPartition[i].SectorSize = SectorSize;
 	disc->udf_session->PhysicalPartition[i].Start = Start;
@@ -4242,53 +5011,186 @@ static void UDF_LogicalVolume_FileSetDescriptor_SetLocation (struct UDF_LogicalV
 	}
 }
 
+/* Releases the content of File, and the older versions */
 static void UDF_File_Free (struct UDF_FS_FileEntry_t *File)
 {
-	while (File)
+	free (File->FileName);
+	free (File->Symlink);
+	FileEntry_Free (File->FE);
+}
+
+/* Releases the content of Directory */
+static void UDF_Directory_Free (struct UDF_FS_DirectoryEntry_t *Directory)
+{
+	int i;
+
+	for (i=0; i < Directory->DirectoryEntries_N; i++)
+	{
+		UDF_Directory_Free (&Directory->DirectoryEntries[i]);
+	}
+	free (Directory->DirectoryEntries);
+	for (i=0; i < Directory->FileEntries_N; i++)
+	{
+		UDF_File_Free (&Directory->FileEntries[i]);
+	}
+	free (Directory->FileEntries);
+	free (Directory->DirectoryName);
+	FileEntry_Free (Directory->FE);
+}
+
+static void UDF_RootDirectory_Free (struct UDF_RootDirectory_t *root)
+{
+	if (root->Root)
+	{
+		UDF_Directory_Free (root->Root);
+		free (root->Root);
+	}
+	if (root->SystemStream)
+	{
+		UDF_Directory_Free (root->SystemStream);
+		free (root->SystemStream);
+	}
+}
+
+struct UDF_FS_DirectoryEntry_t *UDF_FileEntry_Streams (struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir, struct UDF_FileEntry_t *FE)
+{
+#ifdef CDFS_TRACE
+	int trace = trace_enabled;
+#endif
+
+	if (FE->Streams || (!FE->StreamDirectoryICB.ExtentLength))
+	{
+		return FE->Streams;
+	}
+
+	FE->Streams = malloc (sizeof (*FE->Streams));
+	if (!FE->Streams)
+	{
+		fprintf (stderr, "UDF_FileEntry_Streams() malloc() failed\n");
+		return 0;
+	}
+#ifdef CDFS_TRACE
+	trace_enabled = 0; /* the descriptors have been dumped already, if wanted */
+#endif
+	if (DirectoryDecoder (0, "STREAM.", disc, FE->StreamDirectoryICB.ExtentLocation.PartitionReferenceNumber, rootdir, FE->StreamDirectoryICB.ExtentLocation.LogicalBlockNumber, 0, 1, FE->Streams))
+	{
+		free (FE->Streams);
+		FE->Streams = 0;
+	}
+#ifdef CDFS_TRACE
+	trace_enabled = trace;
+#endif
+	return FE->Streams;
+}
+
+int UDF_FileEntry_Read (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE, uint64_t offset, uint8_t *buffer, uint64_t length)
+{
+	return FileEntryReadData (disc, FE, offset, buffer, length);
+}
+
+/* Appends the attributes found in one attribute space, that starts with an Extended Attribute Header Descriptor */
+static int UDF_ExtendedAttributes_Parse (struct UDF_ExtendedAttributes_t *EA, const uint8_t *b, uint32_t l)
+{
+	if ((l < 24) || (((b[1] << 8) | b[0]) != 0x0106))
+	{
+		return 0;
+	}
+	b += 24;
+	l -= 24;
+
+	while (l >= 12)
 	{
-		struct UDF_FS_FileEntry_t *next = File->Next;
+		struct UDF_ExtendedAttribute_t *attribute;
+		uint32_t AttributeLength = (b[11] << 24) | (b[10] << 16) | (b[9] << 8) | b[8];
 
-		if (File->PreviousVersion)
+		if ((AttributeLength > l) || (AttributeLength < 12))
+		{
+			break;
+		}
+		attribute = realloc (EA->Attributes, sizeof (EA->Attributes[0]) * (EA->Attributes_N + 1));
+		if (!attribute)
 		{
-			UDF_File_Free (File->PreviousVersion);
+			fprintf (stderr, "UDF_ExtendedAttributes_Parse() realloc() failed\n");
+			return -1;
+		}
+		EA->Attributes = attribute;
+		attribute = &EA->Attributes[EA->Attributes_N++];
+		memset (attribute, 0, sizeof (*attribute));
+		attribute->AttributeType = (b[3] << 24) | (b[2] << 16) | (b[1] << 8) | b[0];
+		attribute->AttributeSubtype = b[4];
+		attribute->Data = b + 12;
+		attribute->Length = AttributeLength - 12;
+		if (((attribute->AttributeType == 2048) || (attribute->AttributeType == 65536)) && (AttributeLength >= 48))
+		{ /* Implementation / Application Use: a length, an entity identifier and the data */
+			uint32_t IU_L = (b[15] << 24) | (b[14] << 16) | (b[13] << 8) | b[12];
+			memcpy (attribute->Identifier, b + 17, 23);
+			attribute->Data = b + 48;
+			attribute->Length = (IU_L <= (AttributeLength - 48)) ? IU_L : (AttributeLength - 48);
 		}
-		free (File->FileName);
-		free (File->Symlink);
-		FileEntry_Free (File->FE);
-		free (File);
-		File = next;
+		b += AttributeLength;
+		l -= AttributeLength;
 	}
+	return 0;
 }
 
-static void UDF_Directory_Free (struct UDF_FS_DirectoryEntry_t *Directory)
+struct UDF_ExtendedAttributes_t *UDF_FileEntry_ExtendedAttributes (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE)
 {
-	while (Directory)
+	struct UDF_ExtendedAttributes_t *EA;
+	struct UDF_LogicalVolume_Common *lv = 0;
+	uint32_t ICBLength = 0;
+
+	EA = calloc (1, sizeof (*EA));
+	if (!EA)
+	{
+		fprintf (stderr, "UDF_FileEntry_ExtendedAttributes() calloc() failed\n");
+		return 0;
+	}
+	if (FE->ExtendedAttributeICB.ExtentLength)
 	{
-		struct UDF_FS_DirectoryEntry_t *next = Directory->Next;
-		if (Directory->DirectoryEntries)
+		lv = UDF_GetLogicalPartition (disc, FE->ExtendedAttributeICB.ExtentLocation.PartitionReferenceNumber);
+		if (lv)
 		{
-			UDF_Directory_Free (Directory->DirectoryEntries);
+			ICBLength = FE->ExtendedAttributeICB.ExtentLength & 0x3fffffff;
 		}
-		if (Directory->FileEntries)
+	}
+
+	/* the inline space is read together with the File Entry sector, the ICB space follows after that */
+	EA->Space = malloc (SECTORSIZE + (size_t)ICBLength);
+	if (!EA->Space)
+	{
+		fprintf (stderr, "UDF_FileEntry_ExtendedAttributes() malloc() failed\n");
+		free (EA);
+		return 0;
+	}
+	if (FE->InlineExtendedAttributes_Length)
+	{
+		if (UDF_ReadSectors (disc, FE->PartitionCommon, FE->ExtentLocation, 1, EA->Space) ||
+		    UDF_ExtendedAttributes_Parse (EA, EA->Space + FE->InlineExtendedAttributes_Offset, FE->InlineExtendedAttributes_Length))
 		{
-			UDF_File_Free (Directory->FileEntries);
+			UDF_ExtendedAttributes_Free (EA);
+			return 0;
 		}
-		if (Directory->PreviousVersion)
+	}
+	if (ICBLength)
+	{
+		if (UDF_ReadBytes (disc, &lv->PartitionCommon, FE->ExtendedAttributeICB.ExtentLocation.LogicalBlockNumber, 0, EA->Space + SECTORSIZE, ICBLength) ||
+		    UDF_ExtendedAttributes_Parse (EA, EA->Space + SECTORSIZE, ICBLength))
 		{
-			UDF_Directory_Free (Directory->PreviousVersion);
+			UDF_ExtendedAttributes_Free (EA);
+			return 0;
 		}
-		free (Directory->DirectoryName);
-		FileEntry_Free (Directory->FE);
-		free (Directory);
-		Directory = next;
 	}
+	return EA;
 }
 
-static void UDF_RootDirectory_Free (struct UDF_RootDirectory_t *root)
+void UDF_ExtendedAttributes_Free (struct UDF_ExtendedAttributes_t *EA)
 {
-	if (root->Root) UDF_Directory_Free (root->Root);
-	if (root->SystemStream) UDF_Directory_Free (root->SystemStream);
-
+	if (EA)
+	{
+		free (EA->Attributes);
+		free (EA->Space);
+		free (EA);
+	}
 }
 
 static void UDF_LogicalVolumes_Free (struct UDF_LogicalVolumes_t *self)
@@ -4359,7 +5261,7 @@ static int Type1_FetchSector_Real (struct cdfs_disc_t *disc, void *self, uint8_t
 	return t->PhysicalPartition->PartitionCommon.FetchSector (disc, &t->PhysicalPartition->PartitionCommon, buffer, sector);
 }
 
-static int Type1_FetchSector_Virtual (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector)
+static int Type1_MapSector_Virtual (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t sector, uint32_t *absolute, uint32_t *run)
 {
 	struct UDF_LogicalVolume_Type1 *t = (struct UDF_LogicalVolume_Type1 *)self;
 	if (!t->PhysicalPartition)
@@ -4368,9 +5270,9 @@ static int Type1_FetchSector_Virtual (struct cdfs_disc_t *disc, struct UDF_Parti
 	}
 	if (t->VAT)
 	{
-		return t->VAT->Common.PartitionCommon.FetchSector (disc, &t->VAT->Common.PartitionCommon, buffer, sector);
+		return t->VAT->Common.PartitionCommon.MapSector (disc, &t->VAT->Common.PartitionCommon, sector, absolute, run);
 	}
-	return t->PhysicalPartition->PartitionCommon.FetchSector (disc, &t->PhysicalPartition->PartitionCommon, buffer, sector);
+	return t->PhysicalPartition->PartitionCommon.MapSector (disc, &t->PhysicalPartition->PartitionCommon, sector, absolute, run);
 }
 
 static int Type1_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self)
@@ -4473,7 +5375,14 @@ static void UDF_LogicalVolume_Append (struct UDF_LogicalVolumes_t *self, struct
 	self->LogicalVolume_N++;
 }
 
-static int Type2_VAT_FetchSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector)
+#define UDF_VAT_RUN_MAX 256 /* how far MapSector looks for sectors that are contiguous on disc */
+
+static inline uint32_t UDF_VAT_Entry (struct UDF_VAT_Entries *e, uint32_t sector)
+{
+	return e->Pages[sector >> UDF_VAT_PAGE_BITS][sector & (UDF_VAT_PAGE_SIZE - 1)];
+}
+
+static int Type2_VAT_MapSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t sector, uint32_t *absolute, uint32_t *run)
 {
 	struct UDF_LogicalVolume_Type2_VAT *t = (struct UDF_LogicalVolume_Type2_VAT *)self;
 	if (!t->PhysicalPartition)
@@ -4485,31 +5394,57 @@ static int Type2_VAT_FetchSector (struct cdfs_disc_t *disc, struct UDF_Partition
 #if 0
 		return -1;
 #else
-		return t->PhysicalPartition->PartitionCommon.FetchSector (disc, &t->PhysicalPartition->PartitionCommon, buffer, sector);
+		return t->PhysicalPartition->PartitionCommon.MapSector (disc, &t->PhysicalPartition->PartitionCommon, sector, absolute, run);
 #endif
 	}
-	if (t->ActiveEntry->Entries[sector].RemappedTo == (uint32_t)0xffffffff)
+	*absolute = UDF_VAT_Entry (t->ActiveEntry, sector);
+	if (*absolute == 0xffffffff)
 	{
 		return -1;
 	}
-	return t->PhysicalPartition->PartitionCommon.FetchSector (disc, &t->PhysicalPartition->PartitionCommon, buffer, t->ActiveEntry->Entries[sector].RemappedTo);
+	for (*run = 1; (*run < UDF_VAT_RUN_MAX) && ((sector + *run) < t->ActiveEntry->Length); (*run)++)
+	{
+		if (UDF_VAT_Entry (t->ActiveEntry, sector + *run) != (*absolute + *run))
+		{
+			break;
+		}
+	}
+	return 0;
+}
+
+/* Frees the pages of e that are not shared with root */
+static void Type2_VAT_Free_Pages (struct UDF_VAT_Entries *e, struct UDF_VAT_Entries *root)
+{
+	uint32_t p;
+
+	for (p=0; p < e->Pages_N; p++)
+	{
+		if ((e != root) && (p < root->Pages_N) && (e->Pages[p] == root->Pages[p]))
+		{
+			continue;
+		}
+		free (e->Pages[p]);
+	}
+	free (e->Pages);
+	e->Pages = 0;
+	e->Pages_N = 0;
 }
 
-static void Type2_VAT_Free_Entries (struct UDF_VAT_Entries *e)
+static void Type2_VAT_Free_Entries (struct UDF_VAT_Entries *e, struct UDF_VAT_Entries *root)
 {
 	if (e->Previous)
 	{
-		Type2_VAT_Free_Entries (e->Previous);
+		Type2_VAT_Free_Entries (e->Previous, root);
 		free (e->Previous);
 	}
-	free (e->Entries);
+	Type2_VAT_Free_Pages (e, root);
 }
 
 static void Type2_VAT_Free (void *self)
 {
 	struct UDF_LogicalVolume_Type2_VAT *t = (struct UDF_LogicalVolume_Type2_VAT *)self;
 
-	Type2_VAT_Free_Entries (&t->RootEntry);
+	Type2_VAT_Free_Entries (&t->RootEntry, &t->RootEntry);
 
 	free (t);
 }
@@ -4557,8 +5492,28 @@ static int Type2_VAT_NextSession (struct cdfs_disc_t *disc, struct UDF_Partition
 	return -1;
 }
 
-static int Load_VAT (const int n, struct cdfs_disc_t *disc, struct UDF_PhysicalPartition_t *PhysicalPartition, struct UDF_VAT_Entries *target, uint32_t sector, uint32_t *previous_sector)
+/* Stores a page of VAT entries in target, sharing it with newest if the content is the same. Returns non-zero on errors */
+static int Load_VAT_Page (struct UDF_VAT_Entries *target, struct UDF_VAT_Entries *newest, uint32_t p, uint32_t page[UDF_VAT_PAGE_SIZE])
+{
+	if (newest && (p < newest->Pages_N) && (!memcmp (newest->Pages[p], page, UDF_VAT_PAGE_SIZE * sizeof (page[0]))))
+	{
+		target->Pages[p] = newest->Pages[p];
+		return 0;
+	}
+	target->Pages[p] = malloc (UDF_VAT_PAGE_SIZE * sizeof (page[0]));
+	if (!target->Pages[p])
+	{
+		fprintf (stderr, "Load_VAT_Page() malloc() failed\n");
+		return -1;
+	}
+	memcpy (target->Pages[p], page, UDF_VAT_PAGE_SIZE * sizeof (page[0]));
+	return 0;
+}
+
+/* newest is zero when loading the newest VAT, older VATs only store the pages that differ from it */
+static int Load_VAT (const int n, struct cdfs_disc_t *disc, struct UDF_PhysicalPartition_t *PhysicalPartition, struct UDF_VAT_Entries *target, struct UDF_VAT_Entries *newest, uint32_t sector, uint32_t *previous_sector)
 {
+	uint32_t page[UDF_VAT_PAGE_SIZE];
 	uint8_t *filedata = 0;
 	uint64_t filesize = 0;
 
@@ -4574,7 +5529,7 @@ static int Load_VAT (const int n, struct cdfs_disc_t *disc, struct UDF_PhysicalP
 
 	target->VAT_Location = sector;
 
-	N(n); printf ("Testing logical sector %"PRId32"\n", sector);
+	N(n); TRACE ("Testing logical sector %"PRId32"\n", sector);
 	FE = FileEntry (n+2, disc, sector, &PhysicalPartition->PartitionCommon, 0);
 	if (!FE)
 	{
@@ -4584,14 +5539,14 @@ static int Load_VAT (const int n, struct cdfs_disc_t *disc, struct UDF_PhysicalP
 
 	if (FE->FileType != FILETYPE_THE_VIRTUAL_ALLOCATED_TABLE)
 	{
-		N(n+2); printf ("WARNING - Unable to find the \"VAT\" FileEntry\n");
+		N(n+2); TRACE ("WARNING - Unable to find the \"VAT\" FileEntry\n");
 		FileEntry_Free (FE);
 		return -1;
 	}
 
 	if (FileEntryLoadData (disc, FE, &filedata, 36 * 1024 * 1024))
 	{
-		N(n+2); printf ("WARNING - Unable to load the \"VAT\" FileEntry\n");
+		N(n+2); TRACE ("WARNING - Unable to load the \"VAT\" FileEntry\n");
 		FileEntry_Free (FE);
 		return -1;
 	}
@@ -4607,59 +5562,62 @@ static int Load_VAT (const int n, struct cdfs_disc_t *disc, struct UDF_PhysicalP
 	i = 0;
 	if (filesize < 156)
 	{
-		N(n+2); printf ("WARNING - Virtual Allocation Table can not fit in the data loaded\n");
+		N(n+2); TRACE ("WARNING - Virtual Allocation Table can not fit in the data loaded\n");
 		free (filedata);
 		return -1;
 	}
-	N(n+2); printf ("[Virtual Allocation Table]\n");
-	N(n+3); printf ("Length of Header:             %" PRIu16" \n", L_HD = (filedata[1] << 8) | filedata[0]);
+	N(n+2); TRACE ("[Virtual Allocation Table]\n");
+	L_HD = (filedata[1] << 8) | filedata[0];
+	N(n+3); TRACE ("Length of Header:             %" PRIu16" \n", L_HD);
 	if (L_HD > filesize)
 	{
-		N(n+4); printf ("WARNING - Length is too big\n");
+		N(n+4); TRACE ("WARNING - Length is too big\n");
 		free (filedata);
 		return -1;
 	}
-	N(n+3); printf ("Length of Implementation Use: %" PRIu16" \n", L_IU = (filedata[3] << 8) | filedata[2]);
+	L_IU = (filedata[3] << 8) | filedata[2];
+	N(n+3); TRACE ("Length of Implementation Use: %" PRIu16" \n", L_IU);
 	if (L_IU + 152 > L_HD)
 	{
-		N(n+4); printf ("WARNING - Length is too big, it has been shrunk");
+		N(n+4); TRACE ("WARNING - Length is too big, it has been shrunk");
 		L_IU = L_HD - 152;
 	}
-	N(n+3); printf ("Logical Volume Identifier:    "); print_1_7_2_12 (filedata + 4, 128, disc->udf_session->LogicalVolumes->DescriptorCharacterSet, 0); putchar ('\n');
-	N(n+3); printf ("Previous VAT ICB location:    %" PRIu32" \n", *previous_sector = ((filedata[135] << 24) | (filedata[134] << 16) | (filedata[133] << 8) | filedata[132]));
-	N(n+3); printf ("Number of Files:              %" PRIu32" \n", (filedata[139] << 24) | (filedata[138] << 16) | (filedata[137] << 8) | filedata[136]);
-	N(n+3); printf ("Number of Directories:        %" PRIu32" \n", (filedata[143] << 24) | (filedata[142] << 16) | (filedata[141] << 8) | filedata[140]);
+	N(n+3); TRACE ("Logical Volume Identifier:    "); print_1_7_2_12 (filedata + 4, 128, disc->udf_session->LogicalVolumes->DescriptorCharacterSet, 0); TRACE_PUTCHAR ('\n');
+	*previous_sector = ((filedata[135] << 24) | (filedata[134] << 16) | (filedata[133] << 8) | filedata[132]);
+	N(n+3); TRACE ("Previous VAT ICB location:    %" PRIu32" \n", *previous_sector);
+	N(n+3); TRACE ("Number of Files:              %" PRIu32" \n", (filedata[139] << 24) | (filedata[138] << 16) | (filedata[137] << 8) | filedata[136]);
+	N(n+3); TRACE ("Number of Directories:        %" PRIu32" \n", (filedata[143] << 24) | (filedata[142] << 16) | (filedata[141] << 8) | filedata[140]);
 	MinimumUDFReadRevision  = (filedata[145] << 8) | filedata[144];
 	MinimumUDFWriteRevision = (filedata[147] << 8) | filedata[146];
 	MaximumUDFWriteRevision = (filedata[149] << 8) | filedata[148];
 	// 150 + 151 are reserved
-	N(n+3); printf ("Minimum UDF Read Revision:    %d.%d%d\n", MinimumUDFReadRevision >> 8, (MinimumUDFReadRevision & 0xf0) >> 4, MinimumUDFReadRevision & 0x0f);
-	N(n+3); printf ("Minimum UDF Write Revision:   %d.%d%d\n", MinimumUDFWriteRevision >> 8, (MinimumUDFWriteRevision & 0xf0) >> 4, MinimumUDFWriteRevision & 0x0f);
-	N(n+3); printf ("Maximum UDF Write Revision:   %d.%d%d\n", MaximumUDFWriteRevision >> 8, (MaximumUDFWriteRevision & 0xf0) >> 4, MaximumUDFWriteRevision & 0x0f);
+	N(n+3); TRACE ("Minimum UDF Read Revision:    %d.%d%d\n", MinimumUDFReadRevision >> 8, (MinimumUDFReadRevision & 0xf0) >> 4, MinimumUDFReadRevision & 0x0f);
+	N(n+3); TRACE ("Minimum UDF Write Revision:   %d.%d%d\n", MinimumUDFWriteRevision >> 8, (MinimumUDFWriteRevision & 0xf0) >> 4, MinimumUDFWriteRevision & 0x0f);
+	N(n+3); TRACE ("Maximum UDF Write Revision:   %d.%d%d\n", MaximumUDFWriteRevision >> 8, (MaximumUDFWriteRevision & 0xf0) >> 4, MaximumUDFWriteRevision & 0x0f);
 
 	if (L_IU)
 	{
-		N(n+3);printf ("Implementation Use:\n");
+		N(n+3);TRACE ("Implementation Use:\n");
 		if (L_IU >= 32)
 		{
-			N(n+4); printf ("Identitity:     "); print_1_7_4 (filedata + 152, 1); putchar ('\n');
+			N(n+4); TRACE ("Identitity:     "); print_1_7_4 (filedata + 152, 1); TRACE_PUTCHAR ('\n');
 			if (L_IU > 32)
 			{
 				N(n+4);
 				for (i=32; i < L_IU; i++)
 				{
-					printf (" 0x%02" PRIx8, filedata[152 + i]);
+					TRACE (" 0x%02" PRIx8, filedata[152 + i]);
 				}
-				putchar ('\n');
+				TRACE_PUTCHAR ('\n');
 			}
 		} else {
 			/* Not compliant with UDF standards */
 			N(n+4);
 			for (i=0; i < L_IU; i++)
 			{
-				printf (" 0x%02" PRIx8, filedata[152 + i]);
+				TRACE (" 0x%02" PRIx8, filedata[152 + i]);
 			}
-			putchar ('\n');
+			TRACE_PUTCHAR ('\n');
 		}
 	}
 
@@ -4668,32 +5626,48 @@ static int Load_VAT (const int n, struct cdfs_disc_t *disc, struct UDF_PhysicalP
 	target->Length = l / sizeof (uint32_t);
 	if (!target->Length)
 	{
-		N(n+4); printf ("WARNING - VAT has no entries\n");
+		N(n+4); TRACE ("WARNING - VAT has no entries\n");
 		free (filedata);
 		return -1;
 	}
 
-	target->Entries = calloc (target->Length, sizeof (target->Entries[0]));
-	if (!target->Entries)
+	target->Pages_N = (target->Length + UDF_VAT_PAGE_SIZE - 1) >> UDF_VAT_PAGE_BITS;
+	target->Pages = calloc (target->Pages_N, sizeof (target->Pages[0]));
+	if (!target->Pages)
 	{
-		fprintf (stderr, "WARNING - Type2_VAT_Initialize: calloc failed\n");
+		fprintf (stderr, "Load_VAT() calloc() failed\n");
+		target->Pages_N = 0;
 		free (filedata);
 		return -1;
 	}
 
-	while (l >= 4)
+	for (i=0; i < target->Length; i++)
 	{
 		uint32_t Location = (b[3]<<24) | (b[2]<<16) | (b[1] << 8) | b[0];
 		if (Location == (uint32_t)0xffffffff)
 		{
-			N(n+4); printf ("VAT Entry.%d=UNALLOCATED\n", i);
+			N(n+4); TRACE ("VAT Entry.%d=UNALLOCATED\n", i);
+			page[i & (UDF_VAT_PAGE_SIZE - 1)] = 0xffffffff;
 		} else {
-			N(n+4); printf ("VAT Entry.%d=%" PRIu32 "\n", i, Location);
+			N(n+4); TRACE ("VAT Entry.%d=%" PRIu32 "\n", i, Location);
+			page[i & (UDF_VAT_PAGE_SIZE - 1)] = PhysicalPartition->Start + Location;
 		}
-		target->Entries[i].RemappedTo = Location;
-		i++;
-		l -= 4;
 		b += 4;
+
+		if ((((i + 1) & (UDF_VAT_PAGE_SIZE - 1)) == 0) || ((i + 1) == target->Length))
+		{
+			uint32_t j;
+			for (j = (i + 1) & (UDF_VAT_PAGE_SIZE - 1); j && (j < UDF_VAT_PAGE_SIZE); j++)
+			{ /* padding after the last entry */
+				page[j] = 0xffffffff;
+			}
+			if (Load_VAT_Page (target, newest, i >> UDF_VAT_PAGE_BITS, page))
+			{
+				Type2_VAT_Free_Pages (target, newest ? newest : target);
+				free (filedata);
+				return -1;
+			}
+		}
 	}
 	free (filedata);
 
@@ -4798,13 +5772,13 @@ static int Type2_VAT_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_
 			FetchLength = SearchEnd - SearchHalf;
 		}
 
-		printf ("VAT init iteration %d, SearchBegin=%"PRId32" SearchEnd=%"PRId32" SearchHalf=%"PRId32" FetchLength=%"PRId32"\n", iteration, SearchBegin, SearchEnd, SearchHalf, FetchLength);
+		TRACE ("VAT init iteration %d, SearchBegin=%"PRId32" SearchEnd=%"PRId32" SearchHalf=%"PRId32" FetchLength=%"PRId32"\n", iteration, SearchBegin, SearchEnd, SearchHalf, FetchLength);
 
 		for (i=0; i < FetchLength; i++)
 		{
 			if (t->LogicalVolume_Type1->FetchSectorReal (disc, t->LogicalVolume_Type1, buffer, SearchHalf + i))
 			{
-				printf (" FetchSector %" PRIu32 " failed\n", SearchHalf + i);
+				TRACE (" FetchSector %" PRIu32 " failed\n", SearchHalf + i);
 				SearchEnd = SearchHalf + i;
 				break;
 			}
@@ -4812,7 +5786,7 @@ static int Type2_VAT_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_
 			{
 				if (buffer[j])
 				{
-					printf (" Content hit in sector %d\n", i);
+					TRACE (" Content hit in sector %d\n", i);
 					SearchBegin = SearchHalf + i;
 					break;
 				}
@@ -4830,11 +5804,11 @@ static int Type2_VAT_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_
 	t->RootEntry.Length = SearchEnd;
 	t->ActiveEntry = &t->RootEntry;
 
-	printf ("SearchEnd=%" PRId32 "\n", SearchEnd);
+	TRACE ("SearchEnd=%" PRId32 "\n", SearchEnd);
 
 	for (i = 0; i < 16; i++)
 	{
-		if (!Load_VAT (1, disc, t->PhysicalPartition, &t->RootEntry, SearchEnd - i - 1, &next_sector))
+		if (!Load_VAT (1, disc, t->PhysicalPartition, &t->RootEntry, 0, SearchEnd - i - 1, &next_sector))
 		{
 			break;
 		}
@@ -4881,7 +5855,7 @@ static int Type2_VAT_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_
 				break;
 			}
 
-			if (Load_VAT (1, disc, t->PhysicalPartition, next, next_sector, &next_sector))
+			if (Load_VAT (1, disc, t->PhysicalPartition, next, &t->RootEntry, next_sector, &next_sector))
 			{
 				free (next);
 				break;
@@ -4907,7 +5881,8 @@ static void UDF_LogicalVolume_Append_Type1 (struct UDF_LogicalVolumes_t *self, u
 	t = calloc (1, sizeof (*t));
 	t->Common.PartId = PartId;
 	t->Common.Type = 1;
-	t->Common.PartitionCommon.FetchSector = Type1_FetchSector_Virtual;
+	t->Common.PartitionCommon.FetchSector = UDF_Mapped_FetchSector;
+	t->Common.PartitionCommon.MapSector = Type1_MapSector_Virtual;
 	t->Common.PartitionCommon.Initialize = Type1_Initialize;
 	t->Common.PartitionCommon.Free = free;
 	t->Common.PartitionCommon.DefaultSession = Type1_DefaultSession;
@@ -4932,7 +5907,8 @@ static void UDF_LogicalVolume_Append_Type2_VAT (struct UDF_LogicalVolumes_t *sel
 	t = calloc (1, sizeof (*t));
 	t->Common.PartId = PartId;
 	t->Common.Type = 2;
-	t->Common.PartitionCommon.FetchSector = Type2_VAT_FetchSector;
+	t->Common.PartitionCommon.FetchSector = UDF_Mapped_FetchSector;
+	t->Common.PartitionCommon.MapSector = Type2_VAT_MapSector;
 	t->Common.PartitionCommon.Initialize = Type2_VAT_Initialize;
 	t->Common.PartitionCommon.Free = Type2_VAT_Free;
 	t->Common.PartitionCommon.DefaultSession = Type2_VAT_DefaultSession;
@@ -4944,11 +5920,12 @@ static void UDF_LogicalVolume_Append_Type2_VAT (struct UDF_LogicalVolumes_t *sel
 	t->PhysicalPartition_PartitionNumber      = PhysicalPartition_PartitionNumber;
 }
 
-static int Type2_Metadata_LoadData (int n, struct cdfs_disc_t *disc, struct UDF_LogicalVolume_Type2_Metadata *t, uint32_t Location, int ismirror)
+/* Maps the blocks of the metadata file (or its mirror) into target, the data itself is fetched on demand */
+static int Type2_Metadata_LoadData (int n, struct cdfs_disc_t *disc, struct UDF_LogicalVolume_Type2_Metadata *t, uint32_t Location, int ismirror, struct UDF_Translation_t *target)
 {
-	uint8_t *metadata = 0;
-	uint64_t metasize = 0;
+	uint32_t block = 0;
 	struct UDF_FileEntry_t *FE;
+	int i;
 
 	FE = FileEntry (n+1, disc, Location, &t->Master->PartitionCommon, 0);
 	if (!FE)
@@ -4961,53 +5938,69 @@ static int Type2_Metadata_LoadData (int n, struct cdfs_disc_t *disc, struct UDF_
 		case FILETYPE_METADATA_FILE:
 			if (ismirror)
 			{
-				N(n+2); printf ("WARNING - filetype expected was FILETYPE_METADATA_MIRROR_FILE:\n");
+				N(n+2); TRACE ("WARNING - filetype expected was FILETYPE_METADATA_MIRROR_FILE:\n");
 			}
 			break;
 
 		case FILETYPE_METADATA_MIRROR_FILE:
 			if (!ismirror)
 			{
-				N(n+2); printf ("WARNING - filetype expected was FILETYPE_METADATA_FILE:\n");
+				N(n+2); TRACE ("WARNING - filetype expected was FILETYPE_METADATA_FILE:\n");
 			}
 			break;
 
 		default:
-			N(n+2); printf ("Error - filetype was unexpected\n");
+			N(n+2); TRACE ("Error - filetype was unexpected\n");
 			FileEntry_Free (FE);
 			return -1;
 	}
 
-	if (FileEntryLoadData (disc, FE, &metadata, 16*1024*1024))
+	if (FE->InlineData)
 	{
-		N(n+2); printf ("Error - Unable to load the \"MetaData\" FileEntry\n");
+		N(n+2); TRACE ("Error - MetaData is stored inline\n");
 		FileEntry_Free (FE);
 		return -1;
 	}
-	metasize = FE->InformationLength;
-	FileEntry_Free (FE);
-	FE = 0;
 
-	if (!metasize)
+	if (!FE->InformationLength)
 	{
-		free (metadata);
-		N(n+2); printf ("Error - MetaData was 0 bytes\n");
+		N(n+2); TRACE ("Error - MetaData was 0 bytes\n");
 	}
 
-	if (!t->MetaData)
+	for (i=0; i < FE->FileAllocations; i++)
 	{
-		t->MetaData = metadata;
-		t->MetaSize = metasize;
-	} else {
-		free (metadata);
+		uint32_t blocks = (FE->FileAllocation[i].InformationLength + SECTORSIZE - 1) / SECTORSIZE;
+
+		if (FE->FileAllocation[i].Partition == &t->Master->PartitionCommon)
+		{
+			if (UDF_Translation_Append (target, block, FE->FileAllocation[i].ExtentLocation, blocks))
+			{
+				FileEntry_Free (FE);
+				UDF_Translation_Free (target);
+				return -1;
+			}
+		} else if (FE->FileAllocation[i].Partition)
+		{
+			N(n+2); TRACE ("WARNING - MetaData extent is outside the partition, ignoring it\n");
+		}
+		block += blocks;
 	}
 
+	if (!t->MetaBlocks)
+	{
+		t->MetaBlocks = FE->InformationLength / SECTORSIZE;
+	}
+
+	FileEntry_Free (FE);
+
 	return 0;
 }
 
 static int Type2_MetaData_LoadBitmap (int n, struct cdfs_disc_t *disc, struct UDF_LogicalVolume_Type2_Metadata *t)
 {
 	uint8_t *metadata = 0;
+	uint32_t block = 0;
+	int i;
 
 	struct UDF_FileEntry_t *FE;
 
@@ -5023,24 +6016,34 @@ static int Type2_MetaData_LoadBitmap (int n, struct cdfs_disc_t *disc, struct UD
 			break;
 
 		default:
-			N(n+2); printf ("Error - filetype was unexpected\n");
+			N(n+2); TRACE ("Error - filetype was unexpected\n");
 			FileEntry_Free (FE);
 			return -1;
 	}
 
 	if (FileEntryLoadData (disc, FE, &metadata, 8*1024))
 	{
-		N(n+2); printf ("Error - Unable to load the \"MetaData BitMap\" FileEntry\n");
+		N(n+2); TRACE ("Error - Unable to load the \"MetaData BitMap\" FileEntry\n");
 		FileEntry_Free (FE);
 		return -1;
 	}
 
 	if (!FE->InformationLength)
 	{
-		free (metadata);
-		N(n+2); printf ("Error - MetaData BitMap was 0 bytes\n");
+		N(n+2); TRACE ("Error - MetaData BitMap was 0 bytes\n");
 	} else {
-		SpaceBitMapInline (n + 2, metadata, FE->FileAllocation[0].ExtentLocation, FE->InformationLength);
+		SpaceBitMapInline (n + 2, metadata, FE->FileAllocation[0].ExtentLocation, FE->InformationLength, &t->MetadataBitmap);
+	}
+
+	for (i=0; i < FE->FileAllocations; i++)
+	{
+		uint32_t blocks = (FE->FileAllocation[i].AllocatedLength + SECTORSIZE - 1) / SECTORSIZE;
+
+		if (FE->FileAllocation[i].AllocatedPartition == &t->Master->PartitionCommon)
+		{
+			UDF_Translation_Append (&t->MetadataBitmapFile, block, FE->FileAllocation[i].ExtentLocation, blocks);
+		}
+		block += blocks;
 	}
 
 	FileEntry_Free (FE);
@@ -5121,12 +6124,12 @@ static int Type2_Metadata_Initialize (struct cdfs_disc_t *disc, struct UDF_Parti
 	{
 		int errors = 0;
 
-		if (!Type2_Metadata_LoadData (1, disc, t, t->MetadataFileLocation, 0))
+		if (Type2_Metadata_LoadData (1, disc, t, t->MetadataFileLocation, 0, &t->MetadataFile))
 		{
 			errors++;
 		}
 
-		if (!Type2_Metadata_LoadData (1, disc, t, t->MetadataMirrorFileLocation, 1))
+		if (Type2_Metadata_LoadData (1, disc, t, t->MetadataMirrorFileLocation, 1, &t->MetadataMirrorFile))
 		{
 			errors++;
 		}
@@ -5153,24 +6156,79 @@ static void Type2_Metadata_Free (void *self)
 {
 	struct UDF_LogicalVolume_Type2_Metadata *t = (struct UDF_LogicalVolume_Type2_Metadata *)self;
 
-	free (t->MetaData);
+	UDF_Translation_Free (&t->MetadataFile);
+	UDF_Translation_Free (&t->MetadataMirrorFile);
+	UDF_Translation_Free (&t->MetadataBitmapFile);
+	UDF_SpaceBitmap_Free (&t->MetadataBitmap);
 
 	free (t);
 }
 
+/* Returns non-zero if buffer starts with a descriptor tag (the tag checksum is valid) whose descriptor does not match the CRC */
+static int UDF_TagDamaged (uint8_t buffer[SECTORSIZE])
+{
+	uint8_t CheckSum =
+		buffer[ 0] + buffer[ 1] + buffer[ 2] + buffer[ 3] +
+		             buffer[ 5] + buffer[ 6] + buffer[ 7] +
+		buffer[ 8] + buffer[ 9] + buffer[10] + buffer[11] +
+		buffer[12] + buffer[13] + buffer[14] + buffer[15];
+	uint16_t DescriptorCRC =       (buffer[ 9]<<8) | buffer[8];
+	uint16_t DescriptorCRCLength = (buffer[11]<<8) | buffer[10];
+
+	if (buffer[4] != CheckSum)
+	{ /* not a tag, directory data that continues from the previous block, or similar */
+		return 0;
+	}
+	if (DescriptorCRCLength > (SECTORSIZE - 16))
+	{
+		return 1;
+	}
+	return crc16 (buffer + 16, DescriptorCRCLength) != DescriptorCRC;
+}
+
+/* Returns 0 if the block was fetched, 1 if the block was fetched but failed its tag CRC, or -1 on errors */
+static int Type2_Metadata_FetchCopy (struct cdfs_disc_t *disc, struct UDF_LogicalVolume_Type2_Metadata *t, struct UDF_Translation_t *copy, uint8_t *buffer, uint32_t sector)
+{
+	uint32_t location, run;
+
+	if (!copy->Runs_N)
+	{ /* this copy failed to load */
+		return -1;
+	}
+	if (UDF_Translation_Lookup (copy, sector, &location, &run))
+	{ /* unrecorded block */
+		memset (buffer, 0, SECTORSIZE);
+		return 0;
+	}
+	if (t->Master->PartitionCommon.FetchSector (disc, &t->Master->PartitionCommon, buffer, location))
+	{
+		return -1;
+	}
+	return UDF_TagDamaged (buffer) ? 1 : 0;
+}
+
 static int Type2_Metadata_FetchSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector)
 {
 	struct UDF_LogicalVolume_Type2_Metadata *t = (struct UDF_LogicalVolume_Type2_Metadata *)self;
-	if (!t->MetaData)
+	uint8_t mirror[SECTORSIZE];
+	int retval, mirrorval;
+
+	if ((!t->Master) || (sector >= t->MetaBlocks))
 	{
 		return -1;
 	}
-	if (sector >= (t->MetaSize / SECTORSIZE))
+	retval = Type2_Metadata_FetchCopy (disc, t, &t->MetadataFile, buffer, sector);
+	if (!retval)
 	{
-		return -1;
+		return 0;
 	}
-	memcpy (buffer, t->MetaData + sector * SECTORSIZE, SECTORSIZE);
-	return 0;
+	mirrorval = Type2_Metadata_FetchCopy (disc, t, &t->MetadataMirrorFile, mirror, sector);
+	if ((!mirrorval) || ((mirrorval > 0) && (retval < 0)))
+	{ /* a damaged block from the mirror is better than nothing, the caller will report the CRC error */
+		memcpy (buffer, mirror, SECTORSIZE);
+		return 0;
+	}
+	return (retval < 0) ? -1 : 0;
 }
 
 static void Type2_Metadata_DefaultSession (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t *LocationIterator, uint8_t TimeStamp[12])
@@ -5218,6 +6276,16 @@ static void UDF_LogicalVolume_Append_Type2_Metadata (struct UDF_LogicalVolumes_t
 	t->Flags                      = Flags;
 }
 
+static int UDF_SparingTable_MapEntry_cmp (const void *a, const void *b)
+{
+	const struct UDF_SparingTable_MapEntry_t *A = a;
+	const struct UDF_SparingTable_MapEntry_t *B = b;
+
+	if (A->OriginalLocation < B->OriginalLocation) return -1;
+	if (A->OriginalLocation > B->OriginalLocation) return 1;
+	return 0;
+}
+
 static void UDF_Load_SparingTable (int n, struct cdfs_disc_t *disc, struct UDF_LogicalVolume_Type2_SparingPartition *t, uint32_t Location)
 {
 	uint8_t *buffer;
@@ -5230,7 +6298,7 @@ static void UDF_Load_SparingTable (int n, struct cdfs_disc_t *disc, struct UDF_L
 
 	if (t->SizeOfEachSparingTable < 64)
 	{
-		printf ("UDF_Load_SparingTable: size must be atleast 64 bytes\n");
+		TRACE ("UDF_Load_SparingTable: size must be atleast 64 bytes\n");
 		return;
 	}
 
@@ -5261,28 +6329,28 @@ static void UDF_Load_SparingTable (int n, struct cdfs_disc_t *disc, struct UDF_L
 	}
 	if (TagIdentifier != 0x0000)
 	{
-		N(n); printf ("Error - invalid TagIdentifier\n");
+		N(n); TRACE ("Error - invalid TagIdentifier\n");
 		free (buffer);
 		return;
 	}
-	N(n+1); printf ("[Sparing Table]\n");
-	N(n+2); printf ("Sparing Identifier: "); print_1_7_4 (buffer + 16, 0); putchar ('\n');
+	N(n+1); TRACE ("[Sparing Table]\n");
+	N(n+2); TRACE ("Sparing Identifier: "); print_1_7_4 (buffer + 16, 0); TRACE_PUTCHAR ('\n');
 	if (memcmp (buffer + 16 + 1, "*UDF Sparing Table", 19))
 	{
-		N(n+2); printf ("Error - wrong identifier, expected \"*UDF Sparing Table\"\n");
+		N(n+2); TRACE ("Error - wrong identifier, expected \"*UDF Sparing Table\"\n");
 		free (buffer);
 		return;
 	}
 	ReallocationTableLength = (buffer[49] << 8) | buffer[48];
-	N(n+2); printf ("Reallocation Table Length: %" PRIu16 "\n", ReallocationTableLength);
+	N(n+2); TRACE ("Reallocation Table Length: %" PRIu16 "\n", ReallocationTableLength);
 	if ((8 * ReallocationTableLength + 56 > t->SizeOfEachSparingTable) || (ReallocationTableLength == 0))
 	{
-		N(n+2); printf ("Error - Table Length is too large\n");
+		N(n+2); TRACE ("Error - Table Length is too large\n");
 		error = 1;
 	}
 
 	SequenceNumber = (buffer[55] << 24) | (buffer[54] << 16) | (buffer[53] << 8) | buffer[52];
-	N(n+2); printf ("Sequence Number:           %" PRIu32 "\n", SequenceNumber);
+	N(n+2); TRACE ("Sequence Number:           %" PRIu32 "\n", SequenceNumber);
 
 	MapEntries = malloc (sizeof (MapEntries[0]) * ReallocationTableLength);
 	if (!MapEntries)
@@ -5300,12 +6368,12 @@ static void UDF_Load_SparingTable (int n, struct cdfs_disc_t *disc, struct UDF_L
 		}
 		MapEntries[i].OriginalLocation = (buffer[56 + 3 + i*8] << 24) | (buffer[56 + 2 + i*8] << 16) | (buffer[56 + 1 + i*8] << 8) | buffer[56 + 0 + i*8];
 		MapEntries[i].MappedLocation   = (buffer[56 + 7 + i*8] << 24) | (buffer[56 + 6 + i*8] << 16) | (buffer[56 + 5 + i*8] << 8) | buffer[56 + 4 + i*8];
-		N(n+2); printf ("MapEntry.%u.OriginalLocation: %" PRIu32, i, MapEntries[i].OriginalLocation);      /* Logical location */
-		if (MapEntries[i].OriginalLocation == 0xfffffff0) printf (" packet defective");
-		if (MapEntries[i].OriginalLocation == 0xffffffff) printf (" packet available");
+		N(n+2); TRACE ("MapEntry.%u.OriginalLocation: %" PRIu32, i, MapEntries[i].OriginalLocation);      /* Logical location */
+		if (MapEntries[i].OriginalLocation == 0xfffffff0) TRACE (" packet defective");
+		if (MapEntries[i].OriginalLocation == 0xffffffff) TRACE (" packet available");
 
-		putchar ('\n');
-		N(n+2); printf ("MapEntry.%u.MappedLocation:   %" PRIu32 "\n", i, MapEntries[i].MappedLocation);   /* Physical location */
+		TRACE_PUTCHAR ('\n');
+		N(n+2); TRACE ("MapEntry.%u.MappedLocation:   %" PRIu32 "\n", i, MapEntries[i].MappedLocation);   /* Physical location */
 	}
 
 	if (!error)
@@ -5313,6 +6381,7 @@ static void UDF_Load_SparingTable (int n, struct cdfs_disc_t *disc, struct UDF_L
 		// deploy if not already deployed
 		if (!t->SparingTable)
 		{
+			qsort (MapEntries, ReallocationTableLength, sizeof (MapEntries[0]), UDF_SparingTable_MapEntry_cmp);
 			t->SparingTable = MapEntries;
 			t->SparingTableLength = ReallocationTableLength;
 			MapEntries = 0;
@@ -5325,20 +6394,54 @@ static void UDF_Load_SparingTable (int n, struct cdfs_disc_t *disc, struct UDF_L
 	free (buffer);
 }
 
-static int Type2_SparingPartition_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self)
+/* Covers the physical partition with identity runs, except for the spared packets */
+static int Type2_SparingPartition_Translation (struct UDF_LogicalVolume_Type2_SparingPartition *t)
 {
-	struct UDF_LogicalVolume_Type2_SparingPartition *t = (struct UDF_LogicalVolume_Type2_SparingPartition *)self;
-	int i;
+	uint32_t Logical = 0;
+	uint32_t i;
 
-	if (!disc)
+	for (i=0; i < t->SparingTableLength; i++)
 	{
-		return -1;
+		uint32_t OriginalLocation = t->SparingTable[i].OriginalLocation;
+
+		if ((OriginalLocation >= 0xfffffff0) || /* defective or available packets, these are sorted last */
+		    (OriginalLocation % t->PacketLength) || /* not the start of a packet */
+		    (OriginalLocation < Logical))           /* packet listed twice */
+		{
+			continue;
+		}
+		if (((OriginalLocation > Logical) && UDF_Translation_Append (&t->Translation, Logical, t->PhysicalPartition->Start + Logical, OriginalLocation - Logical)) ||
+		    UDF_Translation_Append (&t->Translation, OriginalLocation, t->PhysicalPartition->Start + t->SparingTable[i].MappedLocation, t->PacketLength))
+		{
+			UDF_Translation_Free (&t->Translation);
+			return -1;
+		}
+		t->SparedPackets[((OriginalLocation / t->PacketLength) % UDF_SPARED_PACKETS_BITS) >> 3] |= 1 << ((OriginalLocation / t->PacketLength) & 7);
+		Logical = OriginalLocation + t->PacketLength;
 	}
-	if (!disc->udf_session)
+	if ((Logical < t->PhysicalPartition->Length) &&
+	    UDF_Translation_Append (&t->Translation, Logical, t->PhysicalPartition->Start + Logical, t->PhysicalPartition->Length - Logical))
 	{
+		UDF_Translation_Free (&t->Translation);
 		return -1;
 	}
-	if (!disc->udf_session->PrimaryVolumeDescriptor)
+	return 0;
+}
+
+static int Type2_SparingPartition_Initialize (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self)
+{
+	struct UDF_LogicalVolume_Type2_SparingPartition *t = (struct UDF_LogicalVolume_Type2_SparingPartition *)self;
+	int i;
+
+	if (!disc)
+	{
+		return -1;
+	}
+	if (!disc->udf_session)
+	{
+		return -1;
+	}
+	if (!disc->udf_session->PrimaryVolumeDescriptor)
 	{
 		return -1;
 	}
@@ -5390,6 +6493,13 @@ static int Type2_SparingPartition_Initialize (struct cdfs_disc_t *disc, struct U
 		return -1;
 	}
 
+	if (Type2_SparingPartition_Translation (t))
+	{
+		free (t->SparingTable);
+		t->SparingTable = 0;
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -5414,15 +6524,14 @@ static void Type2_SparingPartition_Free (void *self)
 
 	free (t->SparingTableLocations);
 	free (t->SparingTable);
+	UDF_Translation_Free (&t->Translation);
 	free (t);
 }
 
-static int Type2_SparingPartition_FetchSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector)
+static int Type2_SparingPartition_MapSector (struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t sector, uint32_t *absolute, uint32_t *run)
 {
 	struct UDF_LogicalVolume_Type2_SparingPartition *t = (struct UDF_LogicalVolume_Type2_SparingPartition *)self;
-	uint32_t     PacketIndex;
-	uint_fast8_t PacketMinorIndex;
-	uint32_t     i;
+	uint32_t packet;
 
 	if (!t->PhysicalPartition)
 	{
@@ -5433,18 +6542,33 @@ static int Type2_SparingPartition_FetchSector (struct cdfs_disc_t *disc, struct
 		return -1;
 	}
 
-	PacketMinorIndex = sector % t->PacketLength;
-	PacketIndex      = sector - PacketMinorIndex;
-
-	for (i=0; i < t->SparingTableLength; i++)
-	{
-		if (t->SparingTable[i].OriginalLocation == PacketIndex)
+	packet = sector / t->PacketLength;
+	if ((sector < t->PhysicalPartition->Length) &&
+	    !(t->SparedPackets[(packet % UDF_SPARED_PACKETS_BITS) >> 3] & (1 << (packet & 7))))
+	{ /* the common case, the packet has not been spared. The following packets are included for as long as the bitmap rules them out too */
+		*absolute = t->PhysicalPartition->Start + sector;
+		*run = t->PacketLength - (sector % t->PacketLength);
+		for (packet++; (packet < (t->PhysicalPartition->Length / t->PacketLength)) && (*run < 4096); packet++)
 		{
-			return t->PhysicalPartition->PartitionCommon.FetchSector (disc, &t->PhysicalPartition->PartitionCommon, buffer, t->SparingTable[i].MappedLocation + PacketMinorIndex);
+			if (t->SparedPackets[(packet % UDF_SPARED_PACKETS_BITS) >> 3] & (1 << (packet & 7)))
+			{
+				break;
+			}
+			*run += t->PacketLength;
 		}
+		if (*run > (t->PhysicalPartition->Length - sector))
+		{
+			*run = t->PhysicalPartition->Length - sector;
+		}
+		return 0;
 	}
-	/* no sparing availble, try as-is */
-	return t->PhysicalPartition->PartitionCommon.FetchSector (disc, &t->PhysicalPartition->PartitionCommon, buffer, sector);
+
+	if (!UDF_Translation_Lookup (&t->Translation, sector, absolute, run))
+	{
+		return 0;
+	}
+	/* outside the partition and no sparing availble, try as-is */
+	return t->PhysicalPartition->PartitionCommon.MapSector (disc, &t->PhysicalPartition->PartitionCommon, sector, absolute, run);
 }
 
 static void UDF_LogicalVolume_Append_Type2_SparingPartition (struct UDF_LogicalVolumes_t *self, uint16_t PartId, uint16_t VolumeSequenceNumber, uint16_t PartitionNumber, uint16_t PacketLength, uint8_t NumberOfSparingTables, uint32_t SizeOfEachSparingTable, uint32_t *SparingTableLocations)
@@ -5458,29 +6582,30 @@ static void UDF_LogicalVolume_Append_Type2_SparingPartition (struct UDF_LogicalV
 
 	if (!NumberOfSparingTables)
 	{
-		printf ("Error - NumberOfSparingTables is zero\n");
+		TRACE ("Error - NumberOfSparingTables is zero\n");
 		return;
 	}
 	if (!SizeOfEachSparingTable)
 	{
-		printf ("Error - SizeOfEachSparingTable is zero\n");
+		TRACE ("Error - SizeOfEachSparingTable is zero\n");
 		return;
 	}
 	if (!PacketLength)
 	{
-		printf ("Error - PacketLength is zero\n");
+		TRACE ("Error - PacketLength is zero\n");
 		return;
 	}
 	if (PacketLength & (7))
 	{
-		printf ("WARNING - PacketLength is not a multiple of 32KB (using 4096KB sectors)\n");
+		TRACE ("WARNING - PacketLength is not a multiple of 32KB (using 4096KB sectors)\n");
 	}
 
 	t = calloc (1, sizeof (*t));
 	t->Common.PartId = PartId;
 	t->Common.Type = 2;
 	t->Common.IsSpareablePartitionMap = 1;
-	t->Common.PartitionCommon.FetchSector = Type2_SparingPartition_FetchSector;
+	t->Common.PartitionCommon.FetchSector = UDF_Mapped_FetchSector;
+	t->Common.PartitionCommon.MapSector = Type2_SparingPartition_MapSector;
 	t->Common.PartitionCommon.Initialize = Type2_SparingPartition_Initialize;
 	t->Common.PartitionCommon.Free = Type2_SparingPartition_Free;
 	t->Common.PartitionCommon.DefaultSession = Type2_SparingPartition_DefaultSession;
@@ -5500,30 +6625,513 @@ static void UDF_LogicalVolume_Append_Type2_SparingPartition (struct UDF_LogicalV
 	}
 }
 
+/* The space bitmaps are cross-checked against the blocks that the tree refers to, so leaked and doubly allocated blocks can be reported */
+struct UDF_SpaceCheck_t
+{
+	const char     *Info;
+	uint32_t        Bits;
+	const uint64_t *Unallocated;
+	const uint64_t *Freed;       /* optional, freed blocks are not allocated either */
+	uint64_t       *Referenced;
+	uint64_t       *Twice;       /* referenced more than once */
+	uint64_t        Outside;     /* referenced blocks past the end of the bitmap */
+};
+
+struct UDF_SpaceCheck_Context_t
+{
+	struct cdfs_disc_t         *disc;
+	struct UDF_RootDirectory_t *rootdir;
+	int                         Checks_N;
+	struct UDF_SpaceCheck_t    *Checks;
+	int                        *Volume; /* index into Checks for each logical volume, -1 if it has no space bitmap */
+};
+
+static struct UDF_SpaceCheck_t *UDF_SpaceCheck_Find (struct UDF_SpaceCheck_Context_t *ctx, struct UDF_Partition_Common *PartitionCommon)
+{
+	int i;
+
+	for (i=0; i < ctx->disc->udf_session->LogicalVolumes->LogicalVolume_N; i++)
+	{
+		if (&ctx->disc->udf_session->LogicalVolumes->LogicalVolume[i]->PartitionCommon == PartitionCommon)
+		{
+			return (ctx->Volume[i] >= 0) ? &ctx->Checks[ctx->Volume[i]] : 0;
+		}
+	}
+	return 0;
+}
+
+/* Returns non-zero if the first block was referenced already */
+static int UDF_SpaceCheck_Mark (struct UDF_SpaceCheck_t *c, uint32_t Location, uint32_t Blocks)
+{
+	int retval;
+
+	if ((!c) || (!Blocks))
+	{
+		return 0;
+	}
+	if (Location >= c->Bits)
+	{
+		c->Outside += Blocks;
+		return 0;
+	}
+	if (Blocks > (c->Bits - Location))
+	{
+		c->Outside += Blocks - (c->Bits - Location);
+		Blocks = c->Bits - Location;
+	}
+
+	retval = (c->Referenced[Location >> 6] >> (Location & 63)) & 1;
+	while (Blocks)
+	{
+		uint32_t count = 64 - (Location & 63);
+		uint64_t mask;
+
+		if (count > Blocks)
+		{
+			count = Blocks;
+		}
+		mask = ((count == 64) ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1)) << (Location & 63);
+		c->Twice[Location >> 6] |= c->Referenced[Location >> 6] & mask;
+		c->Referenced[Location >> 6] |= mask;
+		Location += count;
+		Blocks -= count;
+	}
+	return retval;
+}
+
+static void UDF_SpaceCheck_Allocations (struct UDF_SpaceCheck_Context_t *ctx, struct UDF_FileEntry_t *FE)
+{
+	struct UDF_LogicalVolume_Common *lv;
+	int i;
+
+	for (i=0; i < FE->FileAllocations; i++)
+	{
+		UDF_SpaceCheck_Mark (UDF_SpaceCheck_Find (ctx, FE->FileAllocation[i].AllocatedPartition), FE->FileAllocation[i].ExtentLocation, (FE->FileAllocation[i].AllocatedLength + SECTORSIZE - 1) / SECTORSIZE);
+	}
+	for (i=0; i < FE->AllocationExtents_N; i++)
+	{
+		UDF_SpaceCheck_Mark (UDF_SpaceCheck_Find (ctx, FE->AllocationExtents[i].AllocatedPartition), FE->AllocationExtents[i].ExtentLocation, (FE->AllocationExtents[i].AllocatedLength + SECTORSIZE - 1) / SECTORSIZE);
+	}
+	if (FE->ExtendedAttributeICB.ExtentLength && (lv = UDF_GetLogicalPartition (ctx->disc, FE->ExtendedAttributeICB.ExtentLocation.PartitionReferenceNumber)))
+	{
+		UDF_SpaceCheck_Mark (UDF_SpaceCheck_Find (ctx, &lv->PartitionCommon), FE->ExtendedAttributeICB.ExtentLocation.LogicalBlockNumber, ((FE->ExtendedAttributeICB.ExtentLength & 0x3fffffff) + SECTORSIZE - 1) / SECTORSIZE);
+	}
+}
+
+static void UDF_SpaceCheck_Directory (struct UDF_SpaceCheck_Context_t *ctx, struct UDF_FS_DirectoryEntry_t *Directory);
+
+static void UDF_SpaceCheck_FileEntry (struct UDF_SpaceCheck_Context_t *ctx, struct UDF_FileEntry_t *FE)
+{
+	struct UDF_FS_DirectoryEntry_t *Streams;
+	int i;
+
+	if (UDF_SpaceCheck_Mark (UDF_SpaceCheck_Find (ctx, FE->PartitionCommon), FE->ExtentLocation, FE->Strategy4096 ? 2 : 1))
+	{
+		return; /* a hard link, this File Entry has been accounted already */
+	}
+	UDF_SpaceCheck_Allocations (ctx, FE);
+
+	for (i=0; i < FE->PreviousVersions_N; i++)
+	{
+		struct UDF_FileEntry_t *old = FileEntry_PreviousVersion (0, ctx->disc, FE, i);
+
+		/* every older version is a strategy 4096 ICB, followed by the Indirect Entry that leads to the next version */
+		UDF_SpaceCheck_Mark (UDF_SpaceCheck_Find (ctx, FE->PreviousVersions[i].Partition), FE->PreviousVersions[i].Location, 2);
+		if (old)
+		{
+			UDF_SpaceCheck_Allocations (ctx, old);
+			FileEntry_Free (old);
+		}
+	}
+
+	if (FE->Streams)
+	{
+		UDF_SpaceCheck_Directory (ctx, FE->Streams);
+	} else if (FE->StreamDirectoryICB.ExtentLength && (Streams = UDF_FileEntry_Streams (ctx->disc, ctx->rootdir, FE)))
+	{ /* only decoded for the walk, the callers of UDF_FileEntry_Streams() decide what stays in memory */
+		UDF_SpaceCheck_Directory (ctx, Streams);
+		UDF_Directory_Free (Streams);
+		free (Streams);
+		FE->Streams = 0;
+	}
+}
+
+static void UDF_SpaceCheck_Directory (struct UDF_SpaceCheck_Context_t *ctx, struct UDF_FS_DirectoryEntry_t *Directory)
+{
+	int i;
+
+	if (Directory->FE)
+	{
+		UDF_SpaceCheck_FileEntry (ctx, Directory->FE);
+	}
+	for (i=0; i < Directory->FileEntries_N; i++)
+	{
+		if (Directory->FileEntries[i].FE)
+		{
+			UDF_SpaceCheck_FileEntry (ctx, Directory->FileEntries[i].FE);
+		}
+	}
+	for (i=0; i < Directory->DirectoryEntries_N; i++)
+	{
+		UDF_SpaceCheck_Directory (ctx, &Directory->DirectoryEntries[i]);
+	}
+}
+
+static void UDF_SpaceCheck_Translation (struct UDF_SpaceCheck_t *c, struct UDF_Translation_t *Translation)
+{
+	uint32_t i;
+
+	for (i=0; i < Translation->Runs_N; i++)
+	{
+		UDF_SpaceCheck_Mark (c, Translation->Runs[i].Absolute, Translation->Runs[i].Length);
+	}
+}
+
+/* Adds a check for the given bitmaps, or re-uses the one that another logical volume on the same partition already added */
+static int UDF_SpaceCheck_Add (struct UDF_SpaceCheck_Context_t *ctx, struct UDF_LogicalVolume_Common *lv, struct UDF_SpaceBitmap_t *Unallocated, struct UDF_SpaceBitmap_t *Freed)
+{
+	struct UDF_SpaceCheck_t *c;
+	int i;
+
+	if (!Unallocated->Map)
+	{
+		return -1;
+	}
+	for (i=0; i < ctx->Checks_N; i++)
+	{
+		if (ctx->Checks[i].Unallocated == Unallocated->Map)
+		{
+			return i;
+		}
+	}
+
+	c = realloc (ctx->Checks, sizeof (ctx->Checks[0]) * (ctx->Checks_N + 1));
+	if (!c)
+	{
+		fprintf (stderr, "UDF_SpaceCheck_Add() realloc() failed\n");
+		return -1;
+	}
+	ctx->Checks = c;
+	c = &ctx->Checks[ctx->Checks_N];
+	memset (c, 0, sizeof (*c));
+	c->Info = lv->Info;
+	c->Bits = Unallocated->Bits;
+	c->Unallocated = Unallocated->Map;
+	if (Freed && Freed->Map && (Freed->Bits == Unallocated->Bits))
+	{
+		c->Freed = Freed->Map;
+	}
+	c->Referenced = calloc ((c->Bits + 63) >> 6, sizeof (uint64_t));
+	c->Twice = calloc ((c->Bits + 63) >> 6, sizeof (uint64_t));
+	if ((!c->Referenced) || (!c->Twice))
+	{
+		fprintf (stderr, "UDF_SpaceCheck_Add() calloc() failed\n");
+		free (c->Referenced);
+		free (c->Twice);
+		return -1;
+	}
+	return ctx->Checks_N++;
+}
+
+static void UDF_SpaceCheck_Report (int n, struct UDF_SpaceCheck_t *c)
+{
+	uint32_t words = (c->Bits + 63) >> 6;
+	uint64_t *temp;
+	uint32_t i;
+
+	temp = malloc ((words + 1) * sizeof (temp[0]));
+	if (!temp)
+	{
+		fprintf (stderr, "UDF_SpaceCheck_Report() malloc() failed\n");
+		return;
+	}
+
+	N(n); TRACE ("%s\n", c->Info);
+	N(n+1); TRACE ("Blocks:                                 %" PRIu32 "\n", c->Bits);
+
+	for (i=0; i < words; i++)
+	{
+		temp[i] = c->Unallocated[i] | (c->Freed ? c->Freed[i] : 0);
+	}
+	N(n+1); TRACE ("Unallocated according to the bitmap:    %" PRIu32 "\n", UDF_Bits_Count (temp, c->Bits));
+	N(n+1); TRACE ("Referenced by the file system:          %" PRIu32 "\n", UDF_Bits_Count (c->Referenced, c->Bits));
+
+	for (i=0; i < words; i++)
+	{
+		temp[i] = ~(c->Unallocated[i] | (c->Freed ? c->Freed[i] : 0) | c->Referenced[i]);
+	}
+	if (c->Bits & 63)
+	{
+		temp[words - 1] &= ((uint64_t)1 << (c->Bits & 63)) - 1;
+	}
+	N(n+1); TRACE ("Allocated but not referenced (leaked):  %" PRIu32 "\n", UDF_Bits_Count (temp, c->Bits));
+	UDF_Bits_PrintRuns (n+2, temp, c->Bits);
+
+	for (i=0; i < words; i++)
+	{
+		temp[i] = (c->Unallocated[i] | (c->Freed ? c->Freed[i] : 0)) & c->Referenced[i];
+	}
+	N(n+1); TRACE ("Referenced but marked as unallocated:   %" PRIu32 "\n", UDF_Bits_Count (temp, c->Bits));
+	UDF_Bits_PrintRuns (n+2, temp, c->Bits);
+
+	N(n+1); TRACE ("Referenced more than once:              %" PRIu32 "\n", UDF_Bits_Count (c->Twice, c->Bits));
+	UDF_Bits_PrintRuns (n+2, c->Twice, c->Bits);
+
+	if (c->Outside)
+	{
+		N(n+1); TRACE ("WARNING - %" PRIu64 " referenced blocks are past the end of the bitmap\n", c->Outside);
+	}
+
+	free (temp);
+}
+
+static void UDF_SpaceCheck (int n, struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir)
+{
+	struct UDF_LogicalVolumes_t *volumes = disc->udf_session->LogicalVolumes;
+	struct UDF_SpaceCheck_Context_t ctx;
+	struct UDF_LogicalVolume_Common *lv;
+#ifdef CDFS_TRACE
+	int trace = trace_enabled;
+#endif
+	int i;
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.disc = disc;
+	ctx.rootdir = rootdir;
+	ctx.Volume = malloc (sizeof (ctx.Volume[0]) * (volumes->LogicalVolume_N + 1));
+	if (!ctx.Volume)
+	{
+		fprintf (stderr, "UDF_SpaceCheck() malloc() failed\n");
+		return;
+	}
+
+	for (i=0; i < volumes->LogicalVolume_N; i++)
+	{
+		struct UDF_PhysicalPartition_t *PhysicalPartition = 0;
+
+		lv = volumes->LogicalVolume[i];
+		ctx.Volume[i] = -1;
+		if (lv->PartitionCommon.Initialize == Type1_Initialize)
+		{
+			PhysicalPartition = ((struct UDF_LogicalVolume_Type1 *)lv)->PhysicalPartition;
+		} else if (lv->PartitionCommon.Initialize == Type2_SparingPartition_Initialize)
+		{
+			PhysicalPartition = ((struct UDF_LogicalVolume_Type2_SparingPartition *)lv)->PhysicalPartition;
+		} else if (lv->PartitionCommon.Initialize == Type2_Metadata_Initialize)
+		{
+			ctx.Volume[i] = UDF_SpaceCheck_Add (&ctx, lv, &((struct UDF_LogicalVolume_Type2_Metadata *)lv)->MetadataBitmap, 0);
+		} /* the VAT is used on write-once media, and those have no space bitmaps */
+
+		if (PhysicalPartition)
+		{
+			ctx.Volume[i] = UDF_SpaceCheck_Add (&ctx, lv, &PhysicalPartition->UnallocatedSpaceBitmap, &PhysicalPartition->FreedSpaceBitmap);
+			if (ctx.Volume[i] >= 0)
+			{
+				struct UDF_SpaceCheck_t *c = &ctx.Checks[ctx.Volume[i]];
+
+				UDF_SpaceCheck_Mark (c, PhysicalPartition->UnallocatedSpaceBitmapExtent.ExtentPosition, (PhysicalPartition->UnallocatedSpaceBitmapExtent.ExtentLength + SECTORSIZE - 1) / SECTORSIZE);
+				UDF_SpaceCheck_Mark (c, PhysicalPartition->FreedSpaceBitmapExtent.ExtentPosition, (PhysicalPartition->FreedSpaceBitmapExtent.ExtentLength + SECTORSIZE - 1) / SECTORSIZE);
+			}
+		}
+	}
+
+	if (!ctx.Checks_N)
+	{
+		free (ctx.Volume);
+		return;
+	}
+
+#ifdef CDFS_TRACE
+	trace_enabled = 0; /* older versions and named streams are decoded for the walk */
+#endif
+
+	for (i=0; i < volumes->LogicalVolume_N; i++)
+	{
+		struct UDF_LogicalVolume_Type2_Metadata *t = (struct UDF_LogicalVolume_Type2_Metadata *)volumes->LogicalVolume[i];
+		struct UDF_SpaceCheck_t *c;
+
+		if ((t->Common.PartitionCommon.Initialize != Type2_Metadata_Initialize) || (!t->Master) || (!(c = UDF_SpaceCheck_Find (&ctx, &t->Master->PartitionCommon))))
+		{
+			continue;
+		}
+		UDF_SpaceCheck_Mark (c, t->MetadataFileLocation, 1);
+		UDF_SpaceCheck_Mark (c, t->MetadataMirrorFileLocation, 1);
+		if (t->MetadataBitmapFileLocation != 0xffffffff)
+		{
+			UDF_SpaceCheck_Mark (c, t->MetadataBitmapFileLocation, 1);
+		}
+		UDF_SpaceCheck_Translation (c, &t->MetadataFile);
+		UDF_SpaceCheck_Translation (c, &t->MetadataMirrorFile);
+		UDF_SpaceCheck_Translation (c, &t->MetadataBitmapFile);
+	}
+
+	if ((lv = UDF_GetLogicalPartition (disc, rootdir->FileSetDescriptor_PartitionNumber)))
+	{
+		struct UDF_SpaceCheck_t *c = UDF_SpaceCheck_Find (&ctx, &lv->PartitionCommon);
+		uint8_t buffer[SECTORSIZE];
+
+		UDF_SpaceCheck_Mark (c, rootdir->FileSetDescriptor_Location, 1);
+		if ((!lv->PartitionCommon.FetchSector (disc, &lv->PartitionCommon, buffer, rootdir->FileSetDescriptor_Location + 1)) && (((buffer[1] << 8) | buffer[0]) == 0x0008))
+		{
+			UDF_SpaceCheck_Mark (c, rootdir->FileSetDescriptor_Location + 1, 1); /* Terminating Descriptor of the File Set Descriptor Sequence */
+		}
+	}
+
+	if (rootdir->Root)
+	{
+		UDF_SpaceCheck_Directory (&ctx, rootdir->Root);
+	}
+	if (rootdir->SystemStream)
+	{
+		UDF_SpaceCheck_Directory (&ctx, rootdir->SystemStream);
+	}
+
+#ifdef CDFS_TRACE
+	trace_enabled = 1; /* the report was asked for, also with --quiet */
+#endif
+
+	N(n); TRACE ("[Space Bitmap cross-check]\n");
+	for (i=0; i < ctx.Checks_N; i++)
+	{
+		UDF_SpaceCheck_Report (n+1, &ctx.Checks[i]);
+		free (ctx.Checks[i].Referenced);
+		free (ctx.Checks[i].Twice);
+	}
+#ifdef CDFS_TRACE
+	trace_enabled = trace;
+#endif
+	free (ctx.Checks);
+	free (ctx.Volume);
+}
+
+
 
 
 
 
 
+static int64_t DumpFS_UDF_time (uint8_t buffer[12])
+{
+	uint16_t TypeTimeZone = (buffer[1] << 8) | buffer[0];
+	int tz = 0;
+
+	if ((TypeTimeZone >> 12) == 1)
+	{
+		uint16_t a = TypeTimeZone & 0x0fff;
+		if (a & 0x0800) a |= 0xf000;
+		tz = (int16_t)a;
+		if (tz == -2047) /* not specified */
+		{
+			tz = 0;
+		}
+	}
+
+	return DumpFS_time ((buffer[3]<<8) | buffer[2], buffer[4], buffer[5], buffer[6], buffer[7], buffer[8], tz);
+}
+
+/* UNIX permission bits of a FileEntry */
+static mode_t UDF_FE_mode (struct UDF_FileEntry_t *FE)
+{
+	return ((FE->Permissions & 0x1000) ? 0400 : 0) | /* owner read */
+	       ((FE->Permissions & 0x0800) ? 0200 : 0) | /* owner write */
+	       ((FE->Permissions & 0x0400) ? 0100 : 0) | /* owner execute */
+	       ((FE->Permissions & 0x0080) ? 0040 : 0) | /* group read */
+	       ((FE->Permissions & 0x0040) ? 0020 : 0) | /* group write */
+	       ((FE->Permissions & 0x0020) ? 0010 : 0) | /* group execute */
+	       ((FE->Permissions & 0x0004) ? 0004 : 0) | /* other read */
+	       ((FE->Permissions & 0x0002) ? 0002 : 0) | /* other write */
+	       ((FE->Permissions & 0x0001) ? 0001 : 0) | /* other execute */
+	       ((FE->Flags & 0x0040) ? 04000 : 0) |      /* setuid */
+	       ((FE->Flags & 0x0080) ? 02000 : 0) |      /* setgid */
+	       ((FE->Flags & 0x0100) ? 01000 : 0);       /* sticky */
+}
 
-static void DumpFS_UDF3 (struct cdfs_disc_t *disc, struct UDF_FS_DirectoryEntry_t *d, const char *prefix)
+static void DumpFS_UDF_record (struct DumpFS_sink_t *sink, const char *path, const char *name, struct UDF_FileEntry_t *FE, char type, const char *Symlink)
+{
+	struct DumpFS_record_t record;
+	struct DumpFS_extent_t *extents;
+	int i;
+
+	memset (&record, 0, sizeof (record));
+	record.fs = "udf";
+	record.path = path;
+	record.name = name ? name : "";
+	record.name_length = strlen (record.name);
+	record.type = type;
+
+	record.has_mode = 1;
+	record.mode = UDF_FE_mode (FE);
+	record.has_owner = 1;
+	record.uid = FE->UID;
+	record.gid = FE->GID;
+	record.has_size = 1;
+	record.size = FE->InformationLength;
+	if (FE->HasMajorMinor)
+	{
+		record.has_device = 1;
+		record.major = FE->Major;
+		record.minor = FE->Minor;
+	}
+	record.has_mtime = 1;
+	record.mtime = DumpFS_UDF_time (FE->mtime);
+	record.has_ctime = 1;
+	record.ctime = DumpFS_UDF_time (FE->ctime);
+	if (type == 'l')
+	{
+		record.target = Symlink ? Symlink : "???";
+		record.target_length = strlen (record.target);
+	}
+
+	if ((!FE->InlineData) && FE->FileAllocations && (extents = DumpFS_sink_extents (sink, FE->FileAllocations)))
+	{
+		for (i=0; i < FE->FileAllocations; i++)
+		{
+			extents[i].Location = FE->FileAllocation[i].ExtentLocation;
+			extents[i].Length = FE->FileAllocation[i].InformationLength;
+			extents[i].Hole = !FE->FileAllocation[i].Partition;
+		}
+		record.extents = extents;
+		record.extents_count = FE->FileAllocations;
+	}
+
+	DumpFS_sink_record (sink, &record);
+}
+
+static void DumpFS_UDF4 (struct DumpFS_sink_t *sink, struct UDF_FS_DirectoryEntry_t *d, const char *path)
 {
 	struct UDF_FS_DirectoryEntry_t *di;
 	struct UDF_FS_FileEntry_t *fi;
 
-	char *newprefix = malloc (strlen (prefix) + 1 + (d->DirectoryName ? strlen (d->DirectoryName) : 0) + 1);
-	if (!newprefix)
+	if (sink)
 	{
-		fprintf (stderr, "DumpFS_UDF3() malloc() failed\n");
+		for (di = d->DirectoryEntries; di < (d->DirectoryEntries + d->DirectoryEntries_N); di++)
+		{
+			DumpFS_UDF_record (sink, path, di->DirectoryName, di->FE, 'd', 0);
+		}
+		for (fi = d->FileEntries; fi < (d->FileEntries + d->FileEntries_N); fi++)
+		{
+			char type;
+			switch (fi->FE->FileType)
+			{
+				case FILETYPE_BLOCK_SPECIAL_DEVICE: type = 'b'; break;
+				case FILETYPE_CHARACTER_SPECIAL_DEVICE: type = 'c'; break;
+				case FILETYPE_FIFO: type = 'p'; break;
+				case FILETYPE_C_ISSOCK: type = 's'; break;
+				case FILETYPE_SYMLINK: type = 'l'; break;
+				case FILETYPE_FILE: type = '-'; break;
+				default: type = '?'; break;
+			}
+			DumpFS_UDF_record (sink, path, fi->FileName, fi->FE, type, fi->Symlink);
+		}
 		return;
 	}
-	sprintf (newprefix, "%s/%s", prefix, d->DirectoryName ? d->DirectoryName : "");
-	printf ("%s :\n", newprefix);
 
-	for (di = d->DirectoryEntries; di; di = di->Next)
+	TRACE ("%s :\n", path);
+
+	for (di = d->DirectoryEntries; di < (d->DirectoryEntries + d->DirectoryEntries_N); di++)
 	{
-		putchar ('d');
-		printf ("%c%c%c%c%c%c%c%c%c%c",
+		TRACE_PUTCHAR ('d');
+		TRACE ("%c%c%c%c%c%c%c%c%c%c",
 			(di->FE->Permissions & 0x1000) ? 'r' : '-', /* owner read */
 			(di->FE->Permissions & 0x0800) ? 'w' : '-', /* owner write */
 			(di->FE->Flags & 0x0040) ? (  (di->FE->Permissions & 0x0400) ? 's' : 'S'  ) : (  (di->FE->Permissions & 0x0400) ? 'x' : '-'  ), /* owner execute */
@@ -5544,27 +7152,27 @@ static void DumpFS_UDF3 (struct cdfs_disc_t *disc, struct UDF_FS_DirectoryEntry_
 			*/
 		);
 
-		printf (" %4"PRId32" %4"PRId32, di->FE->UID, di->FE->GID);
+		TRACE (" %4"PRId32" %4"PRId32, di->FE->UID, di->FE->GID);
 
-		printf ("            ");
+		TRACE ("            ");
 
 		print_1_7_3 (di->FE->ctime);
-		printf (" %s%s\n", di->DirectoryName, di->PreviousVersion ? "  [Previous versions exists]":"");
+		TRACE (" %s%s\n", di->DirectoryName, di->FE->PreviousVersions_N ? "  [Previous versions exists]":"");
 	}
 
-	for (fi = d->FileEntries; fi; fi = fi->Next)
+	for (fi = d->FileEntries; fi < (d->FileEntries + d->FileEntries_N); fi++)
 	{
 		switch (fi->FE->FileType)
 		{
-			case FILETYPE_BLOCK_SPECIAL_DEVICE: putchar ('b'); break;
-			case FILETYPE_CHARACTER_SPECIAL_DEVICE: putchar ('c'); break;
-			case FILETYPE_FIFO: putchar ('p'); break;
-			case FILETYPE_C_ISSOCK: putchar ('s'); break;
-			case FILETYPE_SYMLINK: putchar ('l'); break;
-			case FILETYPE_FILE: putchar ('-'); break;
-			default: putchar ('?'); break;
+			case FILETYPE_BLOCK_SPECIAL_DEVICE: TRACE_PUTCHAR ('b'); break;
+			case FILETYPE_CHARACTER_SPECIAL_DEVICE: TRACE_PUTCHAR ('c'); break;
+			case FILETYPE_FIFO: TRACE_PUTCHAR ('p'); break;
+			case FILETYPE_C_ISSOCK: TRACE_PUTCHAR ('s'); break;
+			case FILETYPE_SYMLINK: TRACE_PUTCHAR ('l'); break;
+			case FILETYPE_FILE: TRACE_PUTCHAR ('-'); break;
+			default: TRACE_PUTCHAR ('?'); break;
 		}
-		printf ("%c%c%c%c%c%c%c%c%c%c",
+		TRACE ("%c%c%c%c%c%c%c%c%c%c",
 			(fi->FE->Permissions & 0x1000) ? 'r' : '-', /* owner read */
 			(fi->FE->Permissions & 0x0800) ? 'w' : '-', /* owner write */
 			(fi->FE->Flags & 0x0040) ? (  (fi->FE->Permissions & 0x0400) ? 's' : 'S'  ) : (  (fi->FE->Permissions & 0x0400) ? 'x' : '-'  ), /* owner execute */
@@ -5585,7 +7193,7 @@ static void DumpFS_UDF3 (struct cdfs_disc_t *disc, struct UDF_FS_DirectoryEntry_
 			*/
 		);
 
-		printf (" %4"PRId32" %4"PRId32, fi->FE->UID, fi->FE->GID);
+		TRACE (" %4"PRId32" %4"PRId32, fi->FE->UID, fi->FE->GID);
 
 		switch (fi->FE->FileType)
 		{
@@ -5593,42 +7201,101 @@ static void DumpFS_UDF3 (struct cdfs_disc_t *disc, struct UDF_FS_DirectoryEntry_
 			case FILETYPE_CHARACTER_SPECIAL_DEVICE:
 				if (fi->FE->HasMajorMinor)
 				{
-					printf ("%4d %4d   ", fi->FE->Major, fi->FE->Minor);
+					TRACE ("%4d %4d   ", fi->FE->Major, fi->FE->Minor);
 				} else {
-					printf ("   ?    ?   ");
+					TRACE ("   ?    ?   ");
 				}
 				break;
 			case FILETYPE_FILE:
-				printf ("%11" PRIu64 " ", fi->FE->InformationLength);
+				TRACE ("%11" PRIu64 " ", fi->FE->InformationLength);
 				break;
 			default:
-				printf ("            ");
+				TRACE ("            ");
 				break;
 		}
 
 		print_1_7_3 (fi->FE->mtime);
-		printf (" %s", fi->FileName);
+		TRACE (" %s", fi->FileName);
 
 		if (fi->FE->FileType == FILETYPE_SYMLINK)
 		{
-			printf (" -> %s", fi->Symlink ? fi->Symlink : "???");
+			TRACE (" -> %s", fi->Symlink ? fi->Symlink : "???");
 		}
 
-		printf ("%s\n", fi->PreviousVersion ? "  [Previous versions exists]":"");
+		TRACE ("%s\n", fi->FE->PreviousVersions_N ? "  [Previous versions exists]":"");
 	}
+}
+
+struct DumpFS_UDF_frame_t
+{
+	struct UDF_FS_DirectoryEntry_t *parent;
+	int                             next; /* next sub-directory to visit */
+	size_t                          path_length;
+};
 
+/* Walks the directory tree using an explicit stack and a single path buffer, so deep trees does not exhaust the C stack */
+static void DumpFS_UDF3 (struct cdfs_disc_t *disc, struct UDF_FS_DirectoryEntry_t *d, const char *prefix, struct DumpFS_sink_t *sink)
+{
+	struct DumpFS_path_t path;
+	struct DumpFS_UDF_frame_t *stack = 0;
+	int stack_count = 0;
+	int stack_size = 0;
 
-	for (di = d->DirectoryEntries; di; di = di->Next)
+	if (DumpFS_path_init (&path, prefix))
 	{
-		DumpFS_UDF3 (disc, di, newprefix);		
+		return;
 	}
 
-	free (newprefix);
+	while (d)
+	{
+		if (DumpFS_path_append (&path, d->DirectoryName ? d->DirectoryName : "", d->DirectoryName ? strlen (d->DirectoryName) : 0))
+		{
+			break;
+		}
+
+		DumpFS_UDF4 (sink, d, path.data);
+
+		if (stack_count >= stack_size)
+		{
+			struct DumpFS_UDF_frame_t *temp = realloc (stack, sizeof (stack[0]) * (stack_size + 32));
+			if (!temp)
+			{
+				fprintf (stderr, "DumpFS_UDF3() realloc() failed\n");
+				break;
+			}
+			stack = temp;
+			stack_size += 32;
+		}
+		stack[stack_count].parent = d;
+		stack[stack_count].next = 0;
+		stack[stack_count].path_length = path.length;
+		stack_count++;
+
+		d = 0;
+		while (stack_count && !d)
+		{
+			struct DumpFS_UDF_frame_t *top = &stack[stack_count - 1];
+
+			if (top->next >= top->parent->DirectoryEntries_N)
+			{
+				stack_count--;
+				continue;
+			}
+			d = &top->parent->DirectoryEntries[top->next++];
+			DumpFS_path_truncate (&path, top->path_length);
+		}
+	}
+
+	free (stack);
+	DumpFS_path_free (&path);
 }
 
-static void DumpFS_UDF2 (struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rd)
+static void DumpFS_UDF2 (struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rd, struct DumpFS_sink_t *sink)
 {
-	printf ("UDF ROOT "); print_1_7_3 (rd->FileSetDescriptor_TimeStamp_1_7_3); putchar ('\n');
+	if (!sink)
+	{
+		TRACE ("UDF ROOT "); print_1_7_3 (rd->FileSetDescriptor_TimeStamp_1_7_3); TRACE_PUTCHAR ('\n');
+	}
 	if (rd->Root)
 	{
 		struct UDF_LogicalVolume_Common *lv = UDF_GetLogicalPartition (disc, rd->FileSetDescriptor_PartitionNumber);
@@ -5636,17 +7303,21 @@ static void DumpFS_UDF2 (struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *r
 		{
 			lv->PartitionCommon.SelectSession (disc, &lv->PartitionCommon, rd->FileSetDescriptor_Partition_Session);
 		}
-		DumpFS_UDF3 (disc, rd->Root, ".");
+		DumpFS_UDF3 (disc, rd->Root, ".", sink);
 	}
 }
 
-void DumpFS_UDF (struct cdfs_disc_t *disc)
+void DumpFS_UDF (struct cdfs_disc_t *disc, struct DumpFS_sink_t *sink)
 {
 	int i;
 
 	if (!disc->udf_session->LogicalVolumes) return;
 	for (i=0; i < disc->udf_session->LogicalVolumes->RootDirectories_N; i++)
 	{
-		DumpFS_UDF2 (disc, &disc->udf_session->LogicalVolumes->RootDirectories[i]);
+		DumpFS_UDF2 (disc, &disc->udf_session->LogicalVolumes->RootDirectories[i], sink);
 	}	
 }
+
+#include "udf_extract.c"
+
+#include "udf_index.c"
@@ -69,6 +69,7 @@ struct UDF_Partition_Common
 {
 	int (*Initialize)(struct cdfs_disc_t *disc, struct UDF_Partition_Common *self);
 	int (*FetchSector)(struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint8_t *buffer, uint32_t sector);
+	int (*MapSector)(struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t sector, uint32_t *absolute, uint32_t *run); /* optional, gives the absolute disc sector, and how many sectors from there on that are contiguous on disc */
 	void (*Free)(void *self);
 
 	void (*DefaultSession)(struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t *LocationIterator, uint8_t TimeStamp[12]);
@@ -76,6 +77,27 @@ struct UDF_Partition_Common
 	int (*NextSession)(struct cdfs_disc_t *disc, struct UDF_Partition_Common *self, uint32_t *LocationIterator, uint8_t TimeStamp[12]);
 };
 
+struct UDF_TranslationRun_t
+{
+	uint32_t Logical;
+	uint32_t Absolute;
+	uint32_t Length;
+};
+
+struct UDF_Translation_t /* logical sector to absolute disc sector, runs are sorted by Logical and sectors between the runs are not mapped */
+{
+	uint32_t                     Runs_N;
+	uint32_t                     Runs_Size;
+	struct UDF_TranslationRun_t *Runs;
+};
+
+struct UDF_SpaceBitmap_t /* decoded Space Bitmap Descriptor, 4/14.12 */
+{
+	uint32_t  Bits;       /* one per logical block of the partition */
+	uint32_t  FreeBlocks;
+	uint64_t *Map;        /* bit (block & 63) of Map[block >> 6] is set if the block is unallocated, the bits after Bits are clear */
+};
+
 struct UDF_PhysicalPartition_t
 {
 	struct UDF_Partition_Common PartitionCommon;
@@ -86,6 +108,11 @@ struct UDF_PhysicalPartition_t
 	uint32_t SectorSize; /* Will be 2048 for all ISO files */
 	uint32_t Start;
 	uint32_t Length; /* Given in sectors */
+
+	struct UDF_SpaceBitmap_t UnallocatedSpaceBitmap;
+	struct UDF_SpaceBitmap_t FreedSpaceBitmap;
+	struct UDF_shortad       UnallocatedSpaceBitmapExtent; /* the bitmaps are stored inside the partition they describe */
+	struct UDF_shortad       FreedSpaceBitmapExtent;
 };
 
 struct UDF_LogicalVolume_Common
@@ -115,17 +142,17 @@ struct UDF_LogicalVolume_Type1
 	int Initialized;
 };
 
-struct UDF_VAT_Entry
-{
-	uint32_t RemappedTo;
-};
+#define UDF_VAT_PAGE_BITS 10
+#define UDF_VAT_PAGE_SIZE (1 << UDF_VAT_PAGE_BITS) /* entries per page */
+
 struct UDF_VAT_Entries;
 struct UDF_VAT_Entries
 {
 	uint32_t VAT_Location;
 	uint32_t Length;
 	uint8_t  TimeStamp_1_7_3[12];
-	struct UDF_VAT_Entry *Entries;
+	uint32_t   Pages_N;
+	uint32_t **Pages; /* the VAT entries with the start of the physical partition added, 0xffffffff if unallocated. Older generations share the pages that are unchanged with the newest one */
 	struct UDF_VAT_Entries *Previous;
 };
 struct UDF_LogicalVolume_Type2_VAT
@@ -147,6 +174,8 @@ struct UDF_SparingTable_MapEntry_t
  	uint32_t MappedLocation; /* Physical Location */
 };
 
+#define UDF_SPARED_PACKETS_BITS 4096
+
 struct UDF_LogicalVolume_Type2_SparingPartition
 {
 	struct UDF_LogicalVolume_Common Common;
@@ -161,8 +190,10 @@ struct UDF_LogicalVolume_Type2_SparingPartition
 	uint32_t *SparingTableLocations;
 
 	int Initialized;
-	struct UDF_SparingTable_MapEntry_t *SparingTable;
+	struct UDF_SparingTable_MapEntry_t *SparingTable; /* sorted by OriginalLocation */
 	uint32_t   SparingTableLength;
+	struct UDF_Translation_t Translation; /* the physical partition, with the spared packets folded in */
+	uint8_t    SparedPackets[UDF_SPARED_PACKETS_BITS / 8]; /* bit (packet number % UDF_SPARED_PACKETS_BITS) is set if such a packet has been spared */
 };
 
 struct UDF_LogicalVolume_Type2_Metadata
@@ -183,13 +214,17 @@ struct UDF_LogicalVolume_Type2_Metadata
 	*/
 	int Initialized;
 	struct UDF_LogicalVolume_Common *Master;
-	uint8_t  *MetaData;
-	uint64_t  MetaSize;
+	struct UDF_Translation_t MetadataFile;       /* metadata block => sector in Master, gaps are unrecorded blocks */
+	struct UDF_Translation_t MetadataMirrorFile; /* used when a block in MetadataFile can not be read, or fails its tag CRC */
+	struct UDF_Translation_t MetadataBitmapFile; /* only used to account the space in Master */
+	struct UDF_SpaceBitmap_t MetadataBitmap;
+	uint32_t  MetaBlocks;
 };
 
 struct UDF_FS_DirectoryEntry_t;
 struct UDF_FS_FileEntry_t;
 struct UDF_FileEntry_t;
+struct UDF_ICB_Batch_t;
 
 enum eFileType
 {
@@ -221,15 +256,26 @@ struct FileAllocation
 	uint32_t ExtentLocation;
 	uint32_t SkipLength;        // used for finding back InlineData
 	uint32_t InformationLength;
+	struct UDF_Partition_Common *AllocatedPartition; // also set for extents that are allocated but not recorded, 0 if nothing is allocated
+	uint32_t AllocatedLength;   // can be more than InformationLength
+};
+
+struct UDF_FileEntry_Version_t /* an older version of a strategy 4096 ICB */
+{
+	struct UDF_Partition_Common *Partition;
+	uint32_t                     Location;
+	uint8_t                      TimeStamp[12];
 };
 
 struct UDF_FileEntry_t
 {
-	struct UDF_FileEntry_t      *PreviousVersion; /* WORM feature, known as stragety 4096... UDF_FS_FileEntry_t and UDF_FS_DirectoryEntry_t can unroll this */
+	int                              PreviousVersions_N; /* WORM feature, known as strategy 4096 */
+	struct UDF_FileEntry_Version_t  *PreviousVersions;   /* newest first, decoded on demand with FileEntry_PreviousVersion() */
 	struct UDF_Partition_Common *PartitionCommon; // can be discarded now?
 	uint16_t                     TagIdentifier;   // can be discarded now?
 	enum eFileType               FileType;
 	uint16_t                     Flags;
+	uint8_t                      Strategy4096;    // the ICB also owns the Indirect Entry in the next block
 	uint8_t                      TimeStamp[12];   // handy for 4096...
 	uint32_t                     ExtentLocation;  // can be discarded now?
 
@@ -246,6 +292,14 @@ struct UDF_FileEntry_t
 	uint8_t                      ctime[12];
 	uint8_t                      attrtime[12];
 
+	struct UDF_longad                ExtendedAttributeICB;
+	uint16_t                         InlineExtendedAttributes_Offset; /* within the sector of the File Entry */
+	uint16_t                         InlineExtendedAttributes_Length;
+	struct UDF_longad                StreamDirectoryICB; /* Extended File Entry only, ExtentLength is zero if there are no named streams */
+	struct UDF_FS_DirectoryEntry_t  *Streams;            /* decoded from StreamDirectoryICB by UDF_FileEntry_Streams() on first use */
+	int                              AllocationExtents_N; /* the extents that continue the allocation descriptors, only used to account the space */
+	struct FileAllocation           *AllocationExtents;
+
 	uint64_t                     InformationLength; // ObjectSize, FileSize
 	uint8_t                     *InlineData;
 	int                          FileAllocations;
@@ -254,24 +308,22 @@ struct UDF_FileEntry_t
 
 struct UDF_FS_FileEntry_t
 {
-	struct UDF_FS_FileEntry_t *PreviousVersion;
 	struct UDF_FileEntry_t    *FE;
 
 	char                      *FileName;
 	char                      *Symlink;
-	struct UDF_FS_FileEntry_t *Next; /* next item in the current directory */
 };
 
 struct UDF_FS_DirectoryEntry_t
 {
-	struct UDF_FS_DirectoryEntry_t *PreviousVersion;
 	struct UDF_FileEntry_t         *FE;
 	//uint16_t                        Location_Partition;
 	//uint32_t                        Location_Sector;
 	char                           *DirectoryName; /* as seen by the parent */
-	struct UDF_FS_DirectoryEntry_t *Next;
-	struct UDF_FS_DirectoryEntry_t *DirectoryEntries;
-	struct UDF_FS_FileEntry_t      *FileEntries;
+	int                             DirectoryEntries_N;
+	int                             FileEntries_N;
+	struct UDF_FS_DirectoryEntry_t *DirectoryEntries; /* array, in the order they are listed in the directory */
+	struct UDF_FS_FileEntry_t      *FileEntries;      /* array, in the order they are listed in the directory */
 };
 
 struct UDF_RootDirectory_t
@@ -315,6 +367,8 @@ struct UDF_Session
 	struct UDF_PhysicalPartition_t   *PhysicalPartition; /* zero terminated  */
 
 	struct UDF_LogicalVolumes_t      *LogicalVolumes; /* We keep only the one with the highest VolumeDescriptorSequenceNumber */
+
+	struct UDF_ICB_Batch_t           *ICB_Batch; /* File Entries of the directory being decoded, prefetched in disc order */
 };
 
 
@@ -322,6 +376,62 @@ void UDF_Descriptor (struct cdfs_disc_t *disc);
 
 void UDF_Session_Free (struct cdfs_disc_t *disc);
 
-void DumpFS_UDF (struct cdfs_disc_t *disc);
+struct DumpFS_sink_t;
+
+void DumpFS_UDF (struct cdfs_disc_t *disc, struct DumpFS_sink_t *sink);
+
+/* Named streams (like Mac resource forks and Windows alternate data streams) and extended attributes of a file. They are not decoded
+ * while the tree is walked, only when asked for here */
+
+/* The streams are the FileEntries of the returned directory, with their FileName and FE. Returns NULL if the file has no named streams.
+ * The result is owned by FE */
+struct UDF_FS_DirectoryEntry_t *UDF_FileEntry_Streams (struct cdfs_disc_t *disc, struct UDF_RootDirectory_t *rootdir, struct UDF_FileEntry_t *FE);
+
+/* Reads the content of a file or stream. Returns non-zero on errors, or if the range is outside the file */
+int UDF_FileEntry_Read (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE, uint64_t offset, uint8_t *buffer, uint64_t length);
+
+struct UDF_ExtendedAttribute_t
+{
+	uint32_t       AttributeType;    /* ECMA 167 4/14.10, 2048 is Implementation Use and 65536 is Application Use */
+	uint8_t        AttributeSubtype;
+	char           Identifier[24];   /* Implementation and Application Use only, e.g. "*UDF Mac ResourceFork" */
+	uint32_t       Length;
+	const uint8_t *Data;             /* after the attribute header, for Implementation and Application Use after the identifier */
+};
+
+struct UDF_ExtendedAttributes_t
+{
+	int                             Attributes_N;
+	struct UDF_ExtendedAttribute_t *Attributes;
+	uint8_t                        *Space; /* the Data of the attributes points into this */
+};
+
+/* Collects the extended attributes stored inside the File Entry and in its Extended Attribute ICB. Returns NULL on errors */
+struct UDF_ExtendedAttributes_t *UDF_FileEntry_ExtendedAttributes (struct cdfs_disc_t *disc, struct UDF_FileEntry_t *FE);
+
+void UDF_ExtendedAttributes_Free (struct UDF_ExtendedAttributes_t *EA);
+
+/* Writes the files, directories and symlinks of the UDF filesystem into directory, which is created if needed. Returns non-zero on errors */
+int UDF_Extract (struct cdfs_disc_t *disc, const char *directory);
+
+struct UDF_index_t;
+struct cdfs_stat_t;
+struct DumpFS_index_t;
+
+/* Builds an in-memory index of the most recent UDF file set, for the libcdfs.h API. Returns 0 if the disc has no UDF file tree. Inode
+ * numbers are node numbers in the tree, 0 is the root */
+struct UDF_index_t *UDF_Index (struct cdfs_disc_t *disc);
+
+void UDF_Index_Free (struct UDF_index_t *index);
+
+/* The tree used for path lookups and directory listings, owned by index */
+struct DumpFS_index_t *UDF_Index_Tree (struct UDF_index_t *index);
+
+/* Fills in the permissions, ownership and mtime of ino, the rest of st is filled in by libcdfs.c from the tree */
+int UDF_Index_Stat (struct UDF_index_t *index, uint32_t ino, struct cdfs_stat_t *st);
+
+ssize_t UDF_Index_Read (struct UDF_index_t *index, uint32_t ino, void *buffer, size_t count, uint64_t offset);
+
+ssize_t UDF_Index_Readlink (struct UDF_index_t *index, uint32_t ino, char *buffer, size_t size);
 
 #endif
@@ -0,0 +1,473 @@
+/* Extraction of a UDF file tree into a directory, see DumpFS_extract_job_t for the common steps.
+ *
+ * The recorded extents of all the files are sorted on the disc sector they start at and copied in that order, so the image is read
+ * in one sequential pass even if files are fragmented. Extents that are not recorded are skipped, leaving holes in the output
+ * files, and inline data is written as is.
+ */
+
+#define UDF_EXTRACT_BATCH 256 /* sectors per read, 512KB */
+
+struct UDF_extract_extent_t
+{
+	uint32_t Absolute;   /* the first sector on disc, used for the ordering */
+	int      file;
+	int      allocation; /* index into FE->FileAllocation */
+	uint64_t offset;     /* where the extent starts in the file */
+	uint64_t bytes;
+};
+
+struct UDF_extract_t
+{
+	struct cdfs_disc_t *disc;
+	int                 retval;
+	int                 symlinks;
+
+	/* entry is the struct UDF_FileEntry_t */
+	int                          files_count;
+	int                          files_size;
+	struct DumpFS_extract_job_t *files_data;
+
+	int                          directories_count; /* in the order they were created, parents first */
+	int                          directories_size;
+	struct DumpFS_extract_job_t *directories_data;
+
+	int                          symlinks_count;
+	int                          symlinks_size;
+	struct DumpFS_extract_job_t *symlinks_data;
+
+	int                          extents_count;
+	int                          extents_size;
+	struct UDF_extract_extent_t *extents_data;
+
+	uint8_t *buffer;
+};
+
+static int UDF_extract_extent_append (struct UDF_extract_t *self, uint32_t Absolute, int file, int allocation, uint64_t offset, uint64_t bytes)
+{
+	if (self->extents_count >= self->extents_size)
+	{
+		struct UDF_extract_extent_t *temp = realloc (self->extents_data, sizeof (self->extents_data[0]) * (self->extents_size + 256));
+		if (!temp)
+		{
+			fprintf (stderr, "UDF_extract_extent_append() realloc() failed\n");
+			return -1;
+		}
+		self->extents_data = temp;
+		self->extents_size += 256;
+	}
+	self->extents_data[self->extents_count].Absolute = Absolute;
+	self->extents_data[self->extents_count].file = file;
+	self->extents_data[self->extents_count].allocation = allocation;
+	self->extents_data[self->extents_count].offset = offset;
+	self->extents_data[self->extents_count].bytes = bytes;
+	self->extents_count++;
+	return 0;
+}
+
+/* path is used if fd is negative */
+static void UDF_extract_attributes (int fd, const char *path, struct UDF_FileEntry_t *FE, int symlink)
+{
+	struct DumpFS_record_t record;
+
+	memset (&record, 0, sizeof (record));
+	record.type = symlink ? 'l' : (FE->FileType == FILETYPE_DIRECTORY) ? 'd' : '-';
+	record.has_mode = 1;
+	record.mode = UDF_FE_mode (FE);
+	record.has_owner = 1;
+	record.uid = FE->UID;
+	record.gid = FE->GID;
+	record.has_mtime = 1;
+	record.mtime = DumpFS_UDF_time (FE->mtime);
+	DumpFS_extract_attributes (fd, path, &record);
+}
+
+/* Creates the directory path and collects the files and symlinks in it. Returns non-zero if the directory should not be entered */
+static int UDF_extract_dir (struct UDF_extract_t *self, struct UDF_FS_DirectoryEntry_t *d, struct DumpFS_path_t *path, int root)
+{
+	struct UDF_FS_FileEntry_t *fi;
+	char *dup;
+
+	if (DumpFS_extract_mkdir (path->data, root))
+	{
+		self->retval = -1;
+		return -1;
+	}
+	dup = strdup (path->data);
+	if ((!dup) || DumpFS_extract_job_append (&self->directories_count, &self->directories_size, &self->directories_data, dup, d->FE))
+	{
+		free (dup);
+		self->retval = -1;
+		return -1;
+	}
+
+	for (fi = d->FileEntries; fi < (d->FileEntries + d->FileEntries_N); fi++)
+	{
+		size_t length = path->length;
+
+		if (!DumpFS_extract_name_safe (fi->FileName, fi->FileName ? strlen (fi->FileName) : 0))
+		{
+			fprintf (stderr, "Skipping file with an unsafe name in %s\n", path->data);
+			continue;
+		}
+		if ((fi->FE->FileType != FILETYPE_FILE) && (fi->FE->FileType != FILETYPE_SYMLINK))
+		{ /* device nodes, pipes and sockets */
+			fprintf (stderr, "Skipping special file %s/%s\n", path->data, fi->FileName);
+			continue;
+		}
+		if (DumpFS_path_append (path, fi->FileName, strlen (fi->FileName)))
+		{
+			self->retval = -1;
+			return -1;
+		}
+
+		dup = strdup (path->data);
+		if (fi->FE->FileType == FILETYPE_SYMLINK)
+		{
+			if ((!dup) || DumpFS_extract_job_append (&self->symlinks_count, &self->symlinks_size, &self->symlinks_data, dup, fi->FE))
+			{
+				free (dup);
+				self->retval = -1;
+				return -1;
+			}
+			self->symlinks_data[self->symlinks_count - 1].target = fi->Symlink;
+		} else {
+			if ((!dup) || DumpFS_extract_job_append (&self->files_count, &self->files_size, &self->files_data, dup, fi->FE))
+			{
+				free (dup);
+				self->retval = -1;
+				return -1;
+			}
+		}
+		DumpFS_path_truncate (path, length);
+	}
+	return 0;
+}
+
+/* Symlinks are created after all the files have been written */
+static void UDF_extract_symlink (struct UDF_extract_t *self, struct DumpFS_extract_job_t *job)
+{
+	if (!job->target)
+	{
+		fprintf (stderr, "symlink(\"???\", \"%s\") failed: target could not be decoded\n", job->path);
+		self->retval = -1;
+	} else if (DumpFS_extract_symlink (job->target, job->path))
+	{
+		self->retval = -1;
+	} else {
+		UDF_extract_attributes (-1, job->path, job->entry, 1);
+		self->symlinks++;
+	}
+}
+
+/* Walks the directory tree using an explicit stack, the same way as DumpFS_UDF3() */
+static void UDF_extract_tree (struct UDF_extract_t *self, struct UDF_FS_DirectoryEntry_t *d, const char *directory)
+{
+	struct DumpFS_path_t path;
+	struct DumpFS_UDF_frame_t *stack = 0;
+	int stack_count = 0;
+	int stack_size = 0;
+
+	if (DumpFS_path_init (&path, directory))
+	{
+		self->retval = -1;
+		return;
+	}
+
+	while (d)
+	{
+		if (d->DirectoryName && DumpFS_path_append (&path, d->DirectoryName, strlen (d->DirectoryName)))
+		{
+			self->retval = -1;
+			break;
+		}
+
+		/* the children of a directory that could not be created are skipped */
+		if (!UDF_extract_dir (self, d, &path, !stack_count))
+		{
+			if (stack_count >= stack_size)
+			{
+				struct DumpFS_UDF_frame_t *temp = realloc (stack, sizeof (stack[0]) * (stack_size + 32));
+				if (!temp)
+				{
+					fprintf (stderr, "UDF_extract_tree() realloc() failed\n");
+					self->retval = -1;
+					break;
+				}
+				stack = temp;
+				stack_size += 32;
+			}
+			stack[stack_count].parent = d;
+			stack[stack_count].next = 0;
+			stack[stack_count].path_length = path.length;
+			stack_count++;
+		}
+
+		d = 0;
+		while (stack_count && !d)
+		{
+			struct DumpFS_UDF_frame_t *top = &stack[stack_count - 1];
+
+			if (top->next >= top->parent->DirectoryEntries_N)
+			{
+				stack_count--;
+				continue;
+			}
+			d = &top->parent->DirectoryEntries[top->next++];
+			DumpFS_path_truncate (&path, top->path_length);
+			if (!DumpFS_extract_name_safe (d->DirectoryName, d->DirectoryName ? strlen (d->DirectoryName) : 0))
+			{
+				fprintf (stderr, "Skipping directory with an unsafe name in %s\n", path.data);
+				d = 0;
+			}
+		}
+	}
+
+	free (stack);
+	DumpFS_path_free (&path);
+}
+
+static int UDF_extract_cmp (const void *a, const void *b)
+{
+	const struct UDF_extract_extent_t *A = a;
+	const struct UDF_extract_extent_t *B = b;
+
+	if (A->Absolute < B->Absolute) return -1;
+	if (A->Absolute > B->Absolute) return 1;
+	if (A->file != B->file) return A->file - B->file;
+	return A->allocation - B->allocation;
+}
+
+/* Queues the recorded extents of file number i */
+static int UDF_extract_plan (struct UDF_extract_t *self, int i)
+{
+	struct UDF_FileEntry_t *FE = self->files_data[i].entry;
+	uint64_t offset = 0;
+	int j;
+
+	if (FE->InlineData)
+	{
+		return 0;
+	}
+	for (j=0; (j < FE->FileAllocations) && (offset < FE->InformationLength); j++)
+	{
+		struct FileAllocation *fa = &FE->FileAllocation[j];
+		uint64_t bytes = fa->InformationLength;
+		uint32_t absolute = 0xffffffff, run;
+
+		if (bytes > (FE->InformationLength - offset))
+		{
+			bytes = FE->InformationLength - offset;
+		}
+		if (fa->Partition && bytes)
+		{ /* partitions that are not backed directly by disc sectors are sorted last */
+			if ((!fa->Partition->MapSector) || fa->Partition->MapSector (self->disc, fa->Partition, fa->ExtentLocation, &absolute, &run))
+			{
+				absolute = 0xffffffff;
+			}
+			if (UDF_extract_extent_append (self, absolute, i, j, offset, bytes))
+			{
+				return -1;
+			}
+			self->files_data[i].extents_left++;
+		}
+		offset += fa->InformationLength;
+	}
+	return 0;
+}
+
+static int UDF_extract_copy (struct UDF_extract_t *self, int fd, struct UDF_extract_extent_t *extent)
+{
+	struct UDF_FileEntry_t *FE = self->files_data[extent->file].entry;
+	struct FileAllocation *fa = &FE->FileAllocation[extent->allocation];
+	uint32_t sector = fa->ExtentLocation;
+	uint64_t offset = extent->offset;
+	uint64_t left = extent->bytes;
+
+	while (left)
+	{
+		uint32_t n = ((left + SECTORSIZE - 1) / SECTORSIZE > UDF_EXTRACT_BATCH) ? UDF_EXTRACT_BATCH : (left + SECTORSIZE - 1) / SECTORSIZE;
+		uint64_t b = ((uint64_t)n * SECTORSIZE > left) ? left : (uint64_t)n * SECTORSIZE;
+
+		if (UDF_ReadSectors (self->disc, fa->Partition, sector, n, self->buffer))
+		{
+			fprintf (stderr, "Failed to read sector %" PRIu32 "\n", sector);
+			return -1;
+		}
+		if (DumpFS_extract_pwrite (fd, self->buffer, b, offset))
+		{
+			fprintf (stderr, "write() failed: %s\n", strerror (errno));
+			return -1;
+		}
+		sector += n;
+		offset += b;
+		left -= b;
+	}
+	return 0;
+}
+
+/* Sets the final size (the tail can be a hole), the attributes and closes the file */
+static void UDF_extract_finish (struct UDF_extract_t *self, int fd, int i)
+{
+	struct DumpFS_extract_job_t *job = &self->files_data[i];
+	struct UDF_FileEntry_t *FE = job->entry;
+
+	if (ftruncate (fd, FE->InformationLength))
+	{
+		fprintf (stderr, "ftruncate(\"%s\") failed: %s\n", job->path, strerror (errno));
+		self->retval = -1;
+	}
+	UDF_extract_attributes (fd, job->path, FE, 0);
+	if (close (fd))
+	{
+		fprintf (stderr, "close(\"%s\") failed: %s\n", job->path, strerror (errno));
+		self->retval = -1;
+	}
+}
+
+static void UDF_extract_files (struct UDF_extract_t *self)
+{
+	int fd = -1;
+	int current = -1;
+	int i;
+
+	for (i=0; i < self->files_count; i++)
+	{
+		if (UDF_extract_plan (self, i))
+		{
+			self->retval = -1;
+			return;
+		}
+	}
+	qsort (self->extents_data, self->extents_count, sizeof (self->extents_data[0]), UDF_extract_cmp);
+
+	/* files without recorded extents: empty, inline or only holes */
+	for (i=0; i < self->files_count; i++)
+	{
+		struct DumpFS_extract_job_t *job = &self->files_data[i];
+		struct UDF_FileEntry_t *FE = job->entry;
+
+		if (job->extents_left)
+		{
+			continue;
+		}
+		fd = DumpFS_extract_open (job->path, 1);
+		if (fd < 0)
+		{
+			self->retval = -1;
+			continue;
+		}
+		if (FE->InlineData && DumpFS_extract_pwrite (fd, FE->InlineData, FE->InformationLength, 0))
+		{
+			fprintf (stderr, "write(\"%s\") failed: %s\n", job->path, strerror (errno));
+			self->retval = -1;
+		}
+		UDF_extract_finish (self, fd, i);
+	}
+	fd = -1;
+
+	/* files are created when their first extent is reached, and completed after their last one. A file that is split around other
+	 * files is reopened, so only one file is open at a time */
+	for (i=0; i < self->extents_count; i++)
+	{
+		struct UDF_extract_extent_t *extent = &self->extents_data[i];
+		struct DumpFS_extract_job_t *job = &self->files_data[extent->file];
+
+		if (current != extent->file)
+		{
+			if (fd >= 0)
+			{
+				close (fd);
+			}
+			current = extent->file;
+			fd = DumpFS_extract_open (job->path, !job->created);
+			if (fd < 0)
+			{
+				self->retval = -1;
+			}
+			job->created = 1;
+		}
+		if ((fd >= 0) && UDF_extract_copy (self, fd, extent))
+		{
+			fprintf (stderr, "Failed to extract %s\n", job->path);
+			self->retval = -1;
+		}
+		job->extents_left--;
+		if ((!job->extents_left) && (fd >= 0))
+		{
+			UDF_extract_finish (self, fd, extent->file);
+			fd = -1;
+			current = -1;
+		}
+	}
+	if (fd >= 0)
+	{
+		close (fd);
+	}
+}
+
+int UDF_Extract (struct cdfs_disc_t *disc, const char *directory)
+{
+	struct UDF_extract_t self;
+	struct UDF_RootDirectory_t *rd = 0;
+	int i;
+
+	if (disc->udf_session && disc->udf_session->LogicalVolumes)
+	{
+		for (i=0; i < disc->udf_session->LogicalVolumes->RootDirectories_N; i++)
+		{ /* the first one is the most recent */
+			if (disc->udf_session->LogicalVolumes->RootDirectories[i].Root)
+			{
+				rd = &disc->udf_session->LogicalVolumes->RootDirectories[i];
+				break;
+			}
+		}
+	}
+	if (!rd)
+	{
+		fprintf (stderr, "No UDF filesystem to extract\n");
+		return -1;
+	}
+
+	memset (&self, 0, sizeof (self));
+	self.disc = disc;
+
+	self.buffer = malloc (UDF_EXTRACT_BATCH * SECTORSIZE);
+	if (!self.buffer)
+	{
+		fprintf (stderr, "UDF_Extract() malloc() failed\n");
+		return -1;
+	}
+
+	{
+		struct UDF_LogicalVolume_Common *lv = UDF_GetLogicalPartition (disc, rd->FileSetDescriptor_PartitionNumber);
+		if (lv)
+		{
+			lv->PartitionCommon.SelectSession (disc, &lv->PartitionCommon, rd->FileSetDescriptor_Partition_Session);
+		}
+	}
+
+	UDF_extract_tree (&self, rd->Root, directory);
+	UDF_extract_files (&self);
+	for (i=0; i < self.symlinks_count; i++)
+	{
+		UDF_extract_symlink (&self, &self.symlinks_data[i]);
+	}
+
+	for (i=self.directories_count - 1; i >= 0; i--)
+	{
+		if (self.directories_data[i].entry)
+		{
+			UDF_extract_attributes (-1, self.directories_data[i].path, self.directories_data[i].entry, 0);
+		}
+	}
+
+	TRACE ("Extracted %d files, %d symlinks and %d directories into %s\n", self.files_count, self.symlinks, self.directories_count, directory);
+
+	DumpFS_extract_jobs_free (self.files_count, self.files_data);
+	DumpFS_extract_jobs_free (self.directories_count, self.directories_data);
+	DumpFS_extract_jobs_free (self.symlinks_count, self.symlinks_data);
+	free (self.extents_data);
+	free (self.buffer);
+
+	return self.retval;
+}
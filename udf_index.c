@@ -0,0 +1,206 @@
+/* Index of the UDF file tree for the library API in libcdfs.c, see DumpFS_index_t. The entry of a directory node is its struct
+ * UDF_FS_DirectoryEntry_t, files and symlinks have their struct UDF_FS_FileEntry_t. The tree is already complete in memory after
+ * cdfs_disc_scan(), so this only gives it sorted names and inode numbers.
+ */
+
+struct UDF_index_t
+{
+	struct cdfs_disc_t   *disc;
+	struct DumpFS_index_t tree;
+};
+
+/* Adds the content of directory node n */
+static int UDF_index_directory (struct UDF_index_t *self, uint32_t n)
+{
+	struct UDF_FS_DirectoryEntry_t *d = self->tree.nodes_data[n].entry;
+	int i;
+
+	for (i=0; i < d->DirectoryEntries_N; i++)
+	{
+		struct UDF_FS_DirectoryEntry_t *child = &d->DirectoryEntries[i];
+		struct DumpFS_index_node_t *node;
+
+		if ((!child->FE) || (!DumpFS_extract_name_safe (child->DirectoryName, child->DirectoryName ? strlen (child->DirectoryName) : 0)))
+		{
+			continue;
+		}
+		node = DumpFS_index_append (&self->tree, child->DirectoryName, child, n, 'd');
+		if (!node)
+		{
+			return -1;
+		}
+		node->size = child->FE->InformationLength;
+	}
+	for (i=0; i < d->FileEntries_N; i++)
+	{
+		struct UDF_FS_FileEntry_t *fi = &d->FileEntries[i];
+		struct DumpFS_index_node_t *node;
+
+		if ((!fi->FE) || (!DumpFS_extract_name_safe (fi->FileName, fi->FileName ? strlen (fi->FileName) : 0)))
+		{
+			continue;
+		}
+		if ((fi->FE->FileType != FILETYPE_FILE) && (fi->FE->FileType != FILETYPE_SYMLINK))
+		{ /* device nodes, pipes and sockets */
+			continue;
+		}
+		node = DumpFS_index_append (&self->tree, fi->FileName, fi, n, (fi->FE->FileType == FILETYPE_SYMLINK) ? 'l' : '-');
+		if (!node)
+		{
+			return -1;
+		}
+		node->size = fi->FE->InformationLength;
+	}
+	DumpFS_index_sort (&self->tree, n);
+	return 0;
+}
+
+struct UDF_index_t *UDF_Index (struct cdfs_disc_t *disc)
+{
+	struct UDF_RootDirectory_t *rd = 0;
+	struct UDF_LogicalVolume_Common *lv;
+	struct UDF_index_t *self;
+	struct DumpFS_index_node_t *root;
+	uint32_t n;
+	int i;
+
+	if (disc->udf_session && disc->udf_session->LogicalVolumes)
+	{
+		for (i=0; i < disc->udf_session->LogicalVolumes->RootDirectories_N; i++)
+		{ /* the first one is the most recent */
+			if (disc->udf_session->LogicalVolumes->RootDirectories[i].Root && disc->udf_session->LogicalVolumes->RootDirectories[i].Root->FE)
+			{
+				rd = &disc->udf_session->LogicalVolumes->RootDirectories[i];
+				break;
+			}
+		}
+	}
+	if (!rd)
+	{
+		return 0;
+	}
+
+	self = calloc (sizeof (*self), 1);
+	if (!self)
+	{
+		fprintf (stderr, "UDF_Index() calloc() failed\n");
+		return 0;
+	}
+	self->disc = disc;
+
+	/* file data is read through the partition as it was for this file set, the same way as UDF_Extract() */
+	lv = UDF_GetLogicalPartition (disc, rd->FileSetDescriptor_PartitionNumber);
+	if (lv)
+	{
+		lv->PartitionCommon.SelectSession (disc, &lv->PartitionCommon, rd->FileSetDescriptor_Partition_Session);
+	}
+
+	root = DumpFS_index_append (&self->tree, "", rd->Root, 0, 'd');
+	if (!root)
+	{
+		UDF_Index_Free (self);
+		return 0;
+	}
+	root->size = rd->Root->FE->InformationLength;
+
+	for (n = 0; n < self->tree.nodes_count; n++)
+	{
+		if ((self->tree.nodes_data[n].type == 'd') && UDF_index_directory (self, n))
+		{
+			UDF_Index_Free (self);
+			return 0;
+		}
+	}
+
+	return self;
+}
+
+void UDF_Index_Free (struct UDF_index_t *self)
+{
+	if (!self)
+	{
+		return;
+	}
+	DumpFS_index_free (&self->tree);
+	free (self);
+}
+
+struct DumpFS_index_t *UDF_Index_Tree (struct UDF_index_t *self)
+{
+	return &self->tree;
+}
+
+static struct UDF_FileEntry_t *UDF_index_FE (struct UDF_index_t *self, uint32_t n)
+{
+	if (self->tree.nodes_data[n].type == 'd')
+	{
+		return ((struct UDF_FS_DirectoryEntry_t *)self->tree.nodes_data[n].entry)->FE;
+	}
+	return ((struct UDF_FS_FileEntry_t *)self->tree.nodes_data[n].entry)->FE;
+}
+
+int UDF_Index_Stat (struct UDF_index_t *self, uint32_t n, struct cdfs_stat_t *st)
+{
+	struct UDF_FileEntry_t *FE;
+
+	if (n >= self->tree.nodes_count)
+	{
+		return -1;
+	}
+	FE = UDF_index_FE (self, n);
+
+	st->mode = (st->mode & S_IFMT) | UDF_FE_mode (FE);
+	st->uid = FE->UID;
+	st->gid = FE->GID;
+	st->mtime = DumpFS_UDF_time (FE->mtime);
+	return 0;
+}
+
+ssize_t UDF_Index_Read (struct UDF_index_t *self, uint32_t n, void *buffer, size_t count, uint64_t offset)
+{
+	struct UDF_FileEntry_t *FE;
+
+	if ((n >= self->tree.nodes_count) || (self->tree.nodes_data[n].type != '-'))
+	{
+		return -1;
+	}
+	FE = UDF_index_FE (self, n);
+
+	if (offset >= FE->InformationLength)
+	{
+		return 0;
+	}
+	if (count > (FE->InformationLength - offset))
+	{
+		count = FE->InformationLength - offset;
+	}
+	if (UDF_FileEntry_Read (self->disc, FE, offset, buffer, count))
+	{
+		return -1;
+	}
+	return count;
+}
+
+ssize_t UDF_Index_Readlink (struct UDF_index_t *self, uint32_t n, char *buffer, size_t size)
+{
+	const char *target;
+	size_t length;
+
+	if ((n >= self->tree.nodes_count) || (self->tree.nodes_data[n].type != 'l'))
+	{
+		return -1;
+	}
+	target = ((struct UDF_FS_FileEntry_t *)self->tree.nodes_data[n].entry)->Symlink;
+	if (!target)
+	{ /* the target could not be decoded */
+		return -1;
+	}
+	length = strlen (target);
+	if (size)
+	{
+		size_t copy = (length < size) ? length : size - 1;
+		memcpy (buffer, target, copy);
+		buffer[copy] = 0;
+	}
+	return length;
+}